@@ -0,0 +1,319 @@
+/**
+ * @file main.cpp
+ * @brief csvパーサーのスループットとメモリ使用量を計測する
+ * @note 合成したコーパスを CsvParser_LoadFromData / CsvParser_LoadFromFile でパースし、
+ * 結果は1ケース1行のJSONで標準出力へ書き出す
+ *
+ * usage: CsvBenchmark [--quick] [--size BYTES[K|M|G]] [--columns N] [--field-length N] [--quote-ratio R] [--repeat N]
+ * @note --size などを指定した場合は、そのコーパスだけを計測する
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "BenchmarkReport.hpp"
+#include "MemoryUsage.hpp"
+#include "Csv/parser/CsvParser.h"
+#include "Csv/content/CsvContent.h"
+#include "Thread/ThreadPool.h"
+
+namespace {
+
+constexpr size_t MiB = 1024 * 1024;
+
+/**
+ * @brief コーパスの条件
+ */
+struct Corpus {
+	size_t size = 64 * MiB;
+	size_t columns = 8;
+	//! フィールドの平均の長さ
+	size_t fieldLength = 8;
+	//! 引用符で囲むフィールドの割合
+	double quoteRatio = 0.0;
+
+	void AddTo(JsonLine &line) const {
+		line.Add("bytes", (uint64_t)size)
+			.Add("columns", (uint64_t)columns)
+			.Add("field_length", (uint64_t)fieldLength)
+			.Add("quote_ratio", quoteRatio);
+	}
+};
+
+/**
+ * @brief 乱数を使わず、決まった列を作る
+ */
+class Sequence {
+public:
+	uint32_t Next() {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (uint32_t)(state >> 33);
+	}
+	//! [0, 1) の値
+	double Uniform() {
+		return (double)Next() / 2147483648.0;
+	}
+private:
+	uint64_t state = 1;
+};
+
+/**
+ * @brief コーパスを作る
+ * @note 引用符で囲むフィールドには、区切り文字、改行文字、"" のどれかを混ぜる
+ * @param corpus 条件
+ * @return csvデータ
+ */
+std::string Generate(const Corpus &corpus) {
+	static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	static const char *const SPECIALS[] = { ",", "\n", "\"\"" };
+	std::string data;
+	data.reserve(corpus.size + 1024);
+	Sequence sequence;
+	while (data.size() < corpus.size) {
+		for (size_t column = 0; column < corpus.columns; column++) {
+			if (column > 0) {
+				data += ',';
+			}
+			size_t length = 1 + sequence.Next() % (2 * corpus.fieldLength - 1);
+			bool isQuoted = sequence.Uniform() < corpus.quoteRatio;
+			size_t special = isQuoted ? sequence.Next() % length : length;
+			if (isQuoted) {
+				data += '"';
+			}
+			for (size_t i = 0; i < length; i++) {
+				if (i == special) {
+					data += SPECIALS[sequence.Next() % 3];
+				}
+				data += ALPHABET[sequence.Next() % (sizeof(ALPHABET) - 1)];
+			}
+			if (isQuoted) {
+				data += '"';
+			}
+		}
+		data += '\n';
+	}
+	return data;
+}
+
+/**
+ * @brief 計測方法
+ */
+enum class Mode {
+	//! CsvParser_LoadFromData
+	Data,
+	//! CsvParser_LoadFromData をスレッドプールで並列に
+	DataParallel,
+	//! CsvParser_LoadFromFile
+	File,
+	//! CsvParser_LoadFromFile を遅延モードで (行の索引だけ作る)
+	FileLazy,
+};
+
+const char *ToString(Mode mode) {
+	switch (mode) {
+	case Mode::Data:
+		return "data";
+	case Mode::DataParallel:
+		return "data_parallel";
+	case Mode::File:
+		return "file";
+	case Mode::FileLazy:
+		return "file_lazy";
+	}
+	return "";
+}
+
+/**
+ * @brief 1回分の計測結果
+ */
+struct Sample {
+	double seconds = 0;
+	size_t rows = 0;
+	uint64_t peakRssKiB = 0;
+	MemoryUsage::Counter allocations = {};
+	CsvReturnCode status = CSV_SUCCESS;
+};
+
+/**
+ * @brief 1回パースする
+ * @note ピークRSSはパーサーを破棄する前に読む
+ * @param mode 計測方法
+ * @param data csvデータ
+ * @param path csvファイル
+ * @param pool スレッドプール
+ * @return 計測結果
+ */
+Sample ParseOnce(Mode mode, const std::string &data, const std::string &path, ThreadPool_t *pool) {
+	CsvProperties_t props = {};
+	props.isLazy = (mode == Mode::FileLazy);
+	CsvParser_t *parser = CsvParser_Init(&props);
+	if (mode == Mode::DataParallel) {
+		CsvParser_SetThreadPool(parser, pool);
+	}
+	Sample sample;
+	MemoryUsage::ResetPeakRss();
+	MemoryUsage::Counter start = MemoryUsage::Counter::Now();
+	Stopwatch stopwatch;
+	if ((mode == Mode::File) || (mode == Mode::FileLazy)) {
+		sample.status = CsvParser_LoadFromFile(parser, path.c_str());
+	} else {
+		sample.status = CsvParser_LoadFromData(parser, data.c_str(), data.length());
+	}
+	sample.seconds = stopwatch.Seconds();
+	sample.allocations = MemoryUsage::Counter::Now().Since(start);
+	sample.peakRssKiB = MemoryUsage::PeakRssKiB();
+	sample.rows = CsvContent_GetRowCount(CsvParser_GetContent(parser));
+	CsvParser_Destroy(parser);
+	return sample;
+}
+
+/**
+ * @brief コーパスを計測方法ごとにパースする
+ * @note 繰り返した中で最も速かった回を書き出す
+ * @param corpus 条件
+ * @param repeat 繰り返し回数
+ * @param pool スレッドプール
+ */
+void Parse(const Corpus &corpus, int repeat, ThreadPool_t *pool) {
+	std::string data = Generate(corpus);
+	char path[] = "/tmp/CsvBenchmarkXXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		perror("mkstemp");
+		return;
+	}
+	for (size_t written = 0; written < data.length();) {
+		ssize_t size = write(fd, data.c_str() + written, data.length() - written);
+		if (size <= 0) {
+			perror("write");
+			break;
+		}
+		written += (size_t)size;
+	}
+	close(fd);
+
+	for (Mode mode : { Mode::Data, Mode::DataParallel, Mode::File, Mode::FileLazy }) {
+		Sample best;
+		for (int i = 0; i < repeat; i++) {
+			Sample sample = ParseOnce(mode, data, path, pool);
+			if ((i == 0) || (sample.seconds < best.seconds)) {
+				best = sample;
+			}
+		}
+		JsonLine line("csv_parse");
+		line.Add("mode", ToString(mode));
+		corpus.AddTo(line);
+		line.Add("threads", (mode == Mode::DataParallel) ? (uint64_t)ThreadPool_GetNumThreads(pool) : (uint64_t)1)
+			.Add("status", (int)best.status)
+			.Add("rows", (uint64_t)best.rows)
+			.Add("seconds", best.seconds)
+			.Add("mb_per_sec", (double)data.length() / MiB / best.seconds)
+			.Add("rows_per_sec", (double)best.rows / best.seconds)
+			.Add("peak_rss_kib", best.peakRssKiB)
+			.Add("allocations", best.allocations.allocations)
+			.Add("allocated_bytes", best.allocations.bytes)
+			.Print();
+	}
+	unlink(path);
+}
+
+/**
+ * @brief サイズを読む
+ * @param text "64M" のような文字列 (K, M, G は1024の累乗)
+ * @return サイズ
+ */
+size_t ParseSize(const char *text) {
+	char *end = nullptr;
+	size_t size = strtoull(text, &end, 10);
+	switch (*end) {
+	case 'G':
+	case 'g':
+		return size * 1024 * MiB;
+	case 'M':
+	case 'm':
+		return size * MiB;
+	case 'K':
+	case 'k':
+		return size * 1024;
+	default:
+		return size;
+	}
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	bool quick = false;
+	bool isCustom = false;
+	int repeat = 3;
+	Corpus custom;
+	for (int i = 1; i < argc; i++) {
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : "0";
+		if (strcmp(option, "--quick") == 0) {
+			quick = true;
+			continue;
+		}
+		if (strcmp(option, "--size") == 0) {
+			custom.size = ParseSize(value);
+		} else if (strcmp(option, "--columns") == 0) {
+			custom.columns = strtoull(value, nullptr, 10);
+		} else if (strcmp(option, "--field-length") == 0) {
+			custom.fieldLength = strtoull(value, nullptr, 10);
+		} else if (strcmp(option, "--quote-ratio") == 0) {
+			custom.quoteRatio = strtod(value, nullptr);
+		} else if (strcmp(option, "--repeat") == 0) {
+			repeat = atoi(value);
+			i++;
+			continue;
+		} else {
+			fprintf(stderr, "unknown option: %s\n", option);
+			return 1;
+		}
+		isCustom = true;
+		i++;
+	}
+	if ((custom.columns == 0) || (custom.fieldLength == 0) || (custom.size == 0) || (repeat <= 0)) {
+		fprintf(stderr, "invalid corpus\n");
+		return 1;
+	}
+	ThreadPool_t pool;
+	unsigned numThreads = std::thread::hardware_concurrency();
+	ThreadPool_Init(&pool, (uint16_t)(numThreads ? numThreads : 1));
+
+	if (isCustom) {
+		Parse(custom, repeat, &pool);
+		ThreadPool_Destroy(&pool, true);
+		return 0;
+	}
+	repeat = quick ? 1 : repeat;
+	Corpus base;
+	base.size = quick ? MiB : 64 * MiB;
+	for (size_t size : { MiB, 16 * MiB, 256 * MiB }) {
+		Corpus corpus = base;
+		corpus.size = quick ? MiB : size;
+		Parse(corpus, repeat, &pool);
+		if (quick) {
+			break;
+		}
+	}
+	for (size_t columns : { 2, 32, 128 }) {
+		Corpus corpus = base;
+		corpus.columns = columns;
+		Parse(corpus, repeat, &pool);
+	}
+	for (size_t fieldLength : { 2, 32, 256 }) {
+		Corpus corpus = base;
+		corpus.fieldLength = fieldLength;
+		Parse(corpus, repeat, &pool);
+	}
+	for (double quoteRatio : { 0.1, 0.5, 1.0 }) {
+		Corpus corpus = base;
+		corpus.quoteRatio = quoteRatio;
+		Parse(corpus, repeat, &pool);
+	}
+	ThreadPool_Destroy(&pool, true);
+	return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file main.cpp
+ * @brief 並行モードの辞書を読むスループットが読み手の数に応じて伸びるかを計測する
+ * @note 結果は1ケース1行のJSONで標準出力へ書き出す。
+ * scaling は1スレッドのときの何倍読めたかで、読み手どうしが競合しなければスレッド数に近づく
+ *
+ * usage: ExtendedTypesBenchmark [--quick]
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include "BenchmarkReport.hpp"
+#include "ExtendedTypes/Dictionary.h"
+
+namespace {
+
+/**
+ * @brief 計測条件
+ */
+struct Scenario {
+	size_t keys = 4096;
+	size_t readers = 1;
+	//! 読み手1スレッドあたりの検索回数
+	size_t lookups = 1000000;
+	//! 読んでいる間に追加と削除を繰り返す書き手を動かす
+	bool writing = false;
+
+	void AddTo(JsonLine &line) const {
+		line.Add("keys", (uint64_t)keys)
+			.Add("readers", (uint64_t)readers)
+			.Add("lookups_per_reader", (uint64_t)lookups)
+			.Add("writing", writing ? "true" : "false");
+	}
+};
+
+/**
+ * @brief Dictionary_FindCopyByKey を複数スレッドで呼んだときのスループット
+ * @param scenario 計測条件
+ * @return 1秒あたりの検索回数
+ */
+double ReadThroughput(const Scenario &scenario) {
+	Dictionary_t dict;
+	Dictionary_InitConcurrent(&dict, scenario.keys, 32, sizeof(uint64_t));
+	std::vector<std::string> names;
+	std::vector<DictionaryKey_t> keys;
+	for (size_t i = 0; i < scenario.keys; i++) {
+		names.push_back("key" + std::to_string(i));
+	}
+	for (size_t i = 0; i < scenario.keys; i++) {
+		keys.push_back(Dictionary_MakeKey(names[i].c_str(), names[i].length()));
+		uint64_t value = i;
+		Dictionary_AddByKey(&dict, &keys[i], &value, sizeof(value));
+	}
+
+	std::atomic<bool> start = false;
+	std::atomic<bool> stop = false;
+	std::atomic<uint64_t> found = 0;
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < scenario.readers; t++) {
+		threads.emplace_back([&, t] {
+			while (!start) {
+				std::this_thread::yield();
+			}
+			uint64_t hits = 0;
+			size_t index = t * 7919;
+			for (size_t i = 0; i < scenario.lookups; i++) {
+				uint64_t value;
+				index = (index + 1) % scenario.keys;
+				if (Dictionary_FindCopyByKey(&dict, &keys[index], &value, sizeof(value), NULL) == DICTIONARY_FOUND) {
+					hits++;
+				}
+			}
+			found += hits;
+		});
+	}
+	std::thread writer;
+	if (scenario.writing) {
+		writer = std::thread([&] {
+			while (!start) {
+				std::this_thread::yield();
+			}
+			for (uint64_t i = 0; !stop; i++) {
+				std::string name = "churn" + std::to_string(i & 255);
+				Dictionary_Add(&dict, name.c_str(), &i, sizeof(i));
+				Dictionary_Remove(&dict, name.c_str());
+			}
+		});
+	}
+	Stopwatch stopwatch;
+	start = true;
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	double seconds = stopwatch.Seconds();
+	stop = true;
+	if (writer.joinable()) {
+		writer.join();
+	}
+	Dictionary_Destroy(&dict);
+
+	uint64_t lookups = (uint64_t)(scenario.readers * scenario.lookups);
+	if (found != lookups) {
+		fprintf(stderr, "lost %llu lookups\n", (unsigned long long)(lookups - found));
+	}
+	return (double)lookups / seconds;
+}
+
+/**
+ * @brief 読み手を増やしたときの伸び
+ * @param base 計測条件 (readers は上書きする)
+ * @param maxReaders 最大の読み手の数
+ */
+void ReadScaling(const Scenario &base, size_t maxReaders) {
+	double single = 0.0;
+	for (size_t readers = 1; readers <= maxReaders; readers *= 2) {
+		Scenario scenario = base;
+		scenario.readers = readers;
+		double lookupsPerSecond = ReadThroughput(scenario);
+		if (readers == 1) {
+			single = lookupsPerSecond;
+		}
+		JsonLine line("concurrent_read");
+		scenario.AddTo(line);
+		line.Add("hardware_threads", (uint64_t)std::thread::hardware_concurrency())
+			.Add("lookups_per_sec", lookupsPerSecond)
+			.Add("scaling", lookupsPerSecond / single)
+			.Print();
+	}
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	bool quick = (argc > 1) && (strcmp(argv[1], "--quick") == 0);
+	Scenario base;
+	base.lookups = quick ? 20000 : 2000000;
+	size_t maxReaders = std::thread::hardware_concurrency();
+	maxReaders = (maxReaders < 1) ? 1 : ((maxReaders > 16) ? 16 : maxReaders);
+
+	ReadScaling(base, maxReaders);
+	base.writing = true;
+	ReadScaling(base, maxReaders);
+	return 0;
+}
@@ -0,0 +1,327 @@
+/**
+ * @file main.cpp
+ * @brief パブリッシュ/サブスクライブのスループットとレイテンシを計測する
+ * @note 結果は1ケース1行のJSONで標準出力へ書き出す
+ *
+ * usage: PublisherSubscriberBenchmark [--quick]
+ */
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include "BenchmarkReport.hpp"
+#include "PublisherSubscriber/Publisher.h"
+#include "PublisherSubscriber/Broker.h"
+#include "PublisherSubscriber/Subscription.h"
+#include "PublisherSubscriber/PublishPayload.h"
+
+namespace {
+
+constexpr PublishMessageAttribute MATCHED_ATTRIBUTE = 0;
+
+/**
+ * @brief 計測条件
+ */
+struct Scenario {
+	size_t subscribers = 64;
+	//! 発行したメッセージにマッチするサブスクライバーの割合
+	double selectivity = 1.0;
+	//! NACKを返す割合
+	double nackRate = 0.0;
+	size_t payloadSize = 0;
+	size_t messages = 100000;
+
+	void AddTo(JsonLine &line) const {
+		line.Add("subscribers", (uint64_t)subscribers)
+			.Add("selectivity", selectivity)
+			.Add("nack_rate", nackRate)
+			.Add("payload_bytes", (uint64_t)payloadSize)
+			.Add("messages", (uint64_t)messages);
+	}
+};
+
+/**
+ * @brief 計測用のサブスクライバー
+ */
+struct Sink {
+	Subscriber_t subscriber;
+	//! NACKを返すしきい値 (0: 返さない)
+	uint32_t nackThreshold = 0;
+	uint32_t sequence = 0;
+	uint64_t received = 0;
+	uint64_t checksum = 0;
+	//! 発行時刻[ns] (0: 計測しない)
+	const uint64_t *publishedAt = nullptr;
+	LatencyHistogram *latency = nullptr;
+
+	Sink() {
+		Subscriber_Init(&subscriber, Update, this);
+	}
+	~Sink() {
+		Subscriber_Destroy(&subscriber);
+	}
+	static SubscriberReply Update(const PublishContent_t *content, void *arg) {
+		Sink *self = (Sink *)arg;
+		if (self->latency && *self->publishedAt) {
+			self->latency->Record(Stopwatch::Now() - *self->publishedAt);
+		}
+		self->received++;
+		if (content->payload) {
+			const uint8_t *data = (const uint8_t *)PublishPayload_Data(content->payload);
+			self->checksum += data[0] + data[PublishPayload_Size(content->payload) - 1];
+		}
+		// 乱数を使わず、決まった割合でNACKする
+		self->sequence = self->sequence * 1664525u + 1013904223u;
+		if (self->nackThreshold && (self->sequence < self->nackThreshold)) {
+			return SUBSCRIBER_NACK;
+		}
+		return SUBSCRIBER_ACK;
+	}
+};
+
+/**
+ * @brief 計測対象のブローカーと購読者一式
+ */
+class Fixture {
+public:
+	Publisher_t publisher;
+	PublishPayloadPool_t pool;
+	std::vector<std::unique_ptr<Sink>> sinks;
+	uint64_t publishedAt = 0;
+
+	explicit Fixture(const Scenario &scenario, LatencyHistogram *latency = nullptr) {
+		Publisher_Init(&publisher, scenario.subscribers);
+		PublishPayloadPool_Init(&pool);
+		// NACKしたメッセージは再配信スレッドに拾われないよう十分先に保留する
+		BrokerRetryPolicy_t policy = { .initialInterval = 3600 * 1000, .maxInterval = 3600 * 1000, .maxAttempts = 0 };
+		Publisher_SetRetryPolicy(&publisher, &policy);
+		size_t matched = (size_t)((double)scenario.subscribers * scenario.selectivity + 0.5);
+		for (size_t i = 0; i < scenario.subscribers; i++) {
+			auto sink = std::make_unique<Sink>();
+			sink->nackThreshold = (uint32_t)(scenario.nackRate * 4294967295.0);
+			sink->latency = latency;
+			sink->publishedAt = &publishedAt;
+			PublishMessageAttribute attribute = (i < matched) ? MATCHED_ATTRIBUTE : (PublishMessageAttribute)(i + 1);
+			Publisher_Subscribe(&publisher, &sink->subscriber, attribute);
+			sinks.push_back(std::move(sink));
+		}
+	}
+	~Fixture() {
+		Publisher_Destroy(&publisher);
+		PublishPayloadPool_Destroy(&pool);
+	}
+	void Publish(PublishMessage message, size_t payloadSize) {
+		PublishContent_t content = { .message = message, .attribute = MATCHED_ATTRIBUTE, .payload = nullptr };
+		if (payloadSize) {
+			content.payload = PublishPayloadPool_Allocate(&pool, payloadSize);
+			memset(PublishPayload_Data(content.payload), (int)message, payloadSize);
+		}
+		Publisher_Publish(&publisher, &content);
+		PublishPayload_Release(content.payload);
+	}
+	uint64_t Deliveries() const {
+		uint64_t total = 0;
+		for (auto &sink : sinks) {
+			total += sink->received;
+		}
+		return total;
+	}
+};
+
+/**
+ * @brief Broker_Publish のスループット
+ * @param scenario 計測条件
+ */
+void Throughput(const Scenario &scenario) {
+	Fixture fixture(scenario);
+	for (size_t i = 0; i < scenario.messages / 10; i++) {
+		fixture.Publish(i, scenario.payloadSize);
+	}
+	uint64_t warmup = fixture.Deliveries();
+	Stopwatch stopwatch;
+	for (size_t i = 0; i < scenario.messages; i++) {
+		fixture.Publish(i, scenario.payloadSize);
+	}
+	double seconds = stopwatch.Seconds();
+	uint64_t deliveries = fixture.Deliveries() - warmup;
+	JsonLine line("publish_throughput");
+	scenario.AddTo(line);
+	line.Add("deliveries", deliveries)
+		.Add("seconds", seconds)
+		.Add("messages_per_sec", (double)scenario.messages / seconds)
+		.Add("deliveries_per_sec", (double)deliveries / seconds)
+		.Print();
+}
+
+/**
+ * @brief 発行してから各サブスクライバーに届くまでのレイテンシ
+ * @param scenario 計測条件
+ */
+void Latency(const Scenario &scenario) {
+	LatencyHistogram histogram;
+	Fixture fixture(scenario, &histogram);
+	for (size_t i = 0; i < scenario.messages; i++) {
+		fixture.publishedAt = Stopwatch::Now();
+		fixture.Publish(i, scenario.payloadSize);
+	}
+	JsonLine line("delivery_latency");
+	scenario.AddTo(line);
+	histogram.AddTo(line);
+	line.Print();
+}
+
+/**
+ * @brief Subscription_Match と Subscription_NextMatch の走査コスト
+ * @param accounts アカウント数
+ * @param selectivity マッチする割合
+ * @param iterations 繰り返し回数
+ */
+void Match(size_t accounts, double selectivity, size_t iterations) {
+	Subscription_t subscription;
+	Subscription_Init(&subscription, accounts);
+	Subscriber_t subscriber = {};
+	size_t matched = (size_t)((double)accounts * selectivity + 0.5);
+	for (size_t i = 0; i < accounts; i++) {
+		Subscription_Contract(&subscription, &subscriber, (i < matched) ? MATCHED_ATTRIBUTE : (PublishMessageAttribute)(i + 1));
+	}
+	std::vector<SubscriptionAccountId> ids(accounts);
+	uint64_t found = 0;
+	Stopwatch matchWatch;
+	for (size_t i = 0; i < iterations; i++) {
+		found += (uint64_t)Subscription_Match(&subscription, MATCHED_ATTRIBUTE, ids.data(), ids.size());
+	}
+	double matchSeconds = matchWatch.Seconds();
+	Stopwatch nextWatch;
+	for (size_t i = 0; i < iterations; i++) {
+		SubscriptionAccountId cursor = 0;
+		while (Subscription_NextMatch(&subscription, MATCHED_ATTRIBUTE, &cursor)) {
+			found++;
+		}
+	}
+	double nextSeconds = nextWatch.Seconds();
+	Subscription_Destroy(&subscription);
+	JsonLine("subscription_match")
+		.Add("accounts", (uint64_t)accounts)
+		.Add("selectivity", selectivity)
+		.Add("iterations", (uint64_t)iterations)
+		.Add("found", found)
+		.Add("match_ns_per_call", matchSeconds * 1e9 / (double)iterations)
+		.Add("next_match_ns_per_scan", nextSeconds * 1e9 / (double)iterations)
+		.Print();
+}
+
+/**
+ * @brief 保留中のメッセージを再配信する Republish のコスト
+ * @note 再配信時刻前のメッセージの走査と、再配信してACKされるまでの両方を計る
+ * @param pending 保留するメッセージ数
+ */
+void Republish(size_t pending) {
+	Broker_t broker;
+	Broker_Init(&broker, pending);	// 保留できる数はサブスクライバーの最大数に比例する
+	struct Counter {
+		Subscriber_t subscriber;
+		std::atomic<uint64_t> calls = 0;
+		std::atomic<bool> acknowledge = false;
+	} counter;
+	Subscriber_Init(&counter.subscriber, [](const PublishContent_t *content, void *arg) {
+		Counter *self = (Counter *)arg;
+		self->calls++;
+		return self->acknowledge ? SUBSCRIBER_ACK : SUBSCRIBER_NACK;
+	}, &counter);
+	Broker_Subscribe(&broker, &counter.subscriber, MATCHED_ATTRIBUTE);
+
+	BrokerRetryPolicy_t waiting = { .initialInterval = 3600 * 1000, .maxInterval = 3600 * 1000, .maxAttempts = 0 };
+	Broker_SetRetryPolicy(&broker, &waiting);
+	for (size_t i = 0; i < pending; i++) {
+		PublishContent_t content = { .message = i, .attribute = MATCHED_ATTRIBUTE, .payload = nullptr };
+		Broker_Publish(&broker, &content);
+	}
+	constexpr int scans = 20;
+	Stopwatch scanWatch;
+	size_t held = 0;
+	for (int i = 0; i < scans; i++) {
+		held = Broker_Redeliver(&broker);
+	}
+	double scanSeconds = scanWatch.Seconds() / scans;
+
+	Broker_Destroy(&broker);
+
+	// すぐに再配信時刻を迎えるよう保留し直し、すべてACKされるまでの時間を計る
+	Broker_Init(&broker, pending);
+	Broker_Subscribe(&broker, &counter.subscriber, MATCHED_ATTRIBUTE);
+	BrokerRetryPolicy_t immediate = { .initialInterval = 1, .maxInterval = 1, .maxAttempts = 0 };
+	Broker_SetRetryPolicy(&broker, &immediate);
+	for (size_t i = 0; i < pending; i++) {
+		PublishContent_t content = { .message = i, .attribute = MATCHED_ATTRIBUTE, .payload = nullptr };
+		Broker_Publish(&broker, &content);
+	}
+	uint64_t before = counter.calls;
+	Stopwatch drainWatch;
+	counter.acknowledge = true;
+	while (Broker_Redeliver(&broker) != 0) {
+		std::this_thread::yield();
+	}
+	double drainSeconds = drainWatch.Seconds();
+	uint64_t redelivered = counter.calls - before;
+	Broker_Destroy(&broker);
+	Subscriber_Destroy(&counter.subscriber);
+
+	JsonLine("republish")
+		.Add("pending", (uint64_t)held)
+		.Add("scan_ns_per_message", scanSeconds * 1e9 / (double)(held ? held : 1))
+		.Add("redelivered", redelivered)
+		.Add("drain_seconds", drainSeconds)
+		.Add("redeliveries_per_sec", (double)redelivered / drainSeconds)
+		.Print();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	bool quick = (argc > 1) && (strcmp(argv[1], "--quick") == 0);
+	size_t messages = quick ? 2000 : 100000;
+	Scenario base;
+	base.messages = messages;
+
+	for (size_t subscribers : { 1, 16, 256, 4096 }) {
+		Scenario scenario = base;
+		scenario.subscribers = subscribers;
+		scenario.messages = messages / (subscribers > 256 ? 16 : 1);
+		Throughput(scenario);
+	}
+	for (double selectivity : { 1.0, 0.1, 0.01 }) {
+		Scenario scenario = base;
+		scenario.subscribers = 1024;
+		scenario.selectivity = selectivity;
+		scenario.messages = messages / 4;
+		Throughput(scenario);
+	}
+	for (double nackRate : { 0.0, 0.01, 0.1 }) {
+		Scenario scenario = base;
+		scenario.nackRate = nackRate;
+		Throughput(scenario);
+	}
+	for (size_t payloadSize : { 0, 64, 1024, 16384 }) {
+		Scenario scenario = base;
+		scenario.payloadSize = payloadSize;
+		Throughput(scenario);
+	}
+	for (size_t subscribers : { 1, 64, 1024 }) {
+		Scenario scenario = base;
+		scenario.subscribers = subscribers;
+		scenario.messages = messages / (subscribers > 64 ? 16 : 1);
+		Latency(scenario);
+	}
+	for (size_t accounts : { 64, 1024, 65536 }) {
+		for (double selectivity : { 1.0, 0.01 }) {
+			Match(accounts, selectivity, quick ? 100 : (size_t)(1 << 24) / accounts);
+		}
+	}
+	for (size_t pending : { 16, 1024 }) {
+		Republish(pending);
+	}
+	return 0;
+}
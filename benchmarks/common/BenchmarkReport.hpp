@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+/**
+ * @brief 1行のJSONとして結果を書き出す
+ * @note 回帰を機械的に比較できるよう、1ケース1行で標準出力へ出す
+ */
+class JsonLine {
+public:
+	explicit JsonLine(const char *benchmark) {
+		Add("benchmark", benchmark);
+	}
+	JsonLine &Add(const char *key, const char *value) {
+		Key(key);
+		text += '"';
+		text += value;
+		text += '"';
+		return *this;
+	}
+	JsonLine &Add(const char *key, const std::string &value) {
+		return Add(key, value.c_str());
+	}
+	JsonLine &Add(const char *key, double value) {
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%.6g", value);
+		Key(key);
+		text += buffer;
+		return *this;
+	}
+	JsonLine &Add(const char *key, uint64_t value) {
+		Key(key);
+		text += std::to_string(value);
+		return *this;
+	}
+	JsonLine &Add(const char *key, int value) {
+		return Add(key, (uint64_t)value);
+	}
+	JsonLine &AddRaw(const char *key, const std::string &json) {
+		Key(key);
+		text += json;
+		return *this;
+	}
+	void Print() {
+		printf("{%s}\n", text.c_str());
+		fflush(stdout);
+	}
+private:
+	std::string text;
+	void Key(const char *key) {
+		if (!text.empty()) {
+			text += ',';
+		}
+		text += '"';
+		text += key;
+		text += "\":";
+	}
+};
+
+/**
+ * @brief 2のべき乗で区切ったレイテンシのヒストグラム[ns]
+ */
+class LatencyHistogram {
+public:
+	static constexpr int NUM_BUCKETS = 48;
+
+	void Record(uint64_t nanoSeconds) {
+		int bucket = 0;
+		while ((bucket < NUM_BUCKETS - 1) && ((1ULL << bucket) < nanoSeconds)) {
+			bucket++;
+		}
+		buckets[bucket]++;
+		samples.push_back(nanoSeconds);
+	}
+	uint64_t Percentile(double ratio) {
+		if (samples.empty()) {
+			return 0;
+		}
+		if (!sorted) {
+			std::sort(samples.begin(), samples.end());
+			sorted = true;
+		}
+		size_t index = (size_t)(ratio * (double)(samples.size() - 1));
+		return samples[index];
+	}
+	size_t Count() const {
+		return samples.size();
+	}
+	//! [[上限ns, 件数], ...] の形式 (件数0の区間は省く)
+	std::string ToJson() const {
+		std::string json = "[";
+		for (int i = 0; i < NUM_BUCKETS; i++) {
+			if (buckets[i] == 0) {
+				continue;
+			}
+			if (json.size() > 1) {
+				json += ',';
+			}
+			json += "[" + std::to_string(1ULL << i) + "," + std::to_string(buckets[i]) + "]";
+		}
+		return json + "]";
+	}
+	void AddTo(JsonLine &line) {
+		line.Add("samples", (uint64_t)Count())
+			.Add("p50_ns", Percentile(0.5))
+			.Add("p99_ns", Percentile(0.99))
+			.Add("p999_ns", Percentile(0.999))
+			.Add("max_ns", Percentile(1.0))
+			.AddRaw("histogram", ToJson());
+	}
+private:
+	uint64_t buckets[NUM_BUCKETS] = {};
+	std::vector<uint64_t> samples;
+	bool sorted = false;
+};
+
+/**
+ * @brief 経過時間を計る
+ */
+class Stopwatch {
+public:
+	using Clock = std::chrono::steady_clock;
+	Stopwatch() : start(Clock::now()) {}
+	static uint64_t Now() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+	}
+	double Seconds() const {
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+private:
+	Clock::time_point start;
+};
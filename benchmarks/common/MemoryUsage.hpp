@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * @file MemoryUsage.hpp
+ * @brief ピークRSSとヒープ確保回数を計る
+ * @note malloc/calloc/realloc を置き換えて数えるので、1つの実行ファイルで1回だけインクルードすること
+ * @note glibc の __libc_* を呼ぶので glibc 専用。posix_memalign などは数えない
+ */
+
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *pointer, size_t size);
+}
+
+namespace MemoryUsage {
+
+inline std::atomic<uint64_t> totalAllocations{ 0 };
+inline std::atomic<uint64_t> totalBytes{ 0 };
+
+/**
+ * @brief 計測区間の確保回数
+ */
+struct Counter {
+	uint64_t allocations;
+	uint64_t bytes;
+
+	static Counter Now() {
+		return { totalAllocations.load(std::memory_order_relaxed), totalBytes.load(std::memory_order_relaxed) };
+	}
+	Counter Since(const Counter &start) const {
+		return { allocations - start.allocations, bytes - start.bytes };
+	}
+};
+
+/**
+ * @brief ピークRSSを現在のRSSに戻す
+ * @note /proc/self/clear_refs に 5 を書く (Linux 4.0以降)
+ * @return false: 戻せない (ピークはプロセス開始からの値になる)
+ */
+inline bool ResetPeakRss() {
+	FILE *fp = fopen("/proc/self/clear_refs", "w");
+	if (!fp) {
+		return false;
+	}
+	bool isReset = (fputs("5", fp) >= 0);
+	return (fclose(fp) == 0) && isReset;
+}
+
+/**
+ * @brief ピークRSS[KiB]
+ * @return 0: 取得できない
+ */
+inline uint64_t PeakRssKiB() {
+	FILE *fp = fopen("/proc/self/status", "r");
+	if (!fp) {
+		return 0;
+	}
+	char line[256];
+	uint64_t peak = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		if (strncmp(line, "VmHWM:", 6) == 0) {
+			peak = strtoull(line + 6, nullptr, 10);
+			break;
+		}
+	}
+	fclose(fp);
+	return peak;
+}
+
+inline void Count(size_t size) {
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace MemoryUsage
+
+extern "C" void *malloc(size_t size) {
+	MemoryUsage::Count(size);
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+	MemoryUsage::Count(count * size);
+	return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+	MemoryUsage::Count(size);
+	return __libc_realloc(pointer, size);
+}
@@ -18,6 +18,10 @@ extern "C" {
 		CSV_INVALID_PARAMETER,
 		//! 無効な文字コード
 		CSV_INVALID_CHAR_CODE,
+		//! 無効な書式 (閉じていない引用符)
+		CSV_INVALID_FORMAT,
+		//! 書き込みに失敗した (書き込み先のバッファが足りない場合を含む)
+		CSV_WRITE_ERROR,
 	} CsvReturnCode;
 
 #ifdef __cplusplus
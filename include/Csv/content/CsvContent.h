@@ -11,6 +11,27 @@ extern "C" {
 #include <stdlib.h>
 #include <stdbool.h>
 #include "../content/line/CsvLineCollection.h"
+#include "../../ExtendedTypes/Dictionary.h"
+
+	struct CsvLazyRows_t;
+
+	/**
+	 * @brief 行を読み込んでフィールドに分ける関数
+	 * @note 返した行は、次に別の行を読み込むまで有効
+	 * @return 行 (NULL: 範囲外)
+	 */
+	typedef const CsvLine_t *(*CsvLoadRowFunction)(struct CsvLazyRows_t *rows, size_t row);
+
+	/**
+	 * @brief 触れた行だけをフィールドに分ける行の集まり
+	 * @note 実装はこの構造体を先頭のメンバーに持つ
+	 */
+	typedef struct CsvLazyRows_t {
+		//! 行数
+		size_t numRows;
+		CsvLoadRowFunction load;
+	} CsvLazyRows_t;
+
 	/**
 	 * @brief 制御ブロック
 	 */
@@ -19,13 +40,36 @@ extern "C" {
 		//! @{
 
 		//! 行のリスト
+		//! @note パーサーが作る行は items を参照するビューで、アイテムを個別に確保しない
 		CsvLineCollection_t lines;
+		//! 全行のアイテムを先頭から順に並べた配列
+		CsvItemCollection_t items;
+		//! 作成中の行の最初のアイテムの位置
+		size_t lineItemStart;
+		//! 行のアイテムの参照を設定済み (以降はアイテムを追加できない)
+		bool isFinalized;
+		//! 列名から列への対応 (hasColumnNames が true のとき有効)
+		Dictionary_t columnNames;
+		bool hasColumnNames;
+		//! 遅延して分ける行 (NULL: すべての行を lines に持つ)
+		CsvLazyRows_t *lazyRows;
 
 		//! @}
 	} CsvContent_t;
 
 	extern void CsvContent_Init(CsvContent_t *self);
 	extern void CsvContent_MoveBackLine(CsvContent_t *self, CsvLine_t *line);
+	extern bool CsvContent_MoveBackContent(CsvContent_t *self, CsvContent_t *content);
+	extern bool CsvContent_AddItem(CsvContent_t *self, char *text);
+	extern bool CsvContent_EndLine(CsvContent_t *self);
+	extern void CsvContent_DiscardLine(CsvContent_t *self);
+	extern void CsvContent_Finalize(CsvContent_t *self);
+	extern void CsvContent_SetLazyRows(CsvContent_t *self, CsvLazyRows_t *rows);
+	extern void CsvContent_IndexHeader(CsvContent_t *self);
+	extern bool CsvContent_FindColumn(const CsvContent_t *self, const char *name, size_t *column);
+	extern size_t CsvContent_GetRowCount(const CsvContent_t *self);
+	extern size_t CsvContent_GetColumnCount(const CsvContent_t *self, size_t row);
+	extern const char *CsvContent_GetText(const CsvContent_t *self, size_t row, size_t column);
 	extern void CsvContent_Destroy(CsvContent_t *self);
 	extern void CsvContent_Print(CsvContent_t *self);
 	extern bool CsvContent_Equals(CsvContent_t *self, CsvContent_t *content);
@@ -0,0 +1,68 @@
+/**
+ * @file CsvColumn.h
+ * @brief 型付きの列
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../CsvContent.h"
+#include "../../Csv.h"
+
+	/**
+	 * @brief 列の型
+	 */
+	typedef enum CsvColumnType {
+		//! 64bit整数
+		CSV_COLUMN_INT64 = 0,
+		//! 倍精度浮動小数点数
+		CSV_COLUMN_DOUBLE,
+		//! 真偽値 (true/false, 1/0。大文字小文字は区別しない)
+		CSV_COLUMN_BOOL,
+		//! 日時 (YYYY-MM-DD[ T]hh:mm:ss[Z] をUTCとみなしたUNIX時間[秒])
+		CSV_COLUMN_TIMESTAMP,
+	} CsvColumnType;
+
+	/**
+	 * @brief 制御ブロック
+	 */
+	typedef struct CsvColumn_t {
+		//! 型
+		CsvColumnType type;
+		//! 行数
+		size_t length;
+		//! 値 (変換できなかったセルは0)
+		union {
+			int64_t *int64s;
+			double *doubles;
+			bool *bools;
+			int64_t *timestamps;
+		} values;
+		//! 変換できなかったセルの数
+		size_t numErrors;
+
+		//! @name Private
+		//! @{
+
+		//! 変換できなかったセル (ビットn: n行目)
+		uint64_t *errors;
+
+		//! @}
+	} CsvColumn_t;
+
+	extern CsvReturnCode CsvColumn_Extract(CsvColumn_t *self, const CsvContent_t *content, size_t column, CsvColumnType type, size_t firstRow);
+	extern bool CsvColumn_HasError(const CsvColumn_t *self, size_t row);
+	extern void CsvColumn_Destroy(CsvColumn_t *self);
+	extern bool CsvColumn_ParseInt64(const char *text, int64_t *value);
+	extern bool CsvColumn_ParseDouble(const char *text, double *value);
+	extern bool CsvColumn_ParseBool(const char *text, bool *value);
+	extern bool CsvColumn_ParseTimestamp(const char *text, int64_t *value);
+
+#ifdef __cplusplus
+}
+#endif
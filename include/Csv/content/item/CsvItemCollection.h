@@ -25,16 +25,18 @@ extern "C" {
 		CsvItem_t *list;
 		//! 要素数
 		size_t length;
-		//! キャパシティー
+		//! キャパシティー (0: 他のコレクションの要素を参照するビューで、解放しない)
 		size_t capacity;
 
 		//! @}
 	} CsvItemCollection_t;
 
 	extern void CsvItemCollection_Init(CsvItemCollection_t *self);
+	extern void CsvItemCollection_InitView(CsvItemCollection_t *self, CsvItem_t *list, size_t length);
 	extern void CsvItemCollection_Resize(CsvItemCollection_t *self, size_t newCapacity);
 	extern void CsvItemCollection_MoveOwner(CsvItemCollection_t *self, CsvItemCollection_t *newOwner);
 	extern void CsvItemCollection_MoveAndAdd(CsvItemCollection_t *self, CsvItem_t *item);
+	extern void CsvItemCollection_MoveAndAddAll(CsvItemCollection_t *self, CsvItemCollection_t *items);
 	extern void CsvItemCollection_Destroy(CsvItemCollection_t *self);
 	extern void CsvItemCollection_Clear(CsvItemCollection_t *self);
 	extern void CsvItemCollection_Print(CsvItemCollection_t *self);
@@ -26,6 +26,7 @@ extern "C" {
 	} CsvLine_t;
 
 	extern void CsvLine_Init(CsvLine_t *self);
+	extern void CsvLine_InitView(CsvLine_t *self, CsvItem_t *items, size_t length);
 	extern void CsvLine_MoveOwner(CsvLine_t *self, CsvLine_t *newOwner);
 	extern void CsvLine_MoveBackItem(CsvLine_t *self, CsvItem_t *item);
 	extern void CsvLine_Destroy(CsvLine_t *self);
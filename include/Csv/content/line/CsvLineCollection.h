@@ -32,6 +32,7 @@ extern "C" {
 	extern void CsvLineCollection_Init(CsvLineCollection_t *self);
 	extern void CsvLineCollection_Resize(CsvLineCollection_t *self, size_t newCapacity);
 	extern void CsvLineCollection_MoveAndAdd(CsvLineCollection_t *self, CsvLine_t *moveLine);
+	extern void CsvLineCollection_MoveAndAddAll(CsvLineCollection_t *self, CsvLineCollection_t *lines);
 	extern void CsvLineCollection_Destroy(CsvLineCollection_t *self);
 	extern void CsvLineCollection_Print(CsvLineCollection_t *self);
 	extern bool CsvLineCollection_Equals(CsvLineCollection_t *self, CsvLineCollection_t *lines);
@@ -18,10 +18,14 @@ extern "C" {
 	 */
 	struct CsvParser_t;
 	typedef struct CsvParser_t CsvParser_t;
+	struct ThreadPool_t;
 
 	extern CsvParser_t *CsvParser_Init(const CsvProperties_t *props);
 	extern CsvReturnCode CsvParser_LoadFromFile(CsvParser_t *self, const char *filePath);
 	extern CsvReturnCode CsvParser_LoadFromData(CsvParser_t *self, const char *data, size_t dataSize);
+	extern CsvReturnCode CsvParser_LoadFromFileWithIndex(CsvParser_t *self, const char *filePath, const char *indexPath);
+	extern CsvReturnCode CsvParser_SaveIndex(CsvParser_t *self, const char *indexPath);
+	extern void CsvParser_SetThreadPool(CsvParser_t *self, struct ThreadPool_t *pool);
 	extern const CsvContent_t *CsvParser_GetContent(CsvParser_t *self);
 	extern void CsvParser_Destroy(CsvParser_t *self);
 
@@ -0,0 +1,37 @@
+/**
+ * @file CsvStreamParser.h
+ * @brief 少しずつ渡されるデータをパースするCsvパーサー
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdlib.h>
+#include "../property/CsvProperty.h"
+#include "../content/line/CsvLine.h"
+#include "../Csv.h"
+
+	/**
+	 * @brief 行を受け取るハンドラ
+	 * @note 行はハンドラから戻るまで有効
+	 */
+	typedef void (*CsvRowHandler)(const CsvLine_t *line, void *userData);
+
+	/**
+	 * @brief 制御ブロック
+	 */
+	struct CsvStreamParser_t;
+	typedef struct CsvStreamParser_t CsvStreamParser_t;
+
+	extern CsvStreamParser_t *CsvStreamParser_Init(const CsvProperties_t *props, CsvRowHandler onRow, void *userData);
+	extern CsvReturnCode CsvStreamParser_Feed(CsvStreamParser_t *self, const char *data, size_t dataSize);
+	extern CsvReturnCode CsvStreamParser_Next(CsvStreamParser_t *self, const CsvLine_t **line);
+	extern CsvReturnCode CsvStreamParser_Finish(CsvStreamParser_t *self);
+	extern size_t CsvStreamParser_GetBufferSize(const CsvStreamParser_t *self);
+	extern void CsvStreamParser_Destroy(CsvStreamParser_t *self);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,12 +1,62 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef enum CsvEolCode {
 	CSV_EOL_CR = 0,
 	CSV_EOL_CRLF,
 } CsvEolCode;
 
+/**
+ * @brief 条件の比較方法
+ */
+typedef enum CsvPredicateOperator {
+	//! 文字列が一致する
+	CSV_PREDICATE_EQUAL = 0,
+	//! 文字列が一致しない
+	CSV_PREDICATE_NOT_EQUAL,
+	//! 数値として小さい
+	CSV_PREDICATE_LESS_THAN,
+	//! 数値として大きい
+	CSV_PREDICATE_GREATER_THAN,
+} CsvPredicateOperator;
+
+/**
+ * @brief 行を残す条件
+ */
+typedef struct CsvPredicate {
+	//! 列 (columnName が NULL のとき)
+	size_t		column;
+	//! 列名 (NULL: column で指定する)
+	const char	*columnName;
+	CsvPredicateOperator	op;
+	//! 比べる値
+	const char	*value;
+} CsvPredicate_t;
+
 typedef struct CsvProperties {
 	bool		hasHeader;
+	//! 区切り文字 ('\0': ',')
+	char		delimiter;
+	//! 引用符 ('\0': '"')
+	char		quote;
+	//! 次の1文字をそのまま扱うエスケープ文字 ('\0': 使わず、引用符の中の "" だけを " にする)
+	char		escape;
+	//! 行頭にあれば行を読み飛ばすコメント文字 ('\0': 使わない)
+	char		comment;
+	//! 取り出す列 (NULL: すべて)
+	const size_t	*columns;
+	//! 名前で指定する取り出す列 (NULL: columns で指定する。ヘッダーが必要)
+	const char *const	*columnNames;
+	//! 取り出す列の数
+	size_t		numColumns;
+	//! 行を残す条件 (すべて満たす行だけ残す。ヘッダーには適用しない)
+	const CsvPredicate_t	*predicates;
+	//! 条件の数
+	size_t		numPredicates;
+	//! 書き込む改行コード (CSV_EOL_CR: "\n", CSV_EOL_CRLF: "\r\n")
+	CsvEolCode	eol;
+	//! 行の先頭位置だけを集め、フィールドには行に触れたときに分ける (列の選択と条件は使えない)
+	bool		isLazy;
 } CsvProperties_t;
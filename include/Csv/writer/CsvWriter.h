@@ -0,0 +1,49 @@
+/**
+ * @file CsvWriter.h
+ * @brief Csvライター
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../property/CsvProperty.h"
+#include "../content/CsvContent.h"
+#include "../Csv.h"
+#include "../../Stream/MemoryStream.h"
+
+	/**
+	 * @brief 制御ブロック
+	 */
+	struct CsvWriter_t;
+	typedef struct CsvWriter_t CsvWriter_t;
+
+	/**
+	 * @brief 1行ずつ書き込むハンドラ
+	 * @note CsvWriter_Write* でフィールドを書き込み、CsvWriter_EndRow で行を終える
+	 * @return false: 書き込む行が無い
+	 */
+	typedef bool (*CsvRowSource)(CsvWriter_t *writer, void *userData);
+
+	extern CsvWriter_t *CsvWriter_InitMemoryStream(const CsvProperties_t *props, MemoryStream *stream);
+	extern CsvWriter_t *CsvWriter_InitFd(const CsvProperties_t *props, int fd);
+	extern CsvWriter_t *CsvWriter_InitBuffer(const CsvProperties_t *props, char *buffer, size_t size);
+	extern CsvReturnCode CsvWriter_WriteText(CsvWriter_t *self, const char *text);
+	extern CsvReturnCode CsvWriter_WriteInt64(CsvWriter_t *self, int64_t value);
+	extern CsvReturnCode CsvWriter_WriteDouble(CsvWriter_t *self, double value);
+	extern CsvReturnCode CsvWriter_WriteBool(CsvWriter_t *self, bool value);
+	extern CsvReturnCode CsvWriter_EndRow(CsvWriter_t *self);
+	extern CsvReturnCode CsvWriter_WriteLine(CsvWriter_t *self, const CsvLine_t *line);
+	extern CsvReturnCode CsvWriter_WriteContent(CsvWriter_t *self, const CsvContent_t *content);
+	extern CsvReturnCode CsvWriter_WriteRows(CsvWriter_t *self, CsvRowSource source, void *userData);
+	extern CsvReturnCode CsvWriter_Flush(CsvWriter_t *self);
+	extern size_t CsvWriter_GetSize(const CsvWriter_t *self);
+	extern void CsvWriter_Destroy(CsvWriter_t *self);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,6 +9,8 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+#include <stdbool.h>
 #include "ExtendedTypes/MemoryAllocator.h"
 
 	/**
@@ -24,21 +26,28 @@ extern "C" {
 
 	/**
 	 * @brief 制御ブロック
+	 * @note ノードモードは要素ごとにオブジェクトを確保し、参照も持てる。
+	 * インラインモードはオブジェクトを1つの領域に objectSize 刻みで詰めて持つ
 	 */
 	typedef struct ArrayList {
 		//! @name private
 		//! @{
 		ArrayListNode *list;
+		//! オブジェクトを詰めた領域 (インラインモードのみ)
+		uint8_t *objects;
 		size_t objectSize;
 		size_t capacity;
 		size_t length;
 		MemoryAllocator_t allocator;
+		//! インラインモードか
+		bool isInline;
 		//! @}
 	} ArrayList;
 
 	//! @name constructor
 	//! @{
 	extern void ArrayList_Init(ArrayList *self, const MemoryAllocator_t *allocator, size_t objectSize);
+	extern void ArrayList_InitInline(ArrayList *self, const MemoryAllocator_t *allocator, size_t objectSize);
 	//! @}
 
 	//! @name destructor
@@ -57,6 +66,7 @@ extern "C" {
 	extern bool ArrayList_IsEmpty(ArrayList *self);
 	extern void ArrayList_Resize(ArrayList *self, size_t newSize);
 	extern const void *ArrayList_At(ArrayList *self, uint64_t index);
+	extern const void *ArrayList_Data(ArrayList *self);
 	extern void ArrayList_Add(ArrayList *self, const void *object);
 	extern void ArrayList_AddReference(ArrayList *self, void *object);
 	extern void ArrayList_AddRange(ArrayList *self, const void *objects, size_t length);
@@ -9,13 +9,17 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
-#ifndef _GNU_SOURCE
-#define _GNU_SOURCE
-#endif
 
-#include <search.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+
+//! 要素の中に持つキーの最大長 (終端を含む)
+#define DICTIONARY_INLINE_KEY_SIZE	(32)
+//! スラブのサイズクラスの数 (16, 32, ... 16384バイト。これより大きい領域は個別に確保する)
+#define DICTIONARY_SIZE_CLASSES		(11)
+//! プローブ長の度数分布の区間数 (最後の区間はそれ以上をまとめる)
+#define DICTIONARY_PROBE_HISTOGRAM_SIZE	(8)
 
 	/**
 	 * @brief 辞書のキーに対応するオブジェクト
@@ -27,65 +31,168 @@ extern "C" {
 		size_t size;
 	} DictionaryObject_t;
 
+	/**
+	 * @brief キー
+	 * @note 任意のバイト列を使える。ハッシュ値を持たせておけば、同じキーで何度も引くときにハッシュし直さない
+	 */
+	typedef struct DictionaryKey_t {
+		//! キーのバイト列
+		const void *data;
+		//! 長さ (終端を含まない)
+		size_t size;
+		//! Dictionary_Hash で求めたハッシュ値
+		uint64_t hash;
+	} DictionaryKey_t;
+
 	/**
 	 * @brief 要素
 	 */
 	typedef struct DictionaryElement_t {
-		//! キー
-		char *key;
-		//! オブジェクト
+		//! キーのハッシュ値
+		uint64_t hash;
+		//! オブジェクト (buffer==NULL: 削除済み)
 		DictionaryObject_t object;
+		//! キーの長さ (終端を含まない)
+		size_t keyLength;
+		union {
+			//! 長いキー (スラブに持つ)
+			char *key;
+			//! 短いキー (keyLength < DICTIONARY_INLINE_KEY_SIZE のとき)
+			char inlineKey[DICTIONARY_INLINE_KEY_SIZE];
+		};
 	} DictionaryElement_t;
 
+	/**
+	 * @brief 同じサイズの領域を切り出すスラブ
+	 */
+	typedef struct DictionarySlab_t {
+		//! 戻した領域の連結リスト (領域の先頭に次の領域を持つ)
+		void *freeList;
+		//! 最後に確保したブロックの未使用の領域
+		char *next;
+		char *end;
+	} DictionarySlab_t;
+
+	//! スロット (実装は Dictionary.c)
+	struct DictionaryTable_t;
+	//! 並行モードの状態 (実装は Dictionary.c)
+	struct DictionaryConcurrency_t;
+
 	/**
 	 * @brief 制御ブロック
+	 * @note オープンアドレス法のハッシュテーブル。制御バイトに空きか削除済みか、
+	 * ハッシュ値の下位7ビットを持ち、16スロットずつまとめて比べる
+	 * @note 並行モードでは、追加と削除を1つのロックで直列にし、Dictionary_FindCopy はロックを取らずに読む
 	 */
 	typedef struct Dictionary_t {
 		//! @name Private
 		//! @{
 
-		//! ハッシュテーブル
-		struct hsearch_data hashTable;
+		//! スロット (NULL: まだ無い)
+		struct DictionaryTable_t *table;
+		//! 削除済みのスロット数
+		size_t numDeleted;
 		/**
 		 * @brief 要素のリスト
+		 * @note 追加した順に並ぶ。削除した要素は穴になり、作り直すときに詰める
 		 */
 		struct {
 			//! リストの実態
 			DictionaryElement_t *list;
 			//! キャパシティー
 			size_t capacity;
-			//! 個数
+			//! 個数 (穴を含む)
 			size_t count;
+			//! 穴の数
+			size_t removed;
 		} elements;
 		//! キーとなる文字列の最大長
 		size_t maxKeySize;
 		//! オブジェクトの最大サイズ
 		size_t maxObjectSize;
-		//! メモリプール
-		void *memoryPool;
+		/**
+		 * @brief 長いキーとオブジェクトの領域
+		 * @note サイズクラスごとのスラブから切り出す。ブロックは移動しないので、
+		 * 要素のリストを広げてもバッファは動かない
+		 */
+		struct {
+			//! 確保したブロック
+			void **blocks;
+			size_t numBlocks;
+			DictionarySlab_t slabs[DICTIONARY_SIZE_CLASSES];
+		} memoryPool;
+		//! 並行モードの状態 (NULL: 並行モードではない)
+		struct DictionaryConcurrency_t *concurrency;
 
 		//! @}
 	} Dictionary_t;
 
+	/**
+	 * @brief 統計
+	 */
+	typedef struct DictionaryStats_t {
+		//! 要素数
+		size_t count;
+		//! スロット数
+		size_t numSlots;
+		//! 削除済みのスロット数
+		size_t numDeleted;
+		//! 使用率 (要素数 / スロット数)
+		double loadFactor;
+		//! 要素のリストのキャパシティー
+		size_t capacity;
+		//! 要素のリストの穴の数
+		size_t numHoles;
+		/**
+		 * @brief プローブ長ごとの要素数
+		 * @note プローブ長は要素を見つけるまでに調べる16スロットのグループ数。[0]が1グループ
+		 */
+		size_t probeLengths[DICTIONARY_PROBE_HISTOGRAM_SIZE];
+		//! 平均のプローブ長
+		double averageProbeLength;
+		//! 最大のプローブ長
+		size_t maxProbeLength;
+		//! 確保しているメモリ[byte] (並行モードで解放を待つ領域を除く)
+		size_t memoryUsage;
+		//! 並行モードで読み手がいなくなるのを待って解放する領域の数
+		size_t numRetired;
+	} DictionaryStats_t;
+
 	/**
 	 * @enum DictionaryReturn
 	 * @brief ステータス
 	 */
 	typedef enum DictionaryReturn {
+		//! 同じキーが既にある (先に追加したオブジェクトのまま)
+		DICTIONARY_EXISTS = -4,
 		DICTIONARY_INVALID_ARG = -3,
 		DICTIONARY_NOT_FOUND = -2,
+		//! メモリを確保できない
 		DICTIONARY_FULL = -1,
 		DICTIONARY_ADDED = 0,
 		DICTIONARY_FOUND = 0,
+		DICTIONARY_REMOVED = 0,
 	} DictionaryReturn;
 
 	extern void Dictionary_Init(Dictionary_t *self, size_t capacity, size_t maxKeysize, size_t maxObjectSize);
+	extern bool Dictionary_InitConcurrent(Dictionary_t *self, size_t capacity, size_t maxKeySize, size_t maxObjectSize);
 	extern DictionaryReturn Dictionary_Add(Dictionary_t *self, const char *key, void *object, size_t objectSize);
 	extern const DictionaryObject_t *Dictionary_Find(Dictionary_t *self, char *key);
+	extern DictionaryReturn Dictionary_FindCopy(const Dictionary_t *self, const char *key, void *buffer, size_t bufferSize, size_t *objectSize);
+	extern DictionaryReturn Dictionary_Remove(Dictionary_t *self, const char *key);
+	extern uint64_t Dictionary_Hash(const void *data, size_t size);
+	extern DictionaryKey_t Dictionary_MakeKey(const void *data, size_t size);
+	extern DictionaryReturn Dictionary_AddByKey(Dictionary_t *self, const DictionaryKey_t *key, void *object, size_t objectSize);
+	extern const DictionaryObject_t *Dictionary_FindByKey(Dictionary_t *self, const DictionaryKey_t *key);
+	extern DictionaryReturn Dictionary_FindCopyByKey(const Dictionary_t *self, const DictionaryKey_t *key, void *buffer, size_t bufferSize, size_t *objectSize);
+	extern DictionaryReturn Dictionary_RemoveByKey(Dictionary_t *self, const DictionaryKey_t *key);
+	extern DictionaryReturn Dictionary_AddRange(Dictionary_t *self, const DictionaryKey_t *keys, const DictionaryObject_t *objects, size_t count, size_t *numAdded);
+	extern void Dictionary_Reclaim(Dictionary_t *self);
+	extern size_t Dictionary_Count(const Dictionary_t *self);
+	extern bool Dictionary_Next(const Dictionary_t *self, size_t *cursor, DictionaryKey_t *key, DictionaryObject_t *object);
+	extern void Dictionary_GetStats(const Dictionary_t *self, DictionaryStats_t *stats);
 	extern void Dictionary_Destroy(Dictionary_t *self);
 
 #ifdef __cplusplus
 }
 #endif
-
-
@@ -0,0 +1,66 @@
+/**
+ * @file FrozenDictionary.h
+ * @brief 変更できない辞書型
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ExtendedTypes/Dictionary.h"
+
+	//! エントリー (実装は FrozenDictionary.c)
+	struct FrozenDictionaryEntry_t;
+
+	/**
+	 * @brief 制御ブロック
+	 * @note 最小完全ハッシュ (PTHash 方式) で、キーごとに1つのエントリーを1回で引く。
+	 * ヘッダー、バケットごとのパイロット、エントリー、キーとオブジェクトを1つの領域に並べるので、
+	 * そのままファイルに保存し、マッピングして使える
+	 */
+	typedef struct FrozenDictionary_t {
+		//! @name Private
+		//! @{
+
+		//! 領域の全体
+		uint8_t *blob;
+		//! 領域のサイズ
+		size_t size;
+		//! マッピングしたサイズ (0: mallocで確保した)
+		size_t mappedSize;
+		//! 要素数 (エントリー数)
+		uint64_t count;
+		//! バケット数
+		uint64_t numBuckets;
+		//! ハッシュ値に混ぜる種
+		uint64_t seed;
+		//! バケットごとのパイロット
+		const uint32_t *pilots;
+		//! エントリー
+		const struct FrozenDictionaryEntry_t *entries;
+		//! キーとオブジェクト
+		const uint8_t *data;
+		//! キーとオブジェクトのサイズ
+		uint64_t dataSize;
+
+		//! @}
+	} FrozenDictionary_t;
+
+	extern bool FrozenDictionary_Build(FrozenDictionary_t *self, const DictionaryKey_t *keys, const DictionaryObject_t *objects, size_t count);
+	extern bool Dictionary_Freeze(const Dictionary_t *dictionary, FrozenDictionary_t *frozen);
+	extern bool FrozenDictionary_Save(const FrozenDictionary_t *self, const char *path);
+	extern bool FrozenDictionary_Load(FrozenDictionary_t *self, const char *path);
+	extern DictionaryReturn FrozenDictionary_Find(const FrozenDictionary_t *self, const char *key, DictionaryObject_t *object);
+	extern DictionaryReturn FrozenDictionary_FindByKey(const FrozenDictionary_t *self, const DictionaryKey_t *key, DictionaryObject_t *object);
+	extern size_t FrozenDictionary_Count(const FrozenDictionary_t *self);
+	extern void FrozenDictionary_Destroy(FrozenDictionary_t *self);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,10 +9,25 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
 #include "Subscription.h"
 #include "Subscriber.h"
 #include "MessageStorage.h"
 #include "PublishContent.h"
+	/**
+	 * @brief 再配信ポリシー
+	 */
+	typedef struct BrokerRetryPolicy_t {
+		//! 初回の再配信までの間隔[ms]
+		time_t initialInterval;
+		//! 再配信間隔の上限[ms]
+		time_t maxInterval;
+		//! 配信の最大試行回数(初回の配信を含む)
+		uint32_t maxAttempts;
+	} BrokerRetryPolicy_t;
+
 	/**
 	 * @brief 制御ブロック
 	 */
@@ -23,14 +38,33 @@ extern "C" {
 		Subscription_t subscription;
 		//! 保留したメッセージバッファ
 		MessageStorage_t pendingMessages;
+		//! 再配信をあきらめたメッセージバッファ
+		MessageStorage_t deadLetters;
+		//! 再配信ポリシー
+		BrokerRetryPolicy_t retryPolicy;
 		//! サブスクライバーの最大数
-		uint8_t maxSubscribers;
+		size_t maxSubscribers;
+		//! 排他制御
+		pthread_mutex_t mutex;
+		//! 再配信スレッドを起こす
+		pthread_cond_t condition;
+		//! 再配信スレッド
+		pthread_t redeliveryThread;
+		//! 次に再配信スレッドが起きる時刻[ms] (0: 予定なし)
+		time_t nextRedelivery;
+		//! 再配信スレッドの実行中
+		bool running;
+		//! 保留中のメッセージを再配信中 (ハンドラの呼び出し中も含む)
+		bool republishing;
 
 		//! @}
 	} Broker_t;
 
-	void Broker_Init(Broker_t *self, uint8_t maxSubscribers);
+	void Broker_Init(Broker_t *self, size_t maxSubscribers);
+	void Broker_SetRetryPolicy(Broker_t *self, const BrokerRetryPolicy_t *policy);
 	void Broker_Publish(Broker_t *self, const PublishContent_t *content);
+	size_t Broker_Redeliver(Broker_t *self);
+	int Broker_TakeDeadLetter(Broker_t *self, SubscriptionAccountId *id, PublishContent_t *content);
 	SubscriptionAccountId Broker_Subscribe(Broker_t *self, const Subscriber_t *subscriber, PublishMessageAttribute interestedPublish);
 	void Broker_Unsubscribe(Broker_t *self, SubscriptionAccountId id);
 	void Broker_Destroy(Broker_t *self);
@@ -10,6 +10,7 @@
 extern "C" {
 #endif
 #include <stdint.h>
+#include "PublishPayload.h"
 	//! メッセージの属性
 	typedef int PublishMessageAttribute;
 	//! メッセージ
@@ -23,6 +24,9 @@ extern "C" {
 		PublishMessage message;
 		//! 属性
 		PublishMessageAttribute attribute;
+		//! ペイロード (NULL: なし)
+		//! @note すべてのサブスクライバーが同じペイロードを参照する。ハンドラの外で使うなら PublishPayload_Retain する
+		PublishPayload_t *payload;
 	} PublishContent_t;
 
 #ifdef __cplusplus
@@ -0,0 +1,56 @@
+/**
+ * @file PublishPayload.h
+ * @brief 参照カウント付きのペイロード
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+	//! サイズクラスの数 (64B～8KB)
+#define PUBLISH_PAYLOAD_NUM_SIZE_CLASSES	(8)
+
+	/**
+	 * @brief ペイロード
+	 * @note 最後の参照が解放されるとプールに戻る
+	 */
+	struct PublishPayload_t;
+	typedef struct PublishPayload_t PublishPayload_t;
+
+	/**
+	 * @brief 制御ブロック
+	 */
+	typedef struct PublishPayloadPool_t {
+		//! @name Private
+		//! @{
+
+		//! サイズクラスごとの空きリスト
+		PublishPayload_t *freeLists[PUBLISH_PAYLOAD_NUM_SIZE_CLASSES];
+		//! 貸し出し中の数
+		size_t inUse;
+		//! 排他制御
+		pthread_mutex_t mutex;
+
+		//! @}
+	} PublishPayloadPool_t;
+
+	void PublishPayloadPool_Init(PublishPayloadPool_t *self);
+	PublishPayload_t *PublishPayloadPool_Allocate(PublishPayloadPool_t *self, size_t size);
+	size_t PublishPayloadPool_InUse(PublishPayloadPool_t *self);
+	void PublishPayloadPool_Destroy(PublishPayloadPool_t *self);
+
+	void *PublishPayload_Data(PublishPayload_t *self);
+	size_t PublishPayload_Size(const PublishPayload_t *self);
+	PublishPayload_t *PublishPayload_Retain(PublishPayload_t *self);
+	void PublishPayload_Release(PublishPayload_t *self);
+
+#ifdef __cplusplus
+}
+#endif
+
@@ -12,6 +12,7 @@ extern "C" {
 #include <stddef.h>
 #include <stdint.h>
 #include "Broker.h"
+#include "SharedMemoryTransport.h"
 	/**
 	 * @brief 制御ブロック
 	 */
@@ -21,14 +22,19 @@ extern "C" {
 
 		//! ブローカー
 		Broker_t broker;
+		//! 他プロセスへの転送先 (NULL: 転送しない)
+		SharedMemoryTransport_t *transport;
 
 		//! @}
 	} Publisher_t;
 
-	void Publisher_Init(Publisher_t *self, uint8_t maxSubscribers);
+	void Publisher_Init(Publisher_t *self, size_t maxSubscribers);
 	SubscriptionAccountId Publisher_Subscribe(Publisher_t *self, const Subscriber_t *subscriber, PublishMessageAttribute interestedPublish);
 	void Publisher_Unsubscribe(Publisher_t *self, SubscriptionAccountId id);
-	void Publisher_Publish(Publisher_t *self, const PublishContent_t *publish);
+	int Publisher_Publish(Publisher_t *self, const PublishContent_t *publish);
+	void Publisher_AttachTransport(Publisher_t *self, SharedMemoryTransport_t *transport);
+	void Publisher_SetRetryPolicy(Publisher_t *self, const BrokerRetryPolicy_t *policy);
+	int Publisher_TakeDeadLetter(Publisher_t *self, SubscriptionAccountId *id, PublishContent_t *content);
 	void Publisher_Destroy(Publisher_t *self);
 #ifdef __cplusplus
 }
@@ -0,0 +1,58 @@
+/**
+ * @file SharedMemoryTransport.h
+ * @brief 共有メモリを使ったプロセス間のパブリッシュ/サブスクライブ
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "PublishContent.h"
+#include "Subscription.h"
+#include "Broker.h"
+
+	/**
+	 * @brief 共有メモリのセグメント
+	 */
+	struct SharedMemorySegment_t;
+
+	/**
+	 * @brief 制御ブロック
+	 * @note 同じ名前のセグメントを開いたプロセス同士でメッセージをやり取りする
+	 */
+	typedef struct SharedMemoryTransport_t {
+		//! @name Private
+		//! @{
+
+		//! セグメントの名前
+		char name[64];
+		//! マッピングしたセグメント
+		struct SharedMemorySegment_t *segment;
+		//! マッピングしたサイズ
+		size_t mappedSize;
+		//! セグメントの作成者
+		bool owner;
+
+		//! @}
+	} SharedMemoryTransport_t;
+
+	int SharedMemoryTransport_Create(SharedMemoryTransport_t *self, const char *name, size_t capacity, size_t maxPayloadSize, uint16_t maxSubscribers);
+	int SharedMemoryTransport_Open(SharedMemoryTransport_t *self, const char *name);
+	int SharedMemoryTransport_Publish(SharedMemoryTransport_t *self, const PublishContent_t *content);
+	SubscriptionAccountId SharedMemoryTransport_Subscribe(SharedMemoryTransport_t *self);
+	void SharedMemoryTransport_Unsubscribe(SharedMemoryTransport_t *self, SubscriptionAccountId id);
+	ssize_t SharedMemoryTransport_Receive(SharedMemoryTransport_t *self, SubscriptionAccountId id, PublishContent_t *content, void *buffer, size_t bufferSize, time_t timeout);
+	int SharedMemoryTransport_Dispatch(SharedMemoryTransport_t *self, SubscriptionAccountId id, Broker_t *broker, PublishPayloadPool_t *pool, time_t timeout);
+	void SharedMemoryTransport_Close(SharedMemoryTransport_t *self);
+
+#ifdef __cplusplus
+}
+#endif
+
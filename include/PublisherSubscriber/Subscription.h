@@ -28,6 +28,10 @@ extern "C" {
 		PublishMessageAttribute interestedPublish;
 		//! 契約済み
 		bool contracted;
+		//! 次の空きアカウント (解約済みのときだけ有効)
+		SubscriptionAccountId nextFree;
+		//! 世代 (解約のたびに進むので、IDを使い回しても別の契約と区別できる)
+		size_t generation;
 	} SubscriptionAccount_t;
 
 	/**
@@ -41,6 +45,14 @@ extern "C" {
 		SubscriptionAccount_t *accounts;
 		//! 登録できる最大アカウント数
 		size_t numAccounts;
+		//! 確保済みのアカウント数
+		size_t capacity;
+		//! 一度でも使ったアカウント数 (これより後ろは未使用)
+		size_t used;
+		//! 契約数
+		size_t count;
+		//! 解約されたアカウントの空きリストの先頭
+		SubscriptionAccountId freeHead;
 
 		//! @}
 	} Subscription_t;
@@ -51,6 +63,7 @@ extern "C" {
 	void Subscription_Cancellation(Subscription_t *self, SubscriptionAccountId id);
 	SubscriptionAccount_t *Subscription_GetAccount(Subscription_t *self, SubscriptionAccountId id);
 	ssize_t Subscription_Match(Subscription_t *self, PublishMessageAttribute messageAttribute, SubscriptionAccountId matchedIds[], size_t size);
+	SubscriptionAccount_t *Subscription_NextMatch(Subscription_t *self, PublishMessageAttribute messageAttribute, SubscriptionAccountId *cursor);
 	void Subscription_Destroy(Subscription_t *self);
 	size_t Subscription_Count(Subscription_t *self);
 #ifdef __cplusplus
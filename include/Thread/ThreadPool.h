@@ -52,6 +52,8 @@ extern int ThreadPool_Push(ThreadPool_t *self, const ThreadPoolTask_t *task);
 extern int ThreadPool_PushTasks(ThreadPool_t *self, const ThreadPoolTask_t *tasks[], uint64_t numTasks);
 extern void ThreadPool_Destroy(ThreadPool_t *self, bool isWait);
 extern uint64_t ThreadPool_GetNumTasks(ThreadPool_t *self);
+extern uint16_t ThreadPool_GetNumThreads(ThreadPool_t *self);
+extern bool ThreadPool_IsWorker(ThreadPool_t *self);
 
 #ifdef __cplusplus
 }
@@ -19,6 +19,7 @@
 void CsvContent_Init(CsvContent_t *self) {
 	CLEAR(self);
 	CsvLineCollection_Init(&self->lines);
+	CsvItemCollection_Init(&self->items);
 }
 
 /**
@@ -30,12 +31,223 @@ void CsvContent_MoveBackLine(CsvContent_t *self, CsvLine_t *line) {
 	CsvLineCollection_MoveAndAdd(&self->lines, line);
 }
 
+/**
+ * @brief 別のデータの行をすべて最後尾へ移す
+ * @attention CsvContent_Finalize の後は、行が参照するアイテムの配列を動かさないよう移さない
+ * @param self インスタンス
+ * @param content 移すデータ (行は空になる)
+ * @return false: CsvContent_Finalize の後
+ */
+bool CsvContent_MoveBackContent(CsvContent_t *self, CsvContent_t *content) {
+	if (UNLIKELY(self->isFinalized)) {
+		return false;
+	}
+	content->items.length = content->lineItemStart;	// 作りかけの行のアイテムは移さない
+	CsvItemCollection_MoveAndAddAll(&self->items, &content->items);
+	self->lineItemStart = self->items.length;
+	content->lineItemStart = 0;
+	CsvLineCollection_MoveAndAddAll(&self->lines, &content->lines);
+	return true;
+}
+
+/**
+ * @brief 作成中の行の最後尾にアイテムを追加
+ * @note 行を作り終えたら CsvContent_EndLine を呼ぶ
+ * @attention CsvContent_Finalize の後は、行が参照するアイテムの配列を動かさないよう追加しない
+ * @param self インスタンス
+ * @param text テキスト
+ * @return false: CsvContent_Finalize の後
+ */
+bool CsvContent_AddItem(CsvContent_t *self, char *text) {
+	if (UNLIKELY(self->isFinalized)) {
+		return false;
+	}
+	CsvItem_t item = { .text = text };
+	CsvItemCollection_MoveAndAdd(&self->items, &item);
+	return true;
+}
+
+/**
+ * @brief 作成中の行を最後尾に追加
+ * @note 行のアイテムの参照は CsvContent_Finalize で設定する
+ * @param self インスタンス
+ * @return false: CsvContent_Finalize の後
+ */
+bool CsvContent_EndLine(CsvContent_t *self) {
+	if (UNLIKELY(self->isFinalized)) {
+		return false;
+	}
+	CsvLine_t line;
+	CsvLine_InitView(&line, NULL, self->items.length - self->lineItemStart);
+	CsvLineCollection_MoveAndAdd(&self->lines, &line);
+	self->lineItemStart = self->items.length;
+	return true;
+}
+
+/**
+ * @brief 作成中の行のアイテムを捨てる
+ * @param self インスタンス
+ */
+void CsvContent_DiscardLine(CsvContent_t *self) {
+	self->items.length = self->lineItemStart;
+}
+
+/**
+ * @brief 行のアイテムの参照を設定する
+ * @note アイテムの配列は追加するたびに移動するので、追加し終えてからまとめて設定する。
+ * 以降はアイテムと行を追加できない (CsvContent_MoveBackLine で個別にアイテムを持つ行は追加できる)
+ * @note 2回目以降は何もしない。行を書き換えてビューでなくなっていても、参照をずらさない
+ * @param self インスタンス
+ */
+void CsvContent_Finalize(CsvContent_t *self) {
+	if (self->isFinalized) {
+		return;
+	}
+	self->isFinalized = true;
+	size_t offset = 0;
+	for (size_t i = 0; i < self->lines.length; i++) {
+		CsvItemCollection_t *items = &self->lines.list[i].items;
+		if (items->capacity != 0) {
+			continue;	// 個別にアイテムを持つ行
+		}
+		items->list = &self->items.list[offset];
+		offset += items->length;
+	}
+}
+
+/**
+ * @brief 行を取得
+ * @note 遅延して分ける行は、ここで読み込んで分ける
+ * @param self インスタンス
+ * @param row 行
+ * @return 行 (NULL: 範囲外)
+ */
+static const CsvLine_t *GetLine(const CsvContent_t *self, size_t row) {
+	if (self->lazyRows) {
+		return self->lazyRows->load(self->lazyRows, row);
+	}
+	return (row < self->lines.length) ? &self->lines.list[row] : NULL;
+}
+
+/**
+ * @brief 触れた行だけをフィールドに分けるようにする
+ * @note 設定すると、行は rows から取得する。GetText で得たテキストは、別の行に触れるまで有効
+ * @param self インスタンス
+ * @param rows 遅延して分ける行 (NULL: 解除する)。インスタンスより長く生存すること
+ */
+void CsvContent_SetLazyRows(CsvContent_t *self, CsvLazyRows_t *rows) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	self->lazyRows = rows;
+}
+
+/**
+ * @brief 先頭の行をヘッダーとして、列名から列を引けるようにする
+ * @note 同じ列名が複数あれば、最初の列を返す
+ * @param self インスタンス
+ */
+void CsvContent_IndexHeader(CsvContent_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	if (self->hasColumnNames) {
+		Dictionary_Destroy(&self->columnNames);
+		self->hasColumnNames = false;
+	}
+	const CsvLine_t *line = GetLine(self, 0);
+	if (!line) {
+		return;
+	}
+	const CsvItemCollection_t *header = &line->items;
+	size_t maxKeySize = 1;
+	for (size_t i = 0; i < header->length; i++) {
+		size_t keySize = strlen(header->list[i].text) + 1;
+		maxKeySize = (keySize > maxKeySize) ? keySize : maxKeySize;
+	}
+	Dictionary_Init(&self->columnNames, header->length, maxKeySize, sizeof(size_t));
+	for (size_t i = 0; i < header->length; i++) {
+		size_t column = i;
+		Dictionary_Add(&self->columnNames, header->list[i].text, &column, sizeof(column));
+	}
+	self->hasColumnNames = true;
+}
+
+/**
+ * @brief 列名から列を探す
+ * @note CsvContent_IndexHeader で作った対応を引く
+ * @param self インスタンス
+ * @param name 列名
+ * @param column 列
+ * @return false: 見つからない
+ */
+bool CsvContent_FindColumn(const CsvContent_t *self, const char *name, size_t *column) {
+	if (UNLIKELY(!self || !name || !column || !self->hasColumnNames)) {
+		return false;
+	}
+	// 探すだけなので書き換えない
+	const DictionaryObject_t *object = Dictionary_Find((Dictionary_t *)&self->columnNames, (char *)name);
+	if (!object) {
+		return false;
+	}
+	memcpy(column, object->buffer, sizeof(*column));
+	return true;
+}
+
+/**
+ * @brief 行数を取得
+ * @param self インスタンス
+ * @return 行数
+ */
+size_t CsvContent_GetRowCount(const CsvContent_t *self) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	return self->lazyRows ? self->lazyRows->numRows : self->lines.length;
+}
+
+/**
+ * @brief 列数を取得
+ * @param self インスタンス
+ * @param row 行
+ * @return 列数
+ */
+size_t CsvContent_GetColumnCount(const CsvContent_t *self, size_t row) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	const CsvLine_t *line = GetLine(self, row);
+	return line ? line->items.length : 0;
+}
+
+/**
+ * @brief テキストを取得
+ * @param self インスタンス
+ * @param row 行
+ * @param column 列
+ * @return テキスト (NULL: 範囲外)
+ */
+const char *CsvContent_GetText(const CsvContent_t *self, size_t row, size_t column) {
+	if (UNLIKELY(!self)) {
+		return NULL;
+	}
+	const CsvLine_t *line = GetLine(self, row);
+	if (!line || (column >= line->items.length)) {
+		return NULL;
+	}
+	return line->items.list[column].text;
+}
+
 /**
  * @brief インスタンスを破棄
  * @param self インスタンス
  */
 void CsvContent_Destroy(CsvContent_t *self) {
 	CsvLineCollection_Destroy(&self->lines);
+	CsvItemCollection_Destroy(&self->items);
+	if (self->hasColumnNames) {
+		Dictionary_Destroy(&self->columnNames);
+	}
 	CLEAR(self);
 }
 
@@ -0,0 +1,474 @@
+/**
+ * @file CsvColumn.c
+ * @brief 型付きの列
+ * @note 整数は8桁ずつSWARで変換する。浮動小数点数は仮数が2^53以下かつ指数が±22以内なら
+ * 1回の乗除算で正確に求まる(Clingerの高速経路)ので直接求め、それ以外はstrtodに任せる。
+ * strtodは実行中のロケールの小数点に従うので、"C"ロケールを指定してstrtod_lで変換する
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <locale.h>
+#include <pthread.h>
+#include "Csv/content/column/CsvColumn.h"
+#include "utilities.h"
+
+//! 64bit符号無し整数で桁あふれしない桁数
+#define MAX_SAFE_DIGITS		(19)
+//! 倍精度浮動小数点数で正確に表せる最大の整数
+#define MAX_EXACT_MANTISSA	((uint64_t)1 << 53)
+//! 倍精度浮動小数点数で正確に表せる最大の10の累乗
+#define MAX_EXACT_EXPONENT	(22)
+//! 1日の秒数
+#define SECONDS_PER_DAY		((int64_t)86400)
+
+//! 正確に表せる10の累乗
+static const double POWERS_OF_TEN[MAX_EXACT_EXPONENT + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+//! 小数点を '.' に固定するためのロケール ((locale_t)0: 作れなかった)
+static locale_t cLocale = (locale_t)0;
+static pthread_once_t cLocaleOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief "C"ロケールを作る
+ * @note プロセスの終了まで使うので解放しない
+ */
+static void InitCLocale(void) {
+	cLocale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+}
+
+/**
+ * @brief 数字か
+ * @param c 文字
+ * @return
+ */
+static inline bool IsDigit(char c) {
+	return (uint8_t)(c - '0') <= 9;
+}
+
+/**
+ * @brief 8バイトを読む
+ * @param p 先頭
+ * @return 先頭のバイトを最下位にした値
+ */
+static inline uint64_t LoadEightBytes(const char *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+/**
+ * @brief 8バイトがすべて数字か
+ * @param v 8バイト
+ * @return
+ */
+static inline bool IsEightDigits(uint64_t v) {
+	return ((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+		== 0x3333333333333333ULL;
+}
+
+/**
+ * @brief 8桁の数字を変換する
+ * @note 隣り合う桁を掛け合わせて、2桁、4桁、8桁とまとめていく
+ * @param v 8バイト
+ * @return 値
+ */
+static inline uint32_t ParseEightDigits(uint64_t v) {
+	const uint64_t mask = 0x000000FF000000FFULL;
+	const uint64_t mul1 = 100 + (1000000ULL << 32);
+	const uint64_t mul2 = 1 + (10000ULL << 32);
+	v -= 0x3030303030303030ULL;
+	v = (v * 10) + (v >> 8);
+	v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+	return (uint32_t)v;
+}
+
+/**
+ * @brief 数字の並びを変換する
+ * @param p 読む位置 (数字の後ろまで進める)
+ * @param end 文字列の終わり
+ * @param value 値 (続けて加える)
+ * @param numDigits 桁数 (続けて加える)
+ * @return false: 桁あふれ
+ */
+static inline bool ParseDigits(const char **p, const char *end, uint64_t *value, size_t *numDigits) {
+	const char *s = *p;
+	uint64_t v = *value;
+	size_t n = *numDigits;
+	while ((end - s >= 8) && (n + 8 <= MAX_SAFE_DIGITS)) {
+		uint64_t bytes = LoadEightBytes(s);
+		if (!IsEightDigits(bytes)) {
+			break;
+		}
+		v = v * 100000000 + ParseEightDigits(bytes);
+		s += 8;
+		n += 8;
+	}
+	bool ok = true;
+	for (; (s < end) && IsDigit(*s); s++, n++) {
+		if (__builtin_mul_overflow(v, 10, &v) || __builtin_add_overflow(v, (uint64_t)(*s - '0'), &v)) {
+			ok = false;
+		}
+	}
+	*p = s;
+	*value = v;
+	*numDigits = n;
+	return ok;
+}
+
+/**
+ * @brief 整数に変換する
+ * @param text テキスト
+ * @param value 値
+ * @return false: 変換できない
+ */
+bool CsvColumn_ParseInt64(const char *text, int64_t *value) {
+	if (UNLIKELY(!text || !value)) {
+		return false;
+	}
+	const char *end = text + strlen(text);
+	const char *p = text;
+	bool negative = (*p == '-');
+	if (negative || (*p == '+')) {
+		p++;
+	}
+	uint64_t magnitude = 0;
+	size_t numDigits = 0;
+	if (!ParseDigits(&p, end, &magnitude, &numDigits) || (numDigits == 0) || (p != end)) {
+		return false;
+	}
+	uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+	if (magnitude > limit) {
+		return false;
+	}
+	*value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+	return true;
+}
+
+/**
+ * @brief 仮数と指数から正確に求められるか試す
+ * @param text テキスト
+ * @param end テキストの終わり
+ * @param value 値
+ * @return false: 高速経路では求められない
+ */
+static bool TryParseDoubleFast(const char *text, const char *end, double *value) {
+	const char *p = text;
+	bool negative = (*p == '-');
+	if (negative || (*p == '+')) {
+		p++;
+	}
+	uint64_t mantissa = 0;
+	size_t numDigits = 0;
+	if (!ParseDigits(&p, end, &mantissa, &numDigits)) {
+		return false;
+	}
+	int64_t exponent = 0;
+	if ((p < end) && (*p == '.')) {
+		p++;
+		size_t integerDigits = numDigits;
+		if (!ParseDigits(&p, end, &mantissa, &numDigits)) {
+			return false;
+		}
+		exponent = -(int64_t)(numDigits - integerDigits);
+	}
+	if (numDigits == 0) {
+		return false;
+	}
+	if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+		p++;
+		bool negativeExponent = (*p == '-');
+		if (negativeExponent || (*p == '+')) {
+			p++;
+		}
+		uint64_t e = 0;
+		size_t exponentDigits = 0;
+		if (!ParseDigits(&p, end, &e, &exponentDigits) || (exponentDigits == 0) || (e > 1000)) {
+			return false;
+		}
+		exponent += negativeExponent ? -(int64_t)e : (int64_t)e;
+	}
+	if ((p != end) || (mantissa > MAX_EXACT_MANTISSA)) {
+		return false;
+	}
+	if ((exponent < -MAX_EXACT_EXPONENT) || (exponent > MAX_EXACT_EXPONENT)) {
+		return false;
+	}
+	double d = (double)mantissa;
+	d = (exponent < 0) ? d / POWERS_OF_TEN[-exponent] : d * POWERS_OF_TEN[exponent];
+	*value = negative ? -d : d;
+	return true;
+}
+
+/**
+ * @brief 浮動小数点数に変換する
+ * @param text テキスト
+ * @param value 値
+ * @return false: 変換できない
+ */
+bool CsvColumn_ParseDouble(const char *text, double *value) {
+	if (UNLIKELY(!text || !value)) {
+		return false;
+	}
+	const char *end = text + strlen(text);
+	if (LIKELY(TryParseDoubleFast(text, end, value))) {
+		return true;
+	}
+	if ((text == end) || (*text == ' ') || (*text == '\t')) {
+		return false;
+	}
+	pthread_once(&cLocaleOnce, InitCLocale);
+	char *parsed;
+	double d = LIKELY(cLocale) ? strtod_l(text, &parsed, cLocale) : strtod(text, &parsed);
+	if (parsed != end) {
+		return false;
+	}
+	*value = d;
+	return true;
+}
+
+/**
+ * @brief 真偽値に変換する
+ * @param text テキスト
+ * @param value 値
+ * @return false: 変換できない
+ */
+bool CsvColumn_ParseBool(const char *text, bool *value) {
+	if (UNLIKELY(!text || !value)) {
+		return false;
+	}
+	if ((strcmp(text, "1") == 0) || (strcasecmp(text, "true") == 0)) {
+		*value = true;
+		return true;
+	}
+	if ((strcmp(text, "0") == 0) || (strcasecmp(text, "false") == 0)) {
+		*value = false;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief 決まった桁数の数字を変換する
+ * @param p 読む位置 (数字の後ろまで進める)
+ * @param numDigits 桁数
+ * @param value 値
+ * @return false: 数字でない
+ */
+static bool ParseFixedDigits(const char **p, int numDigits, int *value) {
+	int v = 0;
+	for (int i = 0; i < numDigits; i++) {
+		char c = (*p)[i];
+		if (!IsDigit(c)) {
+			return false;
+		}
+		v = v * 10 + (c - '0');
+	}
+	*p += numDigits;
+	*value = v;
+	return true;
+}
+
+/**
+ * @brief 区切り文字を読み飛ばす
+ * @param p 読む位置
+ * @param c 区切り文字
+ * @return false: 区切り文字でない
+ */
+static inline bool Expect(const char **p, char c) {
+	if (**p != c) {
+		return false;
+	}
+	(*p)++;
+	return true;
+}
+
+/**
+ * @brief うるう年か
+ * @param year 年
+ * @return
+ */
+static inline bool IsLeapYear(int year) {
+	return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+}
+
+/**
+ * @brief 1970-01-01からの日数
+ * @param year 年
+ * @param month 月
+ * @param day 日
+ * @return 日数
+ */
+static int64_t DaysFromCivil(int year, int month, int day) {
+	year -= (month <= 2);
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int64_t yearOfEra = year - era * 400;
+	int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+/**
+ * @brief 日時に変換する
+ * @param text テキスト (YYYY-MM-DD[ T]hh:mm:ss[Z]。時刻は省略できる)
+ * @param value UTCとみなしたUNIX時間[秒]
+ * @return false: 変換できない
+ */
+bool CsvColumn_ParseTimestamp(const char *text, int64_t *value) {
+	if (UNLIKELY(!text || !value)) {
+		return false;
+	}
+	static const int DAYS_IN_MONTH[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	const char *p = text;
+	int year, month, day;
+	int hour = 0, minute = 0, second = 0;
+	if (!ParseFixedDigits(&p, 4, &year) || !Expect(&p, '-') ||
+		!ParseFixedDigits(&p, 2, &month) || !Expect(&p, '-') ||
+		!ParseFixedDigits(&p, 2, &day)) {
+		return false;
+	}
+	if ((*p == 'T') || (*p == ' ')) {
+		p++;
+		if (!ParseFixedDigits(&p, 2, &hour) || !Expect(&p, ':') ||
+			!ParseFixedDigits(&p, 2, &minute) || !Expect(&p, ':') ||
+			!ParseFixedDigits(&p, 2, &second)) {
+			return false;
+		}
+		if (*p == 'Z') {
+			p++;
+		}
+	}
+	if (*p != '\0') {
+		return false;
+	}
+	if ((month < 1) || (month > 12) || (hour > 23) || (minute > 59) || (second > 59)) {
+		return false;
+	}
+	int daysInMonth = DAYS_IN_MONTH[month - 1] + (((month == 2) && IsLeapYear(year)) ? 1 : 0);
+	if ((day < 1) || (day > daysInMonth)) {
+		return false;
+	}
+	*value = DaysFromCivil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+	return true;
+}
+
+/**
+ * @brief セルを変換する
+ * @param self インスタンス
+ * @param row 行
+ * @param text テキスト
+ * @return false: 変換できない
+ */
+static inline bool ParseCell(CsvColumn_t *self, size_t row, const char *text) {
+	switch (self->type) {
+	case CSV_COLUMN_INT64:
+		return CsvColumn_ParseInt64(text, &self->values.int64s[row]);
+	case CSV_COLUMN_DOUBLE:
+		return CsvColumn_ParseDouble(text, &self->values.doubles[row]);
+	case CSV_COLUMN_BOOL:
+		return CsvColumn_ParseBool(text, &self->values.bools[row]);
+	case CSV_COLUMN_TIMESTAMP:
+		return CsvColumn_ParseTimestamp(text, &self->values.timestamps[row]);
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief 型の大きさ
+ * @param type 型
+ * @return バイト数 (0: 無効な型)
+ */
+static size_t SizeOfType(CsvColumnType type) {
+	switch (type) {
+	case CSV_COLUMN_INT64:
+		return sizeof(int64_t);
+	case CSV_COLUMN_DOUBLE:
+		return sizeof(double);
+	case CSV_COLUMN_BOOL:
+		return sizeof(bool);
+	case CSV_COLUMN_TIMESTAMP:
+		return sizeof(int64_t);
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief 列を取り出して型に変換する
+ * @note 値は行の順に連続した配列へ格納する。変換できなかったセル(列が無い行を含む)は0にして、
+ * CsvColumn_HasError で分かるようにする
+ * @param self インスタンス
+ * @param content コンテンツ
+ * @param column 列
+ * @param type 型
+ * @param firstRow 取り出し始める行 (ヘッダーを飛ばすときは1)
+ * @return ステータス
+ */
+CsvReturnCode CsvColumn_Extract(CsvColumn_t *self, const CsvContent_t *content, size_t column, CsvColumnType type, size_t firstRow) {
+	if (UNLIKELY(!self || !content)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	CLEAR(self);
+	size_t elementSize = SizeOfType(type);
+	if (UNLIKELY(elementSize == 0)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	size_t numRows = CsvContent_GetRowCount(content);
+	size_t length = (numRows > firstRow) ? numRows - firstRow : 0;
+	void *values = calloc(length ? length : 1, elementSize);
+	uint64_t *errors = calloc((length + 63) / 64 + 1, sizeof(uint64_t));
+	if (UNLIKELY(!values || !errors)) {
+		free(values);
+		free(errors);
+		return CSV_INVALID_PARAMETER;
+	}
+	self->type = type;
+	self->length = length;
+	self->values.int64s = values;
+	self->errors = errors;
+	for (size_t i = 0; i < length; i++) {
+		const char *text = CsvContent_GetText(content, firstRow + i, column);
+		if (UNLIKELY(!text || !ParseCell(self, i, text))) {
+			errors[i / 64] |= 1ULL << (i % 64);
+			self->numErrors++;
+		}
+	}
+	return CSV_SUCCESS;
+}
+
+/**
+ * @brief 変換できなかったセルか
+ * @param self インスタンス
+ * @param row 行 (firstRow からの位置)
+ * @return
+ */
+bool CsvColumn_HasError(const CsvColumn_t *self, size_t row) {
+	if (UNLIKELY(!self || row >= self->length)) {
+		return true;
+	}
+	return (self->errors[row / 64] >> (row % 64)) & 1;
+}
+
+/**
+ * @brief インスタンスを破棄
+ * @param self インスタンス
+ */
+void CsvColumn_Destroy(CsvColumn_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	free(self->values.int64s);
+	free(self->errors);
+	CLEAR(self);
+}
@@ -24,6 +24,33 @@ static inline bool NeedResize(CsvItemCollection_t *self) {
 	return self->length >= self->capacity;
 }
 
+/**
+ * @brief ビューか
+ * @note ビューは他のコレクションの要素を参照しているだけで、領域を持たない
+ * @param self インスタンス
+ * @return
+ */
+static inline bool IsView(const CsvItemCollection_t *self) {
+	return self->capacity == 0;
+}
+
+/**
+ * @brief 必要な数が入るまで広げる
+ * @note キャパシティーは2倍ずつ広げる。ビューは INITIAL_CAPACITY から数える
+ * @param self インスタンス
+ * @param required 必要な数
+ */
+static void Reserve(CsvItemCollection_t *self, size_t required) {
+	if (required <= self->capacity) {
+		return;
+	}
+	size_t newCapacity = self->capacity ? self->capacity : INITIAL_CAPACITY;
+	while (newCapacity < required) {
+		newCapacity *= 2;
+	}
+	CsvItemCollection_Resize(self, newCapacity);
+}
+
 /**
  * @brief 初期化
  * @param self
@@ -35,13 +62,43 @@ void CsvItemCollection_Init(CsvItemCollection_t *self) {
 	self->length = 0;
 }
 
+/**
+ * @brief 他のコレクションの要素を参照するビューとして初期化
+ * @note ビューは要素を所有しないので、破棄しても要素は解放しない
+ * @param self インスタンス
+ * @param list 参照する要素
+ * @param length 要素数
+ */
+void CsvItemCollection_InitView(CsvItemCollection_t *self, CsvItem_t *list, size_t length) {
+	CLEAR(self);
+	self->list = list;
+	self->length = length;
+}
+
 /**
  * @brief リサイズ
+ * @note ビューは参照先を書き換えないよう、自分の領域に写してから所有する (コピーオンライト)
  * @param self インスタンス
  * @param newCapacity サイズ
  */
 void CsvItemCollection_Resize(CsvItemCollection_t *self, size_t newCapacity) {
-	self->list = realloc(self->list, newCapacity * sizeof(CsvItem_t));
+	if (!IsView(self)) {
+		self->list = realloc(self->list, newCapacity * sizeof(CsvItem_t));
+		self->capacity = newCapacity;
+		return;
+	}
+	if (newCapacity == 0) {
+		return;	// ビューのまま
+	}
+	CsvItem_t *list = malloc(newCapacity * sizeof(CsvItem_t));
+	if (UNLIKELY(!list)) {
+		return;
+	}
+	self->length = (self->length < newCapacity) ? self->length : newCapacity;
+	if (self->length > 0) {
+		memcpy(list, self->list, self->length * sizeof(CsvItem_t));
+	}
+	self->list = list;
 	self->capacity = newCapacity;
 }
 
@@ -62,16 +119,39 @@ void CsvItemCollection_MoveOwner(CsvItemCollection_t *self, CsvItemCollection_t
  */
 void CsvItemCollection_MoveAndAdd(CsvItemCollection_t *self, CsvItem_t *item) {
 	if (NeedResize(self)) {
-		CsvItemCollection_Resize(self, self->capacity * 2);
+		Reserve(self, self->length + 1);
+		if (UNLIKELY(NeedResize(self))) {
+			return;	// 広げられない
+		}
 	}
 	CsvItem_MoveOwner(item, &self->list[self->length++]);
 }
 
+/**
+ * @brief 別のコレクションの要素をすべて追加
+ * @param self インスタンス
+ * @param items 移すコレクション (空になる)
+ */
+void CsvItemCollection_MoveAndAddAll(CsvItemCollection_t *self, CsvItemCollection_t *items) {
+	size_t required = self->length + items->length;
+	Reserve(self, required);
+	if (UNLIKELY(required > self->capacity)) {
+		return;	// 広げられない
+	}
+	memcpy(&self->list[self->length], items->list, items->length * sizeof(CsvItem_t));
+	self->length = required;
+	items->length = 0;
+}
+
 /**
  * @brief インスタンスを破棄
  * @param self インスタンス
  */
 void CsvItemCollection_Destroy(CsvItemCollection_t *self) {
+	if (self->capacity == 0) {
+		CLEAR(self);	// ビューは要素を所有しない
+		return;
+	}
 	for (size_t i = 0; i < self->length; i++) {
 		CsvItem_t *item = &self->list[i];
 		CsvItem_Destroy(item);
@@ -84,6 +164,10 @@ void CsvItemCollection_Destroy(CsvItemCollection_t *self) {
  * @param self インスタンス
  */
 void CsvItemCollection_Clear(CsvItemCollection_t *self) {
+	if (IsView(self)) {
+		self->length = 0;	// 参照先は書き換えない
+		return;
+	}
 	memset(self->list, 0, sizeof(*self->list) * self->length);
 	self->length = 0;
 }
@@ -20,6 +20,17 @@ void CsvLine_Init(CsvLine_t *self) {
 	CsvItemCollection_Init(&self->items);
 }
 
+/**
+ * @brief 他で管理しているアイテムを参照する行として初期化
+ * @param self インスタンス
+ * @param items アイテム
+ * @param length アイテム数
+ */
+void CsvLine_InitView(CsvLine_t *self, CsvItem_t *items, size_t length) {
+	CLEAR(self);
+	CsvItemCollection_InitView(&self->items, items, length);
+}
+
 /**
  * @brief ムーブセマンティクス
  * @param self インスタンス
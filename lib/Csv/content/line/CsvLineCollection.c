@@ -57,6 +57,25 @@ void CsvLineCollection_MoveAndAdd(CsvLineCollection_t *self, CsvLine_t *line) {
 	CsvLine_MoveOwner(line, &self->list[self->length++]);
 }
 
+/**
+ * @brief 別のコレクションの要素をすべて追加
+ * @param self インスタンス
+ * @param lines 移すコレクション (空になる)
+ */
+void CsvLineCollection_MoveAndAddAll(CsvLineCollection_t *self, CsvLineCollection_t *lines) {
+	size_t required = self->length + lines->length;
+	if (required > self->capacity) {
+		size_t newCapacity = self->capacity ? self->capacity : INITIAL_CAPACITY;
+		while (newCapacity < required) {
+			newCapacity *= 2;
+		}
+		CsvLineCollection_Resize(self, newCapacity);
+	}
+	memcpy(&self->list[self->length], lines->list, lines->length * sizeof(CsvLine_t));
+	self->length = required;
+	lines->length = 0;
+}
+
 /**
  * @brief インスタンスを破棄
  * @param self インスタンス
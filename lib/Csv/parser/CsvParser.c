@@ -7,10 +7,17 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "Csv/property/CsvProperty.h"
 #include "Csv/content/CsvContent.h"
 #include "Csv/parser/CsvParser.h"
+#include <pthread.h>
+#include "Thread/ThreadPool.h"
 #include "utilities.h"
+#include "CsvScanner.h"
+#include "CsvSelection.h"
+#include "CsvRowIndex.h"
 
 /**
  * @brief ファイルバッファ
@@ -18,6 +25,10 @@
 typedef struct FileBuffer_t {
 	char *data;
 	size_t size;
+	//! 番兵(EOF)より前のサイズ (これより前の0xFFは番兵ではない)
+	size_t length;
+	//! ファイルをマッピングした場合の情報 (mapping.data==NULL: mallocした)
+	FileMapping_t mapping;
 } FileBuffer_t;
 
 /**
@@ -28,37 +39,28 @@ struct CsvParser_t {
 	CsvProperties_t properties;
 	CsvContent_t content;
 	FileBuffer_t file;
+	CsvScanner_t scanner;
+	//! 取り出す列と残す行
+	CsvSelection_t selection;
+	//! 並列にパースするスレッドプール (NULL: 並列にしない)
+	ThreadPool_t *threadPool;
+	//! 行の先頭位置の索引 (遅延モードのとき使う)
+	CsvRowIndex_t rowIndex;
 };
 
 //! ファイルの終端識別子
 #define EOF				((uint8_t)0xFF)
 //! EOFの長さ
 #define EOF_LENGTH		(sizeof(EOF))
-//! コンマ
-#define COMMA			(',')
+//! 並列にパースする1分割の最小サイズ
+#define MIN_CHUNK_SIZE		((size_t)1024 * 1024)
+//! スレッドあたりの分割数 (分割ごとの偏りをならす)
+#define CHUNKS_PER_THREAD	(4)
 //! 改行文字
 #define CARRIGE_RETURN	('\r')
 //! 改行文字
 #define LINE_FEED		('\n')
 
-/**
- * @brief ファイルの終端化判定
- * @param c 文字
- * @return
- */
-static inline bool IsEof(char c) {
-	return (uint8_t)c == EOF;
-}
-
-/**
- * @brief コンマか
- * @param c 文字
- * @return
- */
-static inline bool IsComma(char c) {
-	return c == COMMA;
-}
-
 /**
  * @brief 改行文字か
  * @param c 文字
@@ -105,126 +107,851 @@ static inline bool IsExtraChars(char c) {
 }
 
 /**
- * @brief アスキー文字か
- * @param c
- * @return
+ * @brief 末尾の不要な文字を除いた長さを求める
+ * @param data データ
+ * @param size サイズ
+ * @return 長さ
  */
-static inline bool IsAscii(char c) {
-	return (uint8_t)c <= 0x7F;
+static size_t TrimExtraChars(const char *data, size_t size) {
+	size_t length = size;
+	while ((length > 1) && IsExtraChars(data[length - 1])) {
+		length--;
+	}
+	return length;
 }
 
 /**
- * @brief 有効な文字コードか
- * @param data データ
- * @param size サイズ
- * @return
+ * @brief EOFで埋める
+ * @note 末尾の不要な文字と、後ろの番兵の領域をEOFにする
+ * @param data データ (後ろに EOF_LENGTH バイトの領域があること)
+ * @param size 番兵の領域を除いたサイズ
+ * @return 番兵より前のサイズ
  */
-static bool IsNotSupportedCharCode(const char *data, size_t size) {
-	for (size_t i = 0; i < size; i++) {
-		if (!IsAscii(data[i]) && !IsEof(data[i])) {
-			return true;
+static size_t FillEof(char *data, size_t size) {
+	size_t length = TrimExtraChars(data, size);
+	memset(data + length, EOF, size - length + EOF_LENGTH);
+	return length;
+}
+
+/**
+ * @brief 番兵の領域だけをEOFで埋める
+ * @note 遅延モードでマッピングしたファイルを書き換えないよう、末尾の不要な文字は長さから外すだけにする
+ * @param data データ (後ろに EOF_LENGTH バイトの領域があること)
+ * @param size 番兵の領域を除いたサイズ
+ * @return 番兵より前のサイズ
+ */
+static size_t PlaceEof(char *data, size_t size) {
+	memset(data + size, EOF, EOF_LENGTH);
+	return TrimExtraChars(data, size);
+}
+
+//! 列が無いセルのテキスト
+static char EMPTY_TEXT[] = "";
+
+/**
+ * @brief 作成中の行
+ */
+typedef struct RowBuilder_t {
+	const CsvScanner_t *scanner;
+	//! 取り出す列と残す行 (NULL: すべて残す)
+	const CsvSelection_t *selection;
+	CsvContent_t *content;
+	//! 元の列ごとのテキスト (列を選ぶ場合)
+	char **values;
+	//! 次のフィールドの元の列
+	size_t column;
+	//! 条件を満たさなかった
+	bool isRejected;
+} RowBuilder_t;
+
+/**
+ * @brief 引用符とエスケープを外す
+ * @note 引用符で囲まれておらずエスケープも無ければ、元のデータを指すだけでコピーしない
+ * @param scanner スキャナー
+ * @param start フィールドの先頭
+ * @param end フィールドの終わり (終端済み)
+ * @return テキスト
+ */
+static inline char *Unquote(const CsvScanner_t *scanner, char *start, char *end) {
+	return ((*start == scanner->quote) || scanner->escape) ? CsvScanner_Unquote(scanner, start, end) : start;
+}
+
+/**
+ * @brief 作成中の行を初期化
+ * @param row 作成中の行
+ * @param scanner スキャナー
+ * @param selection 取り出す列と残す行 (NULL: すべて残す)
+ * @param content 行を追加する先
+ * @return false: メモリ不足
+ */
+static bool RowBuilder_Init(RowBuilder_t *row, const CsvScanner_t *scanner, const CsvSelection_t *selection, CsvContent_t *content) {
+	CLEAR(row);
+	row->scanner = scanner;
+	row->selection = selection;
+	row->content = content;
+	if (selection && (selection->numColumns > 0)) {
+		row->values = calloc(selection->numRoles, sizeof(char *));
+		return row->values != NULL;
+	}
+	return true;
+}
+
+/**
+ * @brief 作成中の行を破棄
+ * @param row 作成中の行
+ */
+static void RowBuilder_Destroy(RowBuilder_t *row) {
+	free(row->values);
+	CLEAR(row);
+}
+
+/**
+ * @brief フィールドを終える
+ * @note 列を選ぶ場合、使わない列は引用符も外さずに読み飛ばす。
+ * 条件を満たさなかった行は、残りのフィールドを読み飛ばす
+ * @param row 作成中の行
+ * @param start フィールドの先頭
+ * @param end フィールドの終わり (終端済み)
+ */
+static inline void EndField(RowBuilder_t *row, char *start, char *end) {
+	const CsvSelection_t *selection = row->selection;
+	if (LIKELY(!selection)) {
+		CsvContent_AddItem(row->content, Unquote(row->scanner, start, end));
+		return;
+	}
+	size_t column = row->column++;
+	uint8_t role = CsvSelection_GetRole(selection, column);
+	if (row->isRejected || ((selection->numColumns > 0) && (role == 0))) {
+		return;
+	}
+	char *text = Unquote(row->scanner, start, end);
+	if ((role & CSV_SELECTION_PREDICATE) && !CsvSelection_Test(selection, column, text)) {
+		row->isRejected = true;
+		return;
+	}
+	if (selection->numColumns == 0) {
+		CsvContent_AddItem(row->content, text);
+	} else {
+		row->values[column] = text;
+	}
+}
+
+/**
+ * @brief 行を終える
+ * @param row 作成中の行
+ */
+static inline void EndRow(RowBuilder_t *row) {
+	const CsvSelection_t *selection = row->selection;
+	if (LIKELY(!selection)) {
+		CsvContent_EndLine(row->content);
+		return;
+	}
+	if (row->isRejected || (row->column < selection->minColumns)) {
+		CsvContent_DiscardLine(row->content);	// 条件を満たさないか、条件の列が無い
+	} else {
+		for (size_t i = 0; i < selection->numColumns; i++) {
+			char *text = row->values[selection->columns[i]];
+			CsvContent_AddItem(row->content, text ? text : EMPTY_TEXT);
+		}
+		CsvContent_EndLine(row->content);
+	}
+	if (row->values) {
+		memset(row->values, 0, selection->numRoles * sizeof(char *));
+	}
+	row->column = 0;
+	row->isRejected = false;
+}
+
+/**
+ * @brief 行頭のコメント行を読み飛ばす
+ * @note 読み飛ばす行もUTF-8として検証する
+ * @param scanner スキャナー
+ * @param start 行の先頭。次の行の先頭に更新する (NULL: 範囲の終わりまでコメント)
+ * @param end 範囲の終わり (番兵を含まない)
+ * @return false: 不正な文字コード
+ */
+static bool SkipComments(const CsvScanner_t *scanner, char **start, char *end) {
+	char *line = *start;
+	while (scanner->comment && line && (line < end) && (*line == scanner->comment)) {
+		char *lineFeed = memchr(line, LINE_FEED, (size_t)(end - line));
+		if (!CsvScanner_ValidateText(scanner, line, (size_t)((lineFeed ? lineFeed : end) - line))) {
+			return false;
 		}
+		line = lineFeed ? lineFeed + 1 : NULL;
 	}
-	return false;
+	*start = line;
+	return true;
 }
 
 /**
- * @brief EOFで埋める
+ * @brief ブロックのUTF-8を検証する
+ * @note 番兵より後ろは調べない。番兵より前の0xFFは不正な文字コードになる
+ * @param scanner スキャナー
+ * @param block ブロック
+ * @param size 番兵までの残りのサイズ
+ * @param mask ブロックの検索結果
+ * @param state ブロックをまたいで引き継ぐ状態
+ * @return false: 不正な文字コード
+ */
+static inline bool ValidateBlock(const CsvScanner_t *scanner, const char *block, size_t size, const CsvScanMask_t *mask, CsvUtf8State_t *state) {
+	uint64_t nonAscii = mask->nonAscii;
+	if (size < CSV_SCAN_BLOCK_SIZE) {
+		nonAscii &= (1ULL << size) - 1;
+	} else {
+		size = CSV_SCAN_BLOCK_SIZE;
+	}
+	return CsvScanner_ValidateUtf8(scanner, block, size, nonAscii, state);
+}
+
+/**
+ * @brief 範囲をパースする
+ * @note スキャナーで区切り文字とEOFの位置をまとめて求め、その位置だけを調べる
+ * @note 引用符で囲まれた範囲とエスケープされた区切り文字と改行文字はフィールドの一部として扱う
+ * @note ブロックごとにUTF-8を検証してから区切る
+ * @note コメント行を読み飛ばしたら、引用符の状態を捨てて次の行の先頭から調べ直す
+ * @note アイテムは行ごとに確保せず、content のアイテム配列へ順に並べる
+ * @note 範囲はレコードの先頭から始まり、改行文字の直後かEOFで終わること
+ * @note 番兵とみなすのは eof の位置だけで、それより前の0xFFは不正な文字コードとする
+ * @param scanner スキャナー
+ * @param selection 取り出す列と残す行 (NULL: すべて残す)
+ * @param data 範囲の先頭
+ * @param size 範囲のサイズ
+ * @param eof 番兵の位置 (範囲より後ろでもよい)
+ * @param content 行を追加する先
+ * @param reachedEof EOFまで読んだか
+ * @return 結果
+ */
+static CsvReturnCode ParseRange(const CsvScanner_t *scanner, const CsvSelection_t *selection, char *data, size_t size, char *eof, CsvContent_t *content, bool *reachedEof) {
+	RowBuilder_t row;
+	if (!RowBuilder_Init(&row, scanner, selection, content)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	char *end = data + size;
+	char *limit = (eof < end) ? eof : end;	// 番兵より前
+	char *itemStart = data;
+	CsvReturnCode ret = SkipComments(scanner, &itemStart, limit) ? CSV_SUCCESS : CSV_INVALID_CHAR_CODE;
+	char *processed = itemStart;	// CRLFのLFのように、処理済みの文字を読み飛ばすため
+	CsvScanState_t state;
+	CsvUtf8State_t utf8;
+	CLEAR(&state);
+	CLEAR(&utf8);
+	*reachedEof = !itemStart;
+
+	size_t offset = itemStart ? (size_t)(itemStart - data) : size;
+	while ((offset < size) && !*reachedEof && (ret == CSV_SUCCESS)) {
+		CsvScanMask_t mask;
+		char *block = data + offset;
+		size_t next = offset + CSV_SCAN_BLOCK_SIZE;
+		CsvScanner_Next(scanner, block, size - offset, &state, &mask);
+		if (!ValidateBlock(scanner, block, (size_t)(limit - block), &mask, &utf8)) {
+			ret = CSV_INVALID_CHAR_CODE;
+			break;
+		}
+		for (uint64_t bits = mask.structurals | mask.sentinels; bits != 0; bits &= bits - 1) {
+			int index = __builtin_ctzll(bits);
+			char *c = block + index;
+			if (c < processed) {
+				continue;
+			}
+			if (c >= eof) {	// 末尾の不要な文字は番兵に置き換えていないので、それより後ろも終わりとみなす
+				if (mask.quoted & (1ULL << index)) {
+					ret = CSV_INVALID_FORMAT;	// 引用符が閉じていない
+					break;
+				}
+				Terminate(c);
+				EndField(&row, itemStart, c);
+				EndRow(&row);
+				*reachedEof = true;
+				break;
+			}
+			char *nextChar = c + 1;
+			if (*c == scanner->delimiter) {
+				Terminate(c);	// 終端
+				EndField(&row, itemStart, c);
+				itemStart = nextChar;
+				continue;
+			}
+			char *rowEnd;
+			if (IsCrLf(*c, *nextChar)) {
+				Terminate(nextChar);
+				rowEnd = nextChar + 1;
+			} else if (IsCr(*c)) {
+				rowEnd = nextChar;
+			} else {
+				continue;
+			}
+			Terminate(c);
+			EndField(&row, itemStart, c);
+			EndRow(&row);
+			itemStart = rowEnd;
+			processed = rowEnd;
+			if (LIKELY(!scanner->comment) || (rowEnd >= end) || (*rowEnd != scanner->comment)) {
+				continue;
+			}
+			if (!SkipComments(scanner, &itemStart, limit)) {
+				ret = CSV_INVALID_CHAR_CODE;
+			} else if (!itemStart) {
+				*reachedEof = true;
+			} else {
+				// コメント行の引用符を数えないよう、次の行の先頭から調べ直す
+				processed = itemStart;
+				next = (size_t)(itemStart - data);
+				CLEAR(&state);
+				CLEAR(&utf8);
+			}
+			break;
+		}
+		offset = next;
+	}
+	// 改行文字の直後かEOFで終わったので、作りかけの行は空
+	RowBuilder_Destroy(&row);
+	return ret;
+}
+
+/**
+ * @brief パース結果を捨てる
+ * @param self インスタンス
+ */
+static void ResetContent(CsvParser_t *self) {
+	CsvContent_Destroy(&self->content);
+	CsvContent_Init(&self->content);
+}
+
+/**
+ * @brief 並列にパースする分割数を求める
+ * @note コメント行の中の引用符は数えられないので、コメント文字があれば並列にしない
+ * @param self インスタンス
+ * @return 分割数 (1: 並列にしない)
+ */
+static size_t CountChunks(const CsvParser_t *self) {
+	if (!self->threadPool || self->scanner.comment) {
+		return 1;
+	}
+	size_t numChunks = (size_t)ThreadPool_GetNumThreads(self->threadPool) * CHUNKS_PER_THREAD;
+	size_t maxChunks = self->file.size / MIN_CHUNK_SIZE;
+	return (numChunks < maxChunks) ? numChunks : (maxChunks ? maxChunks : 1);
+}
+
+/**
+ * @brief 次のレコードの先頭を探す
+ * @note 引用符で囲まれておらず、エスケープされていない改行文字の直後がレコードの先頭になる
+ * @param scanner スキャナー
  * @param data データ
- * @param size サイズ
+ * @param from 探し始める位置
+ * @param size データサイズ
+ * @param isQuoted from の位置が引用符で囲まれているか
+ * @return 位置 (size: 見つからない)
  */
-static void FillEof(char *data, size_t size) {
-	// 最後の値は必ずEofにする
-	data[size - 1] = EOF;
-	for (size_t i = size - 2; i != 0; i--) {
-		if (!IsExtraChars(data[i])) {
-			return;
+static size_t FindRecordStart(const CsvScanner_t *scanner, const char *data, size_t from, size_t size, bool isQuoted) {
+	CsvScanState_t state = {
+		.quoted = isQuoted ? ~0ULL : 0,
+		.escaped = CsvScanner_IsEscaped(scanner, data, from),
+	};
+	for (size_t offset = from; offset < size; offset += CSV_SCAN_BLOCK_SIZE) {
+		CsvScanMask_t mask;
+		CsvScanner_Next(scanner, data + offset, size - offset, &state, &mask);
+		for (uint64_t bits = mask.structurals; bits != 0; bits &= bits - 1) {
+			size_t position = offset + __builtin_ctzll(bits);
+			if (IsCr(data[position])) {
+				return position + 1;
+			}
 		}
-		data[i] = EOF;
 	}
+	return size;
 }
 
 /**
- * @brief パース
+ * @brief すべての分割の処理が終わるのを待つための同期
+ */
+typedef struct ParseLatch_t {
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+	size_t remaining;
+} ParseLatch_t;
+
+/**
+ * @brief 分割したパース
+ */
+typedef struct ParseChunk_t {
+	const CsvScanner_t *scanner;
+	const CsvSelection_t *selection;
+	char *data;
+	size_t size;
+	//! 番兵の位置
+	char *eof;
+	//! 範囲内のエスケープされていない引用符の数
+	size_t numQuotes;
+	//! 範囲の先頭がエスケープされているか
+	bool isEscaped;
+	//! 分割ごとのパース結果
+	CsvContent_t content;
+	CsvReturnCode status;
+	bool reachedEof;
+	ParseLatch_t *latch;
+} ParseChunk_t;
+
+/**
+ * @brief 分割の処理が終わったことを知らせる
+ * @param chunk 分割
+ */
+static void CountDownLatch(ParseChunk_t *chunk) {
+	ParseLatch_t *latch = chunk->latch;
+	pthread_mutex_lock(&latch->mutex);
+	if (--latch->remaining == 0) {
+		pthread_cond_signal(&latch->condition);
+	}
+	pthread_mutex_unlock(&latch->mutex);
+}
+
+/**
+ * @brief ワーカースレッドで分割内の引用符を数える
+ * @param arg 分割
+ */
+static void CountQuotes(void *arg) {
+	ParseChunk_t *chunk = (ParseChunk_t *)arg;
+	size_t numQuotes = 0;
+	CsvScanState_t state = { .quoted = 0, .escaped = chunk->isEscaped };
+	for (size_t offset = 0; offset < chunk->size; offset += CSV_SCAN_BLOCK_SIZE) {
+		CsvScanMask_t mask;
+		CsvScanner_Next(chunk->scanner, chunk->data + offset, chunk->size - offset, &state, &mask);
+		numQuotes += (size_t)__builtin_popcountll(mask.quotes);
+	}
+	chunk->numQuotes = numQuotes;
+	CountDownLatch(chunk);
+}
+
+/**
+ * @brief ワーカースレッドで分割をパースする
+ * @param arg 分割
+ */
+static void ParseChunk(void *arg) {
+	ParseChunk_t *chunk = (ParseChunk_t *)arg;
+	chunk->status = ParseRange(chunk->scanner, chunk->selection, chunk->data, chunk->size, chunk->eof, &chunk->content, &chunk->reachedEof);
+	CountDownLatch(chunk);
+}
+
+/**
+ * @brief すべての分割をワーカーで処理し、終わるまで待つ
+ * @note タスクを積めなかった分割と、ワーカーから呼ばれた場合のすべての分割は呼び出し元で処理する
+ * @param self インスタンス
+ * @param chunks 分割
+ * @param numChunks 分割数
+ * @param function 処理
+ */
+static void RunChunks(CsvParser_t *self, ParseChunk_t *chunks, size_t numChunks, void (*function)(void *)) {
+	ParseLatch_t latch;
+	pthread_mutex_init(&latch.mutex, NULL);
+	pthread_cond_init(&latch.condition, NULL);
+	latch.remaining = numChunks;
+	// ワーカーから積むと、空きワーカーが無いときに自分の終わりを待ち続ける
+	bool isWorker = ThreadPool_IsWorker(self->threadPool);
+	for (size_t i = 0; i < numChunks; i++) {
+		chunks[i].latch = &latch;
+		ThreadPoolTask_t task = { .function = function, .arg = &chunks[i] };
+		if (isWorker || (ThreadPool_Push(self->threadPool, &task) != 0)) {
+			function(&chunks[i]);
+		}
+	}
+	pthread_mutex_lock(&latch.mutex);
+	while (latch.remaining > 0) {
+		pthread_cond_wait(&latch.condition, &latch.mutex);
+	}
+	pthread_mutex_unlock(&latch.mutex);
+	pthread_cond_destroy(&latch.condition);
+	pthread_mutex_destroy(&latch.mutex);
+}
+
+/**
+ * @brief 分割の結果を順に繋げる
+ * @note 逐次にパースした場合と同じ結果にするため、最初にEOFかエラーになった分割より後ろは捨てる
  * @param self インスタンス
+ * @param chunks 分割
+ * @param numChunks 分割数
  * @return 結果
  */
-static CsvReturnCode Parse(CsvParser_t *self) {
-	if (IsNotSupportedCharCode(self->file.data, self->file.size)) {
+static CsvReturnCode Stitch(CsvParser_t *self, ParseChunk_t *chunks, size_t numChunks) {
+	CsvReturnCode ret = CSV_SUCCESS;
+	bool done = false;
+	for (size_t i = 0; i < numChunks; i++) {
+		ParseChunk_t *chunk = &chunks[i];
+		if (!done && (chunk->status != CSV_SUCCESS)) {
+			ret = chunk->status;
+			done = true;
+		}
+		if (!done) {
+			CsvContent_MoveBackContent(&self->content, &chunk->content);
+			done = chunk->reachedEof;
+		}
+		CsvContent_Destroy(&chunk->content);
+	}
+	return ret;
+}
+
+/**
+ * @brief スレッドプールで並列にパースする
+ * @note まず均等に分けた範囲ごとに引用符を並列に数え、その累計の偶奇から
+ * 各分割点が引用符で囲まれているかを求めて、囲まれていないレコードの境界で分割し直す。
+ * 分割ごとにワーカーでパースしてから順に繋げる
+ * @param self インスタンス
+ * @param selection 取り出す列と残す行 (NULL: すべて残す)
+ * @param data 範囲の先頭 (レコードの先頭)
+ * @param size 範囲のサイズ
+ * @param numChunks 分割数
+ * @return 結果
+ */
+static CsvReturnCode ParseParallel(CsvParser_t *self, const CsvSelection_t *selection, char *data, size_t size, size_t numChunks) {
+	ParseChunk_t *chunks = calloc(numChunks, sizeof(ParseChunk_t));
+	if (UNLIKELY(!chunks)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	size_t nominalSize = size / numChunks;
+	for (size_t i = 0; i < numChunks; i++) {
+		ParseChunk_t *chunk = &chunks[i];
+		chunk->scanner = &self->scanner;
+		chunk->selection = selection;
+		chunk->data = data + i * nominalSize;
+		chunk->size = (i == numChunks - 1) ? size - i * nominalSize : nominalSize;
+		chunk->eof = self->file.data + self->file.length;
+		chunk->isEscaped = CsvScanner_IsEscaped(&self->scanner, data, i * nominalSize);
+	}
+	RunChunks(self, chunks, numChunks, CountQuotes);
+
+	size_t start = 0;
+	size_t numQuotes = 0;
+	size_t count = 0;
+	for (size_t i = 0; (i < numChunks) && (start < size); i++) {
+		size_t nominalEnd = (i + 1) * nominalSize;
+		numQuotes += chunks[i].numQuotes;
+		size_t end = size;
+		if (i < numChunks - 1) {
+			end = FindRecordStart(&self->scanner, data, nominalEnd, size, numQuotes & 1);
+			if (end <= start) {
+				continue;	// 長いフィールドが前の分割点をまたいだ
+			}
+		}
+		ParseChunk_t *chunk = &chunks[count++];
+		chunk->data = data + start;
+		chunk->size = end - start;
+		CsvContent_Init(&chunk->content);
+		start = end;
+	}
+	RunChunks(self, chunks, count, ParseChunk);
+
+	CsvReturnCode ret = Stitch(self, chunks, count);
+	free(chunks);
+	return ret;
+}
+
+/**
+ * @brief ヘッダーをパースする
+ * @note ヘッダーは条件で捨てず、列名を解決してから選んだ列だけを残す
+ * @note 先頭のコメント行は読み飛ばす
+ * @param self インスタンス
+ * @param headerSize ヘッダーのサイズ
+ * @param reachedEof EOFまで読んだか
+ * @return 結果
+ */
+static CsvReturnCode ParseHeader(CsvParser_t *self, size_t *headerSize, bool *reachedEof) {
+	char *data = self->file.data;
+	char *start = data;
+	if (!SkipComments(&self->scanner, &start, data + self->file.length)) {
 		return CSV_INVALID_CHAR_CODE;
 	}
-	CsvLine_t line;
-	CsvItem_t item;
-	CsvLine_Init(&line);
-	CsvItem_Init(&item);
-	CsvItem_Set(&item, self->file.data);
+	if (!start) {
+		*headerSize = self->file.size;
+		*reachedEof = true;
+		return CsvSelection_Resolve(&self->selection, NULL) ? CSV_SUCCESS : CSV_INVALID_PARAMETER;
+	}
+	size_t size = FindRecordStart(&self->scanner, data, (size_t)(start - data), self->file.size, false);
+	CsvContent_t header;
+	CsvContent_Init(&header);
+	CsvReturnCode ret = ParseRange(&self->scanner, NULL, start, size - (size_t)(start - data), data + self->file.length, &header, reachedEof);
+	CsvContent_Finalize(&header);
+	CsvContent_IndexHeader(&header);
+	const CsvLine_t *line = (header.lines.length > 0) ? &header.lines.list[0] : NULL;
+	if ((ret == CSV_SUCCESS) && !CsvSelection_Resolve(&self->selection, &header)) {
+		ret = CSV_INVALID_PARAMETER;	// 見つからない列名がある
+	}
+	if ((ret == CSV_SUCCESS) && line) {
+		const CsvSelection_t *selection = &self->selection;
+		size_t numColumns = selection->numColumns ? selection->numColumns : line->items.length;
+		for (size_t i = 0; i < numColumns; i++) {
+			size_t column = selection->numColumns ? selection->columns[i] : i;
+			const char *text = CsvContent_GetText(&header, 0, column);
+			CsvContent_AddItem(&self->content, text ? (char *)text : EMPTY_TEXT);
+		}
+		CsvContent_EndLine(&self->content);
+	}
+	CsvContent_Destroy(&header);
+	*headerSize = size;
+	return ret;
+}
 
-	for (char *c = self->file.data; true; c++) {
-		if (IsEof(*c)) {
-			Terminate(c);
-			CsvLine_MoveBackItem(&line, &item);
-			CsvContent_MoveBackLine(&self->content, &line);
+/**
+ * @brief 行の先頭位置の索引を作る
+ * @note ParseRange と同じ規則で行を区切るが、フィールドには分けず、データも書き換えない
+ * @note UTF-8の検証とコメント行の読み飛ばしも ParseRange と同じように行う
+ * @param self インスタンス
+ * @return 結果
+ */
+static CsvReturnCode BuildIndex(CsvParser_t *self) {
+	const CsvScanner_t *scanner = &self->scanner;
+	char *data = self->file.data;
+	size_t size = self->file.size;
+	char *eof = data + self->file.length;
+	char *rowStart = data;
+	if (!SkipComments(scanner, &rowStart, eof)) {
+		return CSV_INVALID_CHAR_CODE;
+	}
+	if (!rowStart) {
+		return CSV_SUCCESS;	// コメントだけ
+	}
+	if (!CsvRowIndex_Add(&self->rowIndex, (size_t)(rowStart - data))) {
+		return CSV_INVALID_PARAMETER;
+	}
+	char *processed = rowStart;
+	CsvScanState_t state;
+	CsvUtf8State_t utf8;
+	CLEAR(&state);
+	CLEAR(&utf8);
+	bool reachedEof = false;
+	CsvReturnCode ret = CSV_SUCCESS;
+
+	size_t offset = (size_t)(rowStart - data);
+	while ((offset < size) && !reachedEof && (ret == CSV_SUCCESS)) {
+		CsvScanMask_t mask;
+		char *block = data + offset;
+		size_t next = offset + CSV_SCAN_BLOCK_SIZE;
+		CsvScanner_Next(scanner, block, size - offset, &state, &mask);
+		if (!ValidateBlock(scanner, block, (block < eof) ? (size_t)(eof - block) : 0, &mask, &utf8)) {
+			ret = CSV_INVALID_CHAR_CODE;
 			break;
 		}
-		char *nextChar = c + 1;
-		if (IsComma(*c)) {
-			Terminate(c);	// 終端
-			CsvLine_MoveBackItem(&line, &item);
-			CsvItem_Set(&item, nextChar);
-		} else if (IsCrLf(*c, *nextChar)) {
-			Terminate(c);
-			Terminate(nextChar);
-			CsvLine_MoveBackItem(&line, &item);
-			CsvContent_MoveBackLine(&self->content, &line);
-			CsvLine_Init(&line);
-			CsvItem_Set(&item, nextChar + 1);
-		} else if (IsCr(*c)) {
-			Terminate(c);
-			CsvLine_MoveBackItem(&line, &item);
-			CsvContent_MoveBackLine(&self->content, &line);
-			CsvLine_Init(&line);
-			CsvItem_Set(&item, nextChar);
+		for (uint64_t bits = mask.structurals | mask.sentinels; bits != 0; bits &= bits - 1) {
+			int index = __builtin_ctzll(bits);
+			char *c = block + index;
+			if ((c < processed) || (*c == scanner->delimiter)) {
+				continue;
+			}
+			if (c >= eof) {	// 末尾の不要な文字は番兵に置き換えていないので、それより後ろも終わりとみなす
+				if (mask.quoted & (1ULL << index)) {
+					ret = CSV_INVALID_FORMAT;	// 引用符が閉じていない
+				}
+				reachedEof = true;
+				break;
+			}
+			char *rowEnd;
+			if (IsCrLf(*c, c[1])) {
+				rowEnd = c + 2;
+			} else if (IsCr(*c)) {
+				rowEnd = c + 1;
+			} else {
+				continue;
+			}
+			processed = rowEnd;
+			if (LIKELY(!scanner->comment) || (*rowEnd != scanner->comment)) {
+				if (!CsvRowIndex_Add(&self->rowIndex, (size_t)(rowEnd - data))) {
+					ret = CSV_INVALID_PARAMETER;
+					break;
+				}
+				continue;
+			}
+			rowStart = rowEnd;
+			if (!SkipComments(scanner, &rowStart, eof)) {
+				ret = CSV_INVALID_CHAR_CODE;
+			} else if (!rowStart) {
+				reachedEof = true;
+			} else if (!CsvRowIndex_Add(&self->rowIndex, (size_t)(rowStart - data))) {
+				ret = CSV_INVALID_PARAMETER;
+			} else {
+				// コメント行の引用符を数えないよう、次の行の先頭から調べ直す
+				processed = rowStart;
+				next = (size_t)(rowStart - data);
+				CLEAR(&state);
+				CLEAR(&utf8);
+			}
+			break;
+		}
+		offset = next;
+	}
+	return ret;
+}
+
+/**
+ * @brief 索引を使って、触れた行だけをフィールドに分けるようにする
+ * @param self インスタンス
+ */
+static void AttachIndex(CsvParser_t *self) {
+	CsvContent_SetLazyRows(&self->content, &self->rowIndex.rows);
+	if (self->properties.hasHeader) {
+		CsvContent_IndexHeader(&self->content);
+	}
+}
+
+/**
+ * @brief 遅延モードでパースする
+ * @note 行の先頭位置だけを集め、フィールドには行に触れたときに分ける
+ * @param self インスタンス
+ * @return 結果
+ */
+static CsvReturnCode ParseLazy(CsvParser_t *self) {
+	CsvRowIndex_Clear(&self->rowIndex);
+	CsvRowIndex_SetData(&self->rowIndex, self->file.data, self->file.length);
+	CsvReturnCode ret = BuildIndex(self);
+	if (ret != CSV_SUCCESS) {
+		CsvRowIndex_Clear(&self->rowIndex);
+		return ret;
+	}
+	AttachIndex(self);
+	return ret;
+}
+
+/**
+ * @brief パース
+ * @note 列の選択か条件があり、ヘッダーがある場合は、ヘッダーを先にパースする
+ * @note ヘッダーがある場合は、列名から列を引けるようにする
+ * @note 遅延モードでは、行の先頭位置の索引だけを作る
+ * @param self インスタンス
+ * @return 結果
+ */
+static CsvReturnCode Parse(CsvParser_t *self) {
+	if (self->properties.isLazy) {
+		return ParseLazy(self);
+	}
+	const CsvSelection_t *selection = self->selection.isActive ? &self->selection : NULL;
+	size_t start = 0;
+	bool reachedEof = false;
+	CsvReturnCode ret = CSV_SUCCESS;
+	if (selection && self->properties.hasHeader) {
+		ret = ParseHeader(self, &start, &reachedEof);
+	} else if (selection && !CsvSelection_Resolve(&self->selection, NULL)) {
+		ret = CSV_INVALID_PARAMETER;	// 列名で指定したがヘッダーが無い
+	}
+	if ((ret == CSV_SUCCESS) && !reachedEof) {
+		char *data = self->file.data + start;
+		size_t size = self->file.size - start;
+		size_t numChunks = CountChunks(self);
+		if (numChunks > 1) {
+			ret = ParseParallel(self, selection, data, size, numChunks);
 		} else {
-			// do nothing
+			ret = ParseRange(&self->scanner, selection, data, size, self->file.data + self->file.length, &self->content, &reachedEof);
 		}
 	}
-	return CSV_SUCCESS;
+	if (ret != CSV_SUCCESS) {
+		ResetContent(self);
+		return ret;
+	}
+	CsvContent_Finalize(&self->content);
+	if (self->properties.hasHeader) {
+		CsvContent_IndexHeader(&self->content);
+	}
+	return ret;
+}
+
+/**
+ * @brief ファイルをバッファに読み込む
+ * @note フィールドの終端をその場で書き込むので、マッピングせずに読み込む。
+ * MAP_PRIVATEでマッピングしても、書き込んだページはほとんどすべてコピーされる
+ * @param self インスタンス
+ * @param filePath ファイルパス
+ * @return 0=成功
+ */
+static int ReadFile(CsvParser_t *self, const char *filePath) {
+	ssize_t size = File_GetSize(filePath);
+	if (size <= 0) {
+		return (size < 0) ? (int)size : -ENODATA;
+	}
+	size_t allocateSize = (size_t)size + EOF_LENGTH;
+	char *data = malloc(allocateSize);
+	if (UNLIKELY(!data)) {
+		return -ENOMEM;
+	}
+	int ret = File_Read(filePath, data, (size_t)size);
+	if (ret < 0) {
+		free(data);
+		return ret;
+	}
+	self->file.data = data;
+	self->file.size = allocateSize;
+	self->file.length = FillEof(self->file.data, (size_t)size);
+	return 0;
 }
 
 /**
  * @brief ファイル読込み
+ * @note 遅延モードではデータを書き換えないので、ファイルはコピーせずMAP_PRIVATEでマッピングし、
+ * ページキャッシュの上で直接パースする。末尾の番兵(EOF)はマッピングの後ろに付け足した領域に書く
+ * @note 遅延モードでなければバッファに読み込む
  * @param self インスタンス
  * @param filePath ファイルパス
  * @return 0=成功
  */
 static int LoadFile(CsvParser_t *self, const char *filePath) {
-	ssize_t file_size = File_GetSize(filePath);
-	if (file_size < 0) {
-		return (int)file_size;
+	if (!self->properties.isLazy) {
+		return ReadFile(self, filePath);
 	}
-	size_t allocate_size = file_size + EOF_LENGTH;
-	self->file.data = malloc(allocate_size);
-	int ret = File_Read(filePath, self->file.data, file_size);
+	int ret = File_Map(&self->file.mapping, filePath, EOF_LENGTH);
 	if (ret < 0) {
-		free(self->file.data);
-		self->file.data = NULL;
 		return ret;
 	}
-	self->file.size = allocate_size;
-	FillEof(self->file.data, self->file.size);
+	self->file.data = self->file.mapping.data;
+	self->file.size = self->file.mapping.size + EOF_LENGTH;
+	self->file.length = PlaceEof(self->file.data, self->file.mapping.size);
+	struct stat source;
+	if (stat(filePath, &source) == 0) {
+		CsvRowIndex_SetSource(&self->rowIndex, &source);	// 索引ファイルの検証用
+	}
 	return 0;
 }
 
+/**
+ * @brief 読み込んだデータを解放
+ * @param self インスタンス
+ */
+static void ReleaseFile(CsvParser_t *self) {
+	if (self->file.mapping.data) {
+		File_Unmap(&self->file.mapping);
+	} else if (self->file.data) {
+		free(self->file.data);
+	}
+	self->file.data = NULL;
+	self->file.size = 0;
+	self->file.length = 0;
+}
+
+/**
+ * @brief 前に読み込んだデータとパース結果を捨てる
+ * @note 同じインスタンスで読み込み直すときに、前のマッピングやバッファを残さない
+ * @param self インスタンス
+ */
+static void Unload(CsvParser_t *self) {
+	ResetContent(self);
+	CsvRowIndex_Clear(&self->rowIndex);
+	self->rowIndex.hasSource = false;	// データから読み込み直したら索引を保存できない
+	ReleaseFile(self);
+}
+
 /**
  * @brief 初期化
  * @param props プロパティ
- * @return インスタンス
+ * @note 遅延モードでは列の選択と条件は使えない
+ * @return インスタンス (NULL: 区切り文字などの組み合わせが不正か、列の指定が不正)
  */
 CsvParser_t *CsvParser_Init(const CsvProperties_t *props) {
 	CsvParser_t *self = (CsvParser_t *)calloc(1, sizeof(*self));
 
 	self->properties = *props;
+	if (!CsvScanner_Init(&self->scanner, props) || !CsvSelection_Init(&self->selection, props)) {
+		free(self);
+		return NULL;
+	}
+	if (props->isLazy && self->selection.isActive) {
+		CsvSelection_Destroy(&self->selection);
+		free(self);
+		return NULL;
+	}
 	CsvContent_Init(&self->content);
+	CsvRowIndex_Init(&self->rowIndex, &self->scanner);
 	return self;
 }
 
@@ -238,6 +965,7 @@ CsvReturnCode CsvParser_LoadFromFile(CsvParser_t *self, const char *filePath) {
 	if (UNLIKELY(!self)) {
 		return CSV_INVALID_PARAMETER;
 	}
+	Unload(self);
 	if (LoadFile(self, filePath) != 0) {
 		return CSV_INVALID_PARAMETER;
 	}
@@ -255,14 +983,73 @@ CsvReturnCode CsvParser_LoadFromData(CsvParser_t *self, const char *data, size_t
 	if (UNLIKELY(!self || !data || dataSize == 0)) {
 		return CSV_INVALID_PARAMETER;
 	}
+	Unload(self);
 	size_t allocate_size = dataSize + EOF_LENGTH;
 	self->file.data = malloc(allocate_size);
 	self->file.size = allocate_size;
 	memcpy(self->file.data, data, dataSize);
-	FillEof(self->file.data, allocate_size);
+	self->file.length = FillEof(self->file.data, dataSize);
 	return Parse(self);
 }
 
+/**
+ * @brief 索引ファイルを使ってファイルを読み込む
+ * @note 遅延モードのみ。索引ファイルが元のファイルと一致すれば、パースせずにそのまま使う。
+ * 一致しなければ索引を作り直して保存する
+ * @note 読み込んだ索引ファイルを使う場合、UTF-8は検証し直さない
+ * @param self インスタンス
+ * @param filePath ファイルパス
+ * @param indexPath 索引ファイルのパス
+ * @return ステータス
+ */
+CsvReturnCode CsvParser_LoadFromFileWithIndex(CsvParser_t *self, const char *filePath, const char *indexPath) {
+	if (UNLIKELY(!self || !indexPath || !self->properties.isLazy)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	Unload(self);
+	if (LoadFile(self, filePath) != 0) {
+		return CSV_INVALID_PARAMETER;
+	}
+	CsvRowIndex_SetData(&self->rowIndex, self->file.data, self->file.length);
+	if (CsvRowIndex_Load(&self->rowIndex, indexPath)) {
+		AttachIndex(self);
+		return CSV_SUCCESS;
+	}
+	CsvReturnCode ret = Parse(self);
+	if (ret != CSV_SUCCESS) {
+		return ret;
+	}
+	return CsvRowIndex_Save(&self->rowIndex, indexPath);
+}
+
+/**
+ * @brief 行の先頭位置の索引を保存する
+ * @note 遅延モードでファイルから読み込んだ後のみ
+ * @param self インスタンス
+ * @param indexPath 索引ファイルのパス
+ * @return ステータス
+ */
+CsvReturnCode CsvParser_SaveIndex(CsvParser_t *self, const char *indexPath) {
+	if (UNLIKELY(!self || !indexPath || !self->properties.isLazy)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	return CsvRowIndex_Save(&self->rowIndex, indexPath);
+}
+
+/**
+ * @brief 並列にパースするスレッドプールを設定する
+ * @note 設定すると、大きなデータはレコードの境界で分割して並列にパースする
+ * @note 遅延モードでは使わない
+ * @param self インスタンス
+ * @param pool スレッドプール (NULL: 並列にしない)
+ */
+void CsvParser_SetThreadPool(CsvParser_t *self, ThreadPool_t *pool) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	self->threadPool = pool;
+}
+
 /**
  * @brief csvデータを取得する
  * @param self インスタンス
@@ -284,7 +1071,9 @@ void CsvParser_Destroy(CsvParser_t *self) {
 		return;
 	}
 	CsvContent_Destroy(&self->content);
-	if (self->file.data) free(self->file.data);
+	CsvSelection_Destroy(&self->selection);
+	CsvRowIndex_Destroy(&self->rowIndex);
+	ReleaseFile(self);
 	free(self);
 	self = NULL;
 }
@@ -0,0 +1,336 @@
+/**
+ * @file CsvRowIndex.c
+ * @brief 行の先頭位置の索引と、触れた行だけをフィールドに分ける行
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "utilities.h"
+#include "CsvRowIndex.h"
+
+//! 索引ファイルの識別子
+static const char INDEX_MAGIC[8] = { 'C', 'S', 'V', 'R', 'O', 'W', 'S', '1' };
+//! 最初に確保する行数
+#define INITIAL_CAPACITY	((size_t)1024)
+//! 改行文字
+#define CARRIGE_RETURN	('\r')
+//! 改行文字
+#define LINE_FEED		('\n')
+
+/**
+ * @brief 索引ファイルのヘッダー
+ * @note 後ろに行の先頭位置 (uint64_t) が行数分続く
+ */
+typedef struct CsvRowIndexHeader_t {
+	char magic[8];
+	//! 元のファイルのサイズと更新時刻
+	uint64_t sourceSize;
+	int64_t sourceSeconds;
+	int64_t sourceNanoseconds;
+	uint64_t numRows;
+	//! 区切り文字、引用符、エスケープ文字、コメント文字
+	char dialect[4];
+	uint8_t reserved[20];
+} CsvRowIndexHeader_t;
+
+/**
+ * @brief 行の先頭位置
+ * @param self インスタンス
+ * @return 先頭位置の配列
+ */
+static inline const uint64_t *GetOffsets(const CsvRowIndex_t *self) {
+	if (self->mapping.data) {
+		return (const uint64_t *)((const char *)self->mapping.data + sizeof(CsvRowIndexHeader_t));
+	}
+	return self->offsets;
+}
+
+/**
+ * @brief 索引ファイルのヘッダーを作る
+ * @param self インスタンス
+ * @param header ヘッダー
+ */
+static void MakeHeader(const CsvRowIndex_t *self, CsvRowIndexHeader_t *header) {
+	CLEAR(header);
+	memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+	header->sourceSize = self->sourceSize;
+	header->sourceSeconds = (int64_t)self->sourceTime.tv_sec;
+	header->sourceNanoseconds = (int64_t)self->sourceTime.tv_nsec;
+	header->numRows = self->rows.numRows;
+	header->dialect[0] = self->scanner->delimiter;
+	header->dialect[1] = self->scanner->quote;
+	header->dialect[2] = self->scanner->escape;
+	header->dialect[3] = self->scanner->comment;
+}
+
+/**
+ * @brief 配列を広げる
+ * @param list 配列
+ * @param capacity 容量
+ * @param required 必要な数
+ * @param elementSize 要素のサイズ
+ * @return false: メモリ不足
+ */
+static bool Reserve(void **list, size_t *capacity, size_t required, size_t elementSize) {
+	if (required <= *capacity) {
+		return true;
+	}
+	size_t newCapacity = *capacity ? *capacity : INITIAL_CAPACITY;
+	while (newCapacity < required) {
+		newCapacity *= 2;
+	}
+	void *newList = realloc(*list, newCapacity * elementSize);
+	if (UNLIKELY(!newList)) {
+		return false;
+	}
+	*list = newList;
+	*capacity = newCapacity;
+	return true;
+}
+
+/**
+ * @brief 行の終わりと区切り文字の位置を探す
+ * @note 行の先頭は引用符の外なので、状態を持たずに調べ始められる
+ * @note データの終わりより前の0xFFは番兵として扱わない
+ * @param self インスタンス
+ * @param start 行の先頭
+ * @param rowEnd 行の終わり (改行文字かデータの終わりの位置)
+ * @return 区切り文字の数 (SIZE_MAX: メモリ不足)
+ */
+static size_t FindFields(CsvRowIndex_t *self, size_t start, size_t *rowEnd) {
+	const CsvScanner_t *scanner = self->scanner;
+	const char *data = self->data;
+	size_t numDelimiters = 0;
+	CsvScanState_t state;
+	CLEAR(&state);
+	*rowEnd = self->size;
+	for (size_t offset = start; offset < self->size; offset += CSV_SCAN_BLOCK_SIZE) {
+		CsvScanMask_t mask;
+		CsvScanner_Next(scanner, data + offset, self->size - offset, &state, &mask);
+		for (uint64_t bits = mask.structurals; bits != 0; bits &= bits - 1) {
+			size_t position = offset + __builtin_ctzll(bits);
+			char c = data[position];
+			if (c == scanner->delimiter) {
+				if (!Reserve((void **)&self->delimiters, &self->delimitersCapacity, numDelimiters + 1, sizeof(size_t))) {
+					return SIZE_MAX;
+				}
+				self->delimiters[numDelimiters++] = position;
+				continue;
+			}
+			bool isCrLf = (c == CARRIGE_RETURN) && (position + 1 < self->size) && (data[position + 1] == LINE_FEED);
+			if ((c == LINE_FEED) || isCrLf) {
+				*rowEnd = position;
+				return numDelimiters;
+			}
+		}
+	}
+	return numDelimiters;
+}
+
+/**
+ * @brief 引用符とエスケープを外す
+ * @param scanner スキャナー
+ * @param start フィールドの先頭
+ * @param end フィールドの終わり (終端済み)
+ * @return テキスト
+ */
+static inline char *Unquote(const CsvScanner_t *scanner, char *start, char *end) {
+	return ((*start == scanner->quote) || scanner->escape) ? CsvScanner_Unquote(scanner, start, end) : start;
+}
+
+/**
+ * @brief 行を読み込んでフィールドに分ける
+ * @note 元のデータは書き換えず、行をコピーしてから分ける。直前と同じ行なら分け直さない
+ * @param rows インスタンス
+ * @param row 行
+ * @return 行 (NULL: 範囲外かメモリ不足)
+ */
+static const CsvLine_t *LoadRow(CsvLazyRows_t *rows, size_t row) {
+	CsvRowIndex_t *self = (CsvRowIndex_t *)rows;
+	if (row >= rows->numRows) {
+		return NULL;
+	}
+	if (self->hasCachedRow && (self->cachedRow == row)) {
+		return &self->line;
+	}
+	self->hasCachedRow = false;
+	size_t start = (size_t)GetOffsets(self)[row];
+	if (UNLIKELY(start > self->size)) {
+		return NULL;	// 索引ファイルが壊れている
+	}
+	size_t rowEnd;
+	size_t numDelimiters = FindFields(self, start, &rowEnd);
+	size_t length = rowEnd - start;
+	if ((numDelimiters == SIZE_MAX) ||
+		!Reserve((void **)&self->buffer, &self->bufferSize, length + 1, sizeof(char)) ||
+		!Reserve((void **)&self->items, &self->itemsCapacity, numDelimiters + 1, sizeof(CsvItem_t))) {
+		return NULL;
+	}
+	memcpy(self->buffer, self->data + start, length);
+	char *fieldStart = self->buffer;
+	for (size_t i = 0; i <= numDelimiters; i++) {
+		char *fieldEnd = self->buffer + ((i < numDelimiters) ? self->delimiters[i] - start : length);
+		*fieldEnd = '\0';
+		CsvItem_Set(&self->items[i], Unquote(self->scanner, fieldStart, fieldEnd));
+		fieldStart = fieldEnd + 1;
+	}
+	CsvLine_InitView(&self->line, self->items, numDelimiters + 1);
+	self->cachedRow = row;
+	self->hasCachedRow = true;
+	return &self->line;
+}
+
+/**
+ * @brief 初期化
+ * @param self インスタンス
+ * @param scanner スキャナー
+ */
+void CsvRowIndex_Init(CsvRowIndex_t *self, const CsvScanner_t *scanner) {
+	CLEAR(self);
+	self->rows.load = LoadRow;
+	self->scanner = scanner;
+}
+
+/**
+ * @brief 元のデータを設定する
+ * @note データはインスタンスより長く生存し、書き換えないこと
+ * @param self インスタンス
+ * @param data データ (後ろにEOFの番兵が続く)
+ * @param size 番兵より前のサイズ
+ */
+void CsvRowIndex_SetData(CsvRowIndex_t *self, const char *data, size_t size) {
+	self->data = data;
+	self->size = size;
+}
+
+/**
+ * @brief 元のファイルの情報を設定する
+ * @note 索引ファイルに書き込み、読み込むときに元のファイルが変わっていないかを確かめる
+ * @param self インスタンス
+ * @param source 元のファイルの情報
+ */
+void CsvRowIndex_SetSource(CsvRowIndex_t *self, const struct stat *source) {
+	self->sourceSize = (uint64_t)source->st_size;
+	self->sourceTime = source->st_mtim;
+	self->hasSource = true;
+}
+
+/**
+ * @brief 行を追加する
+ * @param self インスタンス
+ * @param offset 行の先頭位置
+ * @return false: メモリ不足
+ */
+bool CsvRowIndex_Add(CsvRowIndex_t *self, size_t offset) {
+	if (!Reserve((void **)&self->offsets, &self->capacity, self->rows.numRows + 1, sizeof(uint64_t))) {
+		return false;
+	}
+	self->offsets[self->rows.numRows++] = (uint64_t)offset;
+	return true;
+}
+
+/**
+ * @brief 索引ファイルに保存する
+ * @param self インスタンス
+ * @param path 索引ファイルのパス
+ * @return 結果
+ */
+CsvReturnCode CsvRowIndex_Save(const CsvRowIndex_t *self, const char *path) {
+	if (UNLIKELY(!self->hasSource)) {
+		return CSV_INVALID_PARAMETER;	// ファイルから読み込んでいない
+	}
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return CSV_WRITE_ERROR;
+	}
+	CsvRowIndexHeader_t header;
+	MakeHeader(self, &header);
+	const char *parts[] = { (const char *)&header, (const char *)GetOffsets(self) };
+	size_t sizes[] = { sizeof(header), self->rows.numRows * sizeof(uint64_t) };
+	CsvReturnCode ret = CSV_SUCCESS;
+	for (size_t i = 0; (i < 2) && (ret == CSV_SUCCESS); i++) {
+		for (size_t written = 0; written < sizes[i];) {
+			ssize_t size = write(fd, parts[i] + written, sizes[i] - written);
+			if (size < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				ret = CSV_WRITE_ERROR;
+				break;
+			}
+			written += (size_t)size;
+		}
+	}
+	if ((close(fd) != 0) && (ret == CSV_SUCCESS)) {
+		ret = CSV_WRITE_ERROR;
+	}
+	if (ret != CSV_SUCCESS) {
+		unlink(path);	// 途中までの索引は使わせない
+	}
+	return ret;
+}
+
+/**
+ * @brief 索引ファイルを読み込む
+ * @note 索引ファイルはマッピングしてそのまま使う。元のファイルのサイズと更新時刻、
+ * 区切り文字などが一致しなければ使わない
+ * @note 索引を作るときに検証したので、UTF-8は検証し直さない
+ * @param self インスタンス
+ * @param path 索引ファイルのパス
+ * @return false: 読み込めないか、元のファイルと一致しない
+ */
+bool CsvRowIndex_Load(CsvRowIndex_t *self, const char *path) {
+	if (UNLIKELY(!self->hasSource)) {
+		return false;
+	}
+	FileMapping_t mapping;
+	if (File_Map(&mapping, path, 0) != 0) {
+		return false;
+	}
+	CsvRowIndexHeader_t expected;
+	MakeHeader(self, &expected);
+	const CsvRowIndexHeader_t *header = (const CsvRowIndexHeader_t *)mapping.data;
+	bool isValid = (mapping.size >= sizeof(*header));
+	if (isValid) {
+		expected.numRows = header->numRows;
+		isValid = (memcmp(header, &expected, sizeof(expected)) == 0) &&
+			(header->numRows == (mapping.size - sizeof(*header)) / sizeof(uint64_t)) &&
+			((mapping.size - sizeof(*header)) % sizeof(uint64_t) == 0);
+	}
+	if (!isValid) {
+		File_Unmap(&mapping);
+		return false;
+	}
+	CsvRowIndex_Clear(self);
+	self->mapping = mapping;
+	self->rows.numRows = (size_t)header->numRows;
+	return true;
+}
+
+/**
+ * @brief 行をすべて消す
+ * @param self インスタンス
+ */
+void CsvRowIndex_Clear(CsvRowIndex_t *self) {
+	File_Unmap(&self->mapping);
+	self->rows.numRows = 0;
+	self->hasCachedRow = false;
+}
+
+/**
+ * @brief インスタンスを破棄
+ * @param self インスタンス
+ */
+void CsvRowIndex_Destroy(CsvRowIndex_t *self) {
+	File_Unmap(&self->mapping);
+	free(self->offsets);
+	free(self->items);
+	free(self->buffer);
+	free(self->delimiters);
+	CLEAR(self);
+}
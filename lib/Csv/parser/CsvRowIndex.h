@@ -0,0 +1,72 @@
+/**
+ * @file CsvRowIndex.h
+ * @brief 行の先頭位置の索引と、触れた行だけをフィールドに分ける行
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include "Csv/content/CsvContent.h"
+#include "Csv/Csv.h"
+#include "File.h"
+#include "CsvScanner.h"
+
+	/**
+	 * @brief 制御ブロック
+	 */
+	typedef struct CsvRowIndex_t {
+		//! @name Private
+		//! @{
+
+		//! CsvContent から使う行 (先頭のメンバーであること)
+		CsvLazyRows_t rows;
+		const CsvScanner_t *scanner;
+		//! 元のデータ (後ろにEOFの番兵が続く)
+		const char *data;
+		//! 番兵より前のサイズ
+		size_t size;
+		//! 作った行の先頭位置
+		uint64_t *offsets;
+		size_t capacity;
+		//! 読み込んだ索引ファイル (mapping.data!=NULL: 行の先頭位置はここを指す)
+		FileMapping_t mapping;
+		//! 元のファイルのサイズと更新時刻 (索引ファイルの検証用)
+		uint64_t sourceSize;
+		struct timespec sourceTime;
+		bool hasSource;
+
+		//! 最後に分けた行
+		size_t cachedRow;
+		bool hasCachedRow;
+		CsvLine_t line;
+		CsvItem_t *items;
+		size_t itemsCapacity;
+		//! 行のコピー (フィールドごとに終端する)
+		char *buffer;
+		size_t bufferSize;
+		//! 行内の区切り文字の位置
+		size_t *delimiters;
+		size_t delimitersCapacity;
+
+		//! @}
+	} CsvRowIndex_t;
+
+	void CsvRowIndex_Init(CsvRowIndex_t *self, const CsvScanner_t *scanner);
+	void CsvRowIndex_SetData(CsvRowIndex_t *self, const char *data, size_t size);
+	void CsvRowIndex_SetSource(CsvRowIndex_t *self, const struct stat *source);
+	bool CsvRowIndex_Add(CsvRowIndex_t *self, size_t offset);
+	CsvReturnCode CsvRowIndex_Save(const CsvRowIndex_t *self, const char *path);
+	bool CsvRowIndex_Load(CsvRowIndex_t *self, const char *path);
+	void CsvRowIndex_Clear(CsvRowIndex_t *self);
+	void CsvRowIndex_Destroy(CsvRowIndex_t *self);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,566 @@
+/**
+ * @file CsvScanner.c
+ * @brief 区切り文字をまとめて探すスキャナー
+ * @note x86ではAVX2/SSE2を実行時に選び、それ以外では1バイトずつ調べる
+ * @note UTF-8の検証は、前後のバイトの4bitずつを表引きして誤りの種類を掛け合わせる方法
+ * (Keiser, Lemire: Validating UTF-8 In Less Than One Instruction Per Byte)。AVX2/SSSE3を実行時に選ぶ
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "utilities.h"
+#include "CsvScanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_SCANNER_X86
+#endif
+
+//! 改行文字
+#define CARRIGE_RETURN	('\r')
+//! 改行文字
+#define LINE_FEED		('\n')
+//! 既定の区切り文字
+#define DEFAULT_DELIMITER	(',')
+//! 既定の引用符
+#define DEFAULT_QUOTE		('"')
+//! UTF-8に現れないバイト
+#define SENTINEL		((char)0xFF)
+
+/**
+ * @brief 1バイトずつ調べる
+ * @param self インスタンス
+ * @param block ブロック
+ * @param mask 結果
+ */
+static void ScanScalar(const CsvScanner_t *self, const char *block, CsvScanMask_t *mask) {
+	CLEAR(mask);
+	for (int i = 0; i < CSV_SCAN_BLOCK_SIZE; i++) {
+		char c = block[i];
+		uint64_t bit = 1ULL << i;
+		if ((c == self->delimiter) || (c == CARRIGE_RETURN) || (c == LINE_FEED)) {
+			mask->structurals |= bit;
+		} else if (c == self->quote) {
+			mask->quotes |= bit;
+		} else if (c == self->escape) {
+			mask->escapes |= bit;
+		} else if ((uint8_t)c & 0x80) {
+			mask->nonAscii |= bit;
+			if (c == SENTINEL) {
+				mask->sentinels |= bit;
+			}
+		}
+	}
+}
+
+/**
+ * @brief 1バイトずつUTF-8を検証する
+ * @param block ブロック
+ * @param state 状態
+ * @return false: 不正なバイト列
+ */
+static bool ValidateScalar(const char *block, CsvUtf8State_t *state) {
+	for (int i = 0; i < CSV_SCAN_BLOCK_SIZE; i++) {
+		uint8_t c = (uint8_t)block[i];
+		if (state->remaining > 0) {
+			if ((c < state->lower) || (c > state->upper)) {
+				return false;
+			}
+			state->remaining--;
+			state->lower = 0x80;
+			state->upper = 0xBF;
+		} else if (c < 0x80) {
+			continue;
+		} else if (c < 0xC2) {
+			return false;	// 先頭の継続バイトか冗長な2バイト文字
+		} else if (c < 0xE0) {
+			state->remaining = 1;
+			state->lower = 0x80;
+			state->upper = 0xBF;
+		} else if (c < 0xF0) {
+			state->remaining = 2;
+			state->lower = (c == 0xE0) ? 0xA0 : 0x80;	// 冗長な3バイト文字
+			state->upper = (c == 0xED) ? 0x9F : 0xBF;	// サロゲート
+		} else if (c < 0xF5) {
+			state->remaining = 3;
+			state->lower = (c == 0xF0) ? 0x90 : 0x80;	// 冗長な4バイト文字
+			state->upper = (c == 0xF4) ? 0x8F : 0xBF;	// U+10FFFFを超える
+		} else {
+			return false;
+		}
+	}
+	state->isIncomplete = state->remaining > 0;
+	return true;
+}
+
+#ifdef CSV_SCANNER_X86
+
+//! @name UTF-8の誤りの種類 (前のバイトと今のバイトの組で決まる)
+//! @{
+//! 先頭バイトの後ろに継続バイトが無い
+#define UTF8_TOO_SHORT		(1 << 0)
+//! ASCIIの後ろに継続バイトがある
+#define UTF8_TOO_LONG		(1 << 1)
+//! 冗長な3バイト文字
+#define UTF8_OVERLONG_3		(1 << 2)
+//! U+10FFFFを超える
+#define UTF8_TOO_LARGE		(1 << 3)
+//! サロゲート
+#define UTF8_SURROGATE		(1 << 4)
+//! 冗長な2バイト文字
+#define UTF8_OVERLONG_2		(1 << 5)
+//! U+10FFFFを超える (F4 90以降)
+#define UTF8_TOO_LARGE_1000	(1 << 6)
+//! 冗長な4バイト文字
+#define UTF8_OVERLONG_4		(1 << 6)
+//! 継続バイトが続く (3、4バイト目なら正しい)
+#define UTF8_TWO_CONTS		(1 << 7)
+//! 前のバイトの下位4bitによらない誤り
+#define UTF8_CARRY			(UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+//! @}
+
+//! 前のバイトの上位4bitから引く表
+#define UTF8_BYTE_1_HIGH_TABLE \
+	UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+	UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+	UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, \
+	UTF8_TOO_SHORT | UTF8_OVERLONG_2, \
+	UTF8_TOO_SHORT, \
+	UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE, \
+	UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+
+//! 前のバイトの下位4bitから引く表
+#define UTF8_BYTE_1_LOW_TABLE \
+	UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, \
+	UTF8_CARRY | UTF8_OVERLONG_2, \
+	UTF8_CARRY, \
+	UTF8_CARRY, \
+	UTF8_CARRY | UTF8_TOO_LARGE, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+	UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+
+//! 今のバイトの上位4bitから引く表
+#define UTF8_BYTE_2_HIGH_TABLE \
+	UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+	UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+	UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4, \
+	UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE, \
+	UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, \
+	UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, \
+	UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+
+/**
+ * @brief SSE2で調べる
+ * @param self インスタンス
+ * @param block ブロック
+ * @param mask 結果
+ */
+__attribute__((target("sse2")))
+static void ScanSse2(const CsvScanner_t *self, const char *block, CsvScanMask_t *mask) {
+	const __m128i delimiter = _mm_set1_epi8(self->delimiter);
+	const __m128i quote = _mm_set1_epi8(self->quote);
+	const __m128i escape = _mm_set1_epi8(self->escape);
+	const __m128i cr = _mm_set1_epi8(CARRIGE_RETURN);
+	const __m128i lf = _mm_set1_epi8(LINE_FEED);
+	const __m128i sentinel = _mm_set1_epi8(SENTINEL);
+	CLEAR(mask);
+	for (int i = 0; i < CSV_SCAN_BLOCK_SIZE; i += 16) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(block + i));
+		__m128i structural = _mm_or_si128(_mm_cmpeq_epi8(bytes, delimiter),
+			_mm_or_si128(_mm_cmpeq_epi8(bytes, cr), _mm_cmpeq_epi8(bytes, lf)));
+		mask->structurals |= (uint64_t)(uint16_t)_mm_movemask_epi8(structural) << i;
+		mask->quotes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote)) << i;
+		mask->escapes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, escape)) << i;
+		mask->nonAscii |= (uint64_t)(uint16_t)_mm_movemask_epi8(bytes) << i;
+		mask->sentinels |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, sentinel)) << i;
+	}
+}
+
+/**
+ * @brief AVX2で調べる
+ * @param self インスタンス
+ * @param block ブロック
+ * @param mask 結果
+ */
+__attribute__((target("avx2")))
+static void ScanAvx2(const CsvScanner_t *self, const char *block, CsvScanMask_t *mask) {
+	const __m256i delimiter = _mm256_set1_epi8(self->delimiter);
+	const __m256i quote = _mm256_set1_epi8(self->quote);
+	const __m256i escape = _mm256_set1_epi8(self->escape);
+	const __m256i cr = _mm256_set1_epi8(CARRIGE_RETURN);
+	const __m256i lf = _mm256_set1_epi8(LINE_FEED);
+	const __m256i sentinel = _mm256_set1_epi8(SENTINEL);
+	CLEAR(mask);
+	for (int i = 0; i < CSV_SCAN_BLOCK_SIZE; i += 32) {
+		__m256i bytes = _mm256_loadu_si256((const __m256i *)(block + i));
+		__m256i structural = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, delimiter),
+			_mm256_or_si256(_mm256_cmpeq_epi8(bytes, cr), _mm256_cmpeq_epi8(bytes, lf)));
+		mask->structurals |= (uint64_t)(uint32_t)_mm256_movemask_epi8(structural) << i;
+		mask->quotes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quote)) << i;
+		mask->escapes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, escape)) << i;
+		mask->nonAscii |= (uint64_t)(uint32_t)_mm256_movemask_epi8(bytes) << i;
+		mask->sentinels |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, sentinel)) << i;
+	}
+}
+
+/**
+ * @brief 16バイトのUTF-8の誤りを求める (SSSE3)
+ * @param input 16バイト
+ * @param previous 前の16バイト
+ * @return 誤りのビット (0: 正しい)
+ */
+__attribute__((target("ssse3")))
+static inline __m128i CheckUtf8Ssse3(__m128i input, __m128i previous) {
+	const __m128i byte1High = _mm_setr_epi8(UTF8_BYTE_1_HIGH_TABLE);
+	const __m128i byte1Low = _mm_setr_epi8(UTF8_BYTE_1_LOW_TABLE);
+	const __m128i byte2High = _mm_setr_epi8(UTF8_BYTE_2_HIGH_TABLE);
+	const __m128i low4 = _mm_set1_epi8(0x0F);
+	__m128i previous1 = _mm_alignr_epi8(input, previous, 16 - 1);
+	__m128i special = _mm_and_si128(
+		_mm_and_si128(_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(previous1, 4), low4)),
+			_mm_shuffle_epi8(byte1Low, _mm_and_si128(previous1, low4))),
+		_mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), low4)));
+	// 3、4バイト目の継続バイトには TWO_CONTS が立つので打ち消す
+	__m128i isThird = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 16 - 2), _mm_set1_epi8(0xE0 - 0x80));
+	__m128i isFourth = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 16 - 3), _mm_set1_epi8(0xF0 - 0x80));
+	__m128i must23 = _mm_and_si128(_mm_or_si128(isThird, isFourth), _mm_set1_epi8((char)0x80));
+	return _mm_xor_si128(must23, special);
+}
+
+/**
+ * @brief SSSE3でUTF-8を検証する
+ * @param block ブロック
+ * @param state 状態
+ * @return false: 不正なバイト列
+ */
+__attribute__((target("ssse3")))
+static bool ValidateSsse3(const char *block, CsvUtf8State_t *state) {
+	// 最後の3バイトに、ブロック内で終わらない文字の先頭バイトがあるか
+	const __m128i maxValue = _mm_setr_epi8(
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		(char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+	__m128i previous = state->hasTail ? _mm_loadu_si128((const __m128i *)(state->tail + 16)) : _mm_setzero_si128();
+	__m128i error = _mm_setzero_si128();
+	for (int i = 0; i < CSV_SCAN_BLOCK_SIZE; i += 16) {
+		__m128i input = _mm_loadu_si128((const __m128i *)(block + i));
+		error = _mm_or_si128(error, CheckUtf8Ssse3(input, previous));
+		previous = input;
+	}
+	_mm_storeu_si128((__m128i *)(state->tail + 16), previous);
+	state->hasTail = true;
+	__m128i incomplete = _mm_subs_epu8(previous, maxValue);
+	state->isIncomplete = _mm_movemask_epi8(_mm_cmpeq_epi8(incomplete, _mm_setzero_si128())) != 0xFFFF;
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+//! 前の32バイトから続けて、nバイト前のバイトを並べる
+#define PREVIOUS_256(input, previous, n) \
+	_mm256_alignr_epi8((input), _mm256_permute2x128_si256((previous), (input), 0x21), 16 - (n))
+
+/**
+ * @brief 32バイトのUTF-8の誤りを求める (AVX2)
+ * @param input 32バイト
+ * @param previous 前の32バイト
+ * @return 誤りのビット (0: 正しい)
+ */
+__attribute__((target("avx2")))
+static inline __m256i CheckUtf8Avx2(__m256i input, __m256i previous) {
+	const __m256i byte1High = _mm256_setr_epi8(UTF8_BYTE_1_HIGH_TABLE, UTF8_BYTE_1_HIGH_TABLE);
+	const __m256i byte1Low = _mm256_setr_epi8(UTF8_BYTE_1_LOW_TABLE, UTF8_BYTE_1_LOW_TABLE);
+	const __m256i byte2High = _mm256_setr_epi8(UTF8_BYTE_2_HIGH_TABLE, UTF8_BYTE_2_HIGH_TABLE);
+	const __m256i low4 = _mm256_set1_epi8(0x0F);
+	__m256i previous1 = PREVIOUS_256(input, previous, 1);
+	__m256i special = _mm256_and_si256(
+		_mm256_and_si256(_mm256_shuffle_epi8(byte1High, _mm256_and_si256(_mm256_srli_epi16(previous1, 4), low4)),
+			_mm256_shuffle_epi8(byte1Low, _mm256_and_si256(previous1, low4))),
+		_mm256_shuffle_epi8(byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), low4)));
+	// 3、4バイト目の継続バイトには TWO_CONTS が立つので打ち消す
+	__m256i isThird = _mm256_subs_epu8(PREVIOUS_256(input, previous, 2), _mm256_set1_epi8(0xE0 - 0x80));
+	__m256i isFourth = _mm256_subs_epu8(PREVIOUS_256(input, previous, 3), _mm256_set1_epi8(0xF0 - 0x80));
+	__m256i must23 = _mm256_and_si256(_mm256_or_si256(isThird, isFourth), _mm256_set1_epi8((char)0x80));
+	return _mm256_xor_si256(must23, special);
+}
+
+/**
+ * @brief AVX2でUTF-8を検証する
+ * @param block ブロック
+ * @param state 状態
+ * @return false: 不正なバイト列
+ */
+__attribute__((target("avx2")))
+static bool ValidateAvx2(const char *block, CsvUtf8State_t *state) {
+	// 最後の3バイトに、ブロック内で終わらない文字の先頭バイトがあるか
+	const __m256i maxValue = _mm256_setr_epi8(
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		(char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+	__m256i previous = state->hasTail ? _mm256_loadu_si256((const __m256i *)state->tail) : _mm256_setzero_si256();
+	__m256i error = _mm256_setzero_si256();
+	for (int i = 0; i < CSV_SCAN_BLOCK_SIZE; i += 32) {
+		__m256i input = _mm256_loadu_si256((const __m256i *)(block + i));
+		error = _mm256_or_si256(error, CheckUtf8Avx2(input, previous));
+		previous = input;
+	}
+	_mm256_storeu_si256((__m256i *)state->tail, previous);
+	state->hasTail = true;
+	__m256i incomplete = _mm256_subs_epu8(previous, maxValue);
+	state->isIncomplete = !_mm256_testz_si256(incomplete, incomplete);
+	return _mm256_testz_si256(error, error);
+}
+
+#endif
+
+/**
+ * @brief CPUに合わせて実装を選ぶ
+ * @param self インスタンス
+ */
+static void SelectFunctions(CsvScanner_t *self) {
+	self->scan = ScanScalar;
+	self->validate = ValidateScalar;
+#ifdef CSV_SCANNER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		self->scan = ScanAvx2;
+		self->validate = ValidateAvx2;
+		return;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		self->scan = ScanSse2;
+	}
+	if (__builtin_cpu_supports("ssse3")) {
+		self->validate = ValidateSsse3;
+	}
+#endif
+}
+
+/**
+ * @brief 区切りや引用に使えない文字か
+ * @param c 文字
+ * @return
+ */
+static inline bool IsReserved(char c) {
+	return (c == CARRIGE_RETURN) || (c == LINE_FEED) || ((uint8_t)c & 0x80);
+}
+
+/**
+ * @brief 初期化
+ * @note 区切り文字、引用符、エスケープ文字、コメント文字はプロパティから決める
+ * @param self インスタンス
+ * @param props プロパティ
+ * @return false: 使えない文字の組み合わせ
+ */
+bool CsvScanner_Init(CsvScanner_t *self, const CsvProperties_t *props) {
+	if (UNLIKELY(!self || !props)) {
+		return false;
+	}
+	CLEAR(self);
+	self->delimiter = props->delimiter ? props->delimiter : DEFAULT_DELIMITER;
+	self->quote = props->quote ? props->quote : DEFAULT_QUOTE;
+	self->escape = (props->escape != self->quote) ? props->escape : '\0';	// 引用符と同じなら "" と同じ
+	self->comment = props->comment;
+	if (IsReserved(self->delimiter) || IsReserved(self->quote) || IsReserved(self->escape) || IsReserved(self->comment)) {
+		return false;
+	}
+	if ((self->delimiter == self->quote) || (self->delimiter == self->escape) ||
+		(self->delimiter == self->comment) || (self->quote == self->comment)) {
+		return false;
+	}
+	SelectFunctions(self);
+	return true;
+}
+
+/**
+ * @brief ブロックを調べる
+ * @note 最大 CSV_SCAN_BLOCK_SIZE バイト。足りない分は見つからなかったものとして扱う
+ * @param self インスタンス
+ * @param data データ
+ * @param size サイズ
+ * @param mask 結果
+ */
+void CsvScanner_Scan(const CsvScanner_t *self, const char *data, size_t size, CsvScanMask_t *mask) {
+	if (LIKELY(size >= CSV_SCAN_BLOCK_SIZE)) {
+		self->scan(self, data, mask);
+	} else {
+		// 末尾の端数はバッファの外を読まないよう、コピーしてから調べる
+		char block[CSV_SCAN_BLOCK_SIZE] = { 0 };
+		memcpy(block, data, size);
+		self->scan(self, block, mask);
+		uint64_t valid = (1ULL << size) - 1;
+		mask->structurals &= valid;
+		mask->quotes &= valid;
+		mask->escapes &= valid;
+		mask->nonAscii &= valid;
+		mask->sentinels &= valid;
+	}
+	if (!self->escape) {
+		mask->escapes = 0;	// '\0' と一致したもの
+	}
+}
+
+/**
+ * @brief エスケープされた文字を求める
+ * @note エスケープ文字が奇数個続いた直後の文字がエスケープされている。
+ * 偶数位置と奇数位置から始まる連続を、足し算の繰り上がりで見分ける
+ * @param escapes エスケープ文字のビット
+ * @param carry ブロックの先頭がエスケープされているか (0か1)。次のブロック用に更新する
+ * @return エスケープされた文字のビット
+ */
+static inline uint64_t FindEscaped(uint64_t escapes, uint64_t *carry) {
+	const uint64_t evenBits = 0x5555555555555555ULL;
+	if (escapes == 0) {
+		uint64_t escaped = *carry;
+		*carry = 0;
+		return escaped;
+	}
+	uint64_t escape = escapes & ~*carry;
+	uint64_t followsEscape = (escape << 1) | *carry;
+	uint64_t oddSequenceStarts = escape & ~evenBits & ~followsEscape;
+	uint64_t sequencesStartingOnEvenBits;
+	*carry = __builtin_add_overflow(oddSequenceStarts, escape, &sequencesStartingOnEvenBits);
+	uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+	return (evenBits ^ invertMask) & followsEscape;
+}
+
+/**
+ * @brief ブロックを調べ、エスケープと引用符を解決する
+ * @note 区切り文字と改行文字は、エスケープされておらず引用符で囲まれていないものだけを残す
+ * @param self インスタンス
+ * @param data データ
+ * @param size サイズ
+ * @param state ブロックをまたいで引き継ぐ状態
+ * @param mask 結果
+ */
+void CsvScanner_Next(const CsvScanner_t *self, const char *data, size_t size, CsvScanState_t *state, CsvScanMask_t *mask) {
+	CsvScanner_Scan(self, data, size, mask);
+	if (UNLIKELY(mask->escapes | state->escaped)) {
+		uint64_t escaped = FindEscaped(mask->escapes, &state->escaped);
+		mask->quotes &= ~escaped;
+		mask->structurals &= ~escaped;
+	}
+	mask->quoted = CsvScanner_QuotedRegion(mask->quotes, &state->quoted);
+	mask->structurals &= ~mask->quoted;
+}
+
+/**
+ * @brief 位置の文字がエスケープされているか
+ * @note 直前に続くエスケープ文字の数が奇数ならエスケープされている
+ * @param self インスタンス
+ * @param data データの先頭
+ * @param position 位置
+ * @return
+ */
+bool CsvScanner_IsEscaped(const CsvScanner_t *self, const char *data, size_t position) {
+	if (!self->escape) {
+		return false;
+	}
+	size_t count = 0;
+	while ((count < position) && (data[position - count - 1] == self->escape)) {
+		count++;
+	}
+	return count & 1;
+}
+
+/**
+ * @brief UTF-8を検証する
+ * @note ASCIIだけのブロックは、前のブロックが文字の途中で終わっていないかだけを見る
+ * @param self インスタンス
+ * @param data データ
+ * @param size サイズ (最大 CSV_SCAN_BLOCK_SIZE バイト)
+ * @param nonAscii 0x80以上のバイトのビット
+ * @param state ブロックをまたいで引き継ぐ状態
+ * @return false: 不正なバイト列
+ */
+bool CsvScanner_ValidateUtf8(const CsvScanner_t *self, const char *data, size_t size, uint64_t nonAscii, CsvUtf8State_t *state) {
+	if (LIKELY(nonAscii == 0)) {
+		state->hasTail = false;
+		return !state->isIncomplete;
+	}
+	if (LIKELY(size >= CSV_SCAN_BLOCK_SIZE)) {
+		return self->validate(data, state);
+	}
+	char block[CSV_SCAN_BLOCK_SIZE] = { 0 };
+	memcpy(block, data, size);
+	return self->validate(block, state);
+}
+
+/**
+ * @brief 文字列全体がUTF-8として正しいか
+ * @note 文字の途中で始まったり終わったりしないこと
+ * @param self インスタンス
+ * @param text 文字列
+ * @param size サイズ
+ * @return
+ */
+bool CsvScanner_ValidateText(const CsvScanner_t *self, const char *text, size_t size) {
+	CsvUtf8State_t state;
+	CLEAR(&state);
+	for (size_t offset = 0; offset < size; offset += CSV_SCAN_BLOCK_SIZE) {
+		size_t length = size - offset;
+		uint64_t nonAscii = 0;
+		for (size_t i = 0; (i < length) && (i < CSV_SCAN_BLOCK_SIZE); i++) {
+			nonAscii |= (uint64_t)((uint8_t)text[offset + i] >> 7) << i;
+		}
+		if (!CsvScanner_ValidateUtf8(self, text + offset, length, nonAscii, &state)) {
+			return false;
+		}
+	}
+	return CsvScanner_FinishUtf8(&state);
+}
+
+/**
+ * @brief 引用符とエスケープを外して元の文字列に戻す
+ * @note 引用符で囲まれておらずエスケープ文字も無ければそのまま返す。
+ * エスケープ("" かエスケープ文字)が無ければ引用符を外すだけでコピーしない。
+ * エスケープがあれば、その場で詰めて書き直す
+ * @param self インスタンス
+ * @param field フィールドの先頭
+ * @param end フィールドの終わり (終端済み)
+ * @return テキスト
+ */
+char *CsvScanner_Unquote(const CsvScanner_t *self, char *field, char *end) {
+	bool quoted = (field < end) && (*field == self->quote);
+	bool hasEscape = self->escape && memchr(field, self->escape, (size_t)(end - field));
+	if (!quoted && !hasEscape) {
+		return field;
+	}
+	char *text = quoted ? field + 1 : field;
+	if (quoted && !hasEscape) {
+		char *closing = memchr(text, self->quote, (size_t)(end - text));
+		if (!closing) {
+			return text;	// 閉じていない (呼び出し側で検出する)
+		}
+		if (LIKELY(closing + 1 == end)) {
+			*closing = '\0';	// エスケープが無い
+			return text;
+		}
+	}
+	char *src = text;
+	char *dst = text;
+	while (src < end) {
+		char c = *src++;
+		if (hasEscape && (c == self->escape) && (src < end)) {
+			*dst++ = *src++;	// エスケープされた文字
+		} else if (quoted && (c == self->quote)) {
+			if ((src < end) && (*src == self->quote)) {
+				*dst++ = *src++;	// エスケープされた引用符
+			} else {
+				quoted = false;		// 閉じ引用符
+			}
+		} else {
+			*dst++ = c;
+		}
+	}
+	*dst = '\0';
+	return text;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file CsvScanner.h
+ * @brief 区切り文字をまとめて探すスキャナー
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "Csv/property/CsvProperty.h"
+
+//! 一度に調べるバイト数
+#define CSV_SCAN_BLOCK_SIZE	(64)
+
+	/**
+	 * @brief 1ブロック分の検索結果
+	 * @note ビットnがブロックのnバイト目に対応する
+	 */
+	typedef struct CsvScanMask_t {
+		//! 区切り文字と改行文字 (CsvScanner_Next では引用符の外でエスケープされていないものだけ)
+		uint64_t structurals;
+		//! 引用符 (CsvScanner_Next ではエスケープされていないものだけ)
+		uint64_t quotes;
+		//! エスケープ文字
+		uint64_t escapes;
+		//! 0x80以上のバイト
+		uint64_t nonAscii;
+		//! 0xFF (UTF-8に現れないので、パーサーがEOFの番兵に使う)
+		uint64_t sentinels;
+		//! 引用符で囲まれた範囲 (CsvScanner_Next のみ)
+		uint64_t quoted;
+	} CsvScanMask_t;
+
+	/**
+	 * @brief ブロックをまたいで引き継ぐ状態
+	 */
+	typedef struct CsvScanState_t {
+		//! 前のブロックの終わりで引用符に囲まれていたか (全ビット0か1)
+		uint64_t quoted;
+		//! 次のブロックの先頭がエスケープされているか (0か1)
+		uint64_t escaped;
+	} CsvScanState_t;
+
+	/**
+	 * @brief UTF-8の検証でブロックをまたいで引き継ぐ状態
+	 */
+	typedef struct CsvUtf8State_t {
+		//! 前のブロックの末尾 (最後の3バイトだけ使う)
+		uint8_t tail[32];
+		//! tail が有効か (false: 前のブロックはASCIIだけ)
+		bool hasTail;
+		//! 前のブロックが文字の途中で終わった
+		bool isIncomplete;
+		//! 1バイトずつ調べる場合の、残りの継続バイト数と次のバイトの範囲
+		uint8_t remaining;
+		uint8_t lower;
+		uint8_t upper;
+	} CsvUtf8State_t;
+
+	struct CsvScanner_t;
+
+	/**
+	 * @brief ブロックを調べる関数
+	 */
+	typedef void (*CsvScanFunction)(const struct CsvScanner_t *self, const char *block, CsvScanMask_t *mask);
+
+	/**
+	 * @brief ブロックのUTF-8を検証する関数
+	 */
+	typedef bool (*CsvValidateFunction)(const char *block, CsvUtf8State_t *state);
+
+	/**
+	 * @brief 制御ブロック
+	 */
+	typedef struct CsvScanner_t {
+		//! @name Private
+		//! @{
+
+		//! 区切り文字
+		char delimiter;
+		//! 引用符
+		char quote;
+		//! エスケープ文字 ('\0': 使わない)
+		char escape;
+		//! コメント文字 ('\0': 使わない)
+		char comment;
+		//! CPUに合わせて選んだ実装
+		CsvScanFunction scan;
+		CsvValidateFunction validate;
+
+		//! @}
+	} CsvScanner_t;
+
+	bool CsvScanner_Init(CsvScanner_t *self, const CsvProperties_t *props);
+	void CsvScanner_Scan(const CsvScanner_t *self, const char *data, size_t size, CsvScanMask_t *mask);
+	void CsvScanner_Next(const CsvScanner_t *self, const char *data, size_t size, CsvScanState_t *state, CsvScanMask_t *mask);
+	bool CsvScanner_IsEscaped(const CsvScanner_t *self, const char *data, size_t position);
+	bool CsvScanner_ValidateUtf8(const CsvScanner_t *self, const char *data, size_t size, uint64_t nonAscii, CsvUtf8State_t *state);
+	bool CsvScanner_ValidateText(const CsvScanner_t *self, const char *text, size_t size);
+	char *CsvScanner_Unquote(const CsvScanner_t *self, char *field, char *end);
+
+	/**
+	 * @brief 引用符で囲まれた範囲を求める
+	 * @note 引用符のビットの累積XORで、開き引用符から閉じ引用符の手前までが1になる。
+	 * 連続した引用符("")は2回反転するので、エスケープも囲まれた範囲のまま扱える
+	 * @param quotes 引用符のビット
+	 * @param carry 前のブロックの終わりで囲まれていたか (全ビット0か1)。次のブロック用に更新する
+	 * @return 囲まれた範囲のビット
+	 */
+	static inline uint64_t CsvScanner_QuotedRegion(uint64_t quotes, uint64_t *carry) {
+		uint64_t region = quotes;
+		region ^= region << 1;
+		region ^= region << 2;
+		region ^= region << 4;
+		region ^= region << 8;
+		region ^= region << 16;
+		region ^= region << 32;
+		region ^= *carry;
+		*carry = (uint64_t)((int64_t)region >> 63);
+		return region;
+	}
+
+	/**
+	 * @brief UTF-8の検証を終える
+	 * @param state 状態
+	 * @return false: 文字の途中で終わった
+	 */
+	static inline bool CsvScanner_FinishUtf8(const CsvUtf8State_t *state) {
+		return !state->isIncomplete;
+	}
+
+#ifdef __cplusplus
+}
+#endif
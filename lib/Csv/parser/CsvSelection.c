@@ -0,0 +1,251 @@
+/**
+ * @file CsvSelection.c
+ * @brief パース中に取り出す列と残す行を決める
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "Csv/content/column/CsvColumn.h"
+#include "utilities.h"
+#include "CsvSelection.h"
+
+/**
+ * @brief 文字列を複製する
+ * @param text 文字列 (NULL可)
+ * @param copy 複製 (text が NULL なら NULL)
+ * @return false: メモリ不足
+ */
+static bool Duplicate(const char *text, char **copy) {
+	*copy = NULL;
+	if (!text) {
+		return true;
+	}
+	*copy = strdup(text);
+	return *copy != NULL;
+}
+
+/**
+ * @brief 大きいほう
+ * @param a 値
+ * @param b 値
+ * @return
+ */
+static inline size_t Max(size_t a, size_t b) {
+	return (a > b) ? a : b;
+}
+
+/**
+ * @brief ヘッダーから列を探す
+ * @param header ヘッダー (NULL: ヘッダーが無い)
+ * @param name 列名
+ * @param column 列
+ * @return false: 見つからない
+ */
+static bool FindColumn(const CsvContent_t *header, const char *name, size_t *column) {
+	return header && CsvContent_FindColumn(header, name, column);
+}
+
+/**
+ * @brief 元の列ごとの役割を作る
+ * @param self インスタンス
+ * @return false: メモリ不足
+ */
+static bool BuildRoles(CsvSelection_t *self) {
+	size_t numRoles = 0;
+	size_t minColumns = 0;
+	for (size_t i = 0; i < self->numColumns; i++) {
+		numRoles = Max(numRoles, self->columns[i] + 1);
+	}
+	for (size_t i = 0; i < self->numPredicates; i++) {
+		minColumns = Max(minColumns, self->predicates[i].column + 1);
+	}
+	numRoles = Max(numRoles, minColumns);
+	uint8_t *roles = calloc(numRoles ? numRoles : 1, sizeof(uint8_t));
+	if (UNLIKELY(!roles)) {
+		return false;
+	}
+	for (size_t i = 0; i < self->numColumns; i++) {
+		roles[self->columns[i]] |= CSV_SELECTION_OUTPUT;
+	}
+	for (size_t i = 0; i < self->numPredicates; i++) {
+		roles[self->predicates[i].column] |= CSV_SELECTION_PREDICATE;
+	}
+	free(self->roles);
+	self->roles = roles;
+	self->numRoles = numRoles;
+	self->minColumns = minColumns;
+	return true;
+}
+
+/**
+ * @brief プロパティの配列と文字列を複製する
+ * @param self インスタンス
+ * @param props プロパティ
+ * @param numColumns 取り出す列の数
+ * @param numPredicates 条件の数
+ * @return false: 無効なプロパティかメモリ不足
+ */
+static bool Copy(CsvSelection_t *self, const CsvProperties_t *props, size_t numColumns, size_t numPredicates) {
+	self->columns = calloc(numColumns + 1, sizeof(size_t));
+	self->predicates = calloc(numPredicates + 1, sizeof(CsvSelectionPredicate_t));
+	if (UNLIKELY(!self->columns || !self->predicates)) {
+		return false;
+	}
+	self->numColumns = numColumns;
+	self->numPredicates = numPredicates;
+	if (props->columnNames && (numColumns > 0)) {
+		self->columnNames = calloc(numColumns, sizeof(char *));
+		if (UNLIKELY(!self->columnNames)) {
+			return false;
+		}
+		for (size_t i = 0; i < numColumns; i++) {
+			if (!props->columnNames[i] || !Duplicate(props->columnNames[i], &self->columnNames[i])) {
+				return false;
+			}
+		}
+	} else if (numColumns > 0) {
+		memcpy(self->columns, props->columns, numColumns * sizeof(size_t));
+	}
+	for (size_t i = 0; i < numPredicates; i++) {
+		const CsvPredicate_t *predicate = &props->predicates[i];
+		CsvSelectionPredicate_t *copy = &self->predicates[i];
+		copy->column = predicate->column;
+		copy->op = predicate->op;
+		if (!predicate->value || (predicate->op > CSV_PREDICATE_GREATER_THAN) ||
+			!Duplicate(predicate->columnName, &copy->columnName) ||
+			!Duplicate(predicate->value, &copy->value)) {
+			return false;
+		}
+		if ((predicate->op >= CSV_PREDICATE_LESS_THAN) && !CsvColumn_ParseDouble(predicate->value, &copy->number)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief 初期化
+ * @note プロパティの配列と文字列は複製するので、呼び出し後に解放してよい
+ * @param self インスタンス
+ * @param props プロパティ
+ * @return false: 無効なプロパティかメモリ不足
+ */
+bool CsvSelection_Init(CsvSelection_t *self, const CsvProperties_t *props) {
+	CLEAR(self);
+	size_t numColumns = (props->columns || props->columnNames) ? props->numColumns : 0;
+	size_t numPredicates = props->predicates ? props->numPredicates : 0;
+	self->isActive = (numColumns > 0) || (numPredicates > 0);
+	if (!self->isActive) {
+		return true;
+	}
+	if (!Copy(self, props, numColumns, numPredicates) ||
+		(!CsvSelection_NeedsHeader(self) && !BuildRoles(self))) {
+		CsvSelection_Destroy(self);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief 列名の解決にヘッダーが必要か
+ * @param self インスタンス
+ * @return
+ */
+bool CsvSelection_NeedsHeader(const CsvSelection_t *self) {
+	if (self->columnNames) {
+		return true;
+	}
+	for (size_t i = 0; i < self->numPredicates; i++) {
+		if (self->predicates[i].columnName) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief 列名を列に解決する
+ * @param self インスタンス
+ * @param header ヘッダーだけのコンテンツ (CsvContent_IndexHeader 済み。NULL: ヘッダーが無い)
+ * @return false: 見つからない列名がある
+ */
+bool CsvSelection_Resolve(CsvSelection_t *self, const CsvContent_t *header) {
+	if (!self->isActive) {
+		return true;
+	}
+	for (size_t i = 0; self->columnNames && (i < self->numColumns); i++) {
+		if (!FindColumn(header, self->columnNames[i], &self->columns[i])) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < self->numPredicates; i++) {
+		CsvSelectionPredicate_t *predicate = &self->predicates[i];
+		if (predicate->columnName && !FindColumn(header, predicate->columnName, &predicate->column)) {
+			return false;
+		}
+	}
+	return BuildRoles(self);
+}
+
+/**
+ * @brief 列の値が条件を満たすか
+ * @param self インスタンス
+ * @param column 元の列
+ * @param text 値
+ * @return
+ */
+bool CsvSelection_Test(const CsvSelection_t *self, size_t column, const char *text) {
+	for (size_t i = 0; i < self->numPredicates; i++) {
+		const CsvSelectionPredicate_t *predicate = &self->predicates[i];
+		if (predicate->column != column) {
+			continue;
+		}
+		double number;
+		bool result;
+		switch (predicate->op) {
+		case CSV_PREDICATE_EQUAL:
+			result = strcmp(text, predicate->value) == 0;
+			break;
+		case CSV_PREDICATE_NOT_EQUAL:
+			result = strcmp(text, predicate->value) != 0;
+			break;
+		case CSV_PREDICATE_LESS_THAN:
+			result = CsvColumn_ParseDouble(text, &number) && (number < predicate->number);
+			break;
+		case CSV_PREDICATE_GREATER_THAN:
+			result = CsvColumn_ParseDouble(text, &number) && (number > predicate->number);
+			break;
+		default:
+			result = false;
+			break;
+		}
+		if (!result) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief インスタンスを破棄
+ * @param self インスタンス
+ */
+void CsvSelection_Destroy(CsvSelection_t *self) {
+	if (self->columnNames) {
+		for (size_t i = 0; i < self->numColumns; i++) {
+			free(self->columnNames[i]);
+		}
+		free(self->columnNames);
+	}
+	if (self->predicates) {
+		for (size_t i = 0; i < self->numPredicates; i++) {
+			free(self->predicates[i].columnName);
+			free(self->predicates[i].value);
+		}
+		free(self->predicates);
+	}
+	free(self->columns);
+	free(self->roles);
+	CLEAR(self);
+}
@@ -0,0 +1,79 @@
+/**
+ * @file CsvSelection.h
+ * @brief パース中に取り出す列と残す行を決める
+ * @author atohs
+ * @date 2024/07/12
+ */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "Csv/property/CsvProperty.h"
+#include "Csv/content/CsvContent.h"
+
+//! 列を出力する
+#define CSV_SELECTION_OUTPUT	((uint8_t)0x01)
+//! 列に条件がある
+#define CSV_SELECTION_PREDICATE	((uint8_t)0x02)
+
+	/**
+	 * @brief 条件
+	 */
+	typedef struct CsvSelectionPredicate_t {
+		size_t column;
+		char *columnName;
+		CsvPredicateOperator op;
+		char *value;
+		//! 数値で比べる場合の値
+		double number;
+	} CsvSelectionPredicate_t;
+
+	/**
+	 * @brief 制御ブロック
+	 */
+	typedef struct CsvSelection_t {
+		//! @name Private
+		//! @{
+
+		//! 列の選択か条件がある
+		bool isActive;
+		//! 取り出す列 (出力順)
+		size_t *columns;
+		//! 名前で指定した取り出す列 (NULL: 番号で指定した)
+		char **columnNames;
+		//! 取り出す列の数 (0: すべて)
+		size_t numColumns;
+		CsvSelectionPredicate_t *predicates;
+		size_t numPredicates;
+		//! 元の列ごとの役割 (CSV_SELECTION_OUTPUT | CSV_SELECTION_PREDICATE)
+		uint8_t *roles;
+		size_t numRoles;
+		//! 条件を調べるために最低限必要な列の数
+		size_t minColumns;
+
+		//! @}
+	} CsvSelection_t;
+
+	bool CsvSelection_Init(CsvSelection_t *self, const CsvProperties_t *props);
+	bool CsvSelection_NeedsHeader(const CsvSelection_t *self);
+	bool CsvSelection_Resolve(CsvSelection_t *self, const CsvContent_t *header);
+	bool CsvSelection_Test(const CsvSelection_t *self, size_t column, const char *text);
+	void CsvSelection_Destroy(CsvSelection_t *self);
+
+	/**
+	 * @brief 列の役割
+	 * @param self インスタンス
+	 * @param column 元の列
+	 * @return 役割 (0: 使わない)
+	 */
+	static inline uint8_t CsvSelection_GetRole(const CsvSelection_t *self, size_t column) {
+		return (column < self->numRoles) ? self->roles[column] : 0;
+	}
+
+#ifdef __cplusplus
+}
+#endif
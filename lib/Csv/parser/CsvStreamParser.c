@@ -0,0 +1,401 @@
+/**
+ * @file CsvStreamParser.c
+ * @brief 少しずつ渡されるデータをパースするCsvパーサー
+ * @note 完成した行から順に渡し、使い終わった行は捨てるので、
+ * 保持するのは最も長い行と渡されたデータの分だけになる
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Csv/property/CsvProperty.h"
+#include "Csv/parser/CsvStreamParser.h"
+#include "utilities.h"
+#include "CsvScanner.h"
+
+//! 改行文字
+#define CARRIGE_RETURN	('\r')
+//! 改行文字
+#define LINE_FEED		('\n')
+//! バッファの最小サイズ
+#define MIN_BUFFER_SIZE	((size_t)4096)
+
+/**
+ * @struct CsvStreamParser_t
+ * @brief ストリームパーサー
+ */
+struct CsvStreamParser_t {
+	CsvProperties_t properties;
+	CsvScanner_t scanner;
+	//! 行を受け取るハンドラ (NULL: CsvStreamParser_Next で取り出す)
+	CsvRowHandler onRow;
+	void *userData;
+	//! まだ行にしていないデータ
+	char *buffer;
+	size_t capacity;
+	size_t length;
+	//! 次の行の先頭
+	size_t rowStart;
+	//! 改行を探し終えた位置
+	size_t searched;
+	//! 探し終えた位置の引用符とエスケープの状態
+	CsvScanState_t scanState;
+	//! 次の行の先頭がコメント文字で、行全体を読み飛ばす
+	bool isComment;
+	//! 最後に渡した行
+	CsvLine_t line;
+	//! 後ろに行が続くか分からないので、まだ渡していない空行の数
+	size_t pendingEmptyRows;
+	//! 後ろに行が続くと分かったので、次に渡す空行の数
+	size_t emptyRowsToDeliver;
+	//! データの終わりを受け取った
+	bool finished;
+	//! エラーが起きたら以降は同じエラーを返す
+	CsvReturnCode status;
+};
+
+/**
+ * @brief 空き領域を確保する
+ * @note 渡し終えた行の分を詰めてから、足りなければ広げる
+ * @param self インスタンス
+ * @param size 追加するサイズ
+ * @return false: メモリ不足
+ */
+static bool Reserve(CsvStreamParser_t *self, size_t size) {
+	if (self->rowStart > 0) {
+		self->length -= self->rowStart;
+		self->searched -= self->rowStart;
+		memmove(self->buffer, self->buffer + self->rowStart, self->length);
+		self->rowStart = 0;
+	}
+	size_t required = self->length + size + 1;	// 最後の行を終端する分
+	if (required <= self->capacity) {
+		return true;
+	}
+	size_t newCapacity = self->capacity ? self->capacity : MIN_BUFFER_SIZE;
+	while (newCapacity < required) {
+		newCapacity *= 2;
+	}
+	char *buffer = realloc(self->buffer, newCapacity);
+	if (UNLIKELY(!buffer)) {
+		return false;
+	}
+	self->buffer = buffer;
+	self->capacity = newCapacity;
+	return true;
+}
+
+/**
+ * @brief 行の終わりを探す
+ * @note 探し終えた位置と引用符の状態を覚えておき、続きのデータが来たらそこから探す。
+ * 引用符で囲まれた改行文字とエスケープされた改行文字は行の終わりにしない
+ * @note コメント行は引用符を数えず、次の改行文字までを行とする
+ * @param self インスタンス
+ * @param end 改行文字の位置 (SIZE_MAX: 見つからない)
+ */
+static void FindRowEnd(CsvStreamParser_t *self, size_t *end) {
+	*end = SIZE_MAX;
+	char comment = self->scanner.comment;
+	if (comment && (self->searched == self->rowStart) && (self->rowStart < self->length)) {
+		self->isComment = self->buffer[self->rowStart] == comment;
+	}
+	if (self->isComment) {
+		char *lineFeed = memchr(self->buffer + self->searched, LINE_FEED, self->length - self->searched);
+		self->searched = lineFeed ? (size_t)(lineFeed - self->buffer) + 1 : self->length;
+		*end = lineFeed ? self->searched - 1 : SIZE_MAX;
+		return;
+	}
+	while (self->searched < self->length) {
+		size_t offset = self->searched;
+		size_t size = self->length - offset;
+		CsvScanMask_t mask;
+		CsvScanner_Next(&self->scanner, self->buffer + offset, size, &self->scanState, &mask);
+		for (uint64_t bits = mask.structurals; bits != 0; bits &= bits - 1) {
+			size_t position = offset + __builtin_ctzll(bits);
+			if (self->buffer[position] == LINE_FEED) {
+				self->searched = position + 1;
+				CLEAR(&self->scanState);
+				*end = position;
+				return;
+			}
+		}
+		if (size < CSV_SCAN_BLOCK_SIZE) {
+			// 端数の後ろの詰め物ではなく、続きのデータの先頭がエスケープされるか
+			self->scanState.escaped = CsvScanner_IsEscaped(&self->scanner, self->buffer, self->length);
+		}
+		self->searched += (size < CSV_SCAN_BLOCK_SIZE) ? size : CSV_SCAN_BLOCK_SIZE;
+	}
+}
+
+/**
+ * @brief フィールドを追加する
+ * @param self インスタンス
+ * @param item アイテム
+ * @param start フィールドの先頭
+ * @param end フィールドの終わり (終端済み)
+ */
+static void AddField(CsvStreamParser_t *self, CsvItem_t *item, char *start, char *end) {
+	CsvItem_Set(item, CsvScanner_Unquote(&self->scanner, start, end));
+	CsvLine_MoveBackItem(&self->line, item);
+}
+
+/**
+ * @brief 行をアイテムに分ける
+ * @note 区切る前にブロックごとにUTF-8を検証する
+ * @param self インスタンス
+ * @param start 行の先頭
+ * @param end 行の終わり (改行文字の位置)
+ * @return ステータス
+ */
+static CsvReturnCode SplitRow(CsvStreamParser_t *self, size_t start, size_t end) {
+	if ((end > start) && (self->buffer[end - 1] == CARRIGE_RETURN)) {
+		end--;
+	}
+	char *row = self->buffer + start;
+	size_t size = end - start;
+	row[size] = '\0';
+	CsvItemCollection_Clear(&self->line.items);
+	CsvItem_t item;
+	CsvItem_Init(&item);
+	char *itemStart = row;
+	CsvScanState_t state;
+	CsvUtf8State_t utf8;
+	CLEAR(&state);
+	CLEAR(&utf8);
+	for (size_t offset = 0; offset < size; offset += CSV_SCAN_BLOCK_SIZE) {
+		CsvScanMask_t mask;
+		CsvScanner_Next(&self->scanner, row + offset, size - offset, &state, &mask);
+		if (!CsvScanner_ValidateUtf8(&self->scanner, row + offset, size - offset, mask.nonAscii, &utf8)) {
+			return CSV_INVALID_CHAR_CODE;
+		}
+		for (uint64_t bits = mask.structurals; bits != 0; bits &= bits - 1) {
+			char *c = row + offset + __builtin_ctzll(bits);
+			if (*c == self->scanner.delimiter) {
+				*c = '\0';
+				AddField(self, &item, itemStart, c);
+				itemStart = c + 1;
+			}
+		}
+	}
+	if (!CsvScanner_FinishUtf8(&utf8)) {
+		return CSV_INVALID_CHAR_CODE;
+	}
+	AddField(self, &item, itemStart, row + size);
+	return CSV_SUCCESS;
+}
+
+/**
+ * @brief 空行か
+ * @param self インスタンス
+ * @param start 行の先頭
+ * @param end 行の終わり
+ * @return
+ */
+static inline bool IsEmptyRow(const CsvStreamParser_t *self, size_t start, size_t end) {
+	return (end == start) || ((end == start + 1) && (self->buffer[start] == CARRIGE_RETURN));
+}
+
+/**
+ * @brief 次の行を取り出す
+ * @note 末尾の空行は捨てたいので、空行は次の行が来るまで渡さない
+ * @param self インスタンス
+ * @param line 行 (NULL: まだ行になっていない)
+ * @return ステータス
+ */
+static CsvReturnCode TakeRow(CsvStreamParser_t *self, const CsvLine_t **line) {
+	*line = NULL;
+	if (self->emptyRowsToDeliver > 0) {
+		self->emptyRowsToDeliver--;
+		CsvItemCollection_Clear(&self->line.items);
+		CsvItem_t item;
+		CsvItem_Init(&item);
+		CsvItem_Set(&item, "");
+		CsvLine_MoveBackItem(&self->line, &item);
+		*line = &self->line;
+		return CSV_SUCCESS;
+	}
+	for (;;) {
+		size_t end;
+		FindRowEnd(self, &end);
+		size_t start = self->rowStart;
+		if (self->isComment && ((end != SIZE_MAX) || self->finished)) {
+			// コメント行は空行としても数えない
+			end = (end == SIZE_MAX) ? self->length : end;
+			self->rowStart = (end == self->length) ? end : end + 1;
+			self->isComment = false;
+			if (!CsvScanner_ValidateText(&self->scanner, self->buffer + start, end - start)) {
+				return CSV_INVALID_CHAR_CODE;
+			}
+			continue;
+		}
+		if (end == SIZE_MAX) {
+			if (!self->finished) {
+				return CSV_SUCCESS;
+			}
+			if (self->scanState.quoted) {
+				return CSV_INVALID_FORMAT;	// 引用符が閉じていない
+			}
+			end = self->length;	// 改行で終わっていない最後の行
+			self->rowStart = end;
+			if (IsEmptyRow(self, start, end)) {
+				self->pendingEmptyRows = 0;
+				return CSV_SUCCESS;
+			}
+		} else {
+			self->rowStart = end + 1;
+			if (IsEmptyRow(self, start, end)) {
+				self->pendingEmptyRows++;
+				continue;
+			}
+		}
+		if (self->pendingEmptyRows > 0) {
+			// 空行を先に渡すため、この行は読み直す
+			self->emptyRowsToDeliver = self->pendingEmptyRows;
+			self->pendingEmptyRows = 0;
+			self->rowStart = start;
+			self->searched = start;
+			CLEAR(&self->scanState);
+			return TakeRow(self, line);
+		}
+		CsvReturnCode ret = SplitRow(self, start, end);
+		if (ret != CSV_SUCCESS) {
+			return ret;
+		}
+		*line = &self->line;
+		return CSV_SUCCESS;
+	}
+}
+
+/**
+ * @brief 完成した行をハンドラへ渡す
+ * @param self インスタンス
+ * @return ステータス
+ */
+static CsvReturnCode Dispatch(CsvStreamParser_t *self) {
+	for (;;) {
+		const CsvLine_t *line;
+		CsvReturnCode ret = TakeRow(self, &line);
+		if (ret != CSV_SUCCESS) {
+			return ret;
+		}
+		if (!line) {
+			return CSV_SUCCESS;
+		}
+		self->onRow(line, self->userData);
+	}
+}
+
+/**
+ * @brief 初期化
+ * @param props プロパティ
+ * @param onRow 行を受け取るハンドラ (NULL: CsvStreamParser_Next で取り出す)
+ * @param userData ハンドラに渡すデータ
+ * @return インスタンス (NULL: 区切り文字などの組み合わせが不正)
+ */
+CsvStreamParser_t *CsvStreamParser_Init(const CsvProperties_t *props, CsvRowHandler onRow, void *userData) {
+	if (UNLIKELY(!props)) {
+		return NULL;
+	}
+	CsvStreamParser_t *self = (CsvStreamParser_t *)calloc(1, sizeof(*self));
+	if (UNLIKELY(!self)) {
+		return NULL;
+	}
+	self->properties = *props;
+	self->onRow = onRow;
+	self->userData = userData;
+	if (!CsvScanner_Init(&self->scanner, props)) {
+		free(self);
+		return NULL;
+	}
+	CsvLine_Init(&self->line);
+	return self;
+}
+
+/**
+ * @brief データを渡す
+ * @note 行の途中で区切られていてもよい。ハンドラがあれば完成した行を渡してから戻る
+ * @attention ハンドラが無い場合は CsvStreamParser_Next で行を取り出してから次のデータを渡すこと
+ * @param self インスタンス
+ * @param data データ
+ * @param dataSize データサイズ
+ * @return ステータス
+ */
+CsvReturnCode CsvStreamParser_Feed(CsvStreamParser_t *self, const char *data, size_t dataSize) {
+	if (UNLIKELY(!self || (!data && dataSize > 0) || self->finished)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	if (self->status != CSV_SUCCESS) {
+		return self->status;
+	}
+	if (!Reserve(self, dataSize)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	memcpy(self->buffer + self->length, data, dataSize);
+	self->length += dataSize;
+	if (self->onRow) {
+		self->status = Dispatch(self);
+	}
+	return self->status;
+}
+
+/**
+ * @brief 次の行を取り出す
+ * @note 行は次に CsvStreamParser_Next か CsvStreamParser_Feed を呼ぶまで有効
+ * @param self インスタンス
+ * @param line 行 (NULL: 続きのデータが必要、または終わり)
+ * @return ステータス
+ */
+CsvReturnCode CsvStreamParser_Next(CsvStreamParser_t *self, const CsvLine_t **line) {
+	if (UNLIKELY(!self || !line)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	*line = NULL;
+	if (self->status != CSV_SUCCESS) {
+		return self->status;
+	}
+	self->status = TakeRow(self, line);
+	return self->status;
+}
+
+/**
+ * @brief データの終わりを知らせる
+ * @note 改行で終わっていない最後の行も行として扱う。末尾の空行は捨てる
+ * @param self インスタンス
+ * @return ステータス
+ */
+CsvReturnCode CsvStreamParser_Finish(CsvStreamParser_t *self) {
+	if (UNLIKELY(!self)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	self->finished = true;
+	if ((self->status == CSV_SUCCESS) && self->onRow) {
+		self->status = Dispatch(self);
+	}
+	return self->status;
+}
+
+/**
+ * @brief 確保しているバッファのサイズ
+ * @param self インスタンス
+ * @return バイト数
+ */
+size_t CsvStreamParser_GetBufferSize(const CsvStreamParser_t *self) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	return self->capacity;
+}
+
+/**
+ * @brief インスタンスを破棄
+ * @param self インスタンス
+ */
+void CsvStreamParser_Destroy(CsvStreamParser_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	CsvLine_Destroy(&self->line);
+	if (self->buffer) free(self->buffer);
+	free(self);
+}
@@ -0,0 +1,764 @@
+/**
+ * @file CsvWriter.c
+ * @brief Csvライター
+ * @note 内部バッファに書き溜めてから書き込み先へまとめて渡す。
+ * 区切り文字、引用符、改行文字を含むフィールドだけを引用符で囲む
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Csv/writer/CsvWriter.h"
+#include "utilities.h"
+
+//! 内部バッファのサイズ
+#define BUFFER_SIZE			((size_t)64 * 1024)
+//! 数値を書式化するのに十分なサイズ
+#define NUMBER_SIZE			(32)
+//! 既定の区切り文字
+#define DEFAULT_DELIMITER	(',')
+//! 既定の引用符
+#define DEFAULT_QUOTE		('"')
+//! 改行文字
+#define CARRIGE_RETURN		('\r')
+//! 改行文字
+#define LINE_FEED			('\n')
+//! 小数を整数にして書く場合の最大の小数桁数
+#define MAX_FRACTION_DIGITS	(17)
+//! 誤差なく表せる整数の上限 (2^53)
+#define MAX_EXACT_INTEGER	(9007199254740992.0)
+//! 読み込むと同じ値に戻るのに十分な有効桁数
+#define SIGNIFICANT_DIGITS	(17)
+
+/**
+ * @brief 書き込み先
+ */
+typedef enum CsvWriterSink {
+	//! MemoryStream
+	CSV_WRITER_SINK_MEMORY_STREAM = 0,
+	//! ファイルディスクリプタ
+	CSV_WRITER_SINK_FD,
+	//! 呼び出し側のバッファ (内部バッファを使わず直接書く)
+	CSV_WRITER_SINK_BUFFER,
+} CsvWriterSink;
+
+/**
+ * @struct CsvWriter_t
+ * @brief Csvライター
+ */
+struct CsvWriter_t {
+	char delimiter;
+	char quote;
+	//! エスケープ文字 ('\0': 引用符で囲み、引用符は "" にする)
+	char escape;
+	//! コメント文字 (行頭のフィールドが始まる場合は囲む)
+	char comment;
+	const char *eol;
+	size_t eolLength;
+	//! 文字ごとに、囲むかエスケープが必要か
+	bool isSpecial[256];
+	CsvWriterSink sink;
+	MemoryStream *stream;
+	int fd;
+	char *buffer;
+	size_t capacity;
+	size_t length;
+	//! 書きかけの行の先頭 (呼び出し側のバッファが足りなければ、ここまで戻す)
+	size_t rowStart;
+	//! 書き込み先へ渡したバイト数
+	size_t flushed;
+	//! 現在の行に書いたフィールドの数
+	size_t column;
+	//! 現在の行の先頭のフィールドが空
+	bool isFirstEmpty;
+	//! エラーが起きたら以降は同じエラーを返す
+	CsvReturnCode status;
+};
+
+//! 00から99までの2桁の数字
+static const char DIGIT_PAIRS[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+//! 10の累乗 (誤差なく表せる範囲)
+static const double POWERS_OF_TEN[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+};
+
+/**
+ * @brief ファイルディスクリプタにすべて書き込む
+ * @param fd ファイルディスクリプタ
+ * @param data データ
+ * @param size サイズ
+ * @return false: 失敗
+ */
+static bool WriteAll(int fd, const char *data, size_t size) {
+	while (size > 0) {
+		ssize_t written = write(fd, data, size);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		size -= (size_t)written;
+	}
+	return true;
+}
+
+/**
+ * @brief 書き溜めたデータを書き込み先へ渡す
+ * @param self インスタンス
+ * @return ステータス
+ */
+static CsvReturnCode FlushBuffer(CsvWriter_t *self) {
+	if ((self->sink == CSV_WRITER_SINK_BUFFER) || (self->length == 0)) {
+		return CSV_SUCCESS;
+	}
+	bool succeeded = (self->sink == CSV_WRITER_SINK_FD)
+		? WriteAll(self->fd, self->buffer, self->length)
+		: MemoryStream_Write(self->stream, self->buffer, self->length) == (ssize_t)self->length;
+	if (!succeeded) {
+		return CSV_WRITE_ERROR;
+	}
+	self->flushed += self->length;
+	self->length = 0;
+	return CSV_SUCCESS;
+}
+
+/**
+ * @brief 空き領域を確保する
+ * @param self インスタンス
+ * @param size 必要なサイズ (内部バッファのサイズ以下)
+ * @return false: 書き込めない
+ */
+static inline bool Reserve(CsvWriter_t *self, size_t size) {
+	if (LIKELY(self->length + size <= self->capacity)) {
+		return true;
+	}
+	if (self->sink == CSV_WRITER_SINK_BUFFER) {
+		self->status = CSV_WRITE_ERROR;	// 呼び出し側のバッファが足りない
+		self->length = self->rowStart;	// 書きかけの行を残さない
+		return false;
+	}
+	self->status = FlushBuffer(self);
+	return self->status == CSV_SUCCESS;
+}
+
+/**
+ * @brief データを追加する
+ * @note 内部バッファより大きければ分けて渡す
+ * @param self インスタンス
+ * @param data データ
+ * @param size サイズ
+ * @return false: 書き込めない
+ */
+static bool Append(CsvWriter_t *self, const char *data, size_t size) {
+	while (size > 0) {
+		size_t space = self->capacity - self->length;
+		if ((space == 0) && !Reserve(self, 1)) {
+			return false;
+		}
+		space = self->capacity - self->length;
+		size_t length = (size < space) ? size : space;
+		memcpy(self->buffer + self->length, data, length);
+		self->length += length;
+		data += length;
+		size -= length;
+	}
+	return true;
+}
+
+/**
+ * @brief 1文字追加する
+ * @param self インスタンス
+ * @param c 文字
+ * @return false: 書き込めない
+ */
+static inline bool AppendChar(CsvWriter_t *self, char c) {
+	if (UNLIKELY(!Reserve(self, 1))) {
+		return false;
+	}
+	self->buffer[self->length++] = c;
+	return true;
+}
+
+/**
+ * @brief フィールドを始める
+ * @note 2番目以降のフィールドの前には区切り文字を書く
+ * @param self インスタンス
+ * @return false: 書き込めない
+ */
+static inline bool BeginField(CsvWriter_t *self) {
+	if (UNLIKELY(self->status != CSV_SUCCESS)) {
+		return false;
+	}
+	if (self->column++ == 0) {
+		return true;
+	}
+	return AppendChar(self, self->delimiter);
+}
+
+/**
+ * @brief 囲むかエスケープが必要な文字の位置を探す
+ * @param self インスタンス
+ * @param text テキスト
+ * @param size サイズ
+ * @return 位置 (size: 無い)
+ */
+static inline size_t FindSpecial(const CsvWriter_t *self, const char *text, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		if (self->isSpecial[(uint8_t)text[i]]) {
+			return i;
+		}
+	}
+	return size;
+}
+
+/**
+ * @brief エスケープ文字を前に置いて書く
+ * @param self インスタンス
+ * @param text テキスト
+ * @param size サイズ
+ * @param special 最初に特別な文字がある位置
+ * @return false: 書き込めない
+ */
+static bool AppendEscaped(CsvWriter_t *self, const char *text, size_t size, size_t special) {
+	while (special < size) {
+		if (!Append(self, text, special) || !AppendChar(self, self->escape) || !AppendChar(self, text[special])) {
+			return false;
+		}
+		text += special + 1;
+		size -= special + 1;
+		special = FindSpecial(self, text, size);
+	}
+	return Append(self, text, size);
+}
+
+/**
+ * @brief 引用符で囲んで書く
+ * @note 引用符は "" にする
+ * @param self インスタンス
+ * @param text テキスト
+ * @param size サイズ
+ * @return false: 書き込めない
+ */
+static bool AppendQuoted(CsvWriter_t *self, const char *text, size_t size) {
+	if (!AppendChar(self, self->quote)) {
+		return false;
+	}
+	for (;;) {
+		const char *quote = memchr(text, self->quote, size);
+		if (!quote) {
+			break;
+		}
+		size_t length = (size_t)(quote - text) + 1;
+		if (!Append(self, text, length) || !AppendChar(self, self->quote)) {
+			return false;
+		}
+		text += length;
+		size -= length;
+	}
+	return Append(self, text, size) && AppendChar(self, self->quote);
+}
+
+/**
+ * @brief 書式化済みの数値をフィールドとして書く
+ * @param self インスタンス
+ * @param text 数値
+ * @param size サイズ
+ * @return ステータス
+ */
+static CsvReturnCode AppendNumber(CsvWriter_t *self, const char *text, size_t size) {
+	if (BeginField(self)) {
+		Append(self, text, size);
+	}
+	return self->status;
+}
+
+/**
+ * @brief 符号なし整数を10進数にする
+ * @note 2桁ずつ表を引いて後ろから埋める
+ * @param value 値
+ * @param end 書き込み先の終わり
+ * @return 書き込んだ先頭
+ */
+static char *FormatUnsigned(uint64_t value, char *end) {
+	char *p = end;
+	while (value >= 100) {
+		unsigned pair = (unsigned)(value % 100) * 2;
+		value /= 100;
+		p -= 2;
+		memcpy(p, &DIGIT_PAIRS[pair], 2);
+	}
+	if (value >= 10) {
+		p -= 2;
+		memcpy(p, &DIGIT_PAIRS[value * 2], 2);
+	} else {
+		*--p = (char)('0' + value);
+	}
+	return p;
+}
+
+/**
+ * @brief 整数を10進数にする
+ * @param value 値
+ * @param end 書き込み先の終わり
+ * @return 書き込んだ先頭
+ */
+static char *FormatInt64(int64_t value, char *end) {
+	if (value >= 0) {
+		return FormatUnsigned((uint64_t)value, end);
+	}
+	char *p = FormatUnsigned(0 - (uint64_t)value, end);
+	*--p = '-';
+	return p;
+}
+
+/**
+ * @brief 指数表記から仮数の数字と指数を取り出す
+ * @note 小数点はロケールによって文字もバイト数も異なるので、数字以外を読み飛ばして求める
+ * @param text "%.*e" で書式化した有限の値
+ * @param digits 仮数の数字 (SIGNIFICANT_DIGITS バイト)
+ * @param exponent 指数
+ * @return 数字の数 (末尾の0は除く)
+ */
+static size_t ParseScientific(const char *text, char *digits, int *exponent) {
+	size_t numDigits = 0;
+	const char *p = text;
+	for (; *p && (*p != 'e'); p++) {
+		if ((*p >= '0') && (*p <= '9') && (numDigits < SIGNIFICANT_DIGITS)) {
+			digits[numDigits++] = *p;
+		}
+	}
+	while ((numDigits > 1) && (digits[numDigits - 1] == '0')) {
+		numDigits--;
+	}
+	bool negative = (p[0] == 'e') && (p[1] == '-');
+	int e = 0;
+	for (p += (p[0] == 'e') ? 2 : 0; (*p >= '0') && (*p <= '9'); p++) {
+		e = e * 10 + (*p - '0');
+	}
+	*exponent = negative ? -e : e;
+	return numDigits;
+}
+
+/**
+ * @brief 17桁の有効数字で10進数にする
+ * @note %.17g と同じ表記を、小数点をロケールによらず '.' にして書く。
+ * 数字は snprintf で求め、並べ方と小数点はここで決める
+ * @param value 値
+ * @param buffer 書き込み先 (NUMBER_SIZE バイト)
+ * @return 長さ
+ */
+static size_t FormatSignificant(double value, char *buffer) {
+	size_t length = 0;
+	if (signbit(value) && !isnan(value)) {
+		buffer[length++] = '-';
+	}
+	if (!isfinite(value)) {
+		memcpy(buffer + length, isnan(value) ? "nan" : "inf", 3);
+		return length + 3;
+	}
+	char text[NUMBER_SIZE * 2];
+	snprintf(text, sizeof(text), "%.*e", SIGNIFICANT_DIGITS - 1, fabs(value));
+	char digits[SIGNIFICANT_DIGITS];
+	int exponent;
+	size_t numDigits = ParseScientific(text, digits, &exponent);
+	if ((exponent < -4) || (exponent >= SIGNIFICANT_DIGITS)) {
+		buffer[length++] = digits[0];
+		if (numDigits > 1) {
+			buffer[length++] = '.';
+			memcpy(buffer + length, digits + 1, numDigits - 1);
+			length += numDigits - 1;
+		}
+		buffer[length++] = 'e';
+		buffer[length++] = (exponent < 0) ? '-' : '+';
+		unsigned absExponent = (unsigned)((exponent < 0) ? -exponent : exponent);
+		if (absExponent >= 100) {
+			buffer[length++] = (char)('0' + absExponent / 100);
+		}
+		memcpy(buffer + length, &DIGIT_PAIRS[(absExponent % 100) * 2], 2);
+		return length + 2;
+	}
+	if (exponent < 0) {
+		buffer[length++] = '0';
+		buffer[length++] = '.';
+		for (int i = -1; i > exponent; i--) {
+			buffer[length++] = '0';	// 小数点の直後の0
+		}
+		memcpy(buffer + length, digits, numDigits);
+		return length + numDigits;
+	}
+	size_t numIntegerDigits = (size_t)exponent + 1;
+	for (size_t i = 0; i < numIntegerDigits; i++) {
+		buffer[length++] = (i < numDigits) ? digits[i] : '0';
+	}
+	if (numDigits > numIntegerDigits) {
+		buffer[length++] = '.';
+		memcpy(buffer + length, digits + numIntegerDigits, numDigits - numIntegerDigits);
+		length += numDigits - numIntegerDigits;
+	}
+	return length;
+}
+
+/**
+ * @brief 小数を10進数にする
+ * @note 10^kを掛けて整数になり、割り戻すと元の値に一致する最小のkを探し、
+ * 整数の数字列に小数点を挿入する。割り戻しは整数と10の累乗がどちらも誤差なく表せるので
+ * 1回の丸めで済み、読み込み側(正しく丸める strtod)でも同じ値に戻る。
+ * 見つからなければ17桁の有効数字で書く (FormatSignificant)
+ * @param value 値
+ * @param buffer 書き込み先 (NUMBER_SIZE バイト)
+ * @return 長さ
+ */
+static size_t FormatDouble(double value, char *buffer) {
+	if (isfinite(value) && (fabs(value) < MAX_EXACT_INTEGER)) {
+		for (int k = 0; k <= MAX_FRACTION_DIGITS; k++) {
+			double scaled = value * POWERS_OF_TEN[k];
+			if (fabs(scaled) >= MAX_EXACT_INTEGER) {
+				break;
+			}
+			double integer = nearbyint(scaled);
+			if (integer / POWERS_OF_TEN[k] != value) {
+				continue;
+			}
+			char digits[NUMBER_SIZE];
+			char *end = digits + sizeof(digits);
+			char *p = FormatUnsigned((uint64_t)fabs(integer), end);
+			size_t numDigits = (size_t)(end - p);
+			size_t length = 0;
+			if (signbit(value)) {
+				buffer[length++] = '-';
+			}
+			if (k == 0) {
+				memcpy(buffer + length, p, numDigits);
+				return length + numDigits;
+			}
+			size_t numIntegerDigits = (numDigits > (size_t)k) ? numDigits - (size_t)k : 0;
+			if (numIntegerDigits == 0) {
+				buffer[length++] = '0';
+			} else {
+				memcpy(buffer + length, p, numIntegerDigits);
+				length += numIntegerDigits;
+			}
+			buffer[length++] = '.';
+			for (size_t i = numDigits; i < (size_t)k; i++) {
+				buffer[length++] = '0';	// 小数点の直後の0
+			}
+			memcpy(buffer + length, p + numIntegerDigits, numDigits - numIntegerDigits);
+			return length + numDigits - numIntegerDigits;
+		}
+	}
+	return FormatSignificant(value, buffer);
+}
+
+/**
+ * @brief 初期化
+ * @param props プロパティ
+ * @param sink 書き込み先
+ * @return インスタンス
+ */
+static CsvWriter_t *Init(const CsvProperties_t *props, CsvWriterSink sink) {
+	if (UNLIKELY(!props)) {
+		return NULL;
+	}
+	CsvWriter_t *self = (CsvWriter_t *)calloc(1, sizeof(*self));
+	if (UNLIKELY(!self)) {
+		return NULL;
+	}
+	self->delimiter = props->delimiter ? props->delimiter : DEFAULT_DELIMITER;
+	self->quote = props->quote ? props->quote : DEFAULT_QUOTE;
+	self->escape = (props->escape != self->quote) ? props->escape : '\0';
+	self->comment = props->comment;
+	self->eol = (props->eol == CSV_EOL_CRLF) ? "\r\n" : "\n";
+	self->eolLength = strlen(self->eol);
+	self->isSpecial[(uint8_t)self->delimiter] = true;
+	self->isSpecial[(uint8_t)self->quote] = true;
+	self->isSpecial[(uint8_t)CARRIGE_RETURN] = true;
+	self->isSpecial[(uint8_t)LINE_FEED] = true;
+	if (self->escape) {
+		self->isSpecial[(uint8_t)self->escape] = true;
+	}
+	self->sink = sink;
+	self->fd = -1;
+	if (sink != CSV_WRITER_SINK_BUFFER) {
+		self->buffer = malloc(BUFFER_SIZE);
+		if (UNLIKELY(!self->buffer)) {
+			free(self);
+			return NULL;
+		}
+		self->capacity = BUFFER_SIZE;
+	}
+	return self;
+}
+
+/**
+ * @brief MemoryStreamへ書き込むライターを作る
+ * @param props プロパティ (delimiter, quote, escape, comment, eol を使う)
+ * @param stream 書き込み先
+ * @return インスタンス
+ */
+CsvWriter_t *CsvWriter_InitMemoryStream(const CsvProperties_t *props, MemoryStream *stream) {
+	if (UNLIKELY(!stream)) {
+		return NULL;
+	}
+	CsvWriter_t *self = Init(props, CSV_WRITER_SINK_MEMORY_STREAM);
+	if (self) {
+		self->stream = stream;
+	}
+	return self;
+}
+
+/**
+ * @brief ファイルディスクリプタへ書き込むライターを作る
+ * @param props プロパティ (delimiter, quote, escape, comment, eol を使う)
+ * @param fd 書き込み先 (閉じない)
+ * @return インスタンス
+ */
+CsvWriter_t *CsvWriter_InitFd(const CsvProperties_t *props, int fd) {
+	if (UNLIKELY(fd < 0)) {
+		return NULL;
+	}
+	CsvWriter_t *self = Init(props, CSV_WRITER_SINK_FD);
+	if (self) {
+		self->fd = fd;
+	}
+	return self;
+}
+
+/**
+ * @brief 呼び出し側のバッファへ書き込むライターを作る
+ * @note 終端文字は書かない。書いたサイズは CsvWriter_GetSize で取得する
+ * @note バッファが足りなければ、書きかけの行を取り消してエラーを返す
+ * @param props プロパティ (delimiter, quote, escape, comment, eol を使う)
+ * @param buffer 書き込み先
+ * @param size バッファのサイズ
+ * @return インスタンス
+ */
+CsvWriter_t *CsvWriter_InitBuffer(const CsvProperties_t *props, char *buffer, size_t size) {
+	if (UNLIKELY(!buffer && (size > 0))) {
+		return NULL;
+	}
+	CsvWriter_t *self = Init(props, CSV_WRITER_SINK_BUFFER);
+	if (self) {
+		self->buffer = buffer;
+		self->capacity = size;
+	}
+	return self;
+}
+
+/**
+ * @brief テキストのフィールドを書く
+ * @note 区切り文字、引用符、改行文字 (とエスケープ文字) を含む場合と、
+ * 行頭のフィールドがコメント文字で始まる場合だけ囲むかエスケープする
+ * @param self インスタンス
+ * @param text テキスト (NULL: 空)
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_WriteText(CsvWriter_t *self, const char *text) {
+	if (UNLIKELY(!self)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	bool isFirst = self->column == 0;
+	if (!BeginField(self)) {
+		return self->status;
+	}
+	size_t size = text ? strlen(text) : 0;
+	if (isFirst) {
+		self->isFirstEmpty = (size == 0);
+	}
+	size_t special = FindSpecial(self, text, size);
+	bool startsWithComment = isFirst && self->comment && (size > 0) && (text[0] == self->comment);
+	if (LIKELY((special == size) && !startsWithComment)) {
+		Append(self, text, size);
+	} else if (self->escape) {
+		AppendEscaped(self, text, size, startsWithComment ? 0 : special);
+	} else {
+		AppendQuoted(self, text, size);
+	}
+	return self->status;
+}
+
+/**
+ * @brief 整数のフィールドを書く
+ * @param self インスタンス
+ * @param value 値
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_WriteInt64(CsvWriter_t *self, int64_t value) {
+	if (UNLIKELY(!self)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	char buffer[NUMBER_SIZE];
+	char *end = buffer + sizeof(buffer);
+	char *p = FormatInt64(value, end);
+	return AppendNumber(self, p, (size_t)(end - p));
+}
+
+/**
+ * @brief 小数のフィールドを書く
+ * @note 読み込むと同じ値に戻る短い表記で書く (NaN と無限大は nan, inf)
+ * @param self インスタンス
+ * @param value 値
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_WriteDouble(CsvWriter_t *self, double value) {
+	if (UNLIKELY(!self)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	char buffer[NUMBER_SIZE];
+	size_t length = FormatDouble(value, buffer);
+	return AppendNumber(self, buffer, length);
+}
+
+/**
+ * @brief 真偽値のフィールドを書く
+ * @param self インスタンス
+ * @param value 値
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_WriteBool(CsvWriter_t *self, bool value) {
+	if (UNLIKELY(!self)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	return value ? AppendNumber(self, "true", 4) : AppendNumber(self, "false", 5);
+}
+
+/**
+ * @brief 行を終える
+ * @note 空のフィールドが1つだけの行は空行として読み飛ばされるので "" と書く
+ * @param self インスタンス
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_EndRow(CsvWriter_t *self) {
+	if (UNLIKELY(!self)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	if ((self->column == 1) && self->isFirstEmpty && (self->status == CSV_SUCCESS)) {
+		char quotes[2] = { self->quote, self->quote };
+		Append(self, quotes, sizeof(quotes));
+	}
+	if ((self->status == CSV_SUCCESS) && Append(self, self->eol, self->eolLength)) {
+		self->rowStart = self->length;
+	}
+	self->column = 0;
+	self->isFirstEmpty = false;
+	return self->status;
+}
+
+/**
+ * @brief 行を書く
+ * @note CsvStreamParser のハンドラから渡された行もそのまま書ける
+ * @param self インスタンス
+ * @param line 行
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_WriteLine(CsvWriter_t *self, const CsvLine_t *line) {
+	if (UNLIKELY(!self || !line)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	for (size_t i = 0; i < line->items.length; i++) {
+		CsvWriter_WriteText(self, line->items.list[i].text);
+	}
+	return CsvWriter_EndRow(self);
+}
+
+/**
+ * @brief すべての行を書く
+ * @param self インスタンス
+ * @param content コンテンツ
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_WriteContent(CsvWriter_t *self, const CsvContent_t *content) {
+	if (UNLIKELY(!self || !content)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	size_t numRows = CsvContent_GetRowCount(content);
+	for (size_t row = 0; (row < numRows) && (self->status == CSV_SUCCESS); row++) {
+		size_t numColumns = CsvContent_GetColumnCount(content, row);
+		for (size_t column = 0; column < numColumns; column++) {
+			CsvWriter_WriteText(self, CsvContent_GetText(content, row, column));
+		}
+		CsvWriter_EndRow(self);
+	}
+	return self->status;
+}
+
+/**
+ * @brief ハンドラが返す行を、無くなるまで書く
+ * @param self インスタンス
+ * @param source 1行ずつ書き込むハンドラ
+ * @param userData ハンドラに渡すデータ
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_WriteRows(CsvWriter_t *self, CsvRowSource source, void *userData) {
+	if (UNLIKELY(!self || !source)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	while ((self->status == CSV_SUCCESS) && source(self, userData)) {
+		if (self->column > 0) {
+			CsvWriter_EndRow(self);	// 行を終え忘れた
+		}
+	}
+	return self->status;
+}
+
+/**
+ * @brief 書き溜めたデータを書き込み先へ渡す
+ * @param self インスタンス
+ * @return ステータス
+ */
+CsvReturnCode CsvWriter_Flush(CsvWriter_t *self) {
+	if (UNLIKELY(!self)) {
+		return CSV_INVALID_PARAMETER;
+	}
+	if (self->status == CSV_SUCCESS) {
+		self->status = FlushBuffer(self);
+	}
+	return self->status;
+}
+
+/**
+ * @brief 書いたバイト数
+ * @note 書き溜めてまだ渡していない分も含む
+ * @param self インスタンス
+ * @return バイト数
+ */
+size_t CsvWriter_GetSize(const CsvWriter_t *self) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	return self->flushed + self->length;
+}
+
+/**
+ * @brief インスタンスを破棄
+ * @note 書き溜めたデータは書き込み先へ渡してから破棄する
+ * @param self インスタンス
+ */
+void CsvWriter_Destroy(CsvWriter_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	CsvWriter_Flush(self);
+	if (self->sink != CSV_WRITER_SINK_BUFFER) {
+		free(self->buffer);
+	}
+	free(self);
+}
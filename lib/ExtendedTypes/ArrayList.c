@@ -24,6 +24,38 @@ static inline ArrayListNode *GetNode(const ArrayList *self, uint64_t index) {
 	return &self->list[index];
 }
 
+/**
+ * @brief 要素のオブジェクト
+ * @note インラインモードでは領域の先頭からの位置を計算するだけ
+ * @param self インスタンス
+ * @param index 位置
+ * @return オブジェクト
+ */
+static inline void *GetObject(const ArrayList *self, uint64_t index) {
+	if (self->isInline) {
+		return self->objects + index * self->objectSize;
+	}
+	return GetNode(self, index)->object;
+}
+
+/**
+ * @brief 要素数が収まるまでキャパシティーを倍にする
+ * @param self インスタンス
+ * @param length 要素数
+ * @return false: メモリ不足
+ */
+static bool Reserve(ArrayList *self, size_t length) {
+	if (length <= self->capacity) {
+		return true;
+	}
+	size_t capacity = self->capacity ? self->capacity : INITIAL_CAPACITY;
+	while (capacity < length) {
+		capacity *= 2;
+	}
+	ArrayList_Resize(self, capacity);
+	return length <= self->capacity;
+}
+
 /**
  * @brief
  * @param self
@@ -31,6 +63,11 @@ static inline ArrayListNode *GetNode(const ArrayList *self, uint64_t index) {
  * @param object
  */
 static void Insert(ArrayList *self, uint64_t index, const void *object) {
+	if (self->isInline) {
+		memcpy(GetObject(self, index), object, self->objectSize);
+		self->length++;
+		return;
+	}
 	ArrayListNode *node = GetNode(self, index);
 	node->object = self->allocator.allocate(self->objectSize);
 	memcpy(node->object, object, self->objectSize);
@@ -45,6 +82,10 @@ static void Insert(ArrayList *self, uint64_t index, const void *object) {
  * @param object
  */
 static void InsertReference(ArrayList *self, uint64_t index, void *object) {
+	if (self->isInline) {
+		Insert(self, index, object);	// 参照は持てないのでコピーする
+		return;
+	}
 	ArrayListNode *node = GetNode(self, index);
 	node->object = object;
 	node->hadEntity = false;
@@ -59,6 +100,9 @@ static void InsertReference(ArrayList *self, uint64_t index, void *object) {
  * @return
  */
 static inline void *Shift(ArrayList *self, uint64_t index, uint64_t offset) {
+	if (self->isInline) {
+		return memmove(GetObject(self, index), GetObject(self, index + offset), (self->length - index - offset) * self->objectSize);
+	}
 	return memmove(GetNode(self, index), GetNode(self, index + offset), (self->length - index - offset) * sizeof(ArrayListNode));
 }
 
@@ -81,8 +125,9 @@ static inline void ClearNode(ArrayList *self, ArrayListNode *node) {
  * @param index
  */
 static void RemoveAt(ArrayList *self, uint64_t index) {
-	ArrayListNode *node = GetNode(self, index);
-	ClearNode(self, node);
+	if (!self->isInline) {
+		ClearNode(self, GetNode(self, index));
+	}
 	Shift(self, index, 1);
 	self->length--;
 }
@@ -107,6 +152,27 @@ void ArrayList_Init(ArrayList *self, const MemoryAllocator_t *allocator, size_t
 	}
 }
 
+/**
+ * @brief インラインモードで初期化
+ * @note オブジェクトを1つの領域に詰めて持つので、ArrayList_At は位置の計算だけになる。
+ * ArrayList_AddReference もコピーする。広げると ArrayList_At で得たポインターは無効になる
+ * @note 領域はアロケーターで確保し、広げるときは確保し直して写す
+ * @param self インスタンス
+ * @param allocator アロケーター (NULL: 既定)
+ * @param objectSize オブジェクトのサイズ
+ */
+void ArrayList_InitInline(ArrayList *self, const MemoryAllocator_t *allocator, size_t objectSize) {
+	if (UNLIKELY(!self || objectSize == 0)) {
+		return;
+	}
+	CLEAR(self);
+	self->isInline = true;
+	self->objectSize = objectSize;
+	self->allocator = allocator ? *allocator : *MemoryAllocator_GetDefault();
+	self->objects = self->allocator.allocate(INITIAL_CAPACITY * objectSize);
+	self->capacity = self->objects ? INITIAL_CAPACITY : 0;
+}
+
 /**
  * @brief
  * @param self
@@ -117,6 +183,9 @@ void ArrayList_Destroy(ArrayList *self) {
 	}
 	ArrayList_Clear(self);
 	free(self->list);
+	if (self->objects) {
+		self->allocator.dispose(self->objects);
+	}
 	CLEAR(self);
 }
 
@@ -141,8 +210,24 @@ void ArrayList_Resize(ArrayList *self, size_t newSize) {
 	if (UNLIKELY(!self || (newSize == 0))) {
 		return;
 	}
-	ArrayListNode *new = realloc(self->list, newSize);
-	self->list = new;
+	if (self->isInline) {
+		uint8_t *objects = self->allocator.allocate(newSize * self->objectSize);
+		if (UNLIKELY(!objects)) {
+			return;
+		}
+		if (self->objects) {
+			self->length = (self->length < newSize) ? self->length : newSize;
+			memcpy(objects, self->objects, self->length * self->objectSize);
+			self->allocator.dispose(self->objects);
+		}
+		self->objects = objects;
+	} else {
+		ArrayListNode *new = realloc(self->list, newSize * sizeof(ArrayListNode));
+		if (UNLIKELY(!new)) {
+			return;
+		}
+		self->list = new;
+	}
 	self->capacity = newSize;
 }
 
@@ -183,7 +268,20 @@ const void *ArrayList_At(ArrayList *self, uint64_t index) {
 	if (index >= self->length) {
 		return NULL;
 	}
-	return self->list[index].object;
+	return GetObject(self, index);
+}
+
+/**
+ * @brief 詰めて持っているオブジェクトの先頭
+ * @note objectSize 刻みで ArrayList_Length 個並ぶ。次に追加か削除するまで有効
+ * @param self インスタンス
+ * @return 先頭 (NULL: インラインモードではない)
+ */
+const void *ArrayList_Data(ArrayList *self) {
+	if (UNLIKELY(!self || !self->isInline)) {
+		return NULL;
+	}
+	return self->objects;
 }
 
 /**
@@ -195,8 +293,8 @@ void ArrayList_Add(ArrayList *self, const void *object) {
 	if (UNLIKELY(!self || !object)) {
 		return;
 	}
-	if (self->length >= self->capacity) {
-		ArrayList_Resize(self, self->capacity * 2);
+	if (!Reserve(self, self->length + 1)) {
+		return;
 	}
 	Insert(self, self->length, object);
 }
@@ -211,8 +309,8 @@ void ArrayList_AddReference(ArrayList *self, void *object) {
 	if (UNLIKELY(!self || !object)) {
 		return;
 	}
-	if (self->length >= self->capacity) {
-		ArrayList_Resize(self, self->capacity * 2);
+	if (!Reserve(self, self->length + 1)) {
+		return;
 	}
 	InsertReference(self, self->length, object);
 }
@@ -227,6 +325,14 @@ void ArrayList_AddRange(ArrayList *self, const void *objects, size_t length) {
 	if (UNLIKELY(!self || !objects || (length == 0))) {
 		return;
 	}
+	if (!Reserve(self, self->length + length)) {
+		return;
+	}
+	if (self->isInline) {
+		memcpy(GetObject(self, self->length), objects, length * self->objectSize);
+		self->length += length;
+		return;
+	}
 	const uint8_t *current = objects;
 	for (size_t i = 0; i < length; i++) {
 		ArrayList_Add(self, current);
@@ -246,17 +352,16 @@ void ArrayList_Append(ArrayList *self, const ArrayList *list) {
 	if (self->objectSize != list->objectSize) {
 		return;
 	}
-	if (self->capacity >= (self->length + list->length)) {
-		ArrayList_Resize(self, self->capacity + list->capacity);
+	if (!Reserve(self, self->length + list->length)) {
+		return;
 	}
 	// memcpy(GetNode(self, self->length), list->list, list->length);
 	size_t oldLength = self->length;
 	for (size_t i = self->length, j = 0; i < (oldLength + list->length); i++, j++) {
-		ArrayListNode *otherNode = GetNode(list, j);
-		if (otherNode->hadEntity) {
-			Insert(self, i, otherNode->object);
+		if (list->isInline || GetNode(list, j)->hadEntity) {
+			Insert(self, i, GetObject(list, j));
 		} else {
-			InsertReference(self, i, otherNode->object);
+			InsertReference(self, i, GetObject(list, j));
 		}
 	}
 }
@@ -274,8 +379,15 @@ void ArrayList_Insert(ArrayList *self, uint64_t index, const void *object) {
 	if (index >= self->length) {
 		return;
 	}
-	ArrayListNode *node = GetNode(self, index);
-	memmove(GetNode(self, index + 1), node, (self->length - index) * sizeof(ArrayListNode));
+	if (!Reserve(self, self->length + 1)) {
+		return;
+	}
+	if (self->isInline) {
+		memmove(GetObject(self, index + 1), GetObject(self, index), (self->length - index) * self->objectSize);
+	} else {
+		ArrayListNode *node = GetNode(self, index);
+		memmove(GetNode(self, index + 1), node, (self->length - index) * sizeof(ArrayListNode));
+	}
 	Insert(self, index, object);
 }
 
@@ -290,7 +402,7 @@ ssize_t ArrayList_IndexOf(ArrayList *self, const void *object) {
 		return -1;
 	}
 	for (uint64_t i = 0; i < self->length; i++) {
-		if (memcmp(GetNode(self, i)->object, object, self->objectSize) == 0) {
+		if (memcmp(GetObject(self, i), object, self->objectSize) == 0) {
 			return (ssize_t)i;
 		}
 	}
@@ -318,8 +430,7 @@ bool ArrayList_Remove(ArrayList *self, const void *object) {
 		return false;
 	}
 	for (uint64_t i = 0; i < self->length; i++) {
-		ArrayListNode *node = GetNode(self, i);
-		if (memcmp(node->object, object, self->objectSize) == 0) {
+		if (memcmp(GetObject(self, i), object, self->objectSize) == 0) {
 			RemoveAt(self, i);
 			return true;
 		}
@@ -352,7 +463,7 @@ void ArrayList_Clear(ArrayList *self) {
 	if (UNLIKELY(!self)) {
 		return;
 	}
-	for (size_t i = 0; i < self->length; i++) {
+	for (size_t i = 0; (i < self->length) && !self->isInline; i++) {
 		ClearNode(self, GetNode(self, i));
 	}
 	self->length = 0;
@@ -368,6 +479,6 @@ void ArrayList_ForEach(ArrayList *self, void (*callback)(uint64_t index, const v
 		return;
 	}
 	for (size_t i = 0; i < self->length; i++) {
-		callback(i, GetNode(self, i)->object);
+		callback(i, GetObject(self, i));
 	}
 }
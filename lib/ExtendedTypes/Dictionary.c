@@ -5,47 +5,987 @@
  * @date 2024/07/12
  */
 #include "ExtendedTypes/Dictionary.h"
+#include "ExtendedTypes/FrozenDictionary.h"
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "utilities.h"
 
+//! 一度に比べるスロット数
+#define GROUP_SIZE		(16)
+//! 最小のスロット数
+#define MIN_SLOTS		((size_t)GROUP_SIZE)
+//! 空きスロット
+#define CONTROL_EMPTY	((uint8_t)0x80)
+//! 削除済みのスロット
+#define CONTROL_DELETED	((uint8_t)0xFE)
+//! 要素の位置の上限 (スロットに32ビットで持つ)
+#define MAX_ELEMENTS	((size_t)UINT32_MAX)
+//! 最小のサイズクラスの大きさ
+#define MIN_CLASS_SIZE	((size_t)16)
+//! スラブのブロックの大きさ
+#define SLAB_BLOCK_SIZE	((size_t)64 * 1024)
+//! スラブに無い大きさ
+#define NO_CLASS		(DICTIONARY_SIZE_CLASSES)
+//! 並行モードで削除を見張る版の数 (2のべき乗)
+#define NUM_STRIPES		(64)
+//! キャッシュラインの大きさ
+#define CACHE_LINE_SIZE	(64)
+//! 読み手を数える場所の数 (2のべき乗)
+#define NUM_READER_SLOTS	(64)
+
 /**
- * @brief 要素を追加
+ * @brief スロット
+ * @note 1つの領域に確保し、並行モードでは読み手がポインター1つで一貫した組を得られるようにする
+ */
+typedef struct DictionaryTable_t {
+	//! スロット数 (2のべき乗)
+	size_t numSlots;
+	//! スロットごとの要素の位置
+	uint32_t *slots;
+	//! スロットごとの制御バイト (末尾に先頭の1グループ分の写しを持つ)
+	uint8_t *controls;
+} DictionaryTable_t;
+
+/**
+ * @brief 読み手が読み直すかを決める版 (seqlock)
+ * @note 書き手は書き換える前後で1つずつ進める。奇数の間は書き換え中
+ */
+typedef struct DictionarySequence_t {
+	_Alignas(CACHE_LINE_SIZE) _Atomic uint64_t value;
+} DictionarySequence_t;
+
+/**
+ * @brief 読み手の数
+ * @note スレッドごとに別のキャッシュラインで数え、読み手どうしが同じ行に書かないようにする
+ */
+typedef struct DictionaryReaders_t {
+	//! 世代の偶奇ごとの数
+	_Alignas(CACHE_LINE_SIZE) _Atomic uint64_t count[2];
+} DictionaryReaders_t;
+
+/**
+ * @brief 解放を遅らせる領域
+ */
+typedef struct DictionaryRetired_t {
+	void *memory;
+	//! 預けたときの世代
+	uint64_t epoch;
+} DictionaryRetired_t;
+
+/**
+ * @brief 並行モードの状態
+ * @note 作り直したスロットや要素のリスト、個別に確保した領域は、読み手が参照しているかもしれないので
+ * すぐには解放しない。預けた世代から2つ進み、その前から読んでいた読み手がいなくなってから解放する
+ */
+typedef struct DictionaryConcurrency_t {
+	//! 書き手のロック
+	pthread_mutex_t mutex;
+	//! スロットと要素のリストを作り直したときに進める版
+	DictionarySequence_t sequence;
+	//! 削除したときにハッシュ値ごとに進める版
+	DictionarySequence_t stripes[NUM_STRIPES];
+	//! 世代 (書き手だけが進める)
+	DictionarySequence_t epoch;
+	//! スレッドごとの読み手の数
+	DictionaryReaders_t readers[NUM_READER_SLOTS];
+	//! 解放を遅らせる領域 (預けた世代の順に並ぶ)
+	DictionaryRetired_t *retired;
+	size_t numRetired;
+	size_t retiredCapacity;
+} DictionaryConcurrency_t;
+
+/**
+ * @brief スロットの位置を決めるハッシュ値の上位
+ * @param hash ハッシュ値
+ * @return 位置
+ */
+static inline size_t H1(uint64_t hash) {
+	return (size_t)(hash >> 7);
+}
+
+/**
+ * @brief 制御バイトに持つハッシュ値の下位7ビット
+ * @param hash ハッシュ値
+ * @return 制御バイト
+ */
+static inline uint8_t H2(uint64_t hash) {
+	return (uint8_t)(hash & 0x7F);
+}
+
+/**
+ * @brief 要素のキー
+ * @note 短いキーは要素の中に持つので、要素を移動するたびに位置が変わる
+ * @param element 要素
+ * @return キー
+ */
+static inline const char *KeyOf(const DictionaryElement_t *element) {
+	return (element->keyLength < DICTIONARY_INLINE_KEY_SIZE) ? element->inlineKey : element->key;
+}
+
+/**
+ * @brief 削除済みの要素か
+ * @param element 要素
+ * @return
+ */
+static inline bool IsRemoved(const DictionaryElement_t *element) {
+	return element->object.buffer == NULL;
+}
+
+/**
+ * @brief 64ビットの積の上位と下位
+ * @param a 乗数 (下位を返す)
+ * @param b 乗数 (上位を返す)
+ */
+static inline void Multiply(uint64_t *a, uint64_t *b) {
+	__uint128_t product = (__uint128_t)*a * *b;
+	*a = (uint64_t)product;
+	*b = (uint64_t)(product >> 64);
+}
+
+/**
+ * @brief 64ビットの積の上位と下位を混ぜる
+ * @param a 乗数
+ * @param b 乗数
+ * @return 混ぜた値
+ */
+static inline uint64_t Mix(uint64_t a, uint64_t b) {
+	Multiply(&a, &b);
+	return a ^ b;
+}
+
+/**
+ * @brief 8バイトを読む (境界をそろえなくてよい)
+ * @param p 読む位置
+ * @return 値
+ */
+static inline uint64_t Read8(const uint8_t *p) {
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/**
+ * @brief 4バイトを読む (境界をそろえなくてよい)
+ * @param p 読む位置
+ * @return 値
+ */
+static inline uint64_t Read4(const uint8_t *p) {
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/**
+ * @brief バイト列のハッシュ値
+ * @note wyhash (final4) と同じ手順。16バイトまでは分岐なしの数回の乗算で済み、
+ * 長いキーは48バイトずつ3系統で混ぜる。出力の下位7ビットも上位も偏らない
+ * @param key キー
+ * @param keySize キーの長さ (終端を含まない)
+ * @return ハッシュ値
+ */
+static uint64_t Hash(const void *key, size_t keySize) {
+	static const uint64_t SECRET[4] = { 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL };
+	const uint8_t *p = (const uint8_t *)key;
+	uint64_t seed = Mix(SECRET[0], SECRET[1]);
+	uint64_t a;
+	uint64_t b;
+	if (LIKELY(keySize <= 16)) {
+		if (LIKELY(keySize >= 4)) {
+			size_t offset = (keySize >> 3) << 2;
+			a = (Read4(p) << 32) | Read4(p + offset);
+			b = (Read4(p + keySize - 4) << 32) | Read4(p + keySize - 4 - offset);
+		} else if (keySize > 0) {
+			a = ((uint64_t)p[0] << 16) | ((uint64_t)p[keySize >> 1] << 8) | p[keySize - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t rest = keySize;
+		if (UNLIKELY(rest >= 48)) {
+			uint64_t seed1 = seed;
+			uint64_t seed2 = seed;
+			do {
+				seed = Mix(Read8(p) ^ SECRET[1], Read8(p + 8) ^ seed);
+				seed1 = Mix(Read8(p + 16) ^ SECRET[2], Read8(p + 24) ^ seed1);
+				seed2 = Mix(Read8(p + 32) ^ SECRET[3], Read8(p + 40) ^ seed2);
+				p += 48;
+				rest -= 48;
+			} while (LIKELY(rest >= 48));
+			seed ^= seed1 ^ seed2;
+		}
+		while (UNLIKELY(rest > 16)) {
+			seed = Mix(Read8(p) ^ SECRET[1], Read8(p + 8) ^ seed);
+			p += 16;
+			rest -= 16;
+		}
+		a = Read8(p + rest - 16);
+		b = Read8(p + rest - 8);
+	}
+	a ^= SECRET[1];
+	b ^= seed;
+	Multiply(&a, &b);
+	return Mix(a ^ SECRET[0] ^ keySize, b ^ SECRET[1]);
+}
+
+/**
+ * @brief グループ内で制御バイトが一致するスロット
+ * @param group グループの先頭
+ * @param control 制御バイト
+ * @return ビットnがn番目のスロットに対応する
+ */
+static inline uint32_t MatchControl(const uint8_t *group, uint8_t control) {
+#if defined(__SSE2__)
+	__m128i controls = _mm_loadu_si128((const __m128i *)group);
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8((char)control)));
+#else
+	uint32_t mask = 0;
+	for (int i = 0; i < GROUP_SIZE; i++) {
+		mask |= (uint32_t)(group[i] == control) << i;
+	}
+	return mask;
+#endif
+}
+
+/**
+ * @brief グループ内の空きか削除済みのスロット
+ * @note 空きと削除済みだけが最上位ビットが立っている
+ * @param group グループの先頭
+ * @return ビットnがn番目のスロットに対応する
+ */
+static inline uint32_t MatchFree(const uint8_t *group) {
+#if defined(__SSE2__)
+	return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+	uint32_t mask = 0;
+	for (int i = 0; i < GROUP_SIZE; i++) {
+		mask |= (uint32_t)(group[i] >> 7) << i;
+	}
+	return mask;
+#endif
+}
+
+/**
+ * @brief 制御バイトを設定する
+ * @note 先頭のグループは末尾の写しも書き換え、どの位置からでも1グループ分を読めるようにする
+ * @note 並行モードの読み手が制御バイトを見たら、先に書いたスロットと要素も見えるように release で書く
+ * @param table スロット
+ * @param slot スロット
+ * @param control 制御バイト
+ */
+static inline void SetControl(DictionaryTable_t *table, size_t slot, uint8_t control) {
+	__atomic_store_n(&table->controls[slot], control, __ATOMIC_RELEASE);
+	if (slot < GROUP_SIZE) {
+		__atomic_store_n(&table->controls[table->numSlots + slot], control, __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * @brief 要素を入れられるスロットを探す
+ * @param table スロット
+ * @param hash ハッシュ値
+ * @return スロット
+ */
+static size_t FindFreeSlot(const DictionaryTable_t *table, uint64_t hash) {
+	size_t mask = table->numSlots - 1;
+	size_t position = H1(hash) & mask;
+	for (size_t step = GROUP_SIZE;; step += GROUP_SIZE) {
+		uint32_t free = MatchFree(&table->controls[position]);
+		if (free) {
+			return (position + (size_t)__builtin_ctz(free)) & mask;
+		}
+		position = (position + step) & mask;
+	}
+}
+
+/**
+ * @brief キーのスロットを探す
+ * @note 空きスロットがあるグループまで調べたら見つからない
+ * @param self インスタンス
+ * @param key キー
+ * @return スロット (SIZE_MAX: 見つからない)
+ */
+static size_t FindSlot(const Dictionary_t *self, const DictionaryKey_t *key) {
+	const DictionaryTable_t *table = self->table;
+	if (!table) {
+		return SIZE_MAX;
+	}
+	size_t mask = table->numSlots - 1;
+	size_t position = H1(key->hash) & mask;
+	uint8_t control = H2(key->hash);
+	for (size_t step = GROUP_SIZE; step <= table->numSlots + GROUP_SIZE; step += GROUP_SIZE) {
+		const uint8_t *group = &table->controls[position];
+		for (uint32_t bits = MatchControl(group, control); bits != 0; bits &= bits - 1) {
+			size_t slot = (position + (size_t)__builtin_ctz(bits)) & mask;
+			const DictionaryElement_t *element = &self->elements.list[table->slots[slot]];
+			if ((element->hash == key->hash) && (element->keyLength == key->size) && (memcmp(KeyOf(element), key->data, key->size) == 0)) {
+				return slot;
+			}
+		}
+		if (MatchControl(group, CONTROL_EMPTY)) {
+			break;
+		}
+		position = (position + step) & mask;
+	}
+	return SIZE_MAX;
+}
+
+/**
+ * @brief 要素数に必要なスロット数
+ * @note 使用率を 7/8 以下に保つ
+ * @param count 要素数
+ * @return スロット数
+ */
+static size_t SlotsFor(size_t count) {
+	size_t numSlots = MIN_SLOTS;
+	while (numSlots - numSlots / 8 < count) {
+		numSlots *= 2;
+	}
+	return numSlots;
+}
+
+
+/**
+ * @brief 待つ間にCPUを譲る
+ */
+static inline void Pause(void) {
+#if defined(__SSE2__)
+	_mm_pause();
+#endif
+}
+
+/**
+ * @brief 書き換えを始める
+ * @param sequence 版 (NULL: 並行モードではない)
+ */
+static inline void BeginWrite(DictionarySequence_t *sequence) {
+	if (!sequence) {
+		return;
+	}
+	atomic_store_explicit(&sequence->value, atomic_load_explicit(&sequence->value, memory_order_relaxed) + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * @brief 書き換えを終える
+ * @param sequence 版 (NULL: 並行モードではない)
+ */
+static inline void EndWrite(DictionarySequence_t *sequence) {
+	if (!sequence) {
+		return;
+	}
+	atomic_store_explicit(&sequence->value, atomic_load_explicit(&sequence->value, memory_order_relaxed) + 1, memory_order_release);
+}
+
+/**
+ * @brief 読み始める
+ * @note 書き換え中なら終わるまで待つ
+ * @param sequence 版
+ * @return 読み始めたときの版
+ */
+static inline uint64_t BeginRead(const DictionarySequence_t *sequence) {
+	uint64_t value;
+	while ((value = atomic_load_explicit(&sequence->value, memory_order_acquire)) & 1) {
+		Pause();
+	}
+	return value;
+}
+
+/**
+ * @brief 読み始めてから書き換えられていないか
+ * @param concurrency 並行モードの状態
+ * @param stripe 削除を見張る版
+ * @param version 読み始めたときの版
+ * @param stripeVersion 読み始めたときの削除の版
+ * @return false: 読み直す
+ */
+static inline bool IsConsistent(const DictionaryConcurrency_t *concurrency, const DictionarySequence_t *stripe, uint64_t version, uint64_t stripeVersion) {
+	atomic_thread_fence(memory_order_acquire);
+	return (atomic_load_explicit(&concurrency->sequence.value, memory_order_relaxed) == version)
+		&& (atomic_load_explicit(&stripe->value, memory_order_relaxed) == stripeVersion);
+}
+
+/**
+ * @brief スロットと要素のリストを作り直すときの版
+ * @param self インスタンス
+ * @return 版 (NULL: 並行モードではない)
+ */
+static inline DictionarySequence_t *ResizeSequence(const Dictionary_t *self) {
+	return self->concurrency ? &self->concurrency->sequence : NULL;
+}
+
+/**
+ * @brief キーを削除するときの版
+ * @param self インスタンス
+ * @param hash キーのハッシュ値
+ * @return 版 (NULL: 並行モードではない)
+ */
+static inline DictionarySequence_t *StripeOf(const Dictionary_t *self, uint64_t hash) {
+	return self->concurrency ? &self->concurrency->stripes[(hash >> 32) & (NUM_STRIPES - 1)] : NULL;
+}
+
+//! 次のスレッドに割り当てる読み手の場所
+static _Atomic size_t nextReaderSlot;
+//! このスレッドが読み手を数える場所 (SIZE_MAX: 未割り当て)
+static _Thread_local size_t readerSlot = SIZE_MAX;
+
+/**
+ * @brief このスレッドが読み手を数える場所を取得
+ * @note スレッドが場所の数より多ければ共有するが、数は不可分に増減するので数え間違えない
+ * @return 場所
+ */
+static inline size_t ReaderSlot(void) {
+	if (UNLIKELY(readerSlot == SIZE_MAX)) {
+		readerSlot = atomic_fetch_add_explicit(&nextReaderSlot, 1, memory_order_relaxed) & (NUM_READER_SLOTS - 1);
+	}
+	return readerSlot;
+}
+
+/**
+ * @brief 読み始める前に、読み手として数える
+ * @note 自分のスレッドの場所だけに書くので、読み手どうしでキャッシュラインを取り合わない
+ * @note 数えた後に世代が進んでいたら、新しい世代で数え直す
+ * @param concurrency 並行モードの状態
+ * @return 数えた先 (LeaveReaders に渡す)
+ */
+static inline _Atomic uint64_t *EnterReaders(DictionaryConcurrency_t *concurrency) {
+	DictionaryReaders_t *readers = &concurrency->readers[ReaderSlot()];
+	for (;;) {
+		uint64_t epoch = atomic_load(&concurrency->epoch.value);
+		_Atomic uint64_t *count = &readers->count[epoch & 1];
+		atomic_fetch_add(count, 1);
+		if (atomic_load(&concurrency->epoch.value) == epoch) {
+			return count;
+		}
+		atomic_fetch_sub(count, 1);
+	}
+}
+
+/**
+ * @brief 読み終えたら、読み手から外す
+ * @param count EnterReaders で数えた先
+ */
+static inline void LeaveReaders(_Atomic uint64_t *count) {
+	atomic_fetch_sub_explicit(count, 1, memory_order_release);
+}
+
+/**
+ * @brief 世代の偶奇が同じ読み手がいるか
+ * @param concurrency 並行モードの状態
+ * @param parity 世代の偶奇
+ * @return true: いる
+ */
+static bool HasReaders(const DictionaryConcurrency_t *concurrency, size_t parity) {
+	for (size_t i = 0; i < NUM_READER_SLOTS; i++) {
+		if (atomic_load(&concurrency->readers[i].count[parity]) != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief 読み手がいなくなった領域を解放する
+ * @note 1つ前の世代の読み手がいなければ世代を進める。世代Eに預けた領域は、
+ * E+2に進めたときにはE以前から読んでいた読み手がいないので解放できる
+ * @note 書き手のロックを取ってから呼ぶ
+ * @param concurrency 並行モードの状態
+ */
+static void Reclaim(DictionaryConcurrency_t *concurrency) {
+	uint64_t epoch = atomic_load_explicit(&concurrency->epoch.value, memory_order_relaxed);
+	// NOTE: 差し替えた後に読み手を数えるので、数えた後に読み始めた読み手は新しい方を読む
+	atomic_thread_fence(memory_order_seq_cst);
+	if (!HasReaders(concurrency, (epoch + 1) & 1)) {
+		atomic_store(&concurrency->epoch.value, ++epoch);
+	}
+	size_t numFreed = 0;
+	while ((numFreed < concurrency->numRetired) && (concurrency->retired[numFreed].epoch + 2 <= epoch)) {
+		free(concurrency->retired[numFreed++].memory);
+	}
+	if (numFreed > 0) {
+		concurrency->numRetired -= numFreed;
+		memmove(concurrency->retired, concurrency->retired + numFreed, concurrency->numRetired * sizeof(DictionaryRetired_t));
+	}
+}
+
+/**
+ * @brief 使わなくなった領域を解放する
+ * @note 並行モードでは読み手が参照しているかもしれないので、読み手がいなくなるまで預かる
+ * @param self インスタンス
+ * @param memory 領域
+ */
+static void Discard(Dictionary_t *self, void *memory) {
+	DictionaryConcurrency_t *concurrency = self->concurrency;
+	if (!concurrency || !memory) {
+		free(memory);
+		return;
+	}
+	if (concurrency->numRetired == concurrency->retiredCapacity) {
+		size_t capacity = concurrency->retiredCapacity ? concurrency->retiredCapacity * 2 : MIN_SLOTS;
+		DictionaryRetired_t *retired = realloc(concurrency->retired, capacity * sizeof(DictionaryRetired_t));
+		if (UNLIKELY(!retired)) {
+			return;	// NOTE: 解放すると読み手が壊れるので、預けられなければ漏らす
+		}
+		concurrency->retired = retired;
+		concurrency->retiredCapacity = capacity;
+	}
+	DictionaryRetired_t *retired = &concurrency->retired[concurrency->numRetired++];
+	retired->memory = memory;
+	retired->epoch = atomic_load_explicit(&concurrency->epoch.value, memory_order_relaxed);
+	Reclaim(concurrency);
+}
+
+/**
+ * @brief 削除した要素の穴を詰める
+ * @note 追加した順は変えない。並行モードでは読み手が読んでいるリストを書き換えないよう、新しいリストに詰める
+ * @param self インスタンス
+ * @return false: メモリ不足
+ */
+static bool Compact(Dictionary_t *self) {
+	if (self->elements.removed == 0) {
+		return true;
+	}
+	DictionaryElement_t *list = self->elements.list;
+	if (self->concurrency) {
+		list = malloc(self->elements.capacity * sizeof(DictionaryElement_t));
+		if (UNLIKELY(!list)) {
+			return false;
+		}
+	}
+	size_t count = 0;
+	for (size_t i = 0; i < self->elements.count; i++) {
+		if (!IsRemoved(&self->elements.list[i])) {
+			list[count++] = self->elements.list[i];
+		}
+	}
+	if (list != self->elements.list) {
+		DictionaryElement_t *old = self->elements.list;
+		__atomic_store_n(&self->elements.list, list, __ATOMIC_RELEASE);
+		Discard(self, old);
+	}
+	self->elements.count = count;
+	self->elements.removed = 0;
+	return true;
+}
+
+/**
+ * @brief 空のスロットを確保する
+ * @param numSlots スロット数
+ * @return スロット (NULL: メモリ不足)
+ */
+static DictionaryTable_t *NewTable(size_t numSlots) {
+	DictionaryTable_t *table = malloc(sizeof(DictionaryTable_t) + numSlots * sizeof(uint32_t) + numSlots + GROUP_SIZE);
+	if (UNLIKELY(!table)) {
+		return NULL;
+	}
+	table->numSlots = numSlots;
+	table->slots = (uint32_t *)(table + 1);
+	table->controls = (uint8_t *)(table->slots + numSlots);
+	memset(table->controls, CONTROL_EMPTY, numSlots + GROUP_SIZE);
+	return table;
+}
+
+/**
+ * @brief スロットを作り直す
+ * @note 要素に持つハッシュ値から作るので、キーをハッシュし直さない。削除済みのスロットも消える
+ * @note 新しいスロットを作り終えてから差し替える
+ * @param self インスタンス
+ * @param numSlots スロット数
+ * @return false: メモリ不足
+ */
+static bool Rehash(Dictionary_t *self, size_t numSlots) {
+	DictionaryTable_t *table = NewTable(numSlots);
+	if (UNLIKELY(!table || !Compact(self))) {
+		free(table);
+		return false;
+	}
+	for (size_t i = 0; i < self->elements.count; i++) {
+		uint64_t hash = self->elements.list[i].hash;
+		size_t slot = FindFreeSlot(table, hash);
+		table->slots[slot] = (uint32_t)i;
+		SetControl(table, slot, H2(hash));
+	}
+	DictionaryTable_t *old = self->table;
+	__atomic_store_n(&self->table, table, __ATOMIC_RELEASE);
+	Discard(self, old);
+	self->numDeleted = 0;
+	return true;
+}
+
+/**
+ * @brief 要素のリストを広げる
+ * @note 並行モードでは読み手が読んでいるリストを残すため、realloc せずに写す
+ * @param self インスタンス
+ * @param capacity キャパシティー
+ * @return false: メモリ不足
+ */
+static bool Grow(Dictionary_t *self, size_t capacity) {
+	if (self->concurrency) {
+		DictionaryElement_t *list = malloc(capacity * sizeof(DictionaryElement_t));
+		if (UNLIKELY(!list)) {
+			return false;
+		}
+		if (self->elements.count > 0) {
+			memcpy(list, self->elements.list, self->elements.count * sizeof(DictionaryElement_t));
+		}
+		DictionaryElement_t *old = self->elements.list;
+		__atomic_store_n(&self->elements.list, list, __ATOMIC_RELEASE);
+		Discard(self, old);
+	} else {
+		DictionaryElement_t *list = realloc(self->elements.list, capacity * sizeof(DictionaryElement_t));
+		if (UNLIKELY(!list)) {
+			return false;
+		}
+		self->elements.list = list;
+	}
+	// NOTE: 読み手はキャパシティーをリストより先に読むので、リストより後に書く
+	__atomic_store_n(&self->elements.capacity, capacity, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * @brief 1つ追加できるようにスロットと要素のリストを広げる
+ * @note 削除済みのスロットや要素のリストの穴が多ければ、広げずに作り直す
+ * @param self インスタンス
+ * @return false: メモリ不足
+ */
+static bool Reserve(Dictionary_t *self) {
+	size_t live = self->elements.count - self->elements.removed;
+	size_t numSlots = self->table ? self->table->numSlots : 0;
+	bool isCrowded = (live + self->numDeleted + 1 > numSlots - numSlots / 8);
+	bool hasManyHoles = (self->elements.count == self->elements.capacity) && (self->elements.removed >= self->elements.capacity / 4);
+	if (!self->table || isCrowded || hasManyHoles) {
+		size_t required = SlotsFor(live + 1);
+		numSlots = (numSlots > required) ? numSlots : required;	// 小さくはしない (削除済みを消すだけ)
+		BeginWrite(ResizeSequence(self));
+		bool isRehashed = Rehash(self, numSlots);
+		EndWrite(ResizeSequence(self));
+		if (!isRehashed) {
+			return false;
+		}
+	}
+	if (self->elements.count < self->elements.capacity) {
+		return true;
+	}
+	if (UNLIKELY(self->elements.capacity >= MAX_ELEMENTS)) {
+		return false;
+	}
+	size_t capacity = self->elements.capacity ? self->elements.capacity * 2 : MIN_SLOTS;
+	capacity = (capacity < MAX_ELEMENTS) ? capacity : MAX_ELEMENTS;
+	BeginWrite(ResizeSequence(self));
+	bool isGrown = Grow(self, capacity);
+	EndWrite(ResizeSequence(self));
+	return isGrown;
+}
+
+/**
+ * @brief まとめて追加できるようにスロットと要素のリストを広げる
+ * @note 1つずつ広げると作り直しを何度も繰り返すので、先に一度で広げる
+ * @param self インスタンス
+ * @param count 追加する要素数
+ * @return false: メモリ不足
+ */
+static bool ReserveRange(Dictionary_t *self, size_t count) {
+	size_t live = self->elements.count - self->elements.removed;
+	if (UNLIKELY(count > MAX_ELEMENTS - live)) {
+		return false;
+	}
+	size_t numSlots = SlotsFor(live + count);
+	if (!self->table || (self->table->numSlots < numSlots)) {
+		BeginWrite(ResizeSequence(self));
+		bool isRehashed = Rehash(self, numSlots);
+		EndWrite(ResizeSequence(self));
+		if (!isRehashed) {
+			return false;
+		}
+	}
+	size_t capacity = self->elements.count + count;
+	if (capacity <= self->elements.capacity) {
+		return true;
+	}
+	if (UNLIKELY(capacity > MAX_ELEMENTS)) {
+		return false;
+	}
+	BeginWrite(ResizeSequence(self));
+	bool isGrown = Grow(self, capacity);
+	EndWrite(ResizeSequence(self));
+	return isGrown;
+}
+
+/**
+ * @brief 大きさに合うサイズクラス
+ * @param size 大きさ
+ * @return サイズクラス (NO_CLASS: スラブに無い)
+ */
+static inline size_t ClassOf(size_t size) {
+	if (size <= MIN_CLASS_SIZE) {
+		return 0;
+	}
+	size_t sizeClass = (size_t)(64 - __builtin_clzll((unsigned long long)(size - 1))) - 4;
+	return (sizeClass < DICTIONARY_SIZE_CLASSES) ? sizeClass : NO_CLASS;
+}
+
+/**
+ * @brief 領域を割り当てる
+ * @note サイズクラスのスラブから、戻した領域か最後のブロックの未使用の領域を切り出す。
+ * 使い切ったら新しいブロックを確保する。スラブに無い大きさは個別に確保する
+ * @param self インスタンス
+ * @param size 大きさ
+ * @return 領域 (NULL: メモリ不足)
+ */
+static void *Allocate(Dictionary_t *self, size_t size) {
+	size_t sizeClass = ClassOf(size);
+	if (sizeClass == NO_CLASS) {
+		return malloc(size);
+	}
+	DictionarySlab_t *slab = &self->memoryPool.slabs[sizeClass];
+	if (slab->freeList) {
+		void *cell = slab->freeList;
+		memcpy(&slab->freeList, cell, sizeof(void *));
+		return cell;
+	}
+	size_t cellSize = MIN_CLASS_SIZE << sizeClass;
+	if (slab->next == slab->end) {
+		void **blocks = realloc(self->memoryPool.blocks, (self->memoryPool.numBlocks + 1) * sizeof(void *));
+		if (UNLIKELY(!blocks)) {
+			return NULL;
+		}
+		self->memoryPool.blocks = blocks;
+		char *block = malloc(SLAB_BLOCK_SIZE);
+		if (UNLIKELY(!block)) {
+			return NULL;
+		}
+		blocks[self->memoryPool.numBlocks++] = block;
+		slab->next = block;
+		slab->end = block + (SLAB_BLOCK_SIZE / cellSize) * cellSize;
+	}
+	void *cell = slab->next;
+	slab->next += cellSize;
+	return cell;
+}
+
+/**
+ * @brief 領域を戻す
+ * @note スラブのブロックは破棄するまで解放しないので、並行モードの読み手が読んでも壊れない
+ * @param self インスタンス
+ * @param cell 領域
+ * @param size 割り当てたときの大きさ
+ */
+static void Release(Dictionary_t *self, void *cell, size_t size) {
+	size_t sizeClass = ClassOf(size);
+	if (sizeClass == NO_CLASS) {
+		Discard(self, cell);
+		return;
+	}
+	DictionarySlab_t *slab = &self->memoryPool.slabs[sizeClass];
+	memcpy(cell, &slab->freeList, sizeof(void *));
+	slab->freeList = cell;
+}
+
+/**
+ * @brief 要素の領域をすべて戻す
+ * @note 並行モードでは、読み手がキーを比べているかもしれないので要素は消さず、削除済みの印だけを付ける
  * @param self インスタンス
  * @param element 要素
+ */
+static void ReleaseElement(Dictionary_t *self, DictionaryElement_t *element) {
+	void *buffer = element->object.buffer;
+	__atomic_store_n(&element->object.buffer, NULL, __ATOMIC_RELAXED);
+	if (element->keyLength >= DICTIONARY_INLINE_KEY_SIZE) {
+		Release(self, element->key, element->keyLength + 1);
+	}
+	Release(self, buffer, element->object.size);
+	if (!self->concurrency) {
+		CLEAR(element);
+	}
+}
+
+/**
+ * @brief 書き手のロックを取る
+ * @note 全体を一貫して読む場合も、書き手を止めるために取る
+ * @param self インスタンス
+ */
+static inline void Lock(const Dictionary_t *self) {
+	if (self->concurrency) {
+		pthread_mutex_lock(&self->concurrency->mutex);
+	}
+}
+
+/**
+ * @brief 書き手のロックを外す
+ * @param self インスタンス
+ */
+static inline void Unlock(const Dictionary_t *self) {
+	if (self->concurrency) {
+		pthread_mutex_unlock(&self->concurrency->mutex);
+	}
+}
+
+/**
+ * @brief 要素を追加
+ * @note 要素とスロットを書いてから制御バイトを書き、並行モードの読み手には書き終えた要素だけを見せる
+ * @param self インスタンス
+ * @param key キー
+ * @param object 要素
+ * @param objectSize サイズ
  * @return ステータス
  */
-static inline DictionaryReturn Add(Dictionary_t *self, DictionaryElement_t *element) {
-	ENTRY e = { .key = element->key, .data = element };
-	ENTRY *ep = NULL;
-	if (hsearch_r(e, ENTER, &ep, &self->hashTable) == 0) {
+static DictionaryReturn AddElement(Dictionary_t *self, const DictionaryKey_t *key, void *object, size_t objectSize) {
+	if (FindSlot(self, key) != SIZE_MAX) {
+		return DICTIONARY_EXISTS;
+	}
+	if (!Reserve(self)) {
+		return DICTIONARY_FULL;
+	}
+	size_t keySize = key->size + 1;	// NOTE: 文字列として読めるよう、null文字を付けるので+1
+	DictionaryElement_t *element = &self->elements.list[self->elements.count];
+	CLEAR(element);
+	char *keyBuffer = element->inlineKey;
+	if (keySize > DICTIONARY_INLINE_KEY_SIZE) {
+		keyBuffer = Allocate(self, keySize);
+		if (UNLIKELY(!keyBuffer)) {
+			return DICTIONARY_FULL;
+		}
+		element->key = keyBuffer;
+	}
+	element->object.buffer = Allocate(self, objectSize);
+	if (UNLIKELY(!element->object.buffer)) {
+		if (keyBuffer != element->inlineKey) {
+			Release(self, keyBuffer, keySize);
+		}
 		return DICTIONARY_FULL;
 	}
+	element->object.size = objectSize;
+	element->hash = key->hash;
+	element->keyLength = key->size;
+	memcpy(keyBuffer, key->data, key->size);
+	keyBuffer[key->size] = '\0';
+	memcpy(element->object.buffer, object, objectSize);
+
+	DictionaryTable_t *table = self->table;
+	size_t slot = FindFreeSlot(table, key->hash);
+	if (table->controls[slot] == CONTROL_DELETED) {
+		self->numDeleted--;
+	}
+	table->slots[slot] = (uint32_t)self->elements.count++;
+	SetControl(table, slot, H2(key->hash));
 	return DICTIONARY_ADDED;
 }
 
 /**
- * @brief メモリープールからバッファを割り当てる
+ * @brief 要素を削除する
  * @param self インスタンス
+ * @param key キー
+ * @return ステータス
  */
-static void AssignMemory(Dictionary_t *self) {
-	void *current = self->memoryPool;
-	self->elements.list = (DictionaryElement_t *)current;
+static DictionaryReturn RemoveElement(Dictionary_t *self, const DictionaryKey_t *key) {
+	size_t slot = FindSlot(self, key);
+	if (slot == SIZE_MAX) {
+		return DICTIONARY_NOT_FOUND;
+	}
+	DictionarySequence_t *stripe = StripeOf(self, key->hash);
+	BeginWrite(stripe);
+	SetControl(self->table, slot, CONTROL_DELETED);
+	ReleaseElement(self, &self->elements.list[self->table->slots[slot]]);
+	EndWrite(stripe);
+	self->elements.removed++;
+	self->numDeleted++;
+	return DICTIONARY_REMOVED;
+}
 
-	current += (self->elements.capacity * sizeof(DictionaryElement_t));
-	for (size_t i = 0; i < self->elements.capacity; i++) {
-		DictionaryElement_t *e = &self->elements.list[i];
-		e->key = (char *)current;
-		current += self->maxKeySize;
-		e->object.buffer = current;
-		current += self->maxObjectSize;
+/**
+ * @brief オブジェクトをバッファに写す
+ * @param object オブジェクト
+ * @param buffer バッファ
+ * @param bufferSize バッファの大きさ
+ * @param objectSize オブジェクトのサイズの格納先 (NULL: 不要)
+ * @return ステータス
+ */
+static DictionaryReturn CopyObject(DictionaryObject_t object, void *buffer, size_t bufferSize, size_t *objectSize) {
+	if (objectSize) {
+		*objectSize = object.size;
+	}
+	if (object.size > bufferSize) {
+		return DICTIONARY_INVALID_ARG;
 	}
+	memcpy(buffer, object.buffer, object.size);
+	return DICTIONARY_FOUND;
+}
+
+//! 書き換えられたので読み直す
+#define RETRY	(1)
+
+/**
+ * @brief ロックを取らずに要素を探し、オブジェクトを写す
+ * @note 読んだ値は、ポインターを辿る前と写した後に版を比べて確かめる。作り直した古いスロットや
+ * 要素のリストは読み手がいなくなるまで残るので、途中で書き換えられても読む先が無くなることはない
+ * @param self インスタンス
+ * @param stripe キーの削除を見張る版
+ * @param key キー
+ * @param buffer バッファ
+ * @param bufferSize バッファの大きさ
+ * @param objectSize オブジェクトのサイズの格納先 (NULL: 不要)
+ * @return ステータス (RETRY: 読み直す)
+ */
+static int TryFindCopy(const Dictionary_t *self, const DictionarySequence_t *stripe, const DictionaryKey_t *key, void *buffer, size_t bufferSize, size_t *objectSize) {
+	const DictionaryConcurrency_t *concurrency = self->concurrency;
+	uint64_t version = BeginRead(&concurrency->sequence);
+	uint64_t stripeVersion = BeginRead(stripe);
+	// NOTE: 書き手はリストの後にキャパシティーを書くので、キャパシティーを先に読めばリストはそれ以上の大きさがある
+	size_t capacity = __atomic_load_n(&self->elements.capacity, __ATOMIC_ACQUIRE);
+	const DictionaryElement_t *list = __atomic_load_n(&self->elements.list, __ATOMIC_ACQUIRE);
+	const DictionaryTable_t *table = __atomic_load_n(&self->table, __ATOMIC_ACQUIRE);
+	if (!table) {
+		return IsConsistent(concurrency, stripe, version, stripeVersion) ? DICTIONARY_NOT_FOUND : RETRY;
+	}
+	size_t mask = table->numSlots - 1;
+	size_t position = H1(key->hash) & mask;
+	uint8_t control = H2(key->hash);
+	for (size_t step = GROUP_SIZE; step <= table->numSlots + GROUP_SIZE; step += GROUP_SIZE) {
+		const uint8_t *group = &table->controls[position];
+		uint32_t matches = MatchControl(group, control);
+		bool hasEmpty = (MatchControl(group, CONTROL_EMPTY) != 0);
+		atomic_thread_fence(memory_order_acquire);
+		for (uint32_t bits = matches; bits != 0; bits &= bits - 1) {
+			size_t slot = (position + (size_t)__builtin_ctz(bits)) & mask;
+			uint32_t index = table->slots[slot];
+			if (index >= capacity) {
+				continue;
+			}
+			DictionaryElement_t element = list[index];
+			if ((element.hash != key->hash) || (element.keyLength != key->size)) {
+				continue;
+			}
+			if (!IsConsistent(concurrency, stripe, version, stripeVersion)) {
+				return RETRY;
+			}
+			if (memcmp(KeyOf(&element), key->data, key->size) != 0) {
+				continue;
+			}
+			if (!element.object.buffer) {
+				return DICTIONARY_NOT_FOUND;
+			}
+			DictionaryReturn ret = CopyObject(element.object, buffer, bufferSize, objectSize);
+			return IsConsistent(concurrency, stripe, version, stripeVersion) ? (int)ret : RETRY;
+		}
+		if (hasEmpty) {
+			break;
+		}
+		position = (position + step) & mask;
+	}
+	return IsConsistent(concurrency, stripe, version, stripeVersion) ? DICTIONARY_NOT_FOUND : RETRY;
 }
 
 /**
  * @brief 初期化
+ * @note 容量を超えて追加すると広げる
  * @param self インスタンス
- * @param capacity 最大容量
+ * @param capacity 最初に確保する容量
  * @param maxKeySize キーの最大長
  * @param maxObjectSize 要素のサイズ
  */
@@ -54,21 +994,84 @@ void Dictionary_Init(Dictionary_t *self, size_t capacity, size_t maxKeySize, siz
 		return;
 	}
 	CLEAR(self);
-	self->elements.capacity = capacity;
 	self->maxKeySize = maxKeySize;
 	self->maxObjectSize = maxObjectSize;
+	capacity = (capacity < MAX_ELEMENTS) ? capacity : MAX_ELEMENTS;
+	if (capacity == 0) {
+		return;
+	}
+	self->elements.list = malloc(capacity * sizeof(DictionaryElement_t));
+	self->elements.capacity = self->elements.list ? capacity : 0;
+	Rehash(self, SlotsFor(capacity));
+}
+
+/**
+ * @brief 並行モードで初期化
+ * @note 追加と削除はロックで直列にし、Dictionary_FindCopy はロックを取らずに読む。
+ * 読み手は書き換えと重なったときだけ読み直し、読み手の数もスレッドごとの場所で数えるので、読み手どうしは競合しない
+ * @note 作り直した古いスロットや要素のリストは破棄するまで解放しない
+ * @param self インスタンス
+ * @param capacity 最初に確保する容量
+ * @param maxKeySize キーの最大長
+ * @param maxObjectSize 要素のサイズ
+ * @return false: メモリ不足
+ */
+bool Dictionary_InitConcurrent(Dictionary_t *self, size_t capacity, size_t maxKeySize, size_t maxObjectSize) {
+	if (UNLIKELY(!self)) {
+		return false;
+	}
+	Dictionary_Init(self, capacity, maxKeySize, maxObjectSize);
+	DictionaryConcurrency_t *concurrency = aligned_alloc(CACHE_LINE_SIZE, sizeof(DictionaryConcurrency_t));
+	if (UNLIKELY(!concurrency)) {
+		Dictionary_Destroy(self);
+		return false;
+	}
+	CLEAR(concurrency);
+	pthread_mutex_init(&concurrency->mutex, NULL);
+	self->concurrency = concurrency;
+	return true;
+}
+
+/**
+ * @brief キーを引けるか
+ * @param self インスタンス
+ * @param key キー
+ * @return false: 長すぎるか不正
+ */
+static inline bool IsValidKey(const Dictionary_t *self, const DictionaryKey_t *key) {
+	return key && key->data && (key->size + 1 <= self->maxKeySize);
+}
 
-	hcreate_r(self->elements.capacity, &self->hashTable);
+/**
+ * @brief ハッシュ値を求める
+ * @note DictionaryKey_t に持たせるハッシュ値。プロセスが変わっても同じ値になる
+ * @param data キーのバイト列
+ * @param size 長さ
+ * @return ハッシュ値
+ */
+uint64_t Dictionary_Hash(const void *data, size_t size) {
+	if (UNLIKELY(!data)) {
+		return Hash("", 0);
+	}
+	return Hash(data, size);
+}
 
-	size_t allocateSize = (
-		self->elements.capacity + self->maxKeySize + self->maxObjectSize
-	) * sizeof(DictionaryElement_t);
-	self->memoryPool = malloc(allocateSize);
-	AssignMemory(self);
+/**
+ * @brief キーを作る
+ * @note 同じキーで何度も引く場合は、作ったキーを使い回すとハッシュし直さない
+ * @param data キーのバイト列 (キーを使う間は有効であること)
+ * @param size 長さ (終端を含まない)
+ * @return キー
+ */
+DictionaryKey_t Dictionary_MakeKey(const void *data, size_t size) {
+	DictionaryKey_t key = { .data = data, .size = size, .hash = Dictionary_Hash(data, size) };
+	return key;
 }
 
 /**
  * @brief 要素を追加
+ * @note 追加すると、Dictionary_Find で得た参照は無効になる (バッファは移動しない)
+ * @note 短いキーは要素の中に、長いキーとオブジェクトは大きさに合うスラブに持つ
  * @param self インスタンス
  * @param key キー
  * @param object 要素
@@ -76,59 +1079,408 @@ void Dictionary_Init(Dictionary_t *self, size_t capacity, size_t maxKeySize, siz
  * @return ステータス
  */
 DictionaryReturn Dictionary_Add(Dictionary_t *self, const char *key, void *object, size_t objectSize) {
-	if (UNLIKELY(!self || !key || !object)) {
+	if (UNLIKELY(!key)) {
 		return DICTIONARY_INVALID_ARG;
 	}
-	size_t keySize = strlen(key) + 1;	// NOTE: null文字までコピーするので+1
-	if ((keySize > self->maxKeySize) || (objectSize > self->maxObjectSize)) {
+	DictionaryKey_t binaryKey = Dictionary_MakeKey(key, strlen(key));
+	return Dictionary_AddByKey(self, &binaryKey, object, objectSize);
+}
+
+/**
+ * @brief バイト列のキーで要素を追加
+ * @note キーには null文字を含められる。ハッシュ値は Dictionary_Hash で求めたものであること
+ * @param self インスタンス
+ * @param key キー
+ * @param object 要素
+ * @param objectSize サイズ
+ * @return ステータス
+ */
+DictionaryReturn Dictionary_AddByKey(Dictionary_t *self, const DictionaryKey_t *key, void *object, size_t objectSize) {
+	if (UNLIKELY(!self || !key || !object)) {
 		return DICTIONARY_INVALID_ARG;
 	}
-	if (self->elements.count >= self->elements.capacity) {
-		return DICTIONARY_FULL;
-	}
-	DictionaryElement_t *element = &self->elements.list[self->elements.count];
-	memcpy(element->key, key, keySize);
-	ENTRY e = { .key = element->key, .data = element };
-	ENTRY *ep = NULL;
-	if (hsearch_r(e, ENTER, &ep, &self->hashTable) == 0) {
-		return DICTIONARY_FULL;
+	if (!IsValidKey(self, key) || (objectSize > self->maxObjectSize)) {
+		return DICTIONARY_INVALID_ARG;
 	}
-	memcpy(element->object.buffer, object, objectSize);
-	element->object.size = objectSize;
-	self->elements.count++;
-	return DICTIONARY_ADDED;
+	Lock(self);
+	DictionaryReturn ret = AddElement(self, key, object, objectSize);
+	Unlock(self);
+	return ret;
 }
 
 /**
  * @brief 要素を取得する
+ * @note 並行モードで他のスレッドが削除するかもしれない場合は、Dictionary_FindCopy を使うこと
  * @param self インスタンス
  * @param key キー
- * @return 要素
+ * @return 要素 (NULL: 見つからない)。次に追加か削除するまで有効
  */
 const DictionaryObject_t *Dictionary_Find(Dictionary_t *self, char *key) {
-	if (UNLIKELY(!self || !key)) {
+	if (UNLIKELY(!key)) {
 		return NULL;
 	}
-	if ((strlen(key) + 1) > self->maxKeySize) {
+	DictionaryKey_t binaryKey = Dictionary_MakeKey(key, strlen(key));
+	return Dictionary_FindByKey(self, &binaryKey);
+}
+
+/**
+ * @brief バイト列のキーで要素を取得する
+ * @param self インスタンス
+ * @param key キー
+ * @return 要素 (NULL: 見つからない)。次に追加か削除するまで有効
+ */
+const DictionaryObject_t *Dictionary_FindByKey(Dictionary_t *self, const DictionaryKey_t *key) {
+	if (UNLIKELY(!self || !IsValidKey(self, key))) {
 		return NULL;
 	}
-	ENTRY e = { .key = key };
-	ENTRY *foundObject = NULL;
-	if (hsearch_r(e, FIND, &foundObject, &self->hashTable) == 0) {
+	size_t slot = FindSlot(self, key);
+	if (slot == SIZE_MAX) {
 		return NULL;
 	}
-	if (!foundObject) return NULL;
-	return &((DictionaryElement_t *)foundObject->data)->object;
+	return &self->elements.list[self->table->slots[slot]].object;
+}
+
+/**
+ * @brief 要素を取得し、オブジェクトをバッファに写す
+ * @note 並行モードではロックを取らず、他のスレッドの追加や削除と同時に呼べる
+ * @param self インスタンス
+ * @param key キー
+ * @param buffer バッファ
+ * @param bufferSize バッファの大きさ
+ * @param objectSize オブジェクトのサイズの格納先 (NULL: 不要)
+ * @return ステータス (DICTIONARY_INVALID_ARG: バッファが足りないときも。サイズは格納する)
+ */
+DictionaryReturn Dictionary_FindCopy(const Dictionary_t *self, const char *key, void *buffer, size_t bufferSize, size_t *objectSize) {
+	if (UNLIKELY(!key)) {
+		return DICTIONARY_INVALID_ARG;
+	}
+	DictionaryKey_t binaryKey = Dictionary_MakeKey(key, strlen(key));
+	return Dictionary_FindCopyByKey(self, &binaryKey, buffer, bufferSize, objectSize);
+}
+
+/**
+ * @brief バイト列のキーで要素を取得し、オブジェクトをバッファに写す
+ * @param self インスタンス
+ * @param key キー
+ * @param buffer バッファ
+ * @param bufferSize バッファの大きさ
+ * @param objectSize オブジェクトのサイズの格納先 (NULL: 不要)
+ * @return ステータス (DICTIONARY_INVALID_ARG: バッファが足りないときも。サイズは格納する)
+ */
+DictionaryReturn Dictionary_FindCopyByKey(const Dictionary_t *self, const DictionaryKey_t *key, void *buffer, size_t bufferSize, size_t *objectSize) {
+	if (UNLIKELY(!self || !key || !key->data || (!buffer && (bufferSize > 0)))) {
+		return DICTIONARY_INVALID_ARG;
+	}
+	if (!IsValidKey(self, key)) {
+		return DICTIONARY_NOT_FOUND;
+	}
+	if (!self->concurrency) {
+		size_t slot = FindSlot(self, key);
+		if (slot == SIZE_MAX) {
+			return DICTIONARY_NOT_FOUND;
+		}
+		return CopyObject(self->elements.list[self->table->slots[slot]].object, buffer, bufferSize, objectSize);
+	}
+	const DictionarySequence_t *stripe = StripeOf(self, key->hash);
+	_Atomic uint64_t *readers = EnterReaders(self->concurrency);
+	int ret;
+	while ((ret = TryFindCopy(self, stripe, key, buffer, bufferSize, objectSize)) == RETRY) {
+		Pause();
+	}
+	LeaveReaders(readers);
+	return (DictionaryReturn)ret;
+}
+
+/**
+ * @brief 要素を削除する
+ * @note スロットは削除済みの印を残し、要素のリストは穴にする。どちらも広げるときにまとめて詰める
+ * @note キーとオブジェクトの領域はスラブに戻し、同じサイズクラスの次の追加で使う
+ * @param self インスタンス
+ * @param key キー
+ * @return ステータス
+ */
+DictionaryReturn Dictionary_Remove(Dictionary_t *self, const char *key) {
+	if (UNLIKELY(!key)) {
+		return DICTIONARY_INVALID_ARG;
+	}
+	DictionaryKey_t binaryKey = Dictionary_MakeKey(key, strlen(key));
+	return Dictionary_RemoveByKey(self, &binaryKey);
+}
+
+/**
+ * @brief バイト列のキーで要素を削除する
+ * @param self インスタンス
+ * @param key キー
+ * @return ステータス
+ */
+DictionaryReturn Dictionary_RemoveByKey(Dictionary_t *self, const DictionaryKey_t *key) {
+	if (UNLIKELY(!self || !key || !key->data)) {
+		return DICTIONARY_INVALID_ARG;
+	}
+	if (!IsValidKey(self, key)) {
+		return DICTIONARY_NOT_FOUND;
+	}
+	Lock(self);
+	DictionaryReturn ret = RemoveElement(self, key);
+	Unlock(self);
+	return ret;
+}
+
+/**
+ * @brief 要素をまとめて追加
+ * @note 先にスロットと要素のリストを全体の数まで広げてから、順に追加する。
+ * 既にあるキーは飛ばし、残りを追加する
+ * @note キーがすべて正しいことを確かめてから追加するので、DICTIONARY_INVALID_ARG のときは何も追加しない
+ * @param self インスタンス
+ * @param keys キー
+ * @param objects オブジェクト
+ * @param count 要素数
+ * @param numAdded 追加した要素数の格納先 (NULL: 不要)
+ * @return ステータス (DICTIONARY_EXISTS: 既にあるキーを飛ばした)
+ */
+DictionaryReturn Dictionary_AddRange(Dictionary_t *self, const DictionaryKey_t *keys, const DictionaryObject_t *objects, size_t count, size_t *numAdded) {
+	if (numAdded) {
+		*numAdded = 0;
+	}
+	if (UNLIKELY(!self || ((count > 0) && (!keys || !objects)))) {
+		return DICTIONARY_INVALID_ARG;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (!IsValidKey(self, &keys[i]) || !objects[i].buffer || (objects[i].size > self->maxObjectSize)) {
+			return DICTIONARY_INVALID_ARG;
+		}
+	}
+	Lock(self);
+	DictionaryReturn ret = ReserveRange(self, count) ? DICTIONARY_ADDED : DICTIONARY_FULL;
+	size_t added = 0;
+	for (size_t i = 0; (i < count) && (ret != DICTIONARY_FULL); i++) {
+		DictionaryReturn result = AddElement(self, &keys[i], objects[i].buffer, objects[i].size);
+		if (result == DICTIONARY_ADDED) {
+			added++;
+		} else {
+			ret = result;
+		}
+	}
+	Unlock(self);
+	if (numAdded) {
+		*numAdded = added;
+	}
+	return ret;
+}
+
+/**
+ * @brief 変更できない辞書を作る
+ * @note 削除していない要素を追加した順に FrozenDictionary_Build に渡す
+ * @note 並行モードでは、書き手が止まってから呼ぶこと
+ * @param self インスタンス
+ * @param frozen 変更できない辞書の格納先 (FrozenDictionary_Destroy で破棄する)
+ * @return false: メモリ不足か、作れない
+ */
+bool Dictionary_Freeze(const Dictionary_t *self, FrozenDictionary_t *frozen) {
+	if (UNLIKELY(!self || !frozen)) {
+		return false;
+	}
+	size_t count = Dictionary_Count(self);
+	DictionaryKey_t *keys = malloc(count * sizeof(DictionaryKey_t) + 1);
+	DictionaryObject_t *objects = malloc(count * sizeof(DictionaryObject_t) + 1);
+	bool isFrozen = keys && objects;
+	if (isFrozen) {
+		size_t n = 0;
+		for (size_t i = 0; i < self->elements.count; i++) {
+			const DictionaryElement_t *element = &self->elements.list[i];
+			if (IsRemoved(element)) {
+				continue;
+			}
+			keys[n].data = KeyOf(element);
+			keys[n].size = element->keyLength;
+			keys[n].hash = element->hash;
+			objects[n++] = element->object;
+		}
+		isFrozen = FrozenDictionary_Build(frozen, keys, objects, n);
+	}
+	free(keys);
+	free(objects);
+	return isFrozen;
+}
+
+/**
+ * @brief 読み手がいなくなった領域を解放する
+ * @note 並行モードで預かった領域は追加と削除のたびにも解放するが、書き込みが止まった後に残った分はこれで解放する。
+ * 読み手がいなければすべて解放する
+ * @param self インスタンス
+ */
+void Dictionary_Reclaim(Dictionary_t *self) {
+	if (UNLIKELY(!self) || !self->concurrency) {
+		return;
+	}
+	Lock(self);
+	// 世代を2つ進めれば、それまでに預けた領域はすべて解放できる
+	Reclaim(self->concurrency);
+	Reclaim(self->concurrency);
+	Unlock(self);
+}
+
+/**
+ * @brief 要素数を取得する
+ * @param self インスタンス
+ * @return 要素数
+ */
+size_t Dictionary_Count(const Dictionary_t *self) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	return self->elements.count - self->elements.removed;
+}
+
+/**
+ * @brief 追加した順に要素を取り出す
+ * @note 削除した要素は飛ばす。取り出したキーとオブジェクトは、次に追加か削除するまで有効
+ * @note 並行モードでは書き手のロックを取って読む。取り出したキーとオブジェクトは他のスレッドが
+ * 追加か削除をすると無効になるので、使い終えるまで書き込みを止めること
+ * @param self インスタンス
+ * @param cursor 位置 (最初は0。取り出すたびに進める)
+ * @param key キーの格納先 (NULL: 不要)
+ * @param object オブジェクトの格納先 (NULL: 不要)
+ * @return false: もう無い
+ */
+bool Dictionary_Next(const Dictionary_t *self, size_t *cursor, DictionaryKey_t *key, DictionaryObject_t *object) {
+	if (UNLIKELY(!self || !cursor)) {
+		return false;
+	}
+	Lock(self);
+	for (size_t i = *cursor; i < self->elements.count; i++) {
+		const DictionaryElement_t *element = &self->elements.list[i];
+		if (IsRemoved(element)) {
+			continue;
+		}
+		if (key) {
+			key->data = KeyOf(element);
+			key->size = element->keyLength;
+			key->hash = element->hash;
+		}
+		if (object) {
+			*object = element->object;
+		}
+		*cursor = i + 1;
+		Unlock(self);
+		return true;
+	}
+	*cursor = self->elements.count;
+	Unlock(self);
+	return false;
+}
+
+/**
+ * @brief 要素を見つけるまでに調べるグループ数
+ * @param table スロット
+ * @param hash 要素のハッシュ値
+ * @param slot 要素のスロット
+ * @return グループ数
+ */
+static size_t ProbeLength(const DictionaryTable_t *table, uint64_t hash, size_t slot) {
+	size_t mask = table->numSlots - 1;
+	size_t position = H1(hash) & mask;
+	size_t length = 1;
+	for (size_t step = GROUP_SIZE; step <= table->numSlots + GROUP_SIZE; step += GROUP_SIZE) {
+		if (((slot - position) & mask) < GROUP_SIZE) {
+			break;
+		}
+		position = (position + step) & mask;
+		length++;
+	}
+	return length;
+}
+
+/**
+ * @brief 統計を取得する
+ * @note すべてのスロットを調べるので、要素数に比例した時間がかかる
+ * @note 並行モードでは書き手のロックを取り、その間の追加と削除を待たせる
+ * @param self インスタンス
+ * @param stats 統計の格納先
+ */
+void Dictionary_GetStats(const Dictionary_t *self, DictionaryStats_t *stats) {
+	if (UNLIKELY(!self || !stats)) {
+		return;
+	}
+	CLEAR(stats);
+	Lock(self);
+	const DictionaryTable_t *table = self->table;
+	stats->count = Dictionary_Count(self);
+	stats->numDeleted = self->numDeleted;
+	stats->capacity = self->elements.capacity;
+	stats->numHoles = self->elements.removed;
+	stats->memoryUsage = self->elements.capacity * sizeof(DictionaryElement_t)
+		+ self->memoryPool.numBlocks * (SLAB_BLOCK_SIZE + sizeof(void *));
+	stats->numRetired = self->concurrency ? self->concurrency->numRetired : 0;
+	if (table) {
+		stats->numSlots = table->numSlots;
+		stats->loadFactor = (double)stats->count / (double)table->numSlots;
+		stats->memoryUsage += sizeof(DictionaryTable_t) + table->numSlots * sizeof(uint32_t) + table->numSlots + GROUP_SIZE;
+		size_t totalLength = 0;
+		for (size_t slot = 0; slot < table->numSlots; slot++) {
+			if (table->controls[slot] & CONTROL_EMPTY) {
+				continue;	// 空きか削除済み
+			}
+			size_t length = ProbeLength(table, self->elements.list[table->slots[slot]].hash, slot);
+			size_t bin = (length <= DICTIONARY_PROBE_HISTOGRAM_SIZE) ? length - 1 : DICTIONARY_PROBE_HISTOGRAM_SIZE - 1;
+			stats->probeLengths[bin]++;
+			stats->maxProbeLength = (length > stats->maxProbeLength) ? length : stats->maxProbeLength;
+			totalLength += length;
+		}
+		stats->averageProbeLength = stats->count ? (double)totalLength / (double)stats->count : 0.0;
+	}
+	// スラブに無い大きさの領域は個別に確保している
+	for (size_t i = 0; i < self->elements.count; i++) {
+		const DictionaryElement_t *element = &self->elements.list[i];
+		if (IsRemoved(element)) {
+			continue;
+		}
+		if ((element->keyLength >= DICTIONARY_INLINE_KEY_SIZE) && (ClassOf(element->keyLength + 1) == NO_CLASS)) {
+			stats->memoryUsage += element->keyLength + 1;
+		}
+		if (ClassOf(element->object.size) == NO_CLASS) {
+			stats->memoryUsage += element->object.size;
+		}
+	}
+	Unlock(self);
 }
 
 /**
  * @brief インスタンスを破棄
+ * @note 並行モードでも、他のスレッドが使い終えてから呼ぶこと
  * @param self インスタンス
  */
 void Dictionary_Destroy(Dictionary_t *self) {
 	if (UNLIKELY(!self)) {
 		return;
 	}
-	hdestroy_r(&self->hashTable);
-	free(self->memoryPool);
+	for (size_t i = 0; i < self->elements.count; i++) {
+		DictionaryElement_t *element = &self->elements.list[i];
+		if (IsRemoved(element)) {
+			continue;
+		}
+		// スラブに無い大きさの領域だけを個別に解放する
+		if ((element->keyLength >= DICTIONARY_INLINE_KEY_SIZE) && (ClassOf(element->keyLength + 1) == NO_CLASS)) {
+			free(element->key);
+		}
+		if (ClassOf(element->object.size) == NO_CLASS) {
+			free(element->object.buffer);
+		}
+	}
+	for (size_t i = 0; i < self->memoryPool.numBlocks; i++) {
+		free(self->memoryPool.blocks[i]);
+	}
+	free(self->memoryPool.blocks);
+	free(self->elements.list);
+	free(self->table);
+	DictionaryConcurrency_t *concurrency = self->concurrency;
+	if (concurrency) {
+		for (size_t i = 0; i < concurrency->numRetired; i++) {
+			free(concurrency->retired[i].memory);
+		}
+		free(concurrency->retired);
+		pthread_mutex_destroy(&concurrency->mutex);
+		free(concurrency);
+	}
+	CLEAR(self);
 }
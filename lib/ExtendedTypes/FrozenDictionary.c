@@ -0,0 +1,456 @@
+/**
+ * @file FrozenDictionary.c
+ * @brief 変更できない辞書型
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include "ExtendedTypes/FrozenDictionary.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "utilities.h"
+
+//! ファイルの識別子
+#define MAGIC				"DICTPHF1"
+//! バイト順の確認用
+#define BYTE_ORDER_MARK		(0x01020304U)
+//! バケットあたりの平均のキー数
+#define KEYS_PER_BUCKET		(4)
+//! 種を替えて作り直す回数
+#define MAX_SEEDS			(16)
+//! 領域の境界
+#define ALIGNMENT			((size_t)8)
+
+/**
+ * @brief 領域の先頭に置くヘッダー
+ * @note 数値はホストのバイト順で持つ
+ */
+typedef struct FrozenDictionaryHeader_t {
+	//! MAGIC
+	char magic[8];
+	//! 要素数
+	uint64_t count;
+	//! バケット数
+	uint64_t numBuckets;
+	//! ハッシュ値に混ぜる種
+	uint64_t seed;
+	//! エントリーの位置 (領域の先頭から)
+	uint64_t entriesOffset;
+	//! キーとオブジェクトの位置 (領域の先頭から)
+	uint64_t dataOffset;
+	//! キーとオブジェクトのサイズ
+	uint64_t dataSize;
+	//! sizeof(FrozenDictionaryEntry_t)
+	uint32_t entrySize;
+	//! BYTE_ORDER_MARK
+	uint32_t byteOrder;
+} FrozenDictionaryHeader_t;
+
+/**
+ * @brief エントリー
+ * @note 位置はキーとオブジェクトの領域の先頭から
+ */
+typedef struct FrozenDictionaryEntry_t {
+	//! キーのハッシュ値 (Dictionary_Hash)
+	uint64_t hash;
+	//! キーの位置 (終端の null文字を付けて持つ)
+	uint64_t keyOffset;
+	//! キーの長さ (終端を含まない)
+	uint64_t keySize;
+	//! オブジェクトの位置
+	uint64_t objectOffset;
+	//! オブジェクトのサイズ
+	uint64_t objectSize;
+} FrozenDictionaryEntry_t;
+
+/**
+ * @brief ビットを混ぜる (murmur3 の fmix64)
+ * @param value 値
+ * @return 混ぜた値
+ */
+static inline uint64_t Mix(uint64_t value) {
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+/**
+ * @brief [0, range) に写す
+ * @note 除算の代わりに64ビットの積の上位を使う
+ * @param value 値
+ * @param range 範囲
+ * @return 写した値
+ */
+static inline uint64_t Reduce(uint64_t value, uint64_t range) {
+	return (uint64_t)(((__uint128_t)value * range) >> 64);
+}
+
+/**
+ * @brief 境界にそろえる
+ * @param size サイズ
+ * @return そろえたサイズ
+ */
+static inline size_t Align(size_t size) {
+	return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+/**
+ * @brief 種を混ぜたハッシュ値
+ * @param hash キーのハッシュ値
+ * @param seed 種
+ * @return ハッシュ値
+ */
+static inline uint64_t SeededHash(uint64_t hash, uint64_t seed) {
+	return Mix(hash ^ seed);
+}
+
+/**
+ * @brief エントリーの位置
+ * @param seededHash 種を混ぜたハッシュ値
+ * @param pilot バケットのパイロット
+ * @param count エントリー数
+ * @return 位置
+ */
+static inline uint64_t PositionOf(uint64_t seededHash, uint32_t pilot, uint64_t count) {
+	return Reduce(Mix(seededHash ^ ((uint64_t)(pilot + 1) * 0x9e3779b97f4a7c15ULL)), count);
+}
+
+/**
+ * @brief 領域の中の位置を決める
+ * @param self インスタンス
+ * @param header ヘッダー
+ */
+static void Attach(FrozenDictionary_t *self, const FrozenDictionaryHeader_t *header) {
+	self->count = header->count;
+	self->numBuckets = header->numBuckets;
+	self->seed = header->seed;
+	self->pilots = (const uint32_t *)(self->blob + sizeof(FrozenDictionaryHeader_t));
+	self->entries = (const FrozenDictionaryEntry_t *)(self->blob + header->entriesOffset);
+	self->data = self->blob + header->dataOffset;
+	self->dataSize = header->dataSize;
+}
+
+/**
+ * @brief パイロットを探す
+ * @note キー数の多いバケットから順に、バケット内のキーがすべて空いている位置に入るパイロットを探す
+ * @param hashes 種を混ぜたハッシュ値
+ * @param count キー数
+ * @param numBuckets バケット数
+ * @param pilots バケットごとのパイロットの格納先
+ * @param positions キーごとの位置の格納先
+ * @return false: 見つからない (種を替える)
+ */
+static bool SearchPilots(const uint64_t *hashes, size_t count, size_t numBuckets, uint32_t *pilots, uint64_t *positions) {
+	// バケットごとにキーを並べる (計数ソート)
+	size_t *starts = calloc(numBuckets + 1, sizeof(size_t));
+	size_t *members = malloc(count * sizeof(size_t));
+	size_t *order = malloc(numBuckets * sizeof(size_t));
+	size_t *sizeStarts = calloc(count + 2, sizeof(size_t));
+	uint8_t *isTaken = calloc(count, sizeof(uint8_t));
+	uint64_t *trial = calloc(count, sizeof(uint64_t));
+	bool isFound = starts && members && order && sizeStarts && isTaken && trial;
+	memset(pilots, 0, numBuckets * sizeof(uint32_t));
+	if (isFound) {
+		for (size_t i = 0; i < count; i++) {
+			starts[Reduce(hashes[i], numBuckets) + 1]++;
+		}
+		for (size_t b = 0; b < numBuckets; b++) {
+			starts[b + 1] += starts[b];
+		}
+		for (size_t i = 0; i < count; i++) {
+			members[starts[Reduce(hashes[i], numBuckets)]++] = i;
+		}
+		for (size_t b = numBuckets; b > 0; b--) {
+			starts[b] = starts[b - 1];
+		}
+		starts[0] = 0;
+		// キー数の多い順に並べる
+		for (size_t b = 0; b < numBuckets; b++) {
+			sizeStarts[count - (starts[b + 1] - starts[b]) + 1]++;
+		}
+		for (size_t s = 0; s <= count; s++) {
+			sizeStarts[s + 1] += sizeStarts[s];
+		}
+		for (size_t b = 0; b < numBuckets; b++) {
+			order[sizeStarts[count - (starts[b + 1] - starts[b])]++] = b;
+		}
+	}
+	// 最後のバケットは空きが1つになるので、平均でキー数程度は試す
+	uint64_t maxPilot = (uint64_t)count * 64 + 1024;
+	maxPilot = (maxPilot < UINT32_MAX) ? maxPilot : UINT32_MAX;
+	uint64_t attempt = 0;
+	for (size_t i = 0; isFound && (i < numBuckets); i++) {
+		size_t bucket = order[i];
+		size_t begin = starts[bucket];
+		size_t end = starts[bucket + 1];
+		if (begin == end) {
+			break;	// 以降はすべて空
+		}
+		isFound = false;
+		for (uint64_t pilot = 0; (pilot < maxPilot) && !isFound; pilot++) {
+			attempt++;
+			isFound = true;
+			for (size_t k = begin; k < end; k++) {
+				uint64_t position = PositionOf(hashes[members[k]], (uint32_t)pilot, count);
+				// 同じバケットのキーどうしの衝突は、試行ごとの印で見分ける
+				if (isTaken[position] || (trial[position] == attempt)) {
+					isFound = false;
+					break;
+				}
+				trial[position] = attempt;
+				positions[members[k]] = position;
+			}
+			if (isFound) {
+				pilots[bucket] = (uint32_t)pilot;
+				for (size_t k = begin; k < end; k++) {
+					isTaken[positions[members[k]]] = 1;
+				}
+			}
+		}
+	}
+	free(starts);
+	free(members);
+	free(order);
+	free(sizeStarts);
+	free(isTaken);
+	free(trial);
+	return isFound;
+}
+
+/**
+ * @brief キーとオブジェクトの組から作る
+ * @note キーは重複しないこと。ハッシュ値は Dictionary_Hash で求めたものであること
+ * @param self インスタンス
+ * @param keys キー
+ * @param objects オブジェクト
+ * @param count 要素数
+ * @return false: メモリ不足か、作れない (ハッシュ値が同じキーがある)
+ */
+bool FrozenDictionary_Build(FrozenDictionary_t *self, const DictionaryKey_t *keys, const DictionaryObject_t *objects, size_t count) {
+	if (UNLIKELY(!self || ((count > 0) && (!keys || !objects)))) {
+		return false;
+	}
+	CLEAR(self);
+	size_t numBuckets = (count + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+	numBuckets = numBuckets ? numBuckets : 1;
+	size_t entriesOffset = sizeof(FrozenDictionaryHeader_t) + Align(numBuckets * sizeof(uint32_t));
+	size_t dataOffset = entriesOffset + count * sizeof(FrozenDictionaryEntry_t);
+	size_t dataSize = 0;
+	for (size_t i = 0; i < count; i++) {
+		dataSize += Align(keys[i].size + 1) + Align(objects[i].size);
+	}
+	uint8_t *blob = calloc(1, dataOffset + dataSize);
+	uint64_t *hashes = malloc(count * sizeof(uint64_t) + 1);
+	uint64_t *positions = malloc(count * sizeof(uint64_t) + 1);
+	bool isBuilt = blob && hashes && positions;
+	uint32_t *pilots = (uint32_t *)(blob + sizeof(FrozenDictionaryHeader_t));
+	uint64_t seed = 0;
+	for (uint64_t attempt = 0; isBuilt && (attempt < MAX_SEEDS); attempt++) {
+		seed = Mix(attempt + 0x243f6a8885a308d3ULL);
+		for (size_t i = 0; i < count; i++) {
+			hashes[i] = SeededHash(keys[i].hash, seed);
+		}
+		if ((count == 0) || SearchPilots(hashes, count, numBuckets, pilots, positions)) {
+			break;
+		}
+		isBuilt = (attempt + 1 < MAX_SEEDS);
+	}
+	if (isBuilt) {
+		FrozenDictionaryHeader_t *header = (FrozenDictionaryHeader_t *)blob;
+		memcpy(header->magic, MAGIC, sizeof(header->magic));
+		header->count = count;
+		header->numBuckets = numBuckets;
+		header->seed = seed;
+		header->entriesOffset = entriesOffset;
+		header->dataOffset = dataOffset;
+		header->dataSize = dataSize;
+		header->entrySize = sizeof(FrozenDictionaryEntry_t);
+		header->byteOrder = BYTE_ORDER_MARK;
+		FrozenDictionaryEntry_t *entries = (FrozenDictionaryEntry_t *)(blob + entriesOffset);
+		uint8_t *data = blob + dataOffset;
+		size_t offset = 0;
+		// エントリーの順に詰め、並びを決まったものにする
+		for (size_t i = 0; i < count; i++) {
+			entries[positions[i]].keySize = i;	// 一時的に元の位置を持つ
+		}
+		for (size_t position = 0; position < count; position++) {
+			FrozenDictionaryEntry_t *entry = &entries[position];
+			size_t i = (size_t)entry->keySize;
+			entry->hash = keys[i].hash;
+			entry->keyOffset = offset;
+			entry->keySize = keys[i].size;
+			memcpy(data + offset, keys[i].data, keys[i].size);
+			offset += Align(keys[i].size + 1);
+			entry->objectOffset = offset;
+			entry->objectSize = objects[i].size;
+			memcpy(data + offset, objects[i].buffer, objects[i].size);
+			offset += Align(objects[i].size);
+		}
+		self->blob = blob;
+		self->size = dataOffset + dataSize;
+		Attach(self, header);
+	} else {
+		free(blob);
+	}
+	free(hashes);
+	free(positions);
+	return isBuilt;
+}
+
+/**
+ * @brief ファイルに保存する
+ * @param self インスタンス
+ * @param path ファイルパス
+ * @return false: 書き込めない
+ */
+bool FrozenDictionary_Save(const FrozenDictionary_t *self, const char *path) {
+	if (UNLIKELY(!self || !self->blob || !path)) {
+		return false;
+	}
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+	bool isSaved = true;
+	for (size_t written = 0; written < self->size;) {
+		ssize_t size = write(fd, self->blob + written, self->size - written);
+		if (size < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			isSaved = false;
+			break;
+		}
+		written += (size_t)size;
+	}
+	if (close(fd) != 0) {
+		isSaved = false;
+	}
+	if (!isSaved) {
+		unlink(path);	// 途中までのファイルは使わせない
+	}
+	return isSaved;
+}
+
+/**
+ * @brief ファイルを読み込む
+ * @note ファイルはマッピングしてそのまま使うので、作り直さない。
+ * ヘッダーと各領域の大きさは確かめ、エントリーの位置は引くときに確かめる
+ * @param self インスタンス
+ * @param path ファイルパス
+ * @return false: 読み込めないか、形式が違う
+ */
+bool FrozenDictionary_Load(FrozenDictionary_t *self, const char *path) {
+	if (UNLIKELY(!self || !path)) {
+		return false;
+	}
+	CLEAR(self);
+	FileMapping_t mapping;
+	if (File_Map(&mapping, path, 0) != 0) {
+		return false;
+	}
+	const FrozenDictionaryHeader_t *header = (const FrozenDictionaryHeader_t *)mapping.data;
+	size_t size = mapping.size;
+	bool isValid = (size >= sizeof(*header))
+		&& (memcmp(header->magic, MAGIC, sizeof(header->magic)) == 0)
+		&& (header->byteOrder == BYTE_ORDER_MARK)
+		&& (header->entrySize == sizeof(FrozenDictionaryEntry_t))
+		&& (header->numBuckets > 0) && (header->numBuckets <= size / sizeof(uint32_t))
+		&& (header->count <= size / sizeof(FrozenDictionaryEntry_t));
+	isValid = isValid
+		&& (header->entriesOffset == sizeof(*header) + Align(header->numBuckets * sizeof(uint32_t)))
+		&& (header->dataOffset == header->entriesOffset + header->count * sizeof(FrozenDictionaryEntry_t))
+		&& (header->dataOffset <= size) && (header->dataSize == size - header->dataOffset);
+	if (!isValid) {
+		File_Unmap(&mapping);
+		return false;
+	}
+	self->blob = mapping.data;
+	self->size = mapping.size;
+	self->mappedSize = mapping.mappedSize;
+	Attach(self, header);
+	return true;
+}
+
+/**
+ * @brief 要素を取得する
+ * @param self インスタンス
+ * @param key キー
+ * @param object オブジェクトの格納先 (バッファはインスタンスを破棄するまで有効)
+ * @return ステータス
+ */
+DictionaryReturn FrozenDictionary_Find(const FrozenDictionary_t *self, const char *key, DictionaryObject_t *object) {
+	if (UNLIKELY(!key)) {
+		return DICTIONARY_INVALID_ARG;
+	}
+	DictionaryKey_t binaryKey = Dictionary_MakeKey(key, strlen(key));
+	return FrozenDictionary_FindByKey(self, &binaryKey, object);
+}
+
+/**
+ * @brief バイト列のキーで要素を取得する
+ * @note パイロットを1つ読んでエントリーの位置を決め、そのエントリーのキーと比べるだけ
+ * @param self インスタンス
+ * @param key キー
+ * @param object オブジェクトの格納先 (バッファはインスタンスを破棄するまで有効)
+ * @return ステータス
+ */
+DictionaryReturn FrozenDictionary_FindByKey(const FrozenDictionary_t *self, const DictionaryKey_t *key, DictionaryObject_t *object) {
+	if (UNLIKELY(!self || !key || !key->data || !object)) {
+		return DICTIONARY_INVALID_ARG;
+	}
+	if (self->count == 0) {
+		return DICTIONARY_NOT_FOUND;
+	}
+	uint64_t hash = SeededHash(key->hash, self->seed);
+	uint32_t pilot = self->pilots[Reduce(hash, self->numBuckets)];
+	const FrozenDictionaryEntry_t *entry = &self->entries[PositionOf(hash, pilot, self->count)];
+	if ((entry->hash != key->hash) || (entry->keySize != key->size)) {
+		return DICTIONARY_NOT_FOUND;
+	}
+	// ファイルから読み込んだ場合に備え、領域の外を指していないかを確かめる
+	if (UNLIKELY((entry->keyOffset > self->dataSize) || (entry->keySize > self->dataSize - entry->keyOffset) ||
+		(entry->objectOffset > self->dataSize) || (entry->objectSize > self->dataSize - entry->objectOffset))) {
+		return DICTIONARY_NOT_FOUND;
+	}
+	if (memcmp(self->data + entry->keyOffset, key->data, key->size) != 0) {
+		return DICTIONARY_NOT_FOUND;
+	}
+	object->buffer = (void *)(self->data + entry->objectOffset);
+	object->size = (size_t)entry->objectSize;
+	return DICTIONARY_FOUND;
+}
+
+/**
+ * @brief 要素数を取得する
+ * @param self インスタンス
+ * @return 要素数
+ */
+size_t FrozenDictionary_Count(const FrozenDictionary_t *self) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	return (size_t)self->count;
+}
+
+/**
+ * @brief インスタンスを破棄
+ * @param self インスタンス
+ */
+void FrozenDictionary_Destroy(FrozenDictionary_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	if (self->mappedSize > 0) {
+		FileMapping_t mapping = { .data = self->blob, .size = self->size, .mappedSize = self->mappedSize };
+		File_Unmap(&mapping);
+	} else {
+		free(self->blob);
+	}
+	CLEAR(self);
+}
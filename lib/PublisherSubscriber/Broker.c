@@ -8,6 +8,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include "utilities.h"
 #include "PublisherSubscriber/Subscriber.h"
 #include "PublisherSubscriber/Publisher.h"
@@ -15,55 +17,328 @@
 #include "PublisherSubscriber/MessageStorage.h"
 #include "PublisherSubscriber/Broker.h"
 
+//! 初回の再配信までの間隔の初期値[ms]
+#define DEFAULT_INITIAL_INTERVAL	(100)
+//! 再配信間隔の上限の初期値[ms]
+#define DEFAULT_MAX_INTERVAL		(30 * 1000)
+//! 最大試行回数の初期値
+#define DEFAULT_MAX_ATTEMPTS		(10)
+//! 再配信の予定なし
+#define NO_REDELIVERY				((time_t)0)
+//! サブスクライバー1つあたりに保留できるメッセージ数
+#define PENDING_PER_SUBSCRIBER		((size_t)16)
+//! 保留できるメッセージ数の上限
+#define MAX_PENDING_MESSAGES		((size_t)64 * 1024)
+
  /**
   * @brief 配信情報
   */
 typedef struct Delivery_t {
 	//! アカウントID
 	SubscriptionAccountId id;
+	//! 配信した時点のアカウントの世代
+	size_t generation;
 	//! 内容
 	PublishContent_t content;
+	//! 配信を試行した回数
+	uint32_t attempts;
+	//! 次に再配信してよい時刻[ms]
+	time_t nextRetryTime;
 } Delivery_t;
 
 /**
- * @brief
+ * @brief 試行回数に応じた再配信間隔を計算する
+ * @param policy 再配信ポリシー
+ * @param attempts 試行回数
+ * @return 間隔[ms]
+ */
+static time_t CalculateInterval(const BrokerRetryPolicy_t *policy, uint32_t attempts) {
+	time_t interval = policy->initialInterval;
+	for (uint32_t i = 1; (i < attempts) && (interval < policy->maxInterval); i++) {
+		interval *= 2;
+	}
+	return interval < policy->maxInterval ? interval : policy->maxInterval;
+}
+
+/**
+ * @brief 再配信の予定を立てる
+ * @param self インスタンス
+ * @param delivery 配信情報
+ * @param now 現在時刻[ms]
+ * @return false: 最大試行回数に達した
+ */
+static bool ScheduleRetry(Broker_t *self, Delivery_t *delivery, time_t now) {
+	if ((self->retryPolicy.maxAttempts != 0) && (delivery->attempts >= self->retryPolicy.maxAttempts)) {
+		return false;
+	}
+	delivery->nextRetryTime = now + CalculateInterval(&self->retryPolicy, delivery->attempts);
+	return true;
+}
+
+/**
+ * @brief 配信情報を捨てる
+ * @param delivery 配信情報
+ */
+static inline void Discard(Delivery_t *delivery) {
+	PublishPayload_Release(delivery->content.payload);
+}
+
+/**
+ * @brief 保留中の配信情報をすべて捨てる
+ * @param storage 保留場所
+ */
+static void DiscardAll(MessageStorage_t *storage) {
+	Delivery_t delivery;
+	while (MessageStorage_Pop(storage, &delivery) == 0) {
+		Discard(&delivery);
+	}
+}
+
+/**
+ * @brief 指定したアカウント宛ての配信情報を捨てる
+ * @note 残りの順番は変えない
+ * @param storage 保留場所
+ * @param id アカウントID
+ */
+static void DiscardFor(MessageStorage_t *storage, SubscriptionAccountId id) {
+	size_t count = storage->count;
+	for (size_t i = 0; i < count; i++) {
+		Delivery_t delivery;
+		if (MessageStorage_Pop(storage, &delivery) != 0) {
+			break;
+		}
+		if (delivery.id == id) {
+			Discard(&delivery);
+			continue;
+		}
+		MessageStorage_Push(storage, &delivery);	// 取り出した直後でハンドラも呼んでいないので必ず空きがある
+	}
+}
+
+/**
+ * @brief デッドレターへ移す
+ * @note いっぱいの場合は最も古いものを捨てる
  * @param self インスタンス
+ * @param delivery 配信情報
  */
-static void Republish(Broker_t *self) {
+static void MoveToDeadLetters(Broker_t *self, const Delivery_t *delivery) {
+	if (MessageStorage_Push(&self->deadLetters, delivery) != 0) {
+		Delivery_t oldest;
+		MessageStorage_Pop(&self->deadLetters, &oldest);
+		Discard(&oldest);
+		MessageStorage_Push(&self->deadLetters, delivery);
+	}
+}
+
+/**
+ * @brief 再配信スレッドに予定を知らせる
+ * @param self インスタンス
+ * @param retryTime 再配信時刻[ms]
+ */
+static void NotifyRedelivery(Broker_t *self, time_t retryTime) {
+	if ((self->nextRedelivery == NO_REDELIVERY) || (retryTime < self->nextRedelivery)) {
+		self->nextRedelivery = retryTime;
+		pthread_cond_signal(&self->condition);
+	}
+}
+
+/**
+ * @brief 宛先のアカウントを取得
+ * @note IDが使い回されていれば、配信した時点のサブスクライバーはもういない
+ * @param self インスタンス
+ * @param id アカウントID
+ * @param generation 配信した時点のアカウントの世代
+ * @return アカウント (NULL: 購読をやめた)
+ */
+static SubscriptionAccount_t *GetRecipient(Broker_t *self, SubscriptionAccountId id, size_t generation) {
+	SubscriptionAccount_t *account = Subscription_GetAccount(&self->subscription, id);
+	if (UNLIKELY(!account || (account->generation != generation))) {
+		return NULL;
+	}
+	return account;
+}
+
+/**
+ * @brief 保留する
+ * @note ペイロードの参照は保留場所が持つ
+ * @param self インスタンス
+ * @param delivery 配信情報
+ * @param now 現在時刻[ms]
+ */
+static void Hold(Broker_t *self, Delivery_t *delivery, time_t now) {
+	if (!ScheduleRetry(self, delivery, now) || (MessageStorage_Push(&self->pendingMessages, delivery) != 0)) {
+		MoveToDeadLetters(self, delivery);
+		return;
+	}
+	NotifyRedelivery(self, delivery->nextRetryTime);
+}
+
+/**
+ * @brief 再配信時刻を迎えたメッセージを再配信する
+ * @note 再配信中は保留場所を詰めないので、ハンドラの中で購読をやめたアカウント宛ては取り出したときに捨てる
+ * @param self インスタンス
+ * @return 次に再配信する時刻[ms] (NO_REDELIVERY: 保留なし)
+ */
+static time_t Republish(Broker_t *self) {
+	if (UNLIKELY(self->republishing)) {
+		return NO_REDELIVERY;	// ハンドラから再配信を頼まれても、走査中の保留場所には触らない
+	}
+	self->republishing = true;
 	MessageStorage_t *pending = &self->pendingMessages;
-	Subscription_t *subscription = &self->subscription;
-	size_t count = pending->count; // 保留中のメッセージを一回だけ送りたいので、最初のたまっている数を覚えておく
+	time_t now = GetMonotonicTime();
+	time_t next = NO_REDELIVERY;
+	size_t count = pending->count; // 保留中のメッセージを一回だけ見たいので、最初のたまっている数を覚えておく
 	for (size_t i = 0; i < count; i++) {
-		const Delivery_t *delivery = MessageStorage_Peek(pending);
-		SubscriptionAccount_t *account = Subscription_GetAccount(subscription, delivery->id);
+		Delivery_t delivery;
+		if (MessageStorage_Pop(pending, &delivery) != 0) {
+			break;
+		}
+		SubscriptionAccount_t *account = GetRecipient(self, delivery.id, delivery.generation);
 		if (UNLIKELY(!account)) {
+			Discard(&delivery);	// 購読をやめたアカウント宛ては捨てる
 			continue;
 		}
-		if (Subscriber_Update(&account->subscriber, &delivery->content) == SUBSCRIBER_NACK) {
-			MessageStorage_MoveLast(pending);	// peekしたものを最後尾に持っていく
+		if (delivery.nextRetryTime <= now) {
+			delivery.attempts++;
+			if ((Subscriber_Update(&account->subscriber, &delivery.content) == SUBSCRIBER_ACK) ||
+				!GetRecipient(self, delivery.id, delivery.generation)) {
+				Discard(&delivery);	// ハンドラの中で購読をやめた場合も捨てる (購読し直していても別のサブスクライバー)
+				continue;
+			}
+			if (!ScheduleRetry(self, &delivery, now)) {
+				MoveToDeadLetters(self, &delivery);
+				continue;
+			}
+		}
+		if (MessageStorage_Push(pending, &delivery) != 0) {
+			MoveToDeadLetters(self, &delivery);	// ハンドラがパブリッシュして保留場所を埋めた
+			continue;
 		}
-		MessageStorage_RemoveTop(pending);
+		if ((next == NO_REDELIVERY) || (delivery.nextRetryTime < next)) {
+			next = delivery.nextRetryTime;
+		}
+	}
+	self->republishing = false;
+	return next;
+}
+
+/**
+ * @brief 相対時間から絶対時刻を求める
+ * @param milliSeconds 相対時間[ms]
+ * @param time 絶対時刻
+ */
+static void ToAbsoluteTime(time_t milliSeconds, struct timespec *time) {
+	clock_gettime(CLOCK_MONOTONIC, time);
+	time->tv_sec += milliSeconds / 1000;
+	time->tv_nsec += (milliSeconds % 1000) * 1000000L;
+	if (time->tv_nsec >= 1000000000L) {
+		time->tv_sec++;
+		time->tv_nsec -= 1000000000L;
 	}
 }
 
+/**
+ * @brief 再配信スレッド
+ * @note パブリッシュとは独立して、再配信時刻になったメッセージだけを送る
+ * @param arg インスタンス
+ * @return NULL
+ */
+static void *RedeliveryThread(void *arg) {
+	Broker_t *self = (Broker_t *)arg;
+	pthread_mutex_lock(&self->mutex);
+	while (self->running) {
+		self->nextRedelivery = Republish(self);
+		if (self->nextRedelivery == NO_REDELIVERY) {
+			pthread_cond_wait(&self->condition, &self->mutex);
+			continue;
+		}
+		time_t wait = self->nextRedelivery - GetMonotonicTime();
+		if (wait > 0) {
+			struct timespec timeout;
+			ToAbsoluteTime(wait, &timeout);
+			pthread_cond_timedwait(&self->condition, &self->mutex, &timeout);
+		}
+	}
+	pthread_mutex_unlock(&self->mutex);
+	return NULL;
+}
+
+/**
+ * @brief 排他制御の初期化
+ * @note サブスクライバーのハンドラから再びパブリッシュできるように再帰ロックにする
+ * @param self インスタンス
+ */
+static void InitLock(Broker_t *self) {
+	pthread_mutexattr_t mutexAttribute;
+	pthread_mutexattr_init(&mutexAttribute);
+	pthread_mutexattr_settype(&mutexAttribute, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&self->mutex, &mutexAttribute);
+	pthread_mutexattr_destroy(&mutexAttribute);
+
+	pthread_condattr_t conditionAttribute;
+	pthread_condattr_init(&conditionAttribute);
+	pthread_condattr_setclock(&conditionAttribute, CLOCK_MONOTONIC);
+	pthread_cond_init(&self->condition, &conditionAttribute);
+	pthread_condattr_destroy(&conditionAttribute);
+}
+
+/**
+ * @brief 保留できるメッセージ数を求める
+ * @note サブスクライバーが多くても確保する領域が膨らまないよう上限を設ける
+ * @param maxSubscribers サブスクライバーの最大数
+ * @return メッセージ数
+ */
+static size_t PendingCapacity(size_t maxSubscribers) {
+	if (maxSubscribers > MAX_PENDING_MESSAGES / PENDING_PER_SUBSCRIBER) {
+		return MAX_PENDING_MESSAGES;
+	}
+	return maxSubscribers * PENDING_PER_SUBSCRIBER;
+}
 
 /**
  * @brief 初期化
- * @param self
- * @param maxSubscribers
+ * @param self インスタンス
+ * @param maxSubscribers サブスクライバーの最大数
  */
-void Broker_Init(Broker_t *self, uint8_t maxSubscribers) {
+void Broker_Init(Broker_t *self, size_t maxSubscribers) {
 	if (UNLIKELY(!self)) {
 		return;
 	}
 	CLEAR(self);
 	self->maxSubscribers = maxSubscribers;
+	self->retryPolicy = (BrokerRetryPolicy_t){
+		.initialInterval = DEFAULT_INITIAL_INTERVAL,
+		.maxInterval = DEFAULT_MAX_INTERVAL,
+		.maxAttempts = DEFAULT_MAX_ATTEMPTS,
+	};
 	Subscription_Init(&self->subscription, maxSubscribers);
-	MessageStorage_Init(&self->pendingMessages, sizeof(Delivery_t), maxSubscribers * 16UL);
+	MessageStorage_Init(&self->pendingMessages, sizeof(Delivery_t), PendingCapacity(maxSubscribers));
+	MessageStorage_Init(&self->deadLetters, sizeof(Delivery_t), PendingCapacity(maxSubscribers));
+	InitLock(self);
+	self->running = true;
+	if (pthread_create(&self->redeliveryThread, NULL, RedeliveryThread, self) != 0) {
+		self->running = false;
+	}
+}
+
+/**
+ * @brief 再配信ポリシーを設定
+ * @param self インスタンス
+ * @param policy ポリシー
+ */
+void Broker_SetRetryPolicy(Broker_t *self, const BrokerRetryPolicy_t *policy) {
+	if (UNLIKELY(!self || !policy)) {
+		return;
+	}
+	pthread_mutex_lock(&self->mutex);
+	self->retryPolicy = *policy;
+	pthread_mutex_unlock(&self->mutex);
 }
 
 /**
  * @brief 通知
+ * @note 保留中のメッセージの再配信は再配信スレッドが行う
+ * @note ペイロードはコピーせず、NACKした配信の分だけ参照を増やして保留する
  * @param self インスタンス
  * @param content 内容
  */
@@ -71,23 +346,64 @@ void Broker_Publish(Broker_t *self, const PublishContent_t *content) {
 	if (UNLIKELY(!self || !content)) {
 		return;
 	}
-	Republish(self);
-	SubscriptionAccountId ids[self->maxSubscribers];
-	ssize_t numIds = Subscription_Match(&self->subscription, content->attribute, ids, self->maxSubscribers);
-	if (numIds <= 0) {
-		return;
-	}
-	for (SubscriptionAccountId i = 0; i < numIds; i++) {
-		SubscriptionAccount_t *account = Subscription_GetAccount(&self->subscription, i);
-		if (UNLIKELY(!account)) {
-			continue;
-		}
-		if (Subscriber_Update(&account->subscriber, content) == SUBSCRIBER_NACK) {
-			MessageStorage_Push(&self->pendingMessages, &(Delivery_t){
-				.id = account->id, .content = *content
-			});
+	pthread_mutex_lock(&self->mutex);
+	SubscriptionAccountId cursor = 0;
+	SubscriptionAccount_t *account;
+	while ((account = Subscription_NextMatch(&self->subscription, content->attribute, &cursor)) != NULL) {
+		// コールバック中に購読されると領域が移動するので、先にIDと世代を覚えておく
+		SubscriptionAccountId id = account->id;
+		size_t generation = account->generation;
+		if ((Subscriber_Update(&account->subscriber, content) == SUBSCRIBER_NACK) &&
+			GetRecipient(self, id, generation)) {	// ハンドラの中で購読をやめていなければ保留する
+			Delivery_t delivery = { .id = id, .generation = generation, .content = *content, .attempts = 1 };
+			PublishPayload_Retain(delivery.content.payload);
+			Hold(self, &delivery, GetMonotonicTime());
 		}
 	}
+	pthread_mutex_unlock(&self->mutex);
+}
+
+/**
+ * @brief 再配信時刻を迎えた保留中のメッセージを今すぐ再配信する
+ * @param self インスタンス
+ * @return 保留中のメッセージ数
+ */
+size_t Broker_Redeliver(Broker_t *self) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	pthread_mutex_lock(&self->mutex);
+	time_t next = Republish(self);
+	if (next != NO_REDELIVERY) {
+		NotifyRedelivery(self, next);
+	}
+	size_t count = self->pendingMessages.count;
+	pthread_mutex_unlock(&self->mutex);
+	return count;
+}
+
+/**
+ * @brief 再配信をあきらめたメッセージを取り出す
+ * @note ペイロードの参照は呼び出し元に移るので、PublishPayload_Release すること
+ * @param self インスタンス
+ * @param id 宛先のアカウントID
+ * @param content 内容
+ * @return 0: 成功
+ */
+int Broker_TakeDeadLetter(Broker_t *self, SubscriptionAccountId *id, PublishContent_t *content) {
+	if (UNLIKELY(!self || !id || !content)) {
+		return -1;
+	}
+	Delivery_t delivery;
+	pthread_mutex_lock(&self->mutex);
+	int ret = MessageStorage_Pop(&self->deadLetters, &delivery);
+	pthread_mutex_unlock(&self->mutex);
+	if (ret != 0) {
+		return -1;
+	}
+	*id = delivery.id;
+	*content = delivery.content;
+	return 0;
 }
 
 /**
@@ -98,20 +414,31 @@ void Broker_Publish(Broker_t *self, const PublishContent_t *content) {
  * @return アカウントID
  */
 SubscriptionAccountId Broker_Subscribe(Broker_t *self, const Subscriber_t *subscriber, PublishMessageAttribute interestedTopic) {
-	return Subscription_Contract(&self->subscription, subscriber, interestedTopic);
+	pthread_mutex_lock(&self->mutex);
+	SubscriptionAccountId id = Subscription_Contract(&self->subscription, subscriber, interestedTopic);
+	pthread_mutex_unlock(&self->mutex);
+	return id;
 }
 
 /**
  * @brief 購読を辞める
+ * @note アカウントIDはすぐに使い回すので、保留中のメッセージとデッドレターもここで捨てる。
+ * 残すと、同じIDで次に購読したサブスクライバーに届いてしまう
+ * @note 再配信のハンドラから呼ばれたときは保留場所を走査中なので詰めない。
+ * 残ったものは世代が合わないので、再配信で取り出したときに捨てる
  * @param self インスタンス
  * @param id アカウントID
  */
 void Broker_Unsubscribe(Broker_t *self, SubscriptionAccountId id) {
-	/**
-	 * @note pendingしているメッセージここでは消さず、
-	 * Republishするときにアカウントが見つからなければ消すという方法を取る
-	 */
+	pthread_mutex_lock(&self->mutex);
+	if (Subscription_GetAccount(&self->subscription, id)) {
+		if (!self->republishing) {
+			DiscardFor(&self->pendingMessages, id);
+		}
+		DiscardFor(&self->deadLetters, id);
+	}
 	Subscription_Cancellation(&self->subscription, id);
+	pthread_mutex_unlock(&self->mutex);
 }
 
 /**
@@ -119,8 +446,24 @@ void Broker_Unsubscribe(Broker_t *self, SubscriptionAccountId id) {
  * @param self インスタンス
  */
 void Broker_Destroy(Broker_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	pthread_mutex_lock(&self->mutex);
+	bool running = self->running;
+	self->running = false;
+	pthread_cond_signal(&self->condition);
+	pthread_mutex_unlock(&self->mutex);
+	if (running) {
+		pthread_join(self->redeliveryThread, NULL);
+	}
+	pthread_cond_destroy(&self->condition);
+	pthread_mutex_destroy(&self->mutex);
+	DiscardAll(&self->pendingMessages);
+	DiscardAll(&self->deadLetters);
 	Subscription_Destroy(&self->subscription);
 	MessageStorage_Destroy(&self->pendingMessages);
+	MessageStorage_Destroy(&self->deadLetters);
 }
 
 
@@ -0,0 +1,225 @@
+/**
+ * @file PublishPayload.c
+ * @brief 参照カウント付きのペイロード
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <pthread.h>
+#include "utilities.h"
+#include "PublisherSubscriber/PublishPayload.h"
+
+//! 最小のサイズクラスのバイト数
+#define MIN_CLASS_SIZE		((size_t)64)
+//! プールで管理しない大きさ
+#define LARGE_CLASS			(PUBLISH_PAYLOAD_NUM_SIZE_CLASSES)
+
+/**
+ * @struct PublishPayload_t
+ * @brief ペイロード
+ */
+struct PublishPayload_t {
+	//! 所属するプール
+	PublishPayloadPool_t *pool;
+	//! 空きリストの次
+	PublishPayload_t *next;
+	//! 参照数
+	atomic_uint_fast32_t references;
+	//! サイズクラス
+	uint32_t sizeClass;
+	//! データサイズ
+	size_t size;
+	//! データ
+	alignas(max_align_t) uint8_t data[];
+};
+
+/**
+ * @brief サイズクラスを求める
+ * @param size データサイズ
+ * @return サイズクラス
+ */
+static inline uint32_t ToSizeClass(size_t size) {
+	uint32_t sizeClass = 0;
+	for (size_t classSize = MIN_CLASS_SIZE; classSize < size; classSize <<= 1) {
+		if (++sizeClass == LARGE_CLASS) {
+			break;
+		}
+	}
+	return sizeClass;
+}
+
+/**
+ * @brief サイズクラスの容量
+ * @param sizeClass サイズクラス
+ * @return バイト数
+ */
+static inline size_t ClassCapacity(uint32_t sizeClass) {
+	return MIN_CLASS_SIZE << sizeClass;
+}
+
+/**
+ * @brief 空きリストから取り出す
+ * @param self インスタンス
+ * @param sizeClass サイズクラス
+ * @return ペイロード (NULL: 空き無し)
+ */
+static PublishPayload_t *TakeFree(PublishPayloadPool_t *self, uint32_t sizeClass) {
+	PublishPayload_t *payload = self->freeLists[sizeClass];
+	if (payload) {
+		self->freeLists[sizeClass] = payload->next;
+	}
+	return payload;
+}
+
+/**
+ * @brief プールへ返す
+ * @param self ペイロード
+ */
+static void GiveBack(PublishPayload_t *self) {
+	PublishPayloadPool_t *pool = self->pool;
+	pthread_mutex_lock(&pool->mutex);
+	pool->inUse--;
+	if (self->sizeClass == LARGE_CLASS) {
+		pthread_mutex_unlock(&pool->mutex);
+		free(self);
+		return;
+	}
+	self->next = pool->freeLists[self->sizeClass];
+	pool->freeLists[self->sizeClass] = self;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * @brief 初期化
+ * @param self インスタンス
+ */
+void PublishPayloadPool_Init(PublishPayloadPool_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	CLEAR(self);
+	pthread_mutex_init(&self->mutex, NULL);
+}
+
+/**
+ * @brief ペイロードを割り当てる
+ * @note 参照数1で返すので、使い終わったら PublishPayload_Release を呼ぶ
+ * @param self インスタンス
+ * @param size データサイズ
+ * @return ペイロード
+ */
+PublishPayload_t *PublishPayloadPool_Allocate(PublishPayloadPool_t *self, size_t size) {
+	if (UNLIKELY(!self)) {
+		return NULL;
+	}
+	uint32_t sizeClass = ToSizeClass(size);
+	pthread_mutex_lock(&self->mutex);
+	PublishPayload_t *payload = (sizeClass == LARGE_CLASS) ? NULL : TakeFree(self, sizeClass);
+	self->inUse++;
+	pthread_mutex_unlock(&self->mutex);
+	if (!payload) {
+		size_t capacity = (sizeClass == LARGE_CLASS) ? size : ClassCapacity(sizeClass);
+		payload = malloc(sizeof(PublishPayload_t) + capacity);
+		if (UNLIKELY(!payload)) {
+			pthread_mutex_lock(&self->mutex);
+			self->inUse--;
+			pthread_mutex_unlock(&self->mutex);
+			return NULL;
+		}
+		payload->pool = self;
+		payload->sizeClass = sizeClass;
+	}
+	payload->next = NULL;
+	payload->size = size;
+	atomic_init(&payload->references, 1);
+	return payload;
+}
+
+/**
+ * @brief 貸し出し中のペイロード数
+ * @param self インスタンス
+ * @return 数
+ */
+size_t PublishPayloadPool_InUse(PublishPayloadPool_t *self) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	pthread_mutex_lock(&self->mutex);
+	size_t inUse = self->inUse;
+	pthread_mutex_unlock(&self->mutex);
+	return inUse;
+}
+
+/**
+ * @brief インスタンスを破棄
+ * @attention 貸し出し中のペイロードがすべて解放されてから呼ぶこと
+ * @param self インスタンス
+ */
+void PublishPayloadPool_Destroy(PublishPayloadPool_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	for (uint32_t i = 0; i < PUBLISH_PAYLOAD_NUM_SIZE_CLASSES; i++) {
+		PublishPayload_t *payload;
+		while ((payload = TakeFree(self, i)) != NULL) {
+			free(payload);
+		}
+	}
+	pthread_mutex_destroy(&self->mutex);
+	CLEAR(self);
+}
+
+/**
+ * @brief データの参照を取得
+ * @param self インスタンス
+ * @return データ
+ */
+void *PublishPayload_Data(PublishPayload_t *self) {
+	if (UNLIKELY(!self)) {
+		return NULL;
+	}
+	return self->data;
+}
+
+/**
+ * @brief データサイズを取得
+ * @param self インスタンス
+ * @return サイズ
+ */
+size_t PublishPayload_Size(const PublishPayload_t *self) {
+	if (UNLIKELY(!self)) {
+		return 0;
+	}
+	return self->size;
+}
+
+/**
+ * @brief 参照を増やす
+ * @param self インスタンス
+ * @return self
+ */
+PublishPayload_t *PublishPayload_Retain(PublishPayload_t *self) {
+	if (UNLIKELY(!self)) {
+		return NULL;
+	}
+	atomic_fetch_add_explicit(&self->references, 1, memory_order_relaxed);
+	return self;
+}
+
+/**
+ * @brief 参照を減らす
+ * @note 最後の参照だった場合はプールへ返す
+ * @param self インスタンス
+ */
+void PublishPayload_Release(PublishPayload_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	if (atomic_fetch_sub_explicit(&self->references, 1, memory_order_acq_rel) == 1) {
+		GiveBack(self);
+	}
+}
+
@@ -4,6 +4,7 @@
  * @author atohs
  * @date 2024/07/12
  */
+#include <errno.h>
 #include "utilities.h"
 #include "PublisherSubscriber/Publisher.h"
 #include "PublisherSubscriber/Subscriber.h"
@@ -13,7 +14,7 @@
   * @param self インスタンス
   * @param maxSubscribers サブスクライバー数
   */
-void Publisher_Init(Publisher_t *self, uint8_t maxSubscribers) {
+void Publisher_Init(Publisher_t *self, size_t maxSubscribers) {
 	if (UNLIKELY(!self)) {
 		return;
 	}
@@ -49,14 +50,59 @@ void Publisher_Unsubscribe(Publisher_t *self, SubscriptionAccountId id) {
 
 /**
  * @brief 通知
+ * @note 転送先があれば他プロセスのサブスクライバーにも通知する
  * @param self インスタンス
  * @param content 内容
+ * @return 0: 成功, 負: 転送先に通知できない (SharedMemoryTransport_Publish の戻り値)
  */
-void Publisher_Publish(Publisher_t *self, const PublishContent_t *content) {
+int Publisher_Publish(Publisher_t *self, const PublishContent_t *content) {
 	if (UNLIKELY(!self || !content)) {
-		return;
+		return -EINVAL;
 	}
 	Broker_Publish(&self->broker, content);
+	if (self->transport) {
+		return SharedMemoryTransport_Publish(self->transport, content);
+	}
+	return 0;
+}
+
+/**
+ * @brief 他プロセスへの転送先を設定
+ * @param self インスタンス
+ * @param transport 転送先 (NULL: 転送しない)
+ */
+void Publisher_AttachTransport(Publisher_t *self, SharedMemoryTransport_t *transport) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	self->transport = transport;
+}
+
+/**
+ * @brief 再配信ポリシーを設定
+ * @param self インスタンス
+ * @param policy ポリシー
+ */
+void Publisher_SetRetryPolicy(Publisher_t *self, const BrokerRetryPolicy_t *policy) {
+	if (UNLIKELY(!self || !policy)) {
+		return;
+	}
+	Broker_SetRetryPolicy(&self->broker, policy);
+}
+
+/**
+ * @brief 再配信をあきらめたメッセージを取り出す
+ * @note ペイロードの参照は呼び出し元に移る
+ * @param self インスタンス
+ * @param id 宛先のアカウントID
+ * @param content 内容
+ * @return 0: 成功
+ */
+int Publisher_TakeDeadLetter(Publisher_t *self, SubscriptionAccountId *id, PublishContent_t *content) {
+	if (UNLIKELY(!self)) {
+		return -1;
+	}
+	return Broker_TakeDeadLetter(&self->broker, id, content);
 }
 
 /**
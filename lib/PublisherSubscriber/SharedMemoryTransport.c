@@ -0,0 +1,618 @@
+/**
+ * @file SharedMemoryTransport.c
+ * @brief 共有メモリを使ったプロセス間のパブリッシュ/サブスクライブ
+ * @author atohs
+ * @date 2024/07/12
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "utilities.h"
+#include "PublisherSubscriber/SharedMemoryTransport.h"
+
+//! セグメントの識別子
+#define SEGMENT_MAGIC		((uint32_t)0x53504D53)
+//! セグメントのレイアウトのバージョン
+#define SEGMENT_VERSION		((uint32_t)1)
+//! キャッシュラインのサイズ
+#define CACHE_LINE			(64)
+//! カーソルの持ち主なし
+#define NO_OWNER			((int32_t)0)
+//! カーソルを確保中 (持ち主のプロセスIDを負にして持つ)
+#define CLAIMING(pid)		(-(int32_t)(pid))
+
+/**
+ * @brief サブスクライバーごとの読み込み位置
+ * @note 偽共有を避けるため1キャッシュラインに1つ置く
+ */
+typedef struct SharedMemoryCursor_t {
+	//! 次に読むシーケンス番号
+	_Atomic uint64_t position;
+	//! 持ち主のプロセスID (負: 確保中)
+	_Atomic int32_t owner;
+	uint8_t padding[CACHE_LINE - sizeof(uint64_t) - sizeof(int32_t)];
+} SharedMemoryCursor_t;
+
+/**
+ * @brief リングバッファの1要素
+ */
+typedef struct SharedMemorySlot_t {
+	//! 書込み済みのシーケンス番号+1
+	_Atomic uint64_t sequence;
+	//! メッセージ
+	PublishMessage message;
+	//! 属性
+	PublishMessageAttribute attribute;
+	//! ペイロードのサイズ
+	uint32_t payloadSize;
+	//! ペイロード
+	alignas(16) uint8_t payload[];
+} SharedMemorySlot_t;
+
+/**
+ * @struct SharedMemorySegment_t
+ * @brief 共有メモリのレイアウト
+ * @note カーソルの後ろにリングバッファが続く
+ */
+struct SharedMemorySegment_t {
+	//! 識別子 (初期化完了後に書き込む)
+	_Atomic uint32_t magic;
+	//! バージョン
+	uint32_t version;
+	//! リングバッファの要素数 (2のべき乗)
+	uint64_t capacity;
+	//! 1要素のサイズ
+	uint64_t slotSize;
+	//! ペイロードの最大サイズ
+	uint64_t maxPayloadSize;
+	//! サブスクライバーの最大数
+	uint32_t maxSubscribers;
+	//! 次に書き込むシーケンス番号
+	alignas(CACHE_LINE) _Atomic uint64_t head;
+	//! 待ち合わせ用のfutex
+	alignas(CACHE_LINE) _Atomic uint32_t futex;
+	//! 待っているサブスクライバー数
+	_Atomic uint32_t waiters;
+	//! カーソル
+	alignas(CACHE_LINE) SharedMemoryCursor_t cursors[];
+};
+
+/**
+ * @brief 2のべき乗に切り上げる
+ * @param value 値
+ * @return 2のべき乗
+ */
+static inline uint64_t RoundUpPowerOfTwo(uint64_t value) {
+	uint64_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+/**
+ * @brief 1要素のサイズ
+ * @param maxPayloadSize ペイロードの最大サイズ
+ * @return バイト数
+ */
+static inline size_t CalculateSlotSize(size_t maxPayloadSize) {
+	size_t size = sizeof(SharedMemorySlot_t) + maxPayloadSize;
+	return (size + CACHE_LINE - 1) & ~((size_t)CACHE_LINE - 1);
+}
+
+/**
+ * @brief セグメントのサイズ
+ * @param capacity 要素数
+ * @param slotSize 1要素のサイズ
+ * @param maxSubscribers サブスクライバーの最大数
+ * @return バイト数
+ */
+static inline size_t CalculateSegmentSize(uint64_t capacity, size_t slotSize, uint32_t maxSubscribers) {
+	return sizeof(struct SharedMemorySegment_t) + (maxSubscribers * sizeof(SharedMemoryCursor_t)) + (capacity * slotSize);
+}
+
+/**
+ * @brief シーケンス番号に対応する要素を取得
+ * @param segment セグメント
+ * @param sequence シーケンス番号
+ * @return 要素
+ */
+static inline SharedMemorySlot_t *GetSlot(struct SharedMemorySegment_t *segment, uint64_t sequence) {
+	uint8_t *slots = (uint8_t *)&segment->cursors[segment->maxSubscribers];
+	return (SharedMemorySlot_t *)(slots + ((sequence & (segment->capacity - 1)) * segment->slotSize));
+}
+
+/**
+ * @brief 自分のカーソルを取得
+ * @param self インスタンス
+ * @param id アカウントID
+ * @return カーソル (NULL: 無効なID)
+ */
+static inline SharedMemoryCursor_t *GetCursor(SharedMemoryTransport_t *self, SubscriptionAccountId id) {
+	if (UNLIKELY(!self || !self->segment || (id >= self->segment->maxSubscribers))) {
+		return NULL;
+	}
+	SharedMemoryCursor_t *cursor = &self->segment->cursors[id];
+	if (atomic_load_explicit(&cursor->owner, memory_order_relaxed) <= NO_OWNER) {
+		return NULL;
+	}
+	return cursor;
+}
+
+/**
+ * @brief futexで待つ
+ * @param futex futex
+ * @param expected 期待値
+ * @param timeout タイムアウト (NULL: 無限)
+ */
+static inline void FutexWait(_Atomic uint32_t *futex, uint32_t expected, const struct timespec *timeout) {
+	syscall(SYS_futex, (uint32_t *)futex, FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+/**
+ * @brief futexで待っている全員を起こす
+ * @param futex futex
+ */
+static inline void FutexWakeAll(_Atomic uint32_t *futex) {
+	syscall(SYS_futex, (uint32_t *)futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * @brief プロセスが生きているか
+ * @param pid プロセスID
+ * @return
+ */
+static inline bool IsAlive(pid_t pid) {
+	return (kill(pid, 0) == 0) || (errno != ESRCH);
+}
+
+/**
+ * @brief 一番遅れているサブスクライバーの読み込み位置
+ * @note 確保中のカーソルも数える。読み込み位置を書き終えるまでは前の持ち主の古い位置が残っているが、
+ * 確保した後の位置より前なので、参加しようとしているサブスクライバーを追い越さない
+ * @param segment セグメント
+ * @param head 次に書き込むシーケンス番号
+ * @return 読み込み位置
+ */
+static uint64_t GetSlowestPosition(struct SharedMemorySegment_t *segment, uint64_t head) {
+	uint64_t slowest = head;
+	for (uint32_t i = 0; i < segment->maxSubscribers; i++) {
+		SharedMemoryCursor_t *cursor = &segment->cursors[i];
+		if (atomic_load(&cursor->owner) == NO_OWNER) {
+			continue;
+		}
+		uint64_t position = atomic_load_explicit(&cursor->position, memory_order_acquire);
+		if (position < slowest) {
+			slowest = position;
+		}
+	}
+	return slowest;
+}
+
+/**
+ * @brief 終了したプロセスのカーソルを解放する
+ * @note 確保の途中で終了したプロセスのカーソルも解放する
+ * @param segment セグメント
+ */
+static void ReapDeadSubscribers(struct SharedMemorySegment_t *segment) {
+	for (uint32_t i = 0; i < segment->maxSubscribers; i++) {
+		SharedMemoryCursor_t *cursor = &segment->cursors[i];
+		int32_t owner = atomic_load_explicit(&cursor->owner, memory_order_relaxed);
+		pid_t pid = (owner < NO_OWNER) ? -owner : owner;
+		if ((owner != NO_OWNER) && !IsAlive(pid)) {
+			atomic_compare_exchange_strong(&cursor->owner, &owner, NO_OWNER);
+		}
+	}
+}
+
+/**
+ * @brief 書き込みの終わったサブスクライバーを起こす
+ * @note 誰も待っていなければシステムコールを呼ばない
+ * @note 書き込みを知らせる版を書いた後に呼ぶ。フェンスで、版の書き込みより前に待ち人数を読まないようにする。
+ * WaitForSlot のフェンスと合わせて、待ち人数の0を読んだなら、サブスクライバーは眠る前に版を読める
+ * @param segment セグメント
+ */
+static inline void WakeSubscribers(struct SharedMemorySegment_t *segment) {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&segment->waiters) > 0) {
+		atomic_fetch_add(&segment->futex, 1);
+		FutexWakeAll(&segment->futex);
+	}
+}
+
+/**
+ * @brief 残りの待ち時間を求める
+ * @param deadline 期限(CLOCK_MONOTONIC)
+ * @param remaining 残り時間
+ * @return false: 期限切れ
+ */
+static bool GetRemainingTime(const struct timespec *deadline, struct timespec *remaining) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	remaining->tv_sec = deadline->tv_sec - now.tv_sec;
+	remaining->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+	if (remaining->tv_nsec < 0) {
+		remaining->tv_sec--;
+		remaining->tv_nsec += 1000000000L;
+	}
+	return remaining->tv_sec >= 0;
+}
+
+/**
+ * @brief 要素の状態を調べる
+ * @param slot 要素
+ * @param position 読み込み位置
+ * @return 0: 書き込み済み, -EAGAIN: まだ書き込まれていない, -EOVERFLOW: 上書きされた
+ */
+static inline int CheckSlot(SharedMemorySlot_t *slot, uint64_t position) {
+	uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+	if (sequence == (position + 1)) {
+		return 0;
+	}
+	return (sequence > (position + 1)) ? -EOVERFLOW : -EAGAIN;
+}
+
+/**
+ * @brief 次のメッセージが書き込まれるのを待つ
+ * @note 書き込み済みならシステムコールを呼ばずに返る
+ * @note 読む前に上書きされていたら、読み込み位置を最新のメッセージの後ろに合わせ直す
+ * @param segment セグメント
+ * @param cursor カーソル
+ * @param timeout タイムアウト[ms] (負: 無限, 0: 待たない)
+ * @param slot 要素
+ * @return 0: 成功, -EAGAIN: タイムアウト, -EOVERFLOW: 読む前に上書きされた
+ */
+static int WaitForSlot(struct SharedMemorySegment_t *segment, SharedMemoryCursor_t *cursor, time_t timeout, SharedMemorySlot_t **slot) {
+	uint64_t position = atomic_load_explicit(&cursor->position, memory_order_relaxed);
+	*slot = GetSlot(segment, position);
+	int ret = CheckSlot(*slot, position);
+	if ((ret == -EAGAIN) && (timeout != 0)) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeout / 1000;
+		deadline.tv_nsec += (timeout % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		while (ret == -EAGAIN) {
+			uint32_t futex = atomic_load(&segment->futex);
+			atomic_fetch_add(&segment->waiters, 1);
+			// 待ち人数を増やした後に版を読み直す。WakeSubscribers のフェンスと合わせて、起こし損ねないようにする
+			atomic_thread_fence(memory_order_seq_cst);
+			ret = CheckSlot(*slot, position);
+			if (ret != -EAGAIN) {
+				atomic_fetch_sub(&segment->waiters, 1);
+				break;
+			}
+			struct timespec remaining;
+			if ((timeout > 0) && !GetRemainingTime(&deadline, &remaining)) {
+				atomic_fetch_sub(&segment->waiters, 1);
+				break;
+			}
+			FutexWait(&segment->futex, futex, (timeout > 0) ? &remaining : NULL);
+			atomic_fetch_sub(&segment->waiters, 1);
+			ret = CheckSlot(*slot, position);
+		}
+	}
+	if (ret == -EOVERFLOW) {
+		atomic_store_explicit(&cursor->position, atomic_load(&segment->head), memory_order_release);
+	}
+	return ret;
+}
+
+/**
+ * @brief 読み込み位置を進める
+ * @param cursor カーソル
+ */
+static inline void Advance(SharedMemoryCursor_t *cursor) {
+	uint64_t position = atomic_load_explicit(&cursor->position, memory_order_relaxed);
+	atomic_store_explicit(&cursor->position, position + 1, memory_order_release);
+}
+
+/**
+ * @brief セグメントをマッピングする
+ * @param self インスタンス
+ * @param fd ファイルディスクリプタ
+ * @param size サイズ
+ * @return 0: 成功
+ */
+static int Map(SharedMemoryTransport_t *self, int fd, size_t size) {
+	void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		return -errno;
+	}
+	self->segment = (struct SharedMemorySegment_t *)address;
+	self->mappedSize = size;
+	return 0;
+}
+
+/**
+ * @brief 名前を設定
+ * @param self インスタンス
+ * @param name 名前
+ * @return 0: 成功
+ */
+static int SetName(SharedMemoryTransport_t *self, const char *name) {
+	if (UNLIKELY(!name || (strlen(name) >= sizeof(self->name)))) {
+		return -EINVAL;
+	}
+	strcpy(self->name, name);
+	return 0;
+}
+
+/**
+ * @brief セグメントを作成する
+ * @param self インスタンス
+ * @param name 名前 ("/name"の形式)
+ * @param capacity 溜められるメッセージ数 (2のべき乗に切り上げる)
+ * @param maxPayloadSize ペイロードの最大サイズ
+ * @param maxSubscribers サブスクライバーの最大数 (全プロセスの合計)
+ * @return 0: 成功, 負: -errno
+ */
+int SharedMemoryTransport_Create(SharedMemoryTransport_t *self, const char *name, size_t capacity, size_t maxPayloadSize, uint16_t maxSubscribers) {
+	if (UNLIKELY(!self || (capacity == 0) || (maxPayloadSize > UINT32_MAX) || (maxSubscribers == 0))) {
+		return -EINVAL;
+	}
+	CLEAR(self);
+	int ret = SetName(self, name);
+	if (ret != 0) {
+		return ret;
+	}
+	uint64_t roundedCapacity = RoundUpPowerOfTwo(capacity);
+	size_t slotSize = CalculateSlotSize(maxPayloadSize);
+	size_t size = CalculateSegmentSize(roundedCapacity, slotSize, maxSubscribers);
+
+	int fd = shm_open(self->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0) {
+		return -errno;
+	}
+	if (ftruncate(fd, (off_t)size) != 0) {
+		ret = -errno;
+		close(fd);
+		shm_unlink(self->name);
+		return ret;
+	}
+	ret = Map(self, fd, size);
+	close(fd);
+	if (ret != 0) {
+		shm_unlink(self->name);
+		return ret;
+	}
+	self->owner = true;
+
+	struct SharedMemorySegment_t *segment = self->segment;
+	segment->version = SEGMENT_VERSION;
+	segment->capacity = roundedCapacity;
+	segment->slotSize = slotSize;
+	segment->maxPayloadSize = maxPayloadSize;
+	segment->maxSubscribers = maxSubscribers;
+	atomic_store_explicit(&segment->magic, SEGMENT_MAGIC, memory_order_release);
+	return 0;
+}
+
+/**
+ * @brief 作成済みのセグメントを開く
+ * @param self インスタンス
+ * @param name 名前
+ * @return 0: 成功, -EAGAIN: 作成中 (開き直す), -EPROTO: 別の形式のセグメント, 負: -errno
+ */
+int SharedMemoryTransport_Open(SharedMemoryTransport_t *self, const char *name) {
+	if (UNLIKELY(!self)) {
+		return -EINVAL;
+	}
+	CLEAR(self);
+	int ret = SetName(self, name);
+	if (ret != 0) {
+		return ret;
+	}
+	int fd = shm_open(self->name, O_RDWR, 0);
+	if (fd < 0) {
+		return -errno;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		ret = -errno;
+		close(fd);
+		return ret;
+	}
+	if ((size_t)st.st_size < sizeof(struct SharedMemorySegment_t)) {
+		close(fd);
+		return -EAGAIN;	// 作成中
+	}
+	ret = Map(self, fd, (size_t)st.st_size);
+	close(fd);
+	if (ret != 0) {
+		return ret;
+	}
+	struct SharedMemorySegment_t *segment = self->segment;
+	uint32_t magic = atomic_load_explicit(&segment->magic, memory_order_acquire);
+	if (magic == 0) {
+		SharedMemoryTransport_Close(self);
+		return -EAGAIN;	// 大きさは決まったが、まだ初期化中
+	}
+	if ((magic != SEGMENT_MAGIC) ||
+		(segment->version != SEGMENT_VERSION) ||
+		(CalculateSegmentSize(segment->capacity, segment->slotSize, segment->maxSubscribers) > self->mappedSize)) {
+		SharedMemoryTransport_Close(self);
+		return -EPROTO;
+	}
+	return 0;
+}
+
+/**
+ * @brief 通知
+ * @note ペイロードのデータはセグメントにコピーする
+ * @param self インスタンス
+ * @param content 内容
+ * @return 0: 成功, -EAGAIN: 一番遅いサブスクライバーが追いついていない
+ */
+int SharedMemoryTransport_Publish(SharedMemoryTransport_t *self, const PublishContent_t *content) {
+	if (UNLIKELY(!self || !self->segment || !content)) {
+		return -EINVAL;
+	}
+	struct SharedMemorySegment_t *segment = self->segment;
+	size_t payloadSize = PublishPayload_Size(content->payload);
+	if (payloadSize > segment->maxPayloadSize) {
+		return -EMSGSIZE;
+	}
+	uint64_t head = atomic_load(&segment->head);
+	do {
+		if ((head - GetSlowestPosition(segment, head)) >= segment->capacity) {
+			ReapDeadSubscribers(segment);
+			if ((head - GetSlowestPosition(segment, head)) >= segment->capacity) {
+				return -EAGAIN;
+			}
+		}
+	} while (!atomic_compare_exchange_weak(&segment->head, &head, head + 1));
+
+	SharedMemorySlot_t *slot = GetSlot(segment, head);
+	slot->message = content->message;
+	slot->attribute = content->attribute;
+	slot->payloadSize = (uint32_t)payloadSize;
+	if (payloadSize > 0) {
+		memcpy(slot->payload, PublishPayload_Data(content->payload), payloadSize);
+	}
+	atomic_store(&slot->sequence, head + 1);
+	WakeSubscribers(segment);
+	return 0;
+}
+
+/**
+ * @brief サブスクライブ
+ * @note サブスクライブした後にパブリッシュされたメッセージから受け取る
+ * @param self インスタンス
+ * @return アカウントID (-1: 空きなし)
+ */
+SubscriptionAccountId SharedMemoryTransport_Subscribe(SharedMemoryTransport_t *self) {
+	if (UNLIKELY(!self || !self->segment)) {
+		return -1;
+	}
+	struct SharedMemorySegment_t *segment = self->segment;
+	for (uint32_t i = 0; i < segment->maxSubscribers; i++) {
+		SharedMemoryCursor_t *cursor = &segment->cursors[i];
+		int32_t owner = NO_OWNER;
+		if (!atomic_compare_exchange_strong(&cursor->owner, &owner, CLAIMING(getpid()))) {
+			continue;
+		}
+		atomic_store(&cursor->position, atomic_load(&segment->head));
+		atomic_store(&cursor->owner, (int32_t)getpid());
+		return i;
+	}
+	return -1;
+}
+
+/**
+ * @brief 購読を辞める
+ * @param self インスタンス
+ * @param id アカウントID
+ */
+void SharedMemoryTransport_Unsubscribe(SharedMemoryTransport_t *self, SubscriptionAccountId id) {
+	SharedMemoryCursor_t *cursor = GetCursor(self, id);
+	if (UNLIKELY(!cursor)) {
+		return;
+	}
+	atomic_store(&cursor->owner, NO_OWNER);
+}
+
+/**
+ * @brief メッセージを受け取る
+ * @attention 1つのアカウントIDを複数のスレッドから同時に使わないこと
+ * @param self インスタンス
+ * @param id アカウントID
+ * @param content 内容 (payloadはNULLになる)
+ * @param buffer ペイロードのコピー先
+ * @param bufferSize コピー先のサイズ
+ * @param timeout タイムアウト[ms] (負: 無限, 0: 待たない)
+ * @return ペイロードのサイズ, -EAGAIN: タイムアウト, -EMSGSIZE: バッファ不足(メッセージは残る),
+ * -EOVERFLOW: 読む前に上書きされた (次は最新のメッセージの後ろから読む)
+ */
+ssize_t SharedMemoryTransport_Receive(SharedMemoryTransport_t *self, SubscriptionAccountId id, PublishContent_t *content, void *buffer, size_t bufferSize, time_t timeout) {
+	SharedMemoryCursor_t *cursor = GetCursor(self, id);
+	if (UNLIKELY(!cursor)) {
+		return -EINVAL;
+	}
+	SharedMemorySlot_t *slot;
+	int ret = WaitForSlot(self->segment, cursor, timeout, &slot);
+	if (ret != 0) {
+		return ret;
+	}
+	size_t payloadSize = slot->payloadSize;
+	if (payloadSize > bufferSize) {
+		return -EMSGSIZE;
+	}
+	if (content) {
+		content->message = slot->message;
+		content->attribute = slot->attribute;
+		content->payload = NULL;
+	}
+	if (payloadSize > 0) {
+		memcpy(buffer, slot->payload, payloadSize);
+	}
+	Advance(cursor);
+	return (ssize_t)payloadSize;
+}
+
+/**
+ * @brief メッセージを受け取り、ローカルのブローカーへ通知する
+ * @note poolがNULLの場合、ペイロードは渡さない
+ * @param self インスタンス
+ * @param id アカウントID
+ * @param broker 通知先
+ * @param pool ペイロードの割り当て元
+ * @param timeout タイムアウト[ms] (負: 無限, 0: 待たない)
+ * @return 0: 成功, -EAGAIN: タイムアウト, -EOVERFLOW: 読む前に上書きされた (次は最新のメッセージの後ろから読む)
+ */
+int SharedMemoryTransport_Dispatch(SharedMemoryTransport_t *self, SubscriptionAccountId id, Broker_t *broker, PublishPayloadPool_t *pool, time_t timeout) {
+	SharedMemoryCursor_t *cursor = GetCursor(self, id);
+	if (UNLIKELY(!cursor || !broker)) {
+		return -EINVAL;
+	}
+	SharedMemorySlot_t *slot;
+	int ret = WaitForSlot(self->segment, cursor, timeout, &slot);
+	if (ret != 0) {
+		return ret;
+	}
+	PublishContent_t content = { .message = slot->message, .attribute = slot->attribute, .payload = NULL };
+	if ((slot->payloadSize > 0) && pool) {
+		content.payload = PublishPayloadPool_Allocate(pool, slot->payloadSize);
+		if (UNLIKELY(!content.payload)) {
+			return -ENOMEM;
+		}
+		memcpy(PublishPayload_Data(content.payload), slot->payload, slot->payloadSize);
+	}
+	Advance(cursor);	// ハンドラが遅くてもリングを塞がないよう、先に進めておく
+	Broker_Publish(broker, &content);
+	PublishPayload_Release(content.payload);
+	return 0;
+}
+
+/**
+ * @brief セグメントを閉じる
+ * @note 作成者が閉じるとセグメントの名前を削除する
+ * @param self インスタンス
+ */
+void SharedMemoryTransport_Close(SharedMemoryTransport_t *self) {
+	if (UNLIKELY(!self)) {
+		return;
+	}
+	if (self->segment) {
+		munmap(self->segment, self->mappedSize);
+	}
+	if (self->owner) {
+		shm_unlink(self->name);
+	}
+	CLEAR(self);
+}
+
@@ -10,6 +10,11 @@
 #include "utilities.h"
 #include "PublisherSubscriber/Subscription.h"
 
+//! 最初に確保するアカウント数
+#define INITIAL_CAPACITY	((size_t)64)
+//! 空きリストの終端
+#define NO_ACCOUNT			((SubscriptionAccountId)-1)
+
  /**
   * @brief アカウントを取得
   * @param self インスタンス
@@ -30,22 +35,67 @@ static inline bool IsMatch(SubscriptionAccount_t *self, PublishMessageAttribute
 	return self->interestedPublish == attribute;
 }
 
+/**
+ * @brief アカウントの領域を広げる
+ * @note 最大アカウント数までは2倍ずつ広げる
+ * @param self インスタンス
+ * @return false: これ以上広げられない
+ */
+static bool Grow(Subscription_t *self) {
+	if (self->capacity >= self->numAccounts) {
+		return false;
+	}
+	size_t newCapacity = self->capacity ? self->capacity * 2 : INITIAL_CAPACITY;
+	if (newCapacity > self->numAccounts) {
+		newCapacity = self->numAccounts;
+	}
+	SubscriptionAccount_t *accounts = realloc(self->accounts, newCapacity * sizeof(SubscriptionAccount_t));
+	if (UNLIKELY(!accounts)) {
+		return false;
+	}
+	memset(&accounts[self->capacity], 0, (newCapacity - self->capacity) * sizeof(SubscriptionAccount_t));
+	self->accounts = accounts;
+	self->capacity = newCapacity;
+	return true;
+}
+
+/**
+ * @brief 空いているアカウントIDを取得
+ * @note 解約されたアカウントを優先して再利用する
+ * @param self インスタンス
+ * @return アカウントID (NO_ACCOUNT: 空きなし)
+ */
+static SubscriptionAccountId TakeFreeId(Subscription_t *self) {
+	if (self->freeHead != NO_ACCOUNT) {
+		SubscriptionAccountId id = self->freeHead;
+		self->freeHead = GetAccount(self, id)->nextFree;
+		return id;
+	}
+	if ((self->used >= self->capacity) && !Grow(self)) {
+		return NO_ACCOUNT;
+	}
+	return self->used++;
+}
+
 /**
  * @brief 初期化
+ * @note アカウントの領域は契約に応じて広げる
  * @param self インスタンス
- * @param numAccounts アカウント数
+ * @param numAccounts 最大アカウント数
  */
 void Subscription_Init(Subscription_t *self, size_t numAccounts) {
 	if (UNLIKELY(!self)) {
 		return;
 	}
 	CLEAR(self);
-	self->accounts = calloc(numAccounts, sizeof(SubscriptionAccount_t));
 	self->numAccounts = numAccounts;
+	self->freeHead = NO_ACCOUNT;
+	Grow(self);
 }
 
 /**
  * @brief サブスクライブ
+ * @attention アカウントの領域を広げるので、取得済みのアカウントの参照は無効になる
  * @param self インスタンス
  * @param subscriber サブスクライバー
  * @param interestedTopic 購読する属性
@@ -55,17 +105,18 @@ SubscriptionAccountId Subscription_Contract(Subscription_t *self, const Subscrib
 	if (UNLIKELY(!self || !subscriber)) {
 		return -1;
 	}
-	for (size_t i = 0; i < self->numAccounts; i++) {
-		SubscriptionAccount_t *account = &self->accounts[i];
-		if (!account->contracted) {
-			account->id = i;
-			account->subscriber = *subscriber;
-			account->interestedPublish = interestedTopic;
-			account->contracted = true;
-			return i;
-		}
+	SubscriptionAccountId id = TakeFreeId(self);
+	if (id == NO_ACCOUNT) {
+		return -1;
 	}
-	return -1;
+	SubscriptionAccount_t *account = GetAccount(self, id);
+	account->id = id;
+	account->subscriber = *subscriber;
+	account->interestedPublish = interestedTopic;
+	account->contracted = true;
+	account->nextFree = NO_ACCOUNT;
+	self->count++;
+	return id;
 }
 
 /**
@@ -74,12 +125,17 @@ SubscriptionAccountId Subscription_Contract(Subscription_t *self, const Subscrib
  * @param id アカウントID
  */
 void Subscription_Cancellation(Subscription_t *self, SubscriptionAccountId id) {
-	if (UNLIKELY(!self || id >= self->numAccounts)) {
+	if (UNLIKELY(!self || id >= self->used)) {
 		return;
 	}
 	SubscriptionAccount_t *account = GetAccount(self, id);
 	if (account->contracted) {
+		size_t generation = account->generation;
 		CLEAR(account);
+		account->generation = generation + 1;
+		account->nextFree = self->freeHead;
+		self->freeHead = id;
+		self->count--;
 	}
 }
 
@@ -90,7 +146,7 @@ void Subscription_Cancellation(Subscription_t *self, SubscriptionAccountId id) {
  * @return アカウント
  */
 SubscriptionAccount_t *Subscription_GetAccount(Subscription_t *self, SubscriptionAccountId id) {
-	if (UNLIKELY(!self || id >= self->numAccounts)) {
+	if (UNLIKELY(!self || id >= self->used)) {
 		return NULL;
 	}
 	SubscriptionAccount_t *account = &self->accounts[id];
@@ -113,7 +169,7 @@ ssize_t Subscription_Match(Subscription_t *self, PublishMessageAttribute message
 		return -1;
 	}
 	size_t bufferIndex = 0;
-	for (SubscriptionAccountId i = 0; i < self->numAccounts; i++) {
+	for (SubscriptionAccountId i = 0; i < self->used; i++) {
 		if (size <= bufferIndex) {
 			return -1;
 		}
@@ -126,6 +182,29 @@ ssize_t Subscription_Match(Subscription_t *self, PublishMessageAttribute message
 	return (ssize_t)bufferIndex;
 }
 
+/**
+ * @brief 購読する内容にマッチする次のアカウントを取得
+ * @note バッファを使わずに走査できる。走査中に契約や解約をしてもよい
+ * @param self インスタンス
+ * @param messageAttribute 属性
+ * @param cursor 走査位置 (最初は0を渡す)
+ * @return アカウント (NULL: もうない)
+ */
+SubscriptionAccount_t *Subscription_NextMatch(Subscription_t *self, PublishMessageAttribute messageAttribute, SubscriptionAccountId *cursor) {
+	if (UNLIKELY(!self || !cursor)) {
+		return NULL;
+	}
+	for (SubscriptionAccountId i = *cursor; i < self->used; i++) {
+		SubscriptionAccount_t *account = GetAccount(self, i);
+		if (account->contracted && IsMatch(account, messageAttribute)) {
+			*cursor = i + 1;
+			return account;
+		}
+	}
+	*cursor = self->used;
+	return NULL;
+}
+
 /**
  * @brief インスタンスを破棄
  * @param self インスタンス
@@ -147,18 +226,5 @@ size_t Subscription_Count(Subscription_t *self) {
 	if (UNLIKELY(!self)) {
 		return 0;
 	}
-	size_t counter = 0;
-	for (SubscriptionAccountId i = 0; i < self->numAccounts; i++) {
-		SubscriptionAccount_t *account = GetAccount(self, i);
-		if (account->contracted) {
-			counter++;
-		}
-	}
-	return counter;
+	return self->count;
 }
-
-
-
-
-
-
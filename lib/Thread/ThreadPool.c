@@ -223,8 +223,29 @@ uint64_t ThreadPool_GetNumTasks(ThreadPool_t *self) {
 	return numTasks;
 }
 
+/**
+ * @brief ワーカースレッド数を取得
+ * @param self インスタンス
+ * @return スレッド数
+ */
+uint16_t ThreadPool_GetNumThreads(ThreadPool_t *self) {
+	g_return_val_if_fail(self, 0);
+	return self->maxNumThreads;
+}
 
-
-
-
-
+/**
+ * @brief 呼び出し元がワーカースレッドかを調べる
+ * @note ワーカーからタスクを積んで終わるのを待つと、空きワーカーが無ければ進まなくなる
+ * @param self インスタンス
+ * @return true: このプールのワーカースレッド
+ */
+bool ThreadPool_IsWorker(ThreadPool_t *self) {
+	g_return_val_if_fail(self, false);
+	GThread *current = g_thread_self();
+	for (uint16_t i = 0; i < self->maxNumThreads; i++) {
+		if (self->workers[i] == current) {
+			return true;
+		}
+	}
+	return false;
+}
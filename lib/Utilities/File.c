@@ -7,6 +7,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
 #include <unistd.h>
@@ -39,20 +41,22 @@ bool File_Exists(const char *path) {
 
 /**
  * @brief ファイル読込み
+ * @note size バイト読めなければ失敗にする (途中でファイルが縮んだ場合も)
  * @param path 
  * @param buffer 
  * @param size 
- * @return 読込みサイズ
+ * @return 0: 成功, 負数: エラーコード (-EIO: 読み込みエラーか、size バイトに足りない)
  */
 int File_Read(const char *path, void *buffer, size_t size) {
 	FILE *fp = fopen(path, "r");
 	if (!fp) return -errno;
-	if (fread(buffer, size, 1, fp) != size) {
-		fclose(fp);
-		return -errno;
+	int ret = 0;
+	if (fread(buffer, 1, size, fp) != size) {
+		// ファイルの終わりに達しただけなら errno は設定されない
+		ret = (ferror(fp) && errno) ? -errno : -EIO;
 	}
 	fclose(fp);
-	return 0;
+	return ret;
 }
 
 int File_Create(const char *path) {
@@ -61,3 +65,63 @@ int File_Create(const char *path) {
 	fclose(fp);
 	return 0;
 }
+
+/**
+ * @brief ファイルをメモリにマッピング
+ * @note MAP_PRIVATEなので書き換えてもファイルには反映されない
+ * @note ファイルの後ろに extraSize バイトの0で埋めた領域を付け足す (番兵用)
+ * @param self インスタンス
+ * @param path ファイルパス
+ * @param extraSize 付け足すサイズ
+ * @return 0: 成功, 負数: エラーコード
+ */
+int File_Map(FileMapping_t *self, const char *path, size_t extraSize) {
+	if (!self || !path) return -EINVAL;
+	memset(self, 0, sizeof(*self));
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return -errno;
+	struct stat st = { 0 };
+	if (fstat(fd, &st) != 0) {
+		int error = -errno;
+		close(fd);
+		return error;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return -ENODATA;
+	}
+	size_t size = (size_t)st.st_size;
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t mappedSize = (size + extraSize + pageSize - 1) & ~(pageSize - 1);
+	// ファイルサイズがページの倍数でも番兵を置けるよう、先に匿名ページで領域を確保してから重ねる
+	void *area = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (area == MAP_FAILED) {
+		int error = -errno;
+		close(fd);
+		return error;
+	}
+	void *data = mmap(area, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+	int error = -errno;
+	close(fd);
+	if (data == MAP_FAILED) {
+		munmap(area, mappedSize);
+		return error;
+	}
+	madvise(data, size, MADV_SEQUENTIAL);
+	madvise(data, size, MADV_WILLNEED);
+	self->data = data;
+	self->size = size;
+	self->mappedSize = mappedSize;
+	return 0;
+}
+
+/**
+ * @brief マッピングを解除
+ * @param self インスタンス
+ */
+void File_Unmap(FileMapping_t *self) {
+	if (!self || !self->data) return;
+	munmap(self->data, self->mappedSize);
+	memset(self, 0, sizeof(*self));
+}
+
@@ -13,10 +13,24 @@ extern "C" {
 #include <unistd.h>
 #include <stdbool.h>
 
+	/**
+	 * @brief メモリにマッピングしたファイル
+	 */
+	typedef struct FileMapping_t {
+		//! 先頭
+		void *data;
+		//! ファイルサイズ
+		size_t size;
+		//! マッピングしたサイズ
+		size_t mappedSize;
+	} FileMapping_t;
+
 	ssize_t File_GetSize(const char *path);
 	bool File_Exists(const char *path);
 	int File_Read(const char *path, void *buffer, size_t size);
 	int File_Create(const char *path);
+	int File_Map(FileMapping_t *self, const char *path, size_t extraSize);
+	void File_Unmap(FileMapping_t *self);
 
 #ifdef __cplusplus
 }
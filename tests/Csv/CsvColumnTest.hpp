@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "CsvTestHelper.hpp"
+#include "Csv/parser/CsvParser.h"
+#include "Csv/content/column/CsvColumn.h"
+#include <cmath>
+#include <cstdlib>
+#include <clocale>
+#include <string>
+
+// NOLINTBEGIN
+
+class CsvColumnTest : public::testing::Test {
+protected:
+	static constexpr CsvProperties_t props = With<CsvProperties_t>([](CsvProperties_t &p) { p.hasHeader = false; });
+	CsvParser_t *parser;
+	CsvColumn_t column;
+	void SetUp() override {
+		parser = CsvParser_Init(&props);
+		ASSERT_NE(nullptr, parser);
+		std::string data{
+			"id,price,active,updated\n"
+			"1,10.5,true,2024-07-12\n"
+			"-9223372036854775808,1e-3,FALSE,2024-07-12T01:02:03Z\n"
+			"12345678901234567,abc,1,2024-02-30\n"
+			"x,-0.25,yes,1970-01-01 00:00:00\n"
+			"9223372036854775808\n"
+		};
+		ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	}
+	void TearDown() override {
+		CsvColumn_Destroy(&column);
+		CsvParser_Destroy(parser);
+	}
+	CsvReturnCode Extract(size_t index, CsvColumnType type) {
+		return CsvColumn_Extract(&column, CsvParser_GetContent(parser), index, type, 1);
+	}
+};
+
+TEST_F(CsvColumnTest, Int64) {
+	ASSERT_EQ(CSV_SUCCESS, Extract(0, CSV_COLUMN_INT64));
+	ASSERT_EQ(5, column.length);
+	EXPECT_EQ(1, column.values.int64s[0]);
+	EXPECT_EQ(INT64_MIN, column.values.int64s[1]);
+	EXPECT_EQ(12345678901234567, column.values.int64s[2]);
+	EXPECT_TRUE(CsvColumn_HasError(&column, 3));
+	EXPECT_EQ(0, column.values.int64s[3]);
+	// 桁あふれ
+	EXPECT_TRUE(CsvColumn_HasError(&column, 4));
+	EXPECT_EQ(2, column.numErrors);
+}
+
+TEST_F(CsvColumnTest, Double) {
+	ASSERT_EQ(CSV_SUCCESS, Extract(1, CSV_COLUMN_DOUBLE));
+	EXPECT_DOUBLE_EQ(10.5, column.values.doubles[0]);
+	EXPECT_DOUBLE_EQ(0.001, column.values.doubles[1]);
+	EXPECT_TRUE(CsvColumn_HasError(&column, 2));
+	EXPECT_DOUBLE_EQ(-0.25, column.values.doubles[3]);
+	// 列が無い行
+	EXPECT_TRUE(CsvColumn_HasError(&column, 4));
+	EXPECT_EQ(2, column.numErrors);
+}
+
+TEST_F(CsvColumnTest, Bool) {
+	ASSERT_EQ(CSV_SUCCESS, Extract(2, CSV_COLUMN_BOOL));
+	EXPECT_TRUE(column.values.bools[0]);
+	EXPECT_FALSE(column.values.bools[1]);
+	EXPECT_TRUE(column.values.bools[2]);
+	EXPECT_TRUE(CsvColumn_HasError(&column, 3));
+	EXPECT_FALSE(CsvColumn_HasError(&column, 0));
+}
+
+TEST_F(CsvColumnTest, Timestamp) {
+	ASSERT_EQ(CSV_SUCCESS, Extract(3, CSV_COLUMN_TIMESTAMP));
+	EXPECT_EQ(1720742400, column.values.timestamps[0]);
+	EXPECT_EQ(1720742400 + 3723, column.values.timestamps[1]);
+	EXPECT_TRUE(CsvColumn_HasError(&column, 2));
+	EXPECT_EQ(0, column.values.timestamps[3]);
+	EXPECT_FALSE(CsvColumn_HasError(&column, 3));
+}
+
+TEST_F(CsvColumnTest, InvalidParameter) {
+	EXPECT_EQ(CSV_INVALID_PARAMETER, CsvColumn_Extract(&column, nullptr, 0, CSV_COLUMN_INT64, 0));
+	EXPECT_EQ(CSV_INVALID_PARAMETER, Extract(0, (CsvColumnType)100));
+}
+
+TEST(CsvColumnParseTest, Int64) {
+	int64_t value;
+	EXPECT_TRUE(CsvColumn_ParseInt64("9223372036854775807", &value));
+	EXPECT_EQ(INT64_MAX, value);
+	EXPECT_TRUE(CsvColumn_ParseInt64("+0012345678", &value));
+	EXPECT_EQ(12345678, value);
+	EXPECT_FALSE(CsvColumn_ParseInt64("", &value));
+	EXPECT_FALSE(CsvColumn_ParseInt64("-", &value));
+	EXPECT_FALSE(CsvColumn_ParseInt64("1234567a", &value));
+	EXPECT_FALSE(CsvColumn_ParseInt64("123456789012345678901", &value));
+}
+
+TEST(CsvColumnParseTest, DoubleMatchesStrtod) {
+	// 高速経路でもstrtodと同じ値になる
+	const char *texts[] = {
+		"0", "-0.0", "3.14159", "1e22", "1e-22", "9007199254740992", "0.1", "123456.789e-3",
+		"1.7976931348623157e308", "4.9e-324", "12345678901234567890.5", "inf", "1E+5",
+	};
+	for (const char *text : texts) {
+		double value;
+		ASSERT_TRUE(CsvColumn_ParseDouble(text, &value)) << text;
+		EXPECT_EQ(strtod(text, nullptr), value) << text;
+	}
+	double value;
+	EXPECT_FALSE(CsvColumn_ParseDouble("", &value));
+	EXPECT_FALSE(CsvColumn_ParseDouble(" 1", &value));
+	EXPECT_FALSE(CsvColumn_ParseDouble("1.0x", &value));
+	EXPECT_FALSE(CsvColumn_ParseDouble(".", &value));
+}
+
+TEST(CsvColumnParseTest, DoubleIgnoresLocale) {
+	// 小数点が ',' のロケールでも '.' を小数点として読む
+	std::string previous = setlocale(LC_NUMERIC, nullptr);
+	const char *names[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8" };
+	bool found = false;
+	for (const char *name : names) {
+		if (setlocale(LC_NUMERIC, name)) {
+			found = true;
+			break;
+		}
+	}
+	if (!found) {
+		GTEST_SKIP() << "no locale with a comma decimal point";
+	}
+	double slow = 0.0;
+	double fast = 0.0;
+	bool slowParsed = CsvColumn_ParseDouble("1.0000000000000001e300", &slow);
+	bool fastParsed = CsvColumn_ParseDouble("0.5", &fast);
+	bool commaParsed = CsvColumn_ParseDouble("12345678901234567890,5", &fast);
+	setlocale(LC_NUMERIC, previous.c_str());
+	ASSERT_TRUE(slowParsed);
+	ASSERT_TRUE(fastParsed);
+	EXPECT_FALSE(commaParsed);
+	EXPECT_EQ(1.0000000000000001e300, slow);
+	EXPECT_EQ(0.5, fast);
+}
+
+// NOLINTEND
@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include "CsvTestHelper.hpp"
+#include "Csv/parser/CsvParser.h"
+#include "Csv/content/CsvContent.h"
+#include "Thread/ThreadPool.h"
+#include <string>
+#include <future>
+#include <chrono>
+
+// NOLINTBEGIN
+
+class CsvParallelParserTest : public::testing::Test {
+protected:
+	static constexpr CsvProperties_t props = With<CsvProperties_t>([](CsvProperties_t &p) { p.hasHeader = false; });
+	ThreadPool_t pool;
+	CsvParser_t *serial;
+	CsvParser_t *parallel;
+	void SetUp() override {
+		ThreadPool_Init(&pool, 4);
+		serial = CsvParser_Init(&props);
+		parallel = CsvParser_Init(&props);
+		CsvParser_SetThreadPool(parallel, &pool);
+	}
+	void TearDown() override {
+		CsvParser_Destroy(serial);
+		CsvParser_Destroy(parallel);
+		ThreadPool_Destroy(&pool, true);
+	}
+	static std::string MakeData(size_t numRows) {
+		std::string data;
+		for (size_t i = 0; i < numRows; i++) {
+			data += "row" + std::to_string(i) + ",abcdefghij," + std::to_string(i * 7) + ((i % 3) ? "\n" : "\r\n");
+		}
+		return data;
+	}
+};
+
+TEST_F(CsvParallelParserTest, SameAsSerial) {
+	std::string data = MakeData(300000);
+	ASSERT_LT(4 * 1024 * 1024, data.length());
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(serial, data.c_str(), data.length()));
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parallel, data.c_str(), data.length()));
+	CsvContent_t *expected = const_cast<CsvContent_t *>(CsvParser_GetContent(serial));
+	CsvContent_t *actual = const_cast<CsvContent_t *>(CsvParser_GetContent(parallel));
+	EXPECT_EQ(300000, actual->lines.length);
+	EXPECT_TRUE(CsvContent_Equals(expected, actual));
+}
+
+TEST_F(CsvParallelParserTest, InvalidCharCodeInLaterChunk) {
+	std::string data = MakeData(300000);
+	data[data.length() - 10] = '\x80';
+	EXPECT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(parallel, data.c_str(), data.length()));
+	EXPECT_EQ(0, CsvParser_GetContent(parallel)->lines.length);
+}
+
+TEST_F(CsvParallelParserTest, EofInEarlierChunk) {
+	// 途中の0xFFは番兵ではなく、逐次にパースした場合と同じく不正な文字コードになる
+	std::string data = MakeData(300000);
+	data[data.length() / 4] = '\xff';
+	EXPECT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(serial, data.c_str(), data.length()));
+	EXPECT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(parallel, data.c_str(), data.length()));
+	EXPECT_EQ(0, CsvContent_GetRowCount(CsvParser_GetContent(parallel)));
+}
+
+TEST_F(CsvParallelParserTest, LoadFromWorker) {
+	// ワーカーが1つだけのプールでも、そのワーカーからパースして止まらない
+	ThreadPool_t single;
+	ThreadPool_Init(&single, 1);
+	CsvParser_SetThreadPool(parallel, &single);
+	std::string data = MakeData(300000);
+	struct Job {
+		CsvParser_t *parser;
+		const std::string *data;
+		std::promise<CsvReturnCode> result;
+	} job = { parallel, &data, {} };
+	std::future<CsvReturnCode> result = job.result.get_future();
+	ThreadPoolTask_t task = { .function = [](void *arg) {
+		Job *job = static_cast<Job *>(arg);
+		job->result.set_value(CsvParser_LoadFromData(job->parser, job->data->c_str(), job->data->length()));
+	}, .arg = &job };
+	ASSERT_EQ(0, ThreadPool_Push(&single, &task));
+	ASSERT_EQ(std::future_status::ready, result.wait_for(std::chrono::seconds(30)));
+	EXPECT_EQ(CSV_SUCCESS, result.get());
+	EXPECT_EQ(300000, CsvParser_GetContent(parallel)->lines.length);
+	CsvParser_SetThreadPool(parallel, &pool);
+	ThreadPool_Destroy(&single, true);
+}
+
+TEST_F(CsvParallelParserTest, QuotedNewlinesAtSplitPoints) {
+	// 分割点が引用符で囲まれた改行の近くにあっても、逐次にパースした場合と同じになる
+	std::string data;
+	for (size_t i = 0; data.length() < 6 * 1024 * 1024; i++) {
+		data += "row" + std::to_string(i) + ",\"quoted\n\"\"field\"\"\n" + std::string(i % 97, 'x') + "\",end\n";
+	}
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(serial, data.c_str(), data.length()));
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parallel, data.c_str(), data.length()));
+	CsvContent_t *expected = const_cast<CsvContent_t *>(CsvParser_GetContent(serial));
+	CsvContent_t *actual = const_cast<CsvContent_t *>(CsvParser_GetContent(parallel));
+	EXPECT_EQ(3, CsvContent_GetColumnCount(actual, 0));
+	EXPECT_TRUE(CsvContent_Equals(expected, actual));
+}
+
+// NOLINTEND
@@ -1,14 +1,16 @@
 #include "gtest/gtest.h"
+#include "CsvTestHelper.hpp"
 #include "Csv/parser/CsvParser.h"
 #include "Csv/content/CsvContent.h"
 #include <string>
 #include <vector>
+#include <unistd.h>
 
 // NOLINTBEGIN
 
 class CsvParserTest : public::testing::Test {
 protected:
-	static constexpr CsvProperties_t props = { .hasHeader = false };
+	static constexpr CsvProperties_t props = With<CsvProperties_t>([](CsvProperties_t &p) { p.hasHeader = false; });
 	CsvParser_t *parser;
 	void SetUp() override {
 		parser = CsvParser_Init(&props);
@@ -31,6 +33,28 @@ protected:
 			}
 		}
 	}
+	static std::vector<CsvItem_t> Items(std::initializer_list<const char *> texts) {
+		std::vector<CsvItem_t> items;
+		for (const char *text : texts) {
+			items.push_back({ .text = const_cast<char *>(text) });	// 比べるだけで書き換えない
+		}
+		return items;
+	}
+	std::string WriteTemporaryFile(const std::string &data) {
+		char path[] = "/tmp/CsvParserTestXXXXXX";
+		int fd = mkstemp(path);
+		EXPECT_LE(0, fd);
+		EXPECT_EQ((ssize_t)data.size(), write(fd, data.data(), data.size()));
+		close(fd);
+		temporaryFiles.push_back(path);
+		return path;
+	}
+	std::vector<std::string> temporaryFiles;
+	~CsvParserTest() {
+		for (auto &path : temporaryFiles) {
+			unlink(path.c_str());
+		}
+	}
 };
 
 TEST_F(CsvParserTest, Scenario1) {
@@ -38,13 +62,13 @@ TEST_F(CsvParserTest, Scenario1) {
 		"title1,title2,title3\n"
 		"abc,def,ghi"
 	};
-	std::vector<CsvItem_t> items0{ {"title1"}, {"title2"}, {"title3"} };
-	std::vector<CsvItem_t> items1{ {"abc"}, {"def"}, {"ghi"}, };
+	std::vector<CsvItem_t> items0 = Items({ "title1", "title2", "title3" });
+	std::vector<CsvItem_t> items1 = Items({ "abc", "def", "ghi" });
 	std::vector<CsvLine_t> lines{
-		{.items = {.list = items0.data(), .length = items0.size()}},
-		{.items = {.list = items1.data(), .length = items1.size()}},
+		{.items = {.list = items0.data(), .length = items0.size(), .capacity = 0}},
+		{.items = {.list = items1.data(), .length = items1.size(), .capacity = 0}},
 	};
-	CsvContent_t content = { {.list = lines.data(), .length = lines.size()} };
+	CsvContent_t content = With<CsvContent_t>([&](CsvContent_t &c) { c.lines = { .list = lines.data(), .length = lines.size(), .capacity = 0 }; });
 
 	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
 
@@ -56,13 +80,13 @@ TEST_F(CsvParserTest, Scenario2) {
 		"title1,title2\r\n"
 		"data1,data2"
 	};
-	std::vector<CsvItem_t> items0{ {"title1"}, {"title2"} };
-	std::vector<CsvItem_t> items1{ {"data1"}, {"data2"} };
+	std::vector<CsvItem_t> items0 = Items({ "title1", "title2" });
+	std::vector<CsvItem_t> items1 = Items({ "data1", "data2" });
 	std::vector<CsvLine_t> lines{
-		{.items = {.list = items0.data(), .length = items0.size()}},
-		{.items = {.list = items1.data(), .length = items1.size()}},
+		{.items = {.list = items0.data(), .length = items0.size(), .capacity = 0}},
+		{.items = {.list = items1.data(), .length = items1.size(), .capacity = 0}},
 	};
-	CsvContent_t content = { {.list = lines.data(), .length = lines.size()} };
+	CsvContent_t content = With<CsvContent_t>([&](CsvContent_t &c) { c.lines = { .list = lines.data(), .length = lines.size(), .capacity = 0 }; });
 
 	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
 	AssertContent(&content);
@@ -73,13 +97,13 @@ TEST_F(CsvParserTest, Scenario3) {
 		"title1,title2,title3\n"
 		"data1"
 	};
-	std::vector<CsvItem_t> items0{ {"title1"}, {"title2"}, {"title3"} };
-	std::vector<CsvItem_t> items1{ {"data1"} };
+	std::vector<CsvItem_t> items0 = Items({ "title1", "title2", "title3" });
+	std::vector<CsvItem_t> items1 = Items({ "data1" });
 	std::vector<CsvLine_t> lines{
-		{.items = {.list = items0.data(), .length = items0.size()}},
-		{.items = {.list = items1.data(), .length = items1.size()}},
+		{.items = {.list = items0.data(), .length = items0.size(), .capacity = 0}},
+		{.items = {.list = items1.data(), .length = items1.size(), .capacity = 0}},
 	};
-	CsvContent_t content = { {.list = lines.data(), .length = lines.size()} };
+	CsvContent_t content = With<CsvContent_t>([&](CsvContent_t &c) { c.lines = { .list = lines.data(), .length = lines.size(), .capacity = 0 }; });
 
 	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
 	AssertContent(&content);
@@ -87,14 +111,8 @@ TEST_F(CsvParserTest, Scenario3) {
 
 TEST_F(CsvParserTest, Scenario4) {
 	std::string data{ "" };
-	std::vector<CsvItem_t> items{ {""} };
-	std::vector<CsvLine_t> lines{
-		{{.list = items.data(), .length = items.size()}}
-	};
-	CsvContent_t content = { {.list = lines.data(), .length = lines.size()} };
-
 	ASSERT_EQ(CSV_INVALID_PARAMETER, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
-	// AssertContent(&content);
+	EXPECT_EQ(0, CsvContent_GetRowCount(CsvParser_GetContent(parser)));
 }
 
 TEST_F(CsvParserTest, Scenario5) {
@@ -105,15 +123,15 @@ TEST_F(CsvParserTest, Scenario5) {
 	 *  data1,data2\r\n
 	 *  EOF
 	*/
-	std::vector<CsvItem_t> items0{ {"scenario5"} };
-	std::vector<CsvItem_t> items1{ {"title1"}, {"title2"} };
-	std::vector<CsvItem_t> items2{ {"data1"}, {"data2"} };
+	std::vector<CsvItem_t> items0 = Items({ "scenario5" });
+	std::vector<CsvItem_t> items1 = Items({ "title1", "title2" });
+	std::vector<CsvItem_t> items2 = Items({ "data1", "data2" });
 	std::vector<CsvLine_t> lines{
-		{{.list = items0.data(), .length = items0.size()}},
-		{{.list = items1.data(), .length = items1.size()}},
-		{{.list = items2.data(), .length = items2.size()}},
+		{{.list = items0.data(), .length = items0.size(), .capacity = 0}},
+		{{.list = items1.data(), .length = items1.size(), .capacity = 0}},
+		{{.list = items2.data(), .length = items2.size(), .capacity = 0}},
 	};
-	CsvContent_t content{ {.list = lines.data(), .length = lines.size()} };
+	CsvContent_t content = With<CsvContent_t>([&](CsvContent_t &c) { c.lines = { .list = lines.data(), .length = lines.size(), .capacity = 0 }; });
 	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFile(parser, "/home/atohs/C/CUtils/tests/Csv/input.csv"));
 	AssertContent(&content);
 }
@@ -123,7 +141,304 @@ TEST_F(CsvParserTest, Scenario6) {
 		"タイトル1,title2"
 		"データ1,data2"
 	};
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(1, CsvContent_GetRowCount(content));
+	ASSERT_EQ(3, CsvContent_GetColumnCount(content, 0));
+	EXPECT_STREQ("タイトル1", CsvContent_GetText(content, 0, 0));
+	EXPECT_STREQ("title2データ1", CsvContent_GetText(content, 0, 1));
+	EXPECT_STREQ("data2", CsvContent_GetText(content, 0, 2));
+}
+
+TEST_F(CsvParserTest, LoadFromMappedFile) {
+	std::string path = WriteTemporaryFile(
+		"title1,title2\r\n"
+		"data1,data2\r\n"
+	);
+	std::vector<CsvItem_t> items0 = Items({ "title1", "title2" });
+	std::vector<CsvItem_t> items1 = Items({ "data1", "data2" });
+	std::vector<CsvLine_t> lines{
+		{{.list = items0.data(), .length = items0.size(), .capacity = 0}},
+		{{.list = items1.data(), .length = items1.size(), .capacity = 0}},
+	};
+	CsvContent_t content = With<CsvContent_t>([&](CsvContent_t &c) { c.lines = { .list = lines.data(), .length = lines.size(), .capacity = 0 }; });
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFile(parser, path.c_str()));
+	AssertContent(&content);
+}
+
+TEST_F(CsvParserTest, LoadFromPageSizedFile) {
+	// ファイルサイズがページの倍数でも番兵を置ける
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	std::string last(pageSize - 4, 'a');
+	std::string path = WriteTemporaryFile("a,b\n" + last);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFile(parser, path.c_str()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(2, content->lines.length);
+	ASSERT_EQ(1, content->lines.list[1].items.length);
+	EXPECT_EQ(last, content->lines.list[1].items.list[0].text);
+}
+
+TEST_F(CsvParserTest, LoadFromEmptyFile) {
+	std::string path = WriteTemporaryFile("");
+	EXPECT_EQ(CSV_INVALID_PARAMETER, CsvParser_LoadFromFile(parser, path.c_str()));
+	EXPECT_EQ(CSV_INVALID_PARAMETER, CsvParser_LoadFromFile(parser, "/nonexistent/input.csv"));
+}
+
+TEST_F(CsvParserTest, Reload) {
+	// 読み込み直すと前のデータとパース結果を捨てる
+	std::string path = WriteTemporaryFile("a,b\nc,d\n");
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFile(parser, path.c_str()));
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFile(parser, path.c_str()));
+	EXPECT_EQ(2, CsvContent_GetRowCount(CsvParser_GetContent(parser)));
+	std::string data = "x\n";
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(1, CsvContent_GetRowCount(content));
+	EXPECT_STREQ("x", CsvContent_GetText(content, 0, 0));
+}
+
+TEST_F(CsvParserTest, FieldsAcrossBlocks) {
+	// 64バイトごとにまとめて調べるので、区切りがブロックの境目をまたいでも正しく分ける
+	std::string field1(63, 'a');
+	std::string field2(100, 'b');
+	std::string data = field1 + "\r\n" + field2 + "," + field1 + "\n" + "x";
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(3, content->lines.length);
+	ASSERT_EQ(1, content->lines.list[0].items.length);
+	EXPECT_EQ(field1, content->lines.list[0].items.list[0].text);
+	ASSERT_EQ(2, content->lines.list[1].items.length);
+	EXPECT_EQ(field2, content->lines.list[1].items.list[0].text);
+	EXPECT_EQ(field1, content->lines.list[1].items.list[1].text);
+	EXPECT_STREQ("x", content->lines.list[2].items.list[0].text);
+}
+
+TEST_F(CsvParserTest, InvalidCharCodeAfterFirstBlock) {
+	std::string data = std::string(200, 'a') + ",\x80\n";
+	ASSERT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	EXPECT_EQ(0, CsvParser_GetContent(parser)->lines.length);
+}
+
+TEST_F(CsvParserTest, StrayEofByte) {
+	// 番兵と同じ0xFFがデータの途中にあっても、そこで打ち切らない
+	std::string data = "a,b\n\xff" "c,d\ne,f\n";
 	ASSERT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	EXPECT_EQ(0, CsvParser_GetContent(parser)->lines.length);
+	std::string last = "a,b\nc,d\xff\n";
+	EXPECT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(parser, last.c_str(), last.length()));
+}
+
+TEST_F(CsvParserTest, AccessByIndex) {
+	std::string data{
+		"a,b,c\r\n"
+		"d\n"
+		"\n"
+		"e,f"
+	};
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(4, CsvContent_GetRowCount(content));
+	EXPECT_EQ(3, CsvContent_GetColumnCount(content, 0));
+	EXPECT_EQ(1, CsvContent_GetColumnCount(content, 1));
+	EXPECT_EQ(1, CsvContent_GetColumnCount(content, 2));
+	EXPECT_EQ(2, CsvContent_GetColumnCount(content, 3));
+	EXPECT_STREQ("c", CsvContent_GetText(content, 0, 2));
+	EXPECT_STREQ("d", CsvContent_GetText(content, 1, 0));
+	EXPECT_STREQ("", CsvContent_GetText(content, 2, 0));
+	EXPECT_STREQ("f", CsvContent_GetText(content, 3, 1));
+	// 全行のアイテムは1つの配列に並ぶ
+	EXPECT_EQ(7, content->items.length);
+	EXPECT_EQ(&content->items.list[3], content->lines.list[1].items.list);
+	// 範囲外
+	EXPECT_EQ(0, CsvContent_GetColumnCount(content, 4));
+	EXPECT_EQ(nullptr, CsvContent_GetText(content, 0, 3));
+	EXPECT_EQ(nullptr, CsvContent_GetText(content, 4, 0));
+}
+
+TEST_F(CsvParserTest, QuotedFields) {
+	std::string data{
+		"\"a,b\",plain,\"say \"\"hi\"\"\"\r\n"
+		"\"multi\nline\",\"\",\"\"\"\"\n"
+		"\"x\"y,z"
+	};
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(3, CsvContent_GetRowCount(content));
+	ASSERT_EQ(3, CsvContent_GetColumnCount(content, 0));
+	EXPECT_STREQ("a,b", CsvContent_GetText(content, 0, 0));
+	EXPECT_STREQ("plain", CsvContent_GetText(content, 0, 1));
+	EXPECT_STREQ("say \"hi\"", CsvContent_GetText(content, 0, 2));
+	ASSERT_EQ(3, CsvContent_GetColumnCount(content, 1));
+	EXPECT_STREQ("multi\nline", CsvContent_GetText(content, 1, 0));
+	EXPECT_STREQ("", CsvContent_GetText(content, 1, 1));
+	EXPECT_STREQ("\"", CsvContent_GetText(content, 1, 2));
+	// 閉じ引用符の後ろの文字はそのまま残す
+	ASSERT_EQ(2, CsvContent_GetColumnCount(content, 2));
+	EXPECT_STREQ("xy", CsvContent_GetText(content, 2, 0));
+	EXPECT_STREQ("z", CsvContent_GetText(content, 2, 1));
+}
+
+TEST_F(CsvParserTest, QuotedFieldAcrossBlocks) {
+	// 囲まれた範囲がブロックをまたいでも、区切り文字と改行文字はフィールドの一部になる
+	std::string text = std::string(70, 'a') + "," + std::string(70, '\n');
+	std::string data = "x,\"" + text + "\"\"\",y\n";
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(1, CsvContent_GetRowCount(content));
+	ASSERT_EQ(3, CsvContent_GetColumnCount(content, 0));
+	EXPECT_EQ(text + "\"", CsvContent_GetText(content, 0, 1));
+	EXPECT_STREQ("y", CsvContent_GetText(content, 0, 2));
+}
+
+TEST_F(CsvParserTest, UnterminatedQuote) {
+	std::string data{ "a,b\n\"c,d\n" };
+	EXPECT_EQ(CSV_INVALID_FORMAT, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	EXPECT_EQ(0, CsvContent_GetRowCount(CsvParser_GetContent(parser)));
+}
+
+TEST_F(CsvParserTest, Delimiter) {
+	const CsvProperties_t tsv = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.delimiter = '\t'; });
+	CsvParser_t *tsvParser = CsvParser_Init(&tsv);
+	ASSERT_NE(nullptr, tsvParser);
+	std::string data{ "a,b\tc\n\"d\te\"\tf\n" };
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(tsvParser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(tsvParser);
+	ASSERT_EQ(2, CsvContent_GetRowCount(content));
+	EXPECT_STREQ("a,b", CsvContent_GetText(content, 0, 0));
+	EXPECT_STREQ("c", CsvContent_GetText(content, 0, 1));
+	EXPECT_STREQ("d\te", CsvContent_GetText(content, 1, 0));
+	EXPECT_STREQ("f", CsvContent_GetText(content, 1, 1));
+	CsvParser_Destroy(tsvParser);
+}
+
+TEST_F(CsvParserTest, EscapeChar) {
+	const CsvProperties_t escaped = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.escape = '\\'; });
+	CsvParser_t *escapedParser = CsvParser_Init(&escaped);
+	ASSERT_NE(nullptr, escapedParser);
+	// エスケープされた区切り文字、改行文字、引用符はフィールドの一部になる
+	std::string data = std::string(60, 'x') + "a\\,b,\"c\\\"d\",e\\\nf,g\\\\\n";
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(escapedParser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(escapedParser);
+	ASSERT_EQ(1, CsvContent_GetRowCount(content));
+	ASSERT_EQ(4, CsvContent_GetColumnCount(content, 0));
+	EXPECT_EQ(std::string(60, 'x') + "a,b", CsvContent_GetText(content, 0, 0));
+	EXPECT_STREQ("c\"d", CsvContent_GetText(content, 0, 1));
+	EXPECT_STREQ("e\nf", CsvContent_GetText(content, 0, 2));
+	EXPECT_STREQ("g\\", CsvContent_GetText(content, 0, 3));
+	CsvParser_Destroy(escapedParser);
+}
+
+TEST_F(CsvParserTest, InvalidDialect) {
+	const CsvProperties_t sameChars = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.delimiter = '"'; });
+	EXPECT_EQ(nullptr, CsvParser_Init(&sameChars));
+	const CsvProperties_t lineFeed = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.delimiter = '\n'; });
+	EXPECT_EQ(nullptr, CsvParser_Init(&lineFeed));
+}
+
+TEST_F(CsvParserTest, CommentLines) {
+	const CsvProperties_t commented = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; p.comment = '#'; });
+	CsvParser_t *commentedParser = CsvParser_Init(&commented);
+	ASSERT_NE(nullptr, commentedParser);
+	// コメント行の引用符は数えない
+	std::string data{
+		"# \"header\n"
+		"name,value\n"
+		"#a,\"b\n"
+		"x,1\n"
+		"y,#2\n"
+		"# end"
+	};
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(commentedParser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(commentedParser);
+	ASSERT_EQ(3, CsvContent_GetRowCount(content));
+	EXPECT_STREQ("name", CsvContent_GetText(content, 0, 0));
+	EXPECT_STREQ("x", CsvContent_GetText(content, 1, 0));
+	EXPECT_STREQ("#2", CsvContent_GetText(content, 2, 1));
+	size_t column;
+	ASSERT_TRUE(CsvContent_FindColumn(content, "value", &column));
+	EXPECT_EQ(1, column);
+	CsvParser_Destroy(commentedParser);
+}
+
+TEST_F(CsvParserTest, Utf8AcrossBlocks) {
+	// 文字がブロックの境界をまたいでもよい
+	std::string text;
+	for (int i = 0; i < 50; i++) {
+		text += "あ\xf0\x9f\x98\x80";
+	}
+	std::string data = "a" + text + ",b\n";
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	EXPECT_EQ("a" + text, CsvContent_GetText(CsvParser_GetContent(parser), 0, 0));
+}
+
+TEST_F(CsvParserTest, InvalidUtf8) {
+	std::vector<std::string> invalid{
+		"\xc0\xaf",			// 冗長な2バイト文字
+		"\xe0\x80\xaf",		// 冗長な3バイト文字
+		"\xed\xa0\x80",		// サロゲート
+		"\xf4\x90\x80\x80",	// U+10FFFFを超える
+		"\xe3\x81",			// 文字の途中で終わる
+	};
+	for (auto &text : invalid) {
+		std::string data = std::string(62, 'a') + "," + text;
+		EXPECT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(parser, data.c_str(), data.length())) << data;
+		EXPECT_EQ(0, CsvContent_GetRowCount(CsvParser_GetContent(parser)));
+		CsvParser_Destroy(parser);
+		parser = CsvParser_Init(&props);
+	}
+}
+
+class CsvContentTest : public::testing::Test {
+protected:
+	CsvContent_t content;
+	char a[2] = "a", b[2] = "b", c[2] = "c", x[2] = "x";
+	void SetUp() override {
+		CsvContent_Init(&content);
+		CsvContent_AddItem(&content, a);
+		CsvContent_AddItem(&content, b);
+		CsvContent_EndLine(&content);
+		CsvContent_AddItem(&content, c);
+		CsvContent_EndLine(&content);
+		CsvContent_Finalize(&content);
+	}
+	void TearDown() override {
+		CsvContent_Destroy(&content);
+	}
+};
+
+TEST_F(CsvContentTest, ModifyViewCopiesItems) {
+	// 行は全行のアイテムの配列を参照するビューなので、書き換えるときは自分の領域に写す
+	CsvLine_t *line = &content.lines.list[0];
+	CsvItem_t item = { .text = x };
+	CsvLine_MoveBackItem(line, &item);
+	ASSERT_EQ(3, CsvContent_GetColumnCount(&content, 0));
+	EXPECT_STREQ("a", CsvContent_GetText(&content, 0, 0));
+	EXPECT_STREQ("b", CsvContent_GetText(&content, 0, 1));
+	EXPECT_STREQ("x", CsvContent_GetText(&content, 0, 2));
+	ASSERT_EQ(1, CsvContent_GetColumnCount(&content, 1));
+	EXPECT_STREQ("c", CsvContent_GetText(&content, 1, 0));
+
+	CsvItemCollection_Clear(&content.lines.list[1].items);
+	EXPECT_EQ(0, CsvContent_GetColumnCount(&content, 1));
+	EXPECT_EQ(c, content.items.list[2].text);	// 参照先は書き換えない
+}
+
+TEST_F(CsvContentTest, AddAfterFinalizeFails) {
+	// 追加するとアイテムの配列が移動して、行の参照が無効になる
+	for (int i = 0; i < 100; i++) {
+		EXPECT_FALSE(CsvContent_AddItem(&content, x));
+	}
+	EXPECT_FALSE(CsvContent_EndLine(&content));
+	CsvContent_t other;
+	CsvContent_Init(&other);
+	CsvContent_AddItem(&other, x);
+	CsvContent_EndLine(&other);
+	EXPECT_FALSE(CsvContent_MoveBackContent(&content, &other));
+	CsvContent_Destroy(&other);
+
+	ASSERT_EQ(2, CsvContent_GetRowCount(&content));
+	EXPECT_STREQ("b", CsvContent_GetText(&content, 0, 1));
+	EXPECT_STREQ("c", CsvContent_GetText(&content, 1, 0));
 }
 
 // NOLINTEND
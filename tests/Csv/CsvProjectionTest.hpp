@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+#include "CsvTestHelper.hpp"
+#include "Csv/parser/CsvParser.h"
+#include "Csv/content/CsvContent.h"
+#include "Thread/ThreadPool.h"
+#include <string>
+#include <vector>
+
+// NOLINTBEGIN
+
+class CsvProjectionTest : public::testing::Test {
+protected:
+	CsvParser_t *parser = nullptr;
+	std::string data{
+		"id,name,price,region\n"
+		"1,apple,120,north\n"
+		"2,\"banana, ripe\",80,south\n"
+		"3,cherry,300,north\n"
+		"4,date\n"
+	};
+	void TearDown() override {
+		CsvParser_Destroy(parser);
+	}
+	CsvReturnCode Load(const CsvProperties_t &props) {
+		parser = CsvParser_Init(&props);
+		EXPECT_NE(nullptr, parser);
+		return CsvParser_LoadFromData(parser, data.c_str(), data.length());
+	}
+	std::vector<std::vector<std::string>> Rows() {
+		std::vector<std::vector<std::string>> rows;
+		const CsvContent_t *content = CsvParser_GetContent(parser);
+		for (size_t i = 0; i < CsvContent_GetRowCount(content); i++) {
+			std::vector<std::string> row;
+			for (size_t j = 0; j < CsvContent_GetColumnCount(content, i); j++) {
+				row.push_back(CsvContent_GetText(content, i, j));
+			}
+			rows.push_back(row);
+		}
+		return rows;
+	}
+};
+
+TEST_F(CsvProjectionTest, ColumnsByIndex) {
+	const size_t columns[] = { 2, 1 };
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; p.columns = columns; p.numColumns = 2; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	std::vector<std::vector<std::string>> expected{
+		{ "price", "name" }, { "120", "apple" }, { "80", "banana, ripe" }, { "300", "cherry" }, { "", "date" },
+	};
+	EXPECT_EQ(expected, Rows());
+}
+
+TEST_F(CsvProjectionTest, ColumnsByName) {
+	const char *names[] = { "region", "id" };
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; p.columnNames = names; p.numColumns = 2; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	std::vector<std::vector<std::string>> expected{
+		{ "region", "id" }, { "north", "1" }, { "south", "2" }, { "north", "3" }, { "", "4" },
+	};
+	EXPECT_EQ(expected, Rows());
+}
+
+TEST_F(CsvProjectionTest, Predicates) {
+	const size_t columns[] = { 1 };
+	const CsvPredicate_t predicates[] = {
+		{ .column = 0, .columnName = "region", .op = CSV_PREDICATE_EQUAL, .value = "north" },
+		{ .column = 2, .columnName = NULL, .op = CSV_PREDICATE_GREATER_THAN, .value = "100" },
+	};
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; p.columns = columns; p.numColumns = 1; p.predicates = predicates; p.numPredicates = 2; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	std::vector<std::vector<std::string>> expected{ { "name" }, { "apple" }, { "cherry" } };
+	EXPECT_EQ(expected, Rows());
+}
+
+TEST_F(CsvProjectionTest, PredicatesWithoutProjection) {
+	// 条件を満たさない行や条件の列が無い行は、追加しかけたアイテムごと捨てる
+	const CsvPredicate_t predicates[] = { { .column = 2, .columnName = NULL, .op = CSV_PREDICATE_LESS_THAN, .value = "200" } };
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.predicates = predicates; p.numPredicates = 1; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	std::vector<std::vector<std::string>> expected{
+		{ "1", "apple", "120", "north" }, { "2", "banana, ripe", "80", "south" },
+	};
+	EXPECT_EQ(expected, Rows());
+	EXPECT_EQ(8, CsvParser_GetContent(parser)->items.length);
+}
+
+TEST_F(CsvProjectionTest, InvalidProperties) {
+	const char *names[] = { "missing" };
+	CsvProperties_t byMissingName = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; p.columnNames = names; p.numColumns = 1; });
+	EXPECT_EQ(CSV_INVALID_PARAMETER, Load(byMissingName));
+	EXPECT_EQ(0, CsvContent_GetRowCount(CsvParser_GetContent(parser)));
+	CsvParser_Destroy(parser);
+	CsvProperties_t withoutHeader = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.columnNames = names; p.numColumns = 1; });
+	EXPECT_EQ(CSV_INVALID_PARAMETER, Load(withoutHeader));
+	CsvParser_Destroy(parser);
+	parser = nullptr;
+	const CsvPredicate_t predicates[] = { { .column = 0, .columnName = NULL, .op = CSV_PREDICATE_LESS_THAN, .value = "abc" } };
+	CsvProperties_t notNumber = With<CsvProperties_t>([&](CsvProperties_t &p) { p.predicates = predicates; p.numPredicates = 1; });
+	EXPECT_EQ(nullptr, CsvParser_Init(&notNumber));
+}
+
+TEST_F(CsvProjectionTest, SameAsSerialInParallel) {
+	data = "id,name,value\n";
+	for (size_t i = 0; data.length() < 6 * 1024 * 1024; i++) {
+		data += std::to_string(i) + ",\"name " + std::to_string(i) + "\"," + std::to_string(i % 10) + "\n";
+	}
+	const size_t columns[] = { 1 };
+	const CsvPredicate_t predicates[] = { { .column = 0, .columnName = "value", .op = CSV_PREDICATE_EQUAL, .value = "3" } };
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; p.columns = columns; p.numColumns = 1; p.predicates = predicates; p.numPredicates = 1; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	auto expected = Rows();
+	CsvParser_Destroy(parser);
+	ThreadPool_t pool;
+	ThreadPool_Init(&pool, 4);
+	parser = CsvParser_Init(&props);
+	CsvParser_SetThreadPool(parser, &pool);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	EXPECT_EQ(expected, Rows());
+	EXPECT_EQ("name 3", Rows()[1][0]);
+	ThreadPool_Destroy(&pool, true);
+}
+
+TEST_F(CsvProjectionTest, FindColumnByName) {
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	size_t column;
+	ASSERT_TRUE(CsvContent_FindColumn(content, "price", &column));
+	EXPECT_EQ(2, column);
+	EXPECT_STREQ("300", CsvContent_GetText(content, 3, column));
+	EXPECT_FALSE(CsvContent_FindColumn(content, "missing", &column));
+}
+
+TEST_F(CsvProjectionTest, FindProjectedColumnByName) {
+	// 選んだ列の並びでの位置を返す
+	const char *names[] = { "region", "name" };
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; p.columnNames = names; p.numColumns = 2; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	size_t column;
+	ASSERT_TRUE(CsvContent_FindColumn(CsvParser_GetContent(parser), "name", &column));
+	EXPECT_EQ(1, column);
+	EXPECT_FALSE(CsvContent_FindColumn(CsvParser_GetContent(parser), "price", &column));
+}
+
+TEST_F(CsvProjectionTest, FindColumnWithoutHeader) {
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	size_t column;
+	EXPECT_FALSE(CsvContent_FindColumn(CsvParser_GetContent(parser), "id", &column));
+}
+
+TEST_F(CsvProjectionTest, FindColumnInWideHeader) {
+	data.clear();
+	for (size_t i = 0; i < 500; i++) {
+		data += (i ? "," : "") + std::string("column_with_a_long_name_") + std::to_string(i);
+	}
+	data += "\n";
+	CsvProperties_t props = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; });
+	ASSERT_EQ(CSV_SUCCESS, Load(props));
+	for (size_t i = 0; i < 500; i++) {
+		size_t column;
+		std::string name = "column_with_a_long_name_" + std::to_string(i);
+		ASSERT_TRUE(CsvContent_FindColumn(CsvParser_GetContent(parser), name.c_str(), &column));
+		EXPECT_EQ(i, column);
+	}
+}
+
+// NOLINTEND
@@ -0,0 +1,190 @@
+#include "gtest/gtest.h"
+#include "CsvTestHelper.hpp"
+#include "Csv/parser/CsvParser.h"
+#include "Csv/content/CsvContent.h"
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// NOLINTBEGIN
+
+class CsvRowIndexTest : public::testing::Test {
+protected:
+	static constexpr CsvProperties_t props = With<CsvProperties_t>([](CsvProperties_t &p) { p.hasHeader = false; });
+	static constexpr CsvProperties_t lazyProps = With<CsvProperties_t>([](CsvProperties_t &p) { p.hasHeader = false; p.isLazy = true; });
+	CsvParser_t *eager;
+	CsvParser_t *lazy;
+	std::vector<std::string> paths;
+	void SetUp() override {
+		eager = CsvParser_Init(&props);
+		lazy = CsvParser_Init(&lazyProps);
+		ASSERT_NE(nullptr, lazy);
+	}
+	void TearDown() override {
+		CsvParser_Destroy(eager);
+		CsvParser_Destroy(lazy);
+		for (auto &path : paths) {
+			unlink(path.c_str());
+		}
+	}
+	std::string MakeFile(const std::string &data) {
+		char path[] = "/tmp/CsvRowIndexTestXXXXXX";
+		int fd = mkstemp(path);
+		EXPECT_LE(0, fd);
+		EXPECT_EQ((ssize_t)data.length(), write(fd, data.c_str(), data.length()));
+		close(fd);
+		paths.push_back(path);
+		paths.push_back(std::string(path) + ".idx");
+		return path;
+	}
+	static void ExpectSameContent(const CsvContent_t *expected, const CsvContent_t *actual) {
+		ASSERT_EQ(CsvContent_GetRowCount(expected), CsvContent_GetRowCount(actual));
+		for (size_t row = 0; row < CsvContent_GetRowCount(expected); row++) {
+			ASSERT_EQ(CsvContent_GetColumnCount(expected, row), CsvContent_GetColumnCount(actual, row)) << row;
+			for (size_t column = 0; column < CsvContent_GetColumnCount(expected, row); column++) {
+				EXPECT_STREQ(CsvContent_GetText(expected, row, column), CsvContent_GetText(actual, row, column)) << row;
+			}
+		}
+	}
+};
+
+TEST_F(CsvRowIndexTest, SameAsEager) {
+	std::string data = "a,\"b,\r\nc\",d\r\n\n\"\"\"q\"\"\",,\nlast,\"x\"";
+	for (int i = 0; i < 1000; i++) {
+		data += "\nrow" + std::to_string(i) + ",\"quoted\nfield\"," + std::to_string(i);
+	}
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(eager, data.c_str(), data.length()));
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(lazy, data.c_str(), data.length()));
+	ExpectSameContent(CsvParser_GetContent(eager), CsvParser_GetContent(lazy));
+}
+
+TEST_F(CsvRowIndexTest, RandomAccess) {
+	std::string data;
+	for (int i = 0; i < 5000; i++) {
+		data += std::to_string(i) + ",text" + std::to_string(i) + "\r\n";
+	}
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(lazy, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(lazy);
+	ASSERT_EQ(5000, CsvContent_GetRowCount(content));
+	std::mt19937 random(1);
+	for (int i = 0; i < 1000; i++) {
+		size_t row = random() % 5000;
+		EXPECT_EQ(std::to_string(row), CsvContent_GetText(content, row, 0));
+		EXPECT_EQ("text" + std::to_string(row), CsvContent_GetText(content, row, 1));
+	}
+	EXPECT_EQ(nullptr, CsvContent_GetText(content, 5000, 0));
+	EXPECT_EQ(0, CsvContent_GetColumnCount(content, 5000));
+}
+
+TEST_F(CsvRowIndexTest, HeaderAndDialect) {
+	const CsvProperties_t dialect = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = true; p.delimiter = ';'; p.escape = '\\'; p.comment = '#'; p.isLazy = true; });
+	CsvParser_t *parser = CsvParser_Init(&dialect);
+	std::string data = "# comment \"\nid;name\n1;a\\;b\n# skipped\n2;\"c\nd\"\n";
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(3, CsvContent_GetRowCount(content));
+	size_t column = 0;
+	ASSERT_TRUE(CsvContent_FindColumn(content, "name", &column));
+	EXPECT_EQ(1, column);
+	EXPECT_STREQ("a;b", CsvContent_GetText(content, 1, column));
+	EXPECT_STREQ("c\nd", CsvContent_GetText(content, 2, column));
+	EXPECT_STREQ("id", CsvContent_GetText(content, 0, 0));
+	CsvParser_Destroy(parser);
+}
+
+TEST_F(CsvRowIndexTest, InvalidData) {
+	std::string unclosed = "a,\"b\nc";
+	EXPECT_EQ(CSV_INVALID_FORMAT, CsvParser_LoadFromData(lazy, unclosed.c_str(), unclosed.length()));
+	EXPECT_EQ(0, CsvContent_GetRowCount(CsvParser_GetContent(lazy)));
+	std::string invalid = "a,\xe3\x81\nb";
+	EXPECT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(lazy, invalid.c_str(), invalid.length()));
+	std::string stray = "a,b\n\xff" "c,d\ne,f\n";
+	EXPECT_EQ(CSV_INVALID_CHAR_CODE, CsvParser_LoadFromData(lazy, stray.c_str(), stray.length()));
+	EXPECT_EQ(0, CsvContent_GetRowCount(CsvParser_GetContent(lazy)));
+
+	// 列の選択と一緒には使えない
+	const size_t columns[] = { 0 };
+	const CsvProperties_t projection = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.columns = columns; p.numColumns = 1; p.isLazy = true; });
+	EXPECT_EQ(nullptr, CsvParser_Init(&projection));
+}
+
+TEST_F(CsvRowIndexTest, SidecarIndex) {
+	std::string data;
+	for (int i = 0; i < 3000; i++) {
+		data += std::to_string(i) + ",\"a\nb\"\n";
+	}
+	std::string path = MakeFile(data);
+	std::string indexPath = path + ".idx";
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFileWithIndex(lazy, path.c_str(), indexPath.c_str()));
+	ASSERT_EQ(3000, CsvContent_GetRowCount(CsvParser_GetContent(lazy)));
+	struct stat st;
+	ASSERT_EQ(0, stat(indexPath.c_str(), &st));
+	EXPECT_EQ(64 + 3000 * 8, st.st_size);
+
+	// 保存した索引をそのまま使う
+	CsvParser_t *reader = CsvParser_Init(&lazyProps);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFileWithIndex(reader, path.c_str(), indexPath.c_str()));
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(eager, data.c_str(), data.length()));
+	ExpectSameContent(CsvParser_GetContent(eager), CsvParser_GetContent(reader));
+	CsvParser_Destroy(reader);
+
+	// 区切り文字が違えば作り直す
+	const CsvProperties_t other = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.delimiter = ';'; p.isLazy = true; });
+	reader = CsvParser_Init(&other);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFileWithIndex(reader, path.c_str(), indexPath.c_str()));
+	EXPECT_STREQ("0,\"a\nb\"", CsvContent_GetText(CsvParser_GetContent(reader), 0, 0));
+	CsvParser_Destroy(reader);
+}
+
+TEST_F(CsvRowIndexTest, StaleSidecarIndex) {
+	std::string path = MakeFile("a\nb\nc\n");
+	std::string indexPath = path + ".idx";
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFile(lazy, path.c_str()));
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_SaveIndex(lazy, indexPath.c_str()));
+
+	// 元のファイルが変わった
+	std::ofstream(path) << "x,y\nzz\n";
+	CsvParser_t *reader = CsvParser_Init(&lazyProps);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFileWithIndex(reader, path.c_str(), indexPath.c_str()));
+	const CsvContent_t *content = CsvParser_GetContent(reader);
+	ASSERT_EQ(2, CsvContent_GetRowCount(content));
+	EXPECT_STREQ("y", CsvContent_GetText(content, 0, 1));
+	EXPECT_STREQ("zz", CsvContent_GetText(content, 1, 0));
+	CsvParser_Destroy(reader);
+
+	// データから読み込んだ場合は保存できない
+	CsvParser_t *fromData = CsvParser_Init(&lazyProps);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(fromData, "a\n", 2));
+	EXPECT_EQ(CSV_INVALID_PARAMETER, CsvParser_SaveIndex(fromData, indexPath.c_str()));
+	CsvParser_Destroy(fromData);
+
+	// ファイルの後にデータを読み込み直しても保存できない
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(lazy, "a\n", 2));
+	EXPECT_EQ(1, CsvContent_GetRowCount(CsvParser_GetContent(lazy)));
+	EXPECT_EQ(CSV_INVALID_PARAMETER, CsvParser_SaveIndex(lazy, indexPath.c_str()));
+}
+
+TEST_F(CsvRowIndexTest, TrailingLineBreaksInFile) {
+	// マッピングした末尾の改行は書き換えずに長さから外すだけなので、読み込んだ結果はデータから読んだときと同じになる
+	std::string data = "a,b\r\nc,\"d\"\r\n\r\n\n";
+	for (int i = 0; i < 100; i++) {
+		data += "\n";
+	}
+	std::string path = MakeFile(data);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(eager, data.c_str(), data.length()));
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromFile(lazy, path.c_str()));
+	ASSERT_EQ(2, CsvContent_GetRowCount(CsvParser_GetContent(lazy)));
+	ExpectSameContent(CsvParser_GetContent(eager), CsvParser_GetContent(lazy));
+
+	std::string unclosed = "a,\"b\n";
+	for (int i = 0; i < 100; i++) {
+		unclosed += "\r\n";
+	}
+	path = MakeFile(unclosed);
+	EXPECT_EQ(CSV_INVALID_FORMAT, CsvParser_LoadFromFile(lazy, path.c_str()));
+}
+
+// NOLINTEND
@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+#include "CsvTestHelper.hpp"
+#include "Csv/parser/CsvStreamParser.h"
+#include <string>
+#include <vector>
+
+// NOLINTBEGIN
+
+class CsvStreamParserTest : public::testing::Test {
+protected:
+	static constexpr CsvProperties_t props = With<CsvProperties_t>([](CsvProperties_t &p) { p.hasHeader = false; });
+	CsvStreamParser_t *parser;
+	std::vector<std::vector<std::string>> rows;
+	void SetUp() override {
+		parser = CsvStreamParser_Init(&props, [](const CsvLine_t *line, void *userData) {
+			auto *self = (CsvStreamParserTest *)userData;
+			self->rows.push_back(ToRow(line));
+		}, this);
+		ASSERT_NE(nullptr, parser);
+	}
+	void TearDown() override {
+		CsvStreamParser_Destroy(parser);
+	}
+	static std::vector<std::string> ToRow(const CsvLine_t *line) {
+		std::vector<std::string> row;
+		for (size_t i = 0; i < line->items.length; i++) {
+			row.push_back(line->items.list[i].text);
+		}
+		return row;
+	}
+	CsvReturnCode Feed(const std::string &data) {
+		return CsvStreamParser_Feed(parser, data.c_str(), data.length());
+	}
+};
+
+TEST_F(CsvStreamParserTest, RowsAcrossChunks) {
+	std::string data{
+		"title1,title2\r\n"
+		"data1,data2\n"
+		"data3"
+	};
+	for (char c : data) {
+		ASSERT_EQ(CSV_SUCCESS, Feed(std::string(1, c)));
+	}
+	EXPECT_EQ(2, rows.size());
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Finish(parser));
+	std::vector<std::vector<std::string>> expected{
+		{ "title1", "title2" }, { "data1", "data2" }, { "data3" }
+	};
+	EXPECT_EQ(expected, rows);
+}
+
+TEST_F(CsvStreamParserTest, EmptyRows) {
+	ASSERT_EQ(CSV_SUCCESS, Feed("a\n\nb\n\r\n\n"));
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Finish(parser));
+	// 途中の空行は残し、末尾の空行は捨てる
+	std::vector<std::vector<std::string>> expected{ { "a" }, { "" }, { "b" } };
+	EXPECT_EQ(expected, rows);
+}
+
+TEST_F(CsvStreamParserTest, Pull) {
+	CsvStreamParser_t *puller = CsvStreamParser_Init(&props, nullptr, nullptr);
+	std::string data{ "a,b\nc," };
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Feed(puller, data.c_str(), data.length()));
+	const CsvLine_t *line;
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Next(puller, &line));
+	ASSERT_NE(nullptr, line);
+	EXPECT_EQ((std::vector<std::string>{ "a", "b" }), ToRow(line));
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Next(puller, &line));
+	EXPECT_EQ(nullptr, line);
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Finish(puller));
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Next(puller, &line));
+	ASSERT_NE(nullptr, line);
+	EXPECT_EQ((std::vector<std::string>{ "c", "" }), ToRow(line));
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Next(puller, &line));
+	EXPECT_EQ(nullptr, line);
+	CsvStreamParser_Destroy(puller);
+}
+
+TEST_F(CsvStreamParserTest, BoundedMemory) {
+	std::string row = std::string(90, 'x') + "," + std::string(8, 'y') + "\n";
+	std::string chunk;
+	for (int i = 0; i < 10; i++) {
+		chunk += row;
+	}
+	for (int i = 0; i < 1000; i++) {
+		ASSERT_EQ(CSV_SUCCESS, Feed(chunk));
+	}
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Finish(parser));
+	EXPECT_EQ(10000, rows.size());
+	EXPECT_GE(4096, CsvStreamParser_GetBufferSize(parser));
+}
+
+TEST_F(CsvStreamParserTest, InvalidCharCode) {
+	EXPECT_EQ(CSV_SUCCESS, Feed("a,b\n"));
+	EXPECT_EQ(CSV_INVALID_CHAR_CODE, Feed("\xe3\x81\n"));
+	EXPECT_EQ(CSV_INVALID_CHAR_CODE, Feed("c\n"));
+	EXPECT_EQ(1, rows.size());
+}
+
+TEST_F(CsvStreamParserTest, QuotedFieldsAcrossChunks) {
+	std::string data{
+		"\"a,b\",\"line1\nline2\"\n"
+		"\"say \"\"hi\"\"\",c\n"
+	};
+	for (char c : data) {
+		ASSERT_EQ(CSV_SUCCESS, Feed(std::string(1, c)));
+	}
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Finish(parser));
+	std::vector<std::vector<std::string>> expected{
+		{ "a,b", "line1\nline2" }, { "say \"hi\"", "c" }
+	};
+	EXPECT_EQ(expected, rows);
+}
+
+TEST_F(CsvStreamParserTest, UnterminatedQuote) {
+	ASSERT_EQ(CSV_SUCCESS, Feed("a\n\"b\n"));
+	EXPECT_EQ(CSV_INVALID_FORMAT, CsvStreamParser_Finish(parser));
+	std::vector<std::vector<std::string>> expected{ { "a" } };
+	EXPECT_EQ(expected, rows);
+}
+
+TEST_F(CsvStreamParserTest, DialectAcrossChunks) {
+	const CsvProperties_t dialect = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.delimiter = ';'; p.escape = '\\'; p.comment = '#'; });
+	CsvStreamParser_t *dialectParser = CsvStreamParser_Init(&dialect, [](const CsvLine_t *line, void *userData) {
+		((std::vector<std::vector<std::string>> *)userData)->push_back(ToRow(line));
+	}, &rows);
+	ASSERT_NE(nullptr, dialectParser);
+	std::string data{
+		"# \"comment\n"
+		"a\\;b;\"\\\"あ\"\n"
+		"c\\\nd;e"
+	};
+	for (char c : data) {
+		ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Feed(dialectParser, &c, 1));
+	}
+	ASSERT_EQ(CSV_SUCCESS, CsvStreamParser_Finish(dialectParser));
+	std::vector<std::vector<std::string>> expected{
+		{ "a;b", "\"あ" }, { "c\nd", "e" }
+	};
+	EXPECT_EQ(expected, rows);
+	CsvStreamParser_Destroy(dialectParser);
+}
+
+// NOLINTEND
@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * @brief 値初期化してから一部のメンバーを設定する
+ * @note C の構造体を指示付き初期化子で一部だけ初期化すると -Wmissing-field-initializers の警告になるので、
+ * 設定しないメンバーは値初期化で0にしておく
+ * @param set メンバーを設定する関数
+ * @return 構造体
+ */
+template <typename T, typename Setter>
+constexpr T With(Setter set) {
+	T value{};
+	set(value);
+	return value;
+}
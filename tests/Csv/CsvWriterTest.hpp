@@ -0,0 +1,249 @@
+#include "gtest/gtest.h"
+#include "CsvTestHelper.hpp"
+#include "Csv/writer/CsvWriter.h"
+#include "Csv/parser/CsvParser.h"
+#include <cmath>
+#include <clocale>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// NOLINTBEGIN
+
+class CsvWriterTest : public::testing::Test {
+protected:
+	static constexpr CsvProperties_t props = With<CsvProperties_t>([](CsvProperties_t &p) { p.hasHeader = false; });
+	char buffer[4096];
+	CsvWriter_t *writer;
+	void SetUp() override {
+		writer = CsvWriter_InitBuffer(&props, buffer, sizeof(buffer));
+		ASSERT_NE(nullptr, writer);
+	}
+	void TearDown() override {
+		CsvWriter_Destroy(writer);
+	}
+	std::string Output() {
+		return std::string(buffer, CsvWriter_GetSize(writer));
+	}
+};
+
+TEST_F(CsvWriterTest, QuoteOnlyWhenNeeded) {
+	std::vector<std::string> fields{ "plain", "a,b", "say \"hi\"", "multi\nline", "", "cr\r" };
+	for (auto &field : fields) {
+		ASSERT_EQ(CSV_SUCCESS, CsvWriter_WriteText(writer, field.c_str()));
+	}
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_EndRow(writer));
+	std::string output = Output();
+	EXPECT_EQ("plain,\"a,b\",\"say \"\"hi\"\"\",\"multi\nline\",,\"cr\r\"\n", output);
+
+	// 読み込むと元に戻る
+	CsvParser_t *parser = CsvParser_Init(&props);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, output.c_str(), output.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(1, CsvContent_GetRowCount(content));
+	ASSERT_EQ(fields.size(), CsvContent_GetColumnCount(content, 0));
+	for (size_t i = 0; i < fields.size(); i++) {
+		EXPECT_EQ(fields[i], CsvContent_GetText(content, 0, i));
+	}
+	CsvParser_Destroy(parser);
+}
+
+TEST_F(CsvWriterTest, Numbers) {
+	CsvWriter_WriteInt64(writer, 0);
+	CsvWriter_WriteInt64(writer, -42);
+	CsvWriter_WriteInt64(writer, INT64_MAX);
+	CsvWriter_WriteInt64(writer, INT64_MIN);
+	CsvWriter_WriteBool(writer, true);
+	CsvWriter_WriteBool(writer, false);
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_EndRow(writer));
+	CsvWriter_WriteDouble(writer, 0.1);
+	CsvWriter_WriteDouble(writer, -2.5);
+	CsvWriter_WriteDouble(writer, 123.45);
+	CsvWriter_WriteDouble(writer, 0.001);
+	CsvWriter_WriteDouble(writer, 3.0);
+	CsvWriter_WriteDouble(writer, 1e20);
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_EndRow(writer));
+	EXPECT_EQ(
+		"0,-42,9223372036854775807,-9223372036854775808,true,false\n"
+		"0.1,-2.5,123.45,0.001,3,1e+20\n", Output());
+}
+
+TEST_F(CsvWriterTest, DoubleRoundTrip) {
+	std::mt19937_64 random(1);
+	std::uniform_real_distribution<double> distribution(-1e6, 1e6);
+	std::vector<double> values{ 1e-20, 5e-324, 1.7976931348623157e308, -0.0, M_PI };
+	for (int i = 0; i < 1000; i++) {
+		values.push_back(distribution(random));
+		values.push_back(std::round(distribution(random) * 100) / 100);
+	}
+	for (double value : values) {
+		CsvWriter_t *small = CsvWriter_InitBuffer(&props, buffer, sizeof(buffer));
+		ASSERT_EQ(CSV_SUCCESS, CsvWriter_WriteDouble(small, value));
+		std::string text(buffer, CsvWriter_GetSize(small));
+		EXPECT_EQ(value, std::strtod(text.c_str(), nullptr)) << text;
+		EXPECT_EQ(std::signbit(value), std::signbit(std::strtod(text.c_str(), nullptr))) << text;
+		CsvWriter_Destroy(small);
+	}
+}
+
+TEST_F(CsvWriterTest, DoubleMatchesPrintf) {
+	// 整数にできない値は %.17g と同じ表記で書く
+	std::vector<double> values{
+		1e300, -1e-300, 0.30000000000000004, 1.2345678901234567e-4, 12345678901234567.0, 1e17,
+		1.0000000000000001e300, 5e-324, -1.7976931348623157e308, 9007199254740993.0, 1e100,
+	};
+	for (double value : values) {
+		CsvWriter_t *small = CsvWriter_InitBuffer(&props, buffer, sizeof(buffer));
+		ASSERT_EQ(CSV_SUCCESS, CsvWriter_WriteDouble(small, value));
+		char expected[64];
+		snprintf(expected, sizeof(expected), "%.17g", value);
+		EXPECT_EQ(expected, std::string(buffer, CsvWriter_GetSize(small)));
+		CsvWriter_Destroy(small);
+	}
+	CsvWriter_WriteDouble(writer, NAN);
+	CsvWriter_WriteDouble(writer, -INFINITY);
+	CsvWriter_WriteDouble(writer, INFINITY);
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_EndRow(writer));
+	EXPECT_EQ("nan,-inf,inf\n", Output());
+}
+
+TEST_F(CsvWriterTest, SingleEmptyFieldRoundTrips) {
+	// 空のフィールドが1つだけの行は空行と区別できるように "" と書く
+	const CsvProperties_t dialect = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.escape = '\\'; });
+	for (const CsvProperties_t *p : { &props, &dialect }) {
+		CsvWriter_t *small = CsvWriter_InitBuffer(p, buffer, sizeof(buffer));
+		CsvWriter_WriteText(small, "a");
+		CsvWriter_EndRow(small);
+		CsvWriter_WriteText(small, "");
+		CsvWriter_EndRow(small);
+		CsvWriter_WriteText(small, NULL);
+		CsvWriter_WriteText(small, "");
+		ASSERT_EQ(CSV_SUCCESS, CsvWriter_EndRow(small));
+		std::string output(buffer, CsvWriter_GetSize(small));
+		CsvWriter_Destroy(small);
+		EXPECT_EQ("a\n\"\"\n,\n", output);
+
+		CsvParser_t *parser = CsvParser_Init(p);
+		ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, output.c_str(), output.length()));
+		const CsvContent_t *content = CsvParser_GetContent(parser);
+		ASSERT_EQ(3, CsvContent_GetRowCount(content));
+		ASSERT_EQ(1, CsvContent_GetColumnCount(content, 1));
+		EXPECT_STREQ("", CsvContent_GetText(content, 1, 0));
+		EXPECT_EQ(2, CsvContent_GetColumnCount(content, 2));
+		CsvParser_Destroy(parser);
+	}
+}
+
+TEST_F(CsvWriterTest, Dialect) {
+	const CsvProperties_t dialect = With<CsvProperties_t>([&](CsvProperties_t &p) { p.hasHeader = false; p.delimiter = ';'; p.escape = '\\'; p.comment = '#'; p.eol = CSV_EOL_CRLF; });
+	CsvWriter_t *dialectWriter = CsvWriter_InitBuffer(&dialect, buffer, sizeof(buffer));
+	ASSERT_NE(nullptr, dialectWriter);
+	CsvWriter_WriteText(dialectWriter, "#a;b");
+	CsvWriter_WriteText(dialectWriter, "c\"d\\e");
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_EndRow(dialectWriter));
+	std::string output(buffer, CsvWriter_GetSize(dialectWriter));
+	EXPECT_EQ("\\#a\\;b;c\\\"d\\\\e\r\n", output);
+
+	CsvParser_t *parser = CsvParser_Init(&dialect);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, output.c_str(), output.length()));
+	const CsvContent_t *content = CsvParser_GetContent(parser);
+	ASSERT_EQ(1, CsvContent_GetRowCount(content));
+	EXPECT_STREQ("#a;b", CsvContent_GetText(content, 0, 0));
+	EXPECT_STREQ("c\"d\\e", CsvContent_GetText(content, 0, 1));
+	CsvParser_Destroy(parser);
+	CsvWriter_Destroy(dialectWriter);
+}
+
+TEST_F(CsvWriterTest, BufferTooSmall) {
+	char small[8];
+	CsvWriter_t *smallWriter = CsvWriter_InitBuffer(&props, small, sizeof(small));
+	EXPECT_EQ(CSV_SUCCESS, CsvWriter_WriteText(smallWriter, "abc"));
+	EXPECT_EQ(CSV_WRITE_ERROR, CsvWriter_WriteText(smallWriter, "defghi"));
+	EXPECT_EQ(CSV_WRITE_ERROR, CsvWriter_EndRow(smallWriter));
+	CsvWriter_Destroy(smallWriter);
+}
+
+TEST_F(CsvWriterTest, BufferTooSmallDropsPartialRow) {
+	// 書けなかった行は途中まで残さず、書き終えた行までにする
+	char small[8];
+	CsvWriter_t *smallWriter = CsvWriter_InitBuffer(&props, small, sizeof(small));
+	CsvWriter_WriteText(smallWriter, "ab");
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_EndRow(smallWriter));
+	CsvWriter_WriteText(smallWriter, "cd");
+	EXPECT_EQ(CSV_WRITE_ERROR, CsvWriter_WriteText(smallWriter, "efgh"));
+	EXPECT_EQ(CSV_WRITE_ERROR, CsvWriter_EndRow(smallWriter));
+	EXPECT_EQ("ab\n", std::string(small, CsvWriter_GetSize(smallWriter)));
+	CsvWriter_Destroy(smallWriter);
+}
+
+TEST_F(CsvWriterTest, DoubleIgnoresLocale) {
+	// 小数点が ',' のロケールでも '.' で書く
+	std::string previous = setlocale(LC_NUMERIC, nullptr);
+	const char *names[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8" };
+	bool found = false;
+	for (const char *name : names) {
+		if (setlocale(LC_NUMERIC, name)) {
+			found = true;
+			break;
+		}
+	}
+	if (!found) {
+		GTEST_SKIP() << "no locale with a comma decimal point";
+	}
+	CsvWriter_WriteDouble(writer, 1.0000000000000001e300);
+	CsvWriter_WriteDouble(writer, 0.5);
+	CsvReturnCode ret = CsvWriter_EndRow(writer);
+	setlocale(LC_NUMERIC, previous.c_str());
+	ASSERT_EQ(CSV_SUCCESS, ret);
+	EXPECT_EQ("1.0000000000000001e+300,0.5\n", Output());
+}
+
+TEST_F(CsvWriterTest, WriteContentToFd) {
+	// 内部バッファより大きな出力も欠けずに書ける
+	std::string data;
+	for (int i = 0; i < 20000; i++) {
+		data += std::to_string(i) + ",\"a,b\",text\n";
+	}
+	CsvParser_t *parser = CsvParser_Init(&props);
+	ASSERT_EQ(CSV_SUCCESS, CsvParser_LoadFromData(parser, data.c_str(), data.length()));
+	char path[] = "/tmp/CsvWriterTestXXXXXX";
+	int fd = mkstemp(path);
+	ASSERT_LE(0, fd);
+	CsvWriter_t *fdWriter = CsvWriter_InitFd(&props, fd);
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_WriteContent(fdWriter, CsvParser_GetContent(parser)));
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_Flush(fdWriter));
+	EXPECT_EQ(data.length(), CsvWriter_GetSize(fdWriter));
+	CsvWriter_Destroy(fdWriter);
+	std::string written(data.length(), '\0');
+	EXPECT_EQ((ssize_t)data.length(), pread(fd, written.data(), written.length(), 0));
+	EXPECT_EQ(data, written);
+	close(fd);
+	unlink(path);
+	CsvParser_Destroy(parser);
+}
+
+TEST_F(CsvWriterTest, WriteRowsToMemoryStream) {
+	MemoryStream stream;
+	MemoryStream_Init(&stream);
+	CsvWriter_t *streamWriter = CsvWriter_InitMemoryStream(&props, &stream);
+	int count = 0;
+	ASSERT_EQ(CSV_SUCCESS, CsvWriter_WriteRows(streamWriter, [](CsvWriter_t *writer, void *userData) {
+		int *count = (int *)userData;
+		if (*count == 3) {
+			return false;
+		}
+		CsvWriter_WriteInt64(writer, *count);
+		CsvWriter_WriteText(writer, "x");
+		CsvWriter_EndRow(writer);
+		(*count)++;
+		return true;
+	}, &count));
+	CsvWriter_Destroy(streamWriter);
+	std::string output((const char *)MemoryStream_RefBuffer(&stream), MemoryStream_GetSize(&stream));
+	EXPECT_EQ("0,x\n1,x\n2,x\n", output);
+	MemoryStream_Destroy(&stream);
+}
+
+// NOLINTEND
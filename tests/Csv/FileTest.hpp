@@ -0,0 +1,43 @@
+#include "gtest/gtest.h"
+#include "File.h"
+#include <cerrno>
+#include <string>
+#include <unistd.h>
+
+// NOLINTBEGIN
+
+class FileTest : public::testing::Test {
+protected:
+	std::string path;
+	void SetUp() override {
+		char name[] = "/tmp/FileTestXXXXXX";
+		int fd = mkstemp(name);
+		ASSERT_LE(0, fd);
+		ASSERT_EQ(3, write(fd, "abc", 3));
+		close(fd);
+		path = name;
+	}
+	void TearDown() override {
+		unlink(path.c_str());
+	}
+};
+
+TEST_F(FileTest, Read) {
+	char buffer[3];
+	EXPECT_EQ(0, File_Read(path.c_str(), buffer, sizeof(buffer)));
+	EXPECT_EQ(0, memcmp("abc", buffer, sizeof(buffer)));
+}
+
+TEST_F(FileTest, ShortRead) {
+	// 途中でファイルが縮んだときのように、求めたサイズに足りなければ失敗にする
+	char buffer[8];
+	EXPECT_EQ(-EIO, File_Read(path.c_str(), buffer, sizeof(buffer)));
+}
+
+TEST_F(FileTest, ReadError) {
+	char buffer[8];
+	EXPECT_EQ(-EISDIR, File_Read("/tmp", buffer, sizeof(buffer)));
+	EXPECT_EQ(-ENOENT, File_Read("/tmp/FileTestNotExists", buffer, sizeof(buffer)));
+}
+
+// NOLINTEND
@@ -1 +1,8 @@
 #include "CsvParserTest.hpp"
+#include "CsvStreamParserTest.hpp"
+#include "CsvParallelParserTest.hpp"
+#include "CsvColumnTest.hpp"
+#include "CsvProjectionTest.hpp"
+#include "CsvWriterTest.hpp"
+#include "CsvRowIndexTest.hpp"
+#include "FileTest.hpp"
@@ -240,3 +240,99 @@ TEST_F(ArrayListTest, NullSafety) {
 
 
 
+
+class InlineArrayListTest :public::testing::Test {
+protected:
+	ArrayList list{};
+	void SetUp() override {
+		ArrayList_InitInline(&list, nullptr, sizeof(int));
+	}
+	void TearDown() override {
+		ArrayList_Destroy(&list);
+	}
+	int At(uint64_t index) {
+		return *static_cast<const int *>(ArrayList_At(&list, index));
+	}
+};
+
+TEST_F(InlineArrayListTest, Contiguous) {
+	for (int i = 0; i < 200; i++) {
+		ArrayList_Add(&list, &i);
+	}
+	ASSERT_EQ(200, ArrayList_Length(&list));
+	EXPECT_GE(ArrayList_Capacity(&list), 200);
+	const int *data = static_cast<const int *>(ArrayList_Data(&list));
+	ASSERT_NE(nullptr, data);
+	for (int i = 0; i < 200; i++) {
+		EXPECT_EQ(i, data[i]);
+		EXPECT_EQ(&data[i], ArrayList_At(&list, i));
+	}
+	EXPECT_EQ(nullptr, ArrayList_At(&list, 200));
+
+	ArrayList node;
+	ArrayList_Init(&node, nullptr, sizeof(int));
+	EXPECT_EQ(nullptr, ArrayList_Data(&node));
+	ArrayList_Destroy(&node);
+}
+
+TEST_F(InlineArrayListTest, Modify) {
+	std::vector<int> nums{ 1, 2, 3 };
+	ArrayList_AddRange(&list, nums.data(), nums.size());
+	int a = 4;
+	ArrayList_AddReference(&list, &a);
+	a = 0;
+	EXPECT_EQ(4, At(3));
+
+	int b = 9;
+	ArrayList_Insert(&list, 1, &b);
+	ASSERT_EQ(5, ArrayList_Length(&list));
+	EXPECT_EQ(1, At(0));
+	EXPECT_EQ(9, At(1));
+	EXPECT_EQ(2, At(2));
+	EXPECT_EQ(1, ArrayList_IndexOf(&list, &b));
+
+	EXPECT_EQ(true, ArrayList_Remove(&list, &b));
+	EXPECT_EQ(true, ArrayList_RemoveAt(&list, 0));
+	ASSERT_EQ(3, ArrayList_Length(&list));
+	EXPECT_EQ(2, At(0));
+	EXPECT_EQ(3, At(1));
+	EXPECT_EQ(4, At(2));
+
+	ArrayList_Clear(&list);
+	EXPECT_EQ(true, ArrayList_IsEmpty(&list));
+}
+
+TEST_F(InlineArrayListTest, Append) {
+	ArrayListWrapper<int> node;
+	node.Add(1);
+	node.Add(2);
+	ArrayList_Append(&list, &node);
+	ArrayListWrapper<int> other;
+	ArrayList_Append(&other, &list);
+	ASSERT_EQ(2, ArrayList_Length(&list));
+	EXPECT_EQ(1, At(0));
+	EXPECT_EQ(2, At(1));
+	ASSERT_EQ(2, other.Length());
+	EXPECT_EQ(2, other.At(1));
+}
+
+TEST(InlineArrayListAllocatorTest, UsesAllocator) {
+	// インラインモードの領域も、渡したアロケーターで確保して解放する
+	static int numAllocated;
+	static int numDisposed;
+	numAllocated = 0;
+	numDisposed = 0;
+	MemoryAllocator_t allocator;
+	allocator.allocate = [](size_t size) { numAllocated++; return malloc(size); };
+	allocator.dispose = [](void *ptr) { numDisposed++; free(ptr); };
+	ArrayList list;
+	ArrayList_InitInline(&list, &allocator, sizeof(int));
+	for (int i = 0; i < 200; i++) {
+		ArrayList_Add(&list, &i);
+	}
+	ASSERT_EQ(200, ArrayList_Length(&list));
+	EXPECT_EQ(199, *static_cast<const int *>(ArrayList_At(&list, 199)));
+	EXPECT_LT(1, numAllocated);
+	ArrayList_Destroy(&list);
+	EXPECT_EQ(numAllocated, numDisposed);
+}
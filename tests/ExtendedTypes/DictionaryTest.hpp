@@ -6,6 +6,11 @@ extern "C" {
 #include <string>
 #include <cstring>
 #include <list>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
 #include "gtest/gtest.h"
 
 void DictionaryTest_Normally(void);
@@ -85,8 +90,69 @@ TEST_F(DictionaryTest, KeyNotFound) {
 
 TEST_F(DictionaryTest, CapacityOver) {
 	AddAll();
+	// 容量を超えたら広げる
 	int object = 300;
-	EXPECT_EQ(DICTIONARY_FULL, Dictionary_Add(&dict, "peach", &object, 4));
+	EXPECT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, "peach", &object, 4));
+	EXPECT_EQ(4, Dictionary_Count(&dict));
+	for (size_t i = 0; i < capacity; i++) {
+		const DictionaryObject_t *obj = Dictionary_Find(&dict, (char *)keys[i].c_str());
+		ASSERT_NE(nullptr, obj);
+		EXPECT_EQ(objects[i], *(int *)obj->buffer);
+	}
+	EXPECT_EQ(300, *(int *)Dictionary_Find(&dict, (char *)"peach")->buffer);
+}
+
+TEST_F(DictionaryTest, DuplicateKey) {
+	AddAll();
+	int object = 300;
+	EXPECT_EQ(DICTIONARY_EXISTS, Dictionary_Add(&dict, "apple", &object, 4));
+	EXPECT_EQ(objects[0], *(int *)Dictionary_Find(&dict, (char *)"apple")->buffer);
+	EXPECT_EQ(capacity, Dictionary_Count(&dict));
+}
+
+TEST_F(DictionaryTest, Remove) {
+	AddAll();
+	EXPECT_EQ(DICTIONARY_REMOVED, Dictionary_Remove(&dict, "banana"));
+	EXPECT_EQ(DICTIONARY_NOT_FOUND, Dictionary_Remove(&dict, "banana"));
+	EXPECT_EQ(nullptr, Dictionary_Find(&dict, (char *)"banana"));
+	EXPECT_EQ(2, Dictionary_Count(&dict));
+	EXPECT_EQ(objects[2], *(int *)Dictionary_Find(&dict, (char *)"orange")->buffer);
+
+	int object = 300;
+	EXPECT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, "banana", &object, 4));
+	EXPECT_EQ(300, *(int *)Dictionary_Find(&dict, (char *)"banana")->buffer);
+}
+
+TEST(DictionaryTestAdditional, SameAsUnorderedMap) {
+	// 追加と削除を繰り返しても、広げたり作り直したりした後も同じ結果になる
+	Dictionary_t dict;
+	Dictionary_Init(&dict, 0, 16, sizeof(uint64_t));
+	std::unordered_map<std::string, uint64_t> expected;
+	std::mt19937_64 random(1);
+	for (int i = 0; i < 200000; i++) {
+		uint64_t value = random();
+		std::string key = "k" + std::to_string(value % 20000);
+		if (value & (1ULL << 40)) {
+			DictionaryReturn ret = Dictionary_Add(&dict, key.c_str(), &value, sizeof(value));
+			ASSERT_EQ(expected.count(key) ? DICTIONARY_EXISTS : DICTIONARY_ADDED, ret);
+			expected.emplace(key, value);
+		} else {
+			ASSERT_EQ(expected.erase(key) ? DICTIONARY_REMOVED : DICTIONARY_NOT_FOUND, Dictionary_Remove(&dict, key.c_str()));
+		}
+	}
+	ASSERT_EQ(expected.size(), Dictionary_Count(&dict));
+	for (int i = 0; i < 20000; i++) {
+		std::string key = "k" + std::to_string(i);
+		const DictionaryObject_t *obj = Dictionary_Find(&dict, (char *)key.c_str());
+		auto it = expected.find(key);
+		if (it == expected.end()) {
+			EXPECT_EQ(nullptr, obj) << key;
+		} else {
+			ASSERT_NE(nullptr, obj) << key;
+			EXPECT_EQ(it->second, *(uint64_t *)obj->buffer) << key;
+		}
+	}
+	Dictionary_Destroy(&dict);
 }
 
 TEST_F(DictionaryTest, KeySizeTooBig) {
@@ -99,3 +165,345 @@ TEST_F(DictionaryTest, ObjectSizeTooBig) {
 	EXPECT_EQ(DICTIONARY_INVALID_ARG, Dictionary_Add(&dict, "peach", &s, s.length()));
 }
 
+TEST(DictionaryTestAdditional, VariableSizes) {
+	// 短いキーは要素の中に、長いキーと大きなオブジェクトはスラブか個別の領域に持つ
+	Dictionary_t dict;
+	Dictionary_Init(&dict, 4, 256, 40000);
+	std::vector<std::string> keys;
+	std::vector<std::string> objects;
+	for (size_t i = 0; i < 300; i++) {
+		keys.push_back(std::string(1 + (i * 7) % 200, 'a' + (char)(i % 26)) + std::to_string(i));
+		objects.push_back(std::string(1 + (i * 131) % 39000, 'A' + (char)(i % 26)));
+	}
+	for (size_t i = 0; i < keys.size(); i++) {
+		ASSERT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, keys[i].c_str(), (void *)objects[i].c_str(), objects[i].length()));
+	}
+	for (size_t i = 0; i < keys.size(); i += 2) {
+		ASSERT_EQ(DICTIONARY_REMOVED, Dictionary_Remove(&dict, keys[i].c_str()));
+	}
+	for (size_t i = 0; i < keys.size(); i += 2) {
+		ASSERT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, keys[i].c_str(), (void *)objects[i].c_str(), objects[i].length()));
+	}
+	for (size_t i = 0; i < keys.size(); i++) {
+		const DictionaryObject_t *obj = Dictionary_Find(&dict, (char *)keys[i].c_str());
+		ASSERT_NE(nullptr, obj) << i;
+		ASSERT_EQ(objects[i].length(), obj->size);
+		EXPECT_EQ(0, std::memcmp(objects[i].c_str(), obj->buffer, obj->size)) << i;
+	}
+	Dictionary_Destroy(&dict);
+}
+
+TEST_F(DictionaryTest, FindCopy) {
+	AddAll();
+	int object = 0;
+	size_t size = 0;
+	EXPECT_EQ(DICTIONARY_FOUND, Dictionary_FindCopy(&dict, "banana", &object, sizeof(object), &size));
+	EXPECT_EQ(200, object);
+	EXPECT_EQ(4, size);
+	char small[2];
+	EXPECT_EQ(DICTIONARY_INVALID_ARG, Dictionary_FindCopy(&dict, "apple", small, sizeof(small), &size));
+	EXPECT_EQ(4, size);
+	EXPECT_EQ(DICTIONARY_NOT_FOUND, Dictionary_FindCopy(&dict, "peach", &object, sizeof(object), NULL));
+}
+
+TEST(DictionaryTestAdditional, ConcurrentReaders) {
+	// 書き手が追加と削除を繰り返す間も、読み手は消さないキーを必ず見つけ、壊れたオブジェクトを読まない
+	Dictionary_t dict;
+	ASSERT_TRUE(Dictionary_InitConcurrent(&dict, 4, 64, 20000));
+	auto keyOf = [](const char *prefix, size_t i) {
+		return std::string(prefix) + std::string(i % 40, '-') + std::to_string(i);
+	};
+	auto objectOf = [](size_t i) {
+		return std::string(8 + (i * 977) % 19000, (char)('A' + i % 26)) + std::to_string(i);
+	};
+	const size_t numStable = 500;
+	const size_t numVolatile = 200;
+	for (size_t i = 0; i < numStable; i++) {
+		std::string object = objectOf(i);
+		ASSERT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, keyOf("s", i).c_str(), (void *)object.c_str(), object.length()));
+	}
+	std::atomic<bool> isDone{ false };
+	std::atomic<size_t> errors{ 0 };
+	std::thread writer([&]() {
+		for (int round = 0; round < 40; round++) {
+			for (size_t i = 0; i < numVolatile; i++) {
+				std::string object = objectOf(i);
+				Dictionary_Add(&dict, keyOf("v", i).c_str(), (void *)object.c_str(), object.length());
+			}
+			for (size_t i = round % 2; i < numVolatile; i += 2) {
+				Dictionary_Remove(&dict, keyOf("v", i).c_str());
+			}
+		}
+		isDone = true;
+	});
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++) {
+		readers.emplace_back([&, t]() {
+			std::vector<char> buffer(20000);
+			for (size_t n = t; !isDone || (n < 20000); n++) {
+				size_t i = n % numStable;
+				size_t size = 0;
+				std::string expected = objectOf(i);
+				if ((Dictionary_FindCopy(&dict, keyOf("s", i).c_str(), buffer.data(), buffer.size(), &size) != DICTIONARY_FOUND)
+					|| (std::string(buffer.data(), size) != expected)) {
+					errors++;
+				}
+				i = n % numVolatile;
+				DictionaryReturn ret = Dictionary_FindCopy(&dict, keyOf("v", i).c_str(), buffer.data(), buffer.size(), &size);
+				if ((ret == DICTIONARY_FOUND) ? (std::string(buffer.data(), size) != objectOf(i)) : (ret != DICTIONARY_NOT_FOUND)) {
+					errors++;
+				}
+			}
+		});
+	}
+	writer.join();
+	for (auto &reader : readers) {
+		reader.join();
+	}
+	EXPECT_EQ(0, errors.load());
+	for (size_t i = 0; i < numStable; i++) {
+		EXPECT_NE(nullptr, Dictionary_Find(&dict, (char *)keyOf("s", i).c_str())) << i;
+	}
+	Dictionary_Destroy(&dict);
+}
+
+TEST(DictionaryTestAdditional, ConcurrentChurnReclaims) {
+	// 並行モードで追加と削除を繰り返しても、解放を待つ領域は増え続けない
+	Dictionary_t dict;
+	ASSERT_TRUE(Dictionary_InitConcurrent(&dict, 4, 64, 20000));
+	const std::string object(17000, 'x');	// スラブに無い大きさなので、削除するたびに解放を待つ
+	const size_t numRounds = 20000;
+	auto churn = [&](size_t from) {
+		size_t maxRetired = 0;
+		DictionaryStats_t stats;
+		for (size_t i = from; i < from + numRounds; i++) {
+			std::string key = std::to_string(i % 64);
+			EXPECT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, key.c_str(), (void *)object.c_str(), object.length()));
+			EXPECT_EQ(DICTIONARY_REMOVED, Dictionary_Remove(&dict, key.c_str()));
+			if (i % 16 == 0) {
+				Dictionary_GetStats(&dict, &stats);
+				maxRetired = (stats.numRetired > maxRetired) ? stats.numRetired : maxRetired;
+			}
+		}
+		return maxRetired;
+	};
+	// 読み手がいなければ、預けた領域は2世代のうちに解放される
+	EXPECT_LE(churn(0), 4);
+
+	std::atomic<bool> isDone{ false };
+	std::atomic<size_t> errors{ 0 };
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 2; t++) {
+		readers.emplace_back([&]() {
+			std::vector<char> buffer(20000);
+			for (size_t n = 0; !isDone; n++) {
+				size_t size = 0;
+				DictionaryReturn ret = Dictionary_FindCopy(&dict, std::to_string(n % 64).c_str(), buffer.data(), buffer.size(), &size);
+				if ((ret == DICTIONARY_FOUND) ? (std::string(buffer.data(), size) != object) : (ret != DICTIONARY_NOT_FOUND)) {
+					errors++;
+				}
+				std::this_thread::yield();	// 読んでいる途中で止まりにくくする
+			}
+		});
+	}
+	// 読み手がいても、読み終えた分から解放される
+	size_t maxRetired = churn(numRounds);
+	isDone = true;
+	for (auto &reader : readers) {
+		reader.join();
+	}
+	EXPECT_EQ(0, errors.load());
+	EXPECT_LT(maxRetired, numRounds / 2);	// 読み手が読んでいる途中で止まっている間だけ溜まる
+	Dictionary_Reclaim(&dict);
+	DictionaryStats_t stats;
+	Dictionary_GetStats(&dict, &stats);
+	EXPECT_EQ(0, stats.numRetired);
+	Dictionary_Destroy(&dict);
+}
+
+TEST(DictionaryTestAdditional, BinaryKeys) {
+	// null文字を含むキーや、前方が同じキーも区別する
+	Dictionary_t dict;
+	Dictionary_Init(&dict, 4, 64, sizeof(int));
+	const std::string keys[] = { std::string("a\0b", 3), std::string("a\0c", 3), std::string("a", 1), std::string(40, '\0'), std::string() };
+	for (int i = 0; i < 5; i++) {
+		DictionaryKey_t key = Dictionary_MakeKey(keys[i].data(), keys[i].size());
+		ASSERT_EQ(DICTIONARY_ADDED, Dictionary_AddByKey(&dict, &key, &i, sizeof(i))) << i;
+		EXPECT_EQ(DICTIONARY_EXISTS, Dictionary_AddByKey(&dict, &key, &i, sizeof(i))) << i;
+	}
+	for (int i = 0; i < 5; i++) {
+		DictionaryKey_t key = Dictionary_MakeKey(keys[i].data(), keys[i].size());
+		const DictionaryObject_t *obj = Dictionary_FindByKey(&dict, &key);
+		ASSERT_NE(nullptr, obj) << i;
+		EXPECT_EQ(i, *(int *)obj->buffer);
+	}
+	// 文字列のキーは終端までのバイト列と同じ
+	EXPECT_EQ(2, *(int *)Dictionary_Find(&dict, (char *)"a")->buffer);
+	DictionaryKey_t key = Dictionary_MakeKey(keys[0].data(), keys[0].size());
+	EXPECT_EQ(DICTIONARY_REMOVED, Dictionary_RemoveByKey(&dict, &key));
+	EXPECT_EQ(nullptr, Dictionary_FindByKey(&dict, &key));
+	std::string tooLong(64, 'x');
+	key = Dictionary_MakeKey(tooLong.data(), tooLong.size());
+	int object = 0;
+	EXPECT_EQ(DICTIONARY_INVALID_ARG, Dictionary_AddByKey(&dict, &key, &object, sizeof(object)));
+	Dictionary_Destroy(&dict);
+}
+
+TEST(DictionaryTestAdditional, PrecomputedHash) {
+	Dictionary_t dict;
+	Dictionary_Init(&dict, 0, 128, sizeof(size_t));
+	std::vector<std::string> keys;
+	for (size_t i = 0; i < 1000; i++) {
+		keys.push_back(std::to_string(i) + std::string(i % 100, 'k'));
+		ASSERT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, keys[i].c_str(), &i, sizeof(i)));
+	}
+	for (size_t i = 0; i < keys.size(); i++) {
+		DictionaryKey_t key = { keys[i].data(), keys[i].size(), Dictionary_Hash(keys[i].data(), keys[i].size()) };
+		EXPECT_EQ(Dictionary_MakeKey(keys[i].data(), keys[i].size()).hash, key.hash);
+		size_t object = 0;
+		ASSERT_EQ(DICTIONARY_FOUND, Dictionary_FindCopyByKey(&dict, &key, &object, sizeof(object), NULL)) << i;
+		EXPECT_EQ(i, object);
+	}
+	// 違うハッシュ値では見つからない
+	DictionaryKey_t key = Dictionary_MakeKey(keys[0].data(), keys[0].size());
+	key.hash ^= 1;
+	EXPECT_EQ(nullptr, Dictionary_FindByKey(&dict, &key));
+	Dictionary_Destroy(&dict);
+}
+
+TEST(DictionaryTestAdditional, InsertionOrder) {
+	Dictionary_t dict;
+	Dictionary_Init(&dict, 2, 16, sizeof(int));
+	std::vector<std::string> expected;
+	for (int i = 0; i < 100; i++) {
+		std::string key = "k" + std::to_string(i);
+		ASSERT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, key.c_str(), &i, sizeof(i)));
+		expected.push_back(key);
+	}
+	// 削除した要素は飛ばし、追加し直した要素は最後に来る
+	for (int i = 0; i < 100; i += 3) {
+		ASSERT_EQ(DICTIONARY_REMOVED, Dictionary_Remove(&dict, expected[i].c_str()));
+	}
+	ASSERT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, "k0", &expected, sizeof(int)));
+	std::vector<std::string> order;
+	for (size_t i = 0; i < expected.size(); i++) {
+		if (i % 3 != 0) {
+			order.push_back(expected[i]);
+		}
+	}
+	order.push_back("k0");
+	std::vector<std::string> actual;
+	size_t cursor = 0;
+	DictionaryKey_t key;
+	DictionaryObject_t object;
+	while (Dictionary_Next(&dict, &cursor, &key, &object)) {
+		actual.push_back(std::string((const char *)key.data, key.size));
+		EXPECT_EQ(Dictionary_Hash(key.data, key.size), key.hash);
+		EXPECT_EQ(sizeof(int), object.size);
+	}
+	EXPECT_EQ(order, actual);
+	EXPECT_FALSE(Dictionary_Next(&dict, &cursor, NULL, NULL));
+	Dictionary_Destroy(&dict);
+}
+
+TEST(DictionaryTestAdditional, AddRange) {
+	Dictionary_t dict;
+	Dictionary_Init(&dict, 0, 16, sizeof(size_t));
+	std::vector<std::string> names;
+	std::vector<size_t> values;
+	for (size_t i = 0; i < 10000; i++) {
+		names.push_back("key" + std::to_string(i));
+		values.push_back(i);
+	}
+	std::vector<DictionaryKey_t> keys;
+	std::vector<DictionaryObject_t> objects;
+	for (size_t i = 0; i < names.size(); i++) {
+		keys.push_back(Dictionary_MakeKey(names[i].data(), names[i].size()));
+		objects.push_back({ &values[i], sizeof(size_t) });
+	}
+	size_t added = 0;
+	ASSERT_EQ(DICTIONARY_ADDED, Dictionary_AddRange(&dict, keys.data(), objects.data(), 5000, &added));
+	EXPECT_EQ(5000, added);
+	// 既にあるキーは飛ばす
+	EXPECT_EQ(DICTIONARY_EXISTS, Dictionary_AddRange(&dict, keys.data(), objects.data(), keys.size(), &added));
+	EXPECT_EQ(5000, added);
+	ASSERT_EQ(10000, Dictionary_Count(&dict));
+	for (size_t i = 0; i < names.size(); i++) {
+		size_t value = 0;
+		ASSERT_EQ(DICTIONARY_FOUND, Dictionary_FindCopyByKey(&dict, &keys[i], &value, sizeof(value), NULL));
+		EXPECT_EQ(i, value);
+	}
+	// 不正なキーがあれば何も追加しない
+	std::string tooLong(16, 'x');
+	DictionaryKey_t invalid[] = { Dictionary_MakeKey("new", 3), Dictionary_MakeKey(tooLong.data(), tooLong.size()) };
+	EXPECT_EQ(DICTIONARY_INVALID_ARG, Dictionary_AddRange(&dict, invalid, objects.data(), 2, &added));
+	EXPECT_EQ(0, added);
+	EXPECT_EQ(nullptr, Dictionary_FindByKey(&dict, &invalid[0]));
+	Dictionary_Destroy(&dict);
+}
+
+TEST(DictionaryTestAdditional, Stats) {
+	Dictionary_t dict;
+	Dictionary_Init(&dict, 0, 16, sizeof(size_t));
+	DictionaryStats_t stats;
+	Dictionary_GetStats(&dict, &stats);
+	EXPECT_EQ(0, stats.count);
+	EXPECT_EQ(0, stats.numSlots);
+	for (size_t i = 0; i < 3000; i++) {
+		std::string key = std::to_string(i);
+		ASSERT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, key.c_str(), &i, sizeof(i)));
+	}
+	for (size_t i = 0; i < 3000; i += 2) {
+		ASSERT_EQ(DICTIONARY_REMOVED, Dictionary_Remove(&dict, std::to_string(i).c_str()));
+	}
+	Dictionary_GetStats(&dict, &stats);
+	EXPECT_EQ(1500, stats.count);
+	EXPECT_EQ(1500, stats.numDeleted);
+	EXPECT_EQ(1500, stats.numHoles);
+	EXPECT_DOUBLE_EQ((double)stats.count / stats.numSlots, stats.loadFactor);
+	EXPECT_LE(stats.loadFactor, 7.0 / 8.0);
+	size_t total = 0;
+	for (size_t bin = 0; bin < DICTIONARY_PROBE_HISTOGRAM_SIZE; bin++) {
+		total += stats.probeLengths[bin];
+	}
+	EXPECT_EQ(stats.count, total);
+	EXPECT_GE(stats.averageProbeLength, 1.0);
+	EXPECT_GE(stats.maxProbeLength, 1);
+	EXPECT_GT(stats.memoryUsage, stats.capacity * sizeof(DictionaryElement_t));
+	Dictionary_Destroy(&dict);
+}
+
+TEST(DictionaryTestAdditional, StatsWhileWriting) {
+	// 並行モードでは、書き手が追加と削除を繰り返す間も一貫した統計を読める
+	Dictionary_t dict;
+	ASSERT_TRUE(Dictionary_InitConcurrent(&dict, 4, 16, 20000));
+	const std::string object(17000, 'x');
+	std::atomic<bool> isDone{ false };
+	std::thread writer([&]() {
+		for (size_t i = 0; i < 5000; i++) {
+			std::string key = std::to_string(i);
+			Dictionary_Add(&dict, key.c_str(), (void *)object.c_str(), object.length());
+			if (i % 3 != 0) {
+				Dictionary_Remove(&dict, key.c_str());
+			}
+		}
+		isDone = true;
+	});
+	size_t errors = 0;
+	while (!isDone) {
+		DictionaryStats_t stats;
+		Dictionary_GetStats(&dict, &stats);
+		size_t total = 0;
+		for (size_t bin = 0; bin < DICTIONARY_PROBE_HISTOGRAM_SIZE; bin++) {
+			total += stats.probeLengths[bin];
+		}
+		errors += (total != stats.count) || (stats.count + stats.numHoles > stats.capacity);
+		// キーとオブジェクトは書き込みで無効になるので、取り出さずに辿る
+		size_t cursor = 0;
+		while (Dictionary_Next(&dict, &cursor, NULL, NULL)) {
+		}
+	}
+	writer.join();
+	EXPECT_EQ(0, errors);
+	Dictionary_Destroy(&dict);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+extern "C" {
+#include "ExtendedTypes/Dictionary.h"
+#include "ExtendedTypes/FrozenDictionary.h"
+}
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+#include "gtest/gtest.h"
+
+class FrozenDictionaryTest : public ::testing::Test {
+protected:
+	Dictionary_t dict;
+	FrozenDictionary_t frozen;
+	std::vector<std::string> keys;
+	std::string path;
+	virtual void SetUp() {
+		Dictionary_Init(&dict, 0, 128, 64);
+		for (size_t i = 0; i < 5000; i++) {
+			keys.push_back("key" + std::to_string(i) + std::string(i % 50, '#'));
+			std::string object = "object" + std::to_string(i);
+			ASSERT_EQ(DICTIONARY_ADDED, Dictionary_Add(&dict, keys[i].c_str(), (void *)object.c_str(), object.length() + 1));
+		}
+		for (size_t i = 0; i < keys.size(); i += 10) {
+			ASSERT_EQ(DICTIONARY_REMOVED, Dictionary_Remove(&dict, keys[i].c_str()));
+		}
+		char name[] = "/tmp/FrozenDictionaryTestXXXXXX";
+		int fd = mkstemp(name);
+		close(fd);
+		path = name;
+	}
+	virtual void TearDown() {
+		Dictionary_Destroy(&dict);
+		unlink(path.c_str());
+	}
+	void ExpectSame(const FrozenDictionary_t *frozen) {
+		ASSERT_EQ(Dictionary_Count(&dict), FrozenDictionary_Count(frozen));
+		for (size_t i = 0; i < keys.size(); i++) {
+			DictionaryObject_t object;
+			DictionaryReturn ret = FrozenDictionary_Find(frozen, keys[i].c_str(), &object);
+			if (i % 10 == 0) {
+				EXPECT_EQ(DICTIONARY_NOT_FOUND, ret) << i;
+				continue;
+			}
+			ASSERT_EQ(DICTIONARY_FOUND, ret) << i;
+			EXPECT_STREQ(("object" + std::to_string(i)).c_str(), (const char *)object.buffer);
+		}
+		DictionaryObject_t object;
+		EXPECT_EQ(DICTIONARY_NOT_FOUND, FrozenDictionary_Find(frozen, "missing", &object));
+	}
+};
+
+TEST_F(FrozenDictionaryTest, Freeze) {
+	ASSERT_TRUE(Dictionary_Freeze(&dict, &frozen));
+	ExpectSame(&frozen);
+	// 元の辞書を変えても影響しない
+	Dictionary_Destroy(&dict);
+	Dictionary_Init(&dict, 0, 128, 64);
+	DictionaryObject_t object;
+	DictionaryKey_t key = Dictionary_MakeKey(keys[1].data(), keys[1].size());
+	EXPECT_EQ(DICTIONARY_FOUND, FrozenDictionary_FindByKey(&frozen, &key, &object));
+	FrozenDictionary_Destroy(&frozen);
+}
+
+TEST_F(FrozenDictionaryTest, SaveAndLoad) {
+	ASSERT_TRUE(Dictionary_Freeze(&dict, &frozen));
+	ASSERT_TRUE(FrozenDictionary_Save(&frozen, path.c_str()));
+	FrozenDictionary_Destroy(&frozen);
+	FrozenDictionary_t loaded;
+	ASSERT_TRUE(FrozenDictionary_Load(&loaded, path.c_str()));
+	ExpectSame(&loaded);
+	FrozenDictionary_Destroy(&loaded);
+
+	// 途中で切れたファイルは読み込まない
+	ASSERT_EQ(0, truncate(path.c_str(), 1000));
+	EXPECT_FALSE(FrozenDictionary_Load(&loaded, path.c_str()));
+	std::ofstream(path) << "not a dictionary";
+	EXPECT_FALSE(FrozenDictionary_Load(&loaded, path.c_str()));
+}
+
+TEST_F(FrozenDictionaryTest, Empty) {
+	Dictionary_t empty;
+	Dictionary_Init(&empty, 0, 8, 8);
+	ASSERT_TRUE(Dictionary_Freeze(&empty, &frozen));
+	EXPECT_EQ(0, FrozenDictionary_Count(&frozen));
+	DictionaryObject_t object;
+	EXPECT_EQ(DICTIONARY_NOT_FOUND, FrozenDictionary_Find(&frozen, "a", &object));
+	ASSERT_TRUE(FrozenDictionary_Save(&frozen, path.c_str()));
+	FrozenDictionary_Destroy(&frozen);
+	ASSERT_TRUE(FrozenDictionary_Load(&frozen, path.c_str()));
+	EXPECT_EQ(DICTIONARY_NOT_FOUND, FrozenDictionary_Find(&frozen, "a", &object));
+	FrozenDictionary_Destroy(&frozen);
+	Dictionary_Destroy(&empty);
+}
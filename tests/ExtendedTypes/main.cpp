@@ -1,2 +1,3 @@
-// #include "DictionaryTest.hpp"
+#include "DictionaryTest.hpp"
+#include "FrozenDictionaryTest.hpp"
 #include "ArrayListTest.hpp"
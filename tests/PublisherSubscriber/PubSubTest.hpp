@@ -1,6 +1,10 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
 #include "gtest/gtest.h"
 #include "PublisherSubscriber/Subscriber.h"
 #include "PublisherSubscriber/Publisher.h"
@@ -18,8 +22,8 @@ public:
 	static constexpr PublishMessage MSG4 = 4;
 
 	Publisher_t publisher;
-	Subject() {
-		Publisher_Init(&publisher, 4);
+	Subject(size_t maxSubscribers = 4) {
+		Publisher_Init(&publisher, maxSubscribers);
 	}
 	~Subject() {
 		Publisher_Destroy(&publisher);
@@ -28,12 +32,21 @@ public:
 		return Publisher_Subscribe(&publisher, sub, attr);
 	}
 	void Publish(PublishMessage msg, PublishMessageAttribute attr) {
-		PublishContent_t publish = { .message = msg, .attribute = attr };
+		PublishContent_t publish = { .message = msg, .attribute = attr, .payload = NULL };
 		Publisher_Publish(&publisher, &publish);
 	}
 	void Unsubscribe(SubscriptionAccountId id) {
 		Publisher_Unsubscribe(&publisher, id);
 	}
+	void SetRetryPolicy(time_t initialInterval, time_t maxInterval, uint32_t maxAttempts) {
+		BrokerRetryPolicy_t policy = {
+			.initialInterval = initialInterval, .maxInterval = maxInterval, .maxAttempts = maxAttempts
+		};
+		Publisher_SetRetryPolicy(&publisher, &policy);
+	}
+	int TakeDeadLetter(SubscriptionAccountId *id, PublishContent_t *content) {
+		return Publisher_TakeDeadLetter(&publisher, id, content);
+	}
 };
 
 class Observer {
@@ -44,7 +57,7 @@ public:
 		return SUBSCRIBER_ACK;
 	};
 	std::vector<PublishContent_t> publishes;
-	int calledCount = 0;
+	std::atomic<int> calledCount = 0;
 	Observer() {
 		Subscriber_Init(&subscriber, [](const PublishContent_t *publish, void *arg) {
 			Observer *observer = (Observer *)arg;
@@ -66,6 +79,17 @@ protected:
 	Observer observer3;
 	virtual void SetUp() {}
 	virtual void TearDown() {}
+
+	bool WaitUntil(std::function<bool()> condition, int milliSeconds = 1000) {
+		auto limit = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliSeconds);
+		while (!condition()) {
+			if (std::chrono::steady_clock::now() > limit) {
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
 };
 
 TEST_F(PubSubTest, Publish) {
@@ -114,13 +138,101 @@ TEST_F(PubSubTest, Republish) {
 		}
 		return SUBSCRIBER_ACK;
 	};
+	subject.SetRetryPolicy(10, 100, 3);
 	subject.Subscribe(&observer1.subscriber, subject.ATTR1);
 	subject.Publish(subject.MSG1, subject.ATTR1);
 	ASSERT_EQ(1, observer1.calledCount);
-	subject.Publish(subject.MSG2, subject.ATTR2);
+	// 次のパブリッシュを待たずに再配信される
+	EXPECT_TRUE(WaitUntil([this] { return observer1.calledCount == 2; }));
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
 	EXPECT_EQ(2, observer1.calledCount);
 }
 
+TEST_F(PubSubTest, RepublishIsNotTriggeredByPublish) {
+	observer1.Update =
+		[](Observer *observer, const PublishContent_t *content) {
+		return content->message == Subject::MSG1 ? SUBSCRIBER_NACK : SUBSCRIBER_ACK;
+	};
+	subject.SetRetryPolicy(60 * 1000, 60 * 1000, 3);
+	subject.Subscribe(&observer1.subscriber, subject.ATTR1);
+	subject.Publish(subject.MSG1, subject.ATTR1);
+	subject.Publish(subject.MSG2, subject.ATTR1);
+	subject.Publish(subject.MSG3, subject.ATTR1);
+	EXPECT_EQ(3, observer1.calledCount);
+}
+
+TEST_F(PubSubTest, DeadLetter) {
+	observer1.Update =
+		[](Observer *observer, const PublishContent_t *content) {
+		return SUBSCRIBER_NACK;
+	};
+	subject.SetRetryPolicy(1, 4, 3);
+	SubscriptionAccountId subscribed = subject.Subscribe(&observer1.subscriber, subject.ATTR1);
+	subject.Publish(subject.MSG1, subject.ATTR1);
+
+	SubscriptionAccountId id;
+	PublishContent_t content;
+	EXPECT_TRUE(WaitUntil([&] { return subject.TakeDeadLetter(&id, &content) == 0; }));
+	EXPECT_EQ(3, observer1.calledCount);
+	EXPECT_EQ(subscribed, id);
+	EXPECT_EQ(subject.MSG1, content.message);
+	EXPECT_EQ(subject.ATTR1, content.attribute);
+	EXPECT_EQ(-1, subject.TakeDeadLetter(&id, &content));
+}
+
+TEST_F(PubSubTest, DeadLetterWhenHandlerFillsPending) {
+	// 再配信中のハンドラが保留場所を埋めても、メッセージを失わずにデッドレターへ移す
+	static Subject *target;
+	static bool isFilling;
+	Subject small(1);
+	target = &small;
+	isFilling = false;
+	observer1.Update =
+		[](Observer *observer, const PublishContent_t *content) {
+		if ((content->message == Subject::MSG1) && (observer->calledCount == 2)) {
+			isFilling = true;
+			for (int i = 0; i < 16; i++) {
+				target->Publish(Subject::MSG2, Subject::ATTR1);
+			}
+			isFilling = false;
+		}
+		if (content->message == Subject::MSG1) {
+			return SUBSCRIBER_NACK;
+		}
+		return isFilling ? SUBSCRIBER_NACK : SUBSCRIBER_ACK;
+	};
+	small.SetRetryPolicy(1, 1, 10);
+	SubscriptionAccountId subscribed = small.Subscribe(&observer1.subscriber, small.ATTR1);
+	small.Publish(small.MSG1, small.ATTR1);
+
+	SubscriptionAccountId id;
+	PublishContent_t content;
+	ASSERT_TRUE(WaitUntil([&] { return small.TakeDeadLetter(&id, &content) == 0; }));
+	EXPECT_EQ(subscribed, id);
+	EXPECT_EQ(small.MSG1, content.message);
+}
+
+TEST_F(PubSubTest, ExponentialBackoff) {
+	static std::vector<std::chrono::steady_clock::time_point> calledTimes;
+	calledTimes.clear();
+	observer1.Update =
+		[](Observer *observer, const PublishContent_t *content) {
+		calledTimes.push_back(std::chrono::steady_clock::now());
+		return observer->calledCount < 4 ? SUBSCRIBER_NACK : SUBSCRIBER_ACK;
+	};
+	subject.SetRetryPolicy(20, 1000, 10);
+	subject.Subscribe(&observer1.subscriber, subject.ATTR1);
+	subject.Publish(subject.MSG1, subject.ATTR1);
+	ASSERT_TRUE(WaitUntil([this] { return observer1.calledCount == 4; }));
+	ASSERT_EQ(4, calledTimes.size());
+	auto interval = [](auto from, auto to) {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+	};
+	EXPECT_GE(interval(calledTimes[0], calledTimes[1]), 18);
+	EXPECT_GE(interval(calledTimes[1], calledTimes[2]), 38);
+	EXPECT_GE(interval(calledTimes[2], calledTimes[3]), 78);
+}
+
 TEST_F(PubSubTest, Unsubscribe) {
 	SubscriptionAccountId id = subject.Subscribe(&observer1.subscriber, subject.ATTR1);
 	subject.Unsubscribe(id);
@@ -128,3 +240,118 @@ TEST_F(PubSubTest, Unsubscribe) {
 	EXPECT_EQ(0, observer1.calledCount);
 }
 
+TEST_F(PubSubTest, ReusedIdDoesNotReceivePending) {
+	// 購読をやめたIDを使い回しても、前のサブスクライバー宛ての保留メッセージは届かない
+	observer1.Update =
+		[](Observer *observer, const PublishContent_t *content) {
+		return SUBSCRIBER_NACK;
+	};
+	subject.SetRetryPolicy(10, 10, 3);
+	SubscriptionAccountId first = subject.Subscribe(&observer1.subscriber, subject.ATTR1);
+	subject.Publish(subject.MSG1, subject.ATTR1);
+	subject.Unsubscribe(first);
+	SubscriptionAccountId second = subject.Subscribe(&observer2.subscriber, subject.ATTR2);
+	ASSERT_EQ(first, second);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_EQ(0, observer2.calledCount);
+	SubscriptionAccountId id;
+	PublishContent_t content;
+	EXPECT_EQ(-1, subject.TakeDeadLetter(&id, &content));
+}
+
+TEST_F(PubSubTest, ResubscribeInHandlerDoesNotReceiveNacked) {
+	// ハンドラの中で購読をやめて購読し直すと同じIDが返るが、NACKした配信は新しいサブスクライバーに届かない
+	static Subject *target;
+	static Observer *next;
+	static SubscriptionAccountId subscribed;
+	target = &subject;
+	next = &observer2;
+	observer1.Update =
+		[](Observer *observer, const PublishContent_t *content) {
+		target->Unsubscribe(subscribed);
+		EXPECT_EQ(subscribed, target->Subscribe(&next->subscriber, Subject::ATTR2));
+		return SUBSCRIBER_NACK;
+	};
+	subject.SetRetryPolicy(1, 1, 3);
+	subscribed = subject.Subscribe(&observer1.subscriber, subject.ATTR1);
+	subject.Publish(subject.MSG1, subject.ATTR1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_EQ(1, observer1.calledCount);
+	EXPECT_EQ(0, observer2.calledCount);
+	SubscriptionAccountId id;
+	PublishContent_t content;
+	EXPECT_EQ(-1, subject.TakeDeadLetter(&id, &content));
+}
+
+TEST_F(PubSubTest, ResubscribeInRedeliveryDoesNotReceivePending) {
+	// 再配信のハンドラの中で購読し直しても、前のサブスクライバー宛ての保留メッセージは届かない
+	static Subject *target;
+	static Observer *next;
+	static SubscriptionAccountId subscribed;
+	target = &subject;
+	next = &observer2;
+	observer1.Update =
+		[](Observer *observer, const PublishContent_t *content) {
+		if (observer->calledCount == 3) {	// 2通とも保留したあとの最初の再配信
+			target->Unsubscribe(subscribed);
+			EXPECT_EQ(subscribed, target->Subscribe(&next->subscriber, Subject::ATTR1));
+		}
+		return SUBSCRIBER_NACK;
+	};
+	observer2.Update =
+		[](Observer *observer, const PublishContent_t *content) {
+		return SUBSCRIBER_NACK;
+	};
+	subject.SetRetryPolicy(1, 1, 3);
+	subscribed = subject.Subscribe(&observer1.subscriber, subject.ATTR1);
+	subject.Publish(subject.MSG1, subject.ATTR1);
+	subject.Publish(subject.MSG2, subject.ATTR1);
+	ASSERT_TRUE(WaitUntil([this] { return observer1.calledCount == 3; }));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_EQ(3, observer1.calledCount);
+	EXPECT_EQ(0, observer2.calledCount);
+	SubscriptionAccountId id;
+	PublishContent_t content;
+	EXPECT_EQ(-1, subject.TakeDeadLetter(&id, &content));
+
+	// 新しいサブスクライバー宛ては通常どおり再配信される
+	subject.Publish(subject.MSG3, subject.ATTR1);
+	ASSERT_TRUE(WaitUntil([this] { return observer2.calledCount == 3; }));
+	for (auto &publish : observer2.publishes) {
+		EXPECT_EQ(subject.MSG3, publish.message);
+	}
+}
+
+TEST_F(PubSubTest, ManySubscribers) {
+	Subject many(1000);
+	std::vector<Observer> observers(600);
+	for (auto &observer : observers) {
+		ASSERT_NE(-1, many.Subscribe(&observer.subscriber, many.ATTR1));
+	}
+	many.Publish(many.MSG1, many.ATTR1);
+	for (auto &observer : observers) {
+		EXPECT_EQ(1, observer.calledCount);
+	}
+}
+
+TEST_F(PubSubTest, SubscribeDuringPublish) {
+	static Subject *target;
+	static Observer *late;
+	Subject growing(1000);
+	Observer added;
+	target = &growing;
+	late = &added;
+	std::vector<Observer> observers(64);
+	for (auto &observer : observers) {
+		observer.Update = [](Observer *observer, const PublishContent_t *content) {
+			target->Subscribe(&late->subscriber, content->attribute + 1);
+			return SUBSCRIBER_ACK;
+		};
+		growing.Subscribe(&observer.subscriber, growing.ATTR1);
+	}
+	growing.Publish(growing.MSG1, growing.ATTR1);
+	for (auto &observer : observers) {
+		EXPECT_EQ(1, observer.calledCount);
+	}
+	EXPECT_EQ(0, added.calledCount);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+#include "gtest/gtest.h"
+#include "PublisherSubscriber/PublishPayload.h"
+#include "PublisherSubscriber/Publisher.h"
+
+class PublishPayloadTest : public::testing::Test {
+protected:
+	static constexpr PublishMessageAttribute ATTR = 1;
+
+	PublishPayloadPool_t pool;
+	Publisher_t publisher;
+	virtual void SetUp() {
+		PublishPayloadPool_Init(&pool);
+		Publisher_Init(&publisher, 4);
+	}
+	virtual void TearDown() {
+		Publisher_Destroy(&publisher);
+		EXPECT_EQ(0, PublishPayloadPool_InUse(&pool));
+		PublishPayloadPool_Destroy(&pool);
+	}
+
+	PublishPayload_t *Allocate(const char *text) {
+		size_t size = std::strlen(text) + 1;
+		PublishPayload_t *payload = PublishPayloadPool_Allocate(&pool, size);
+		std::memcpy(PublishPayload_Data(payload), text, size);
+		return payload;
+	}
+	struct Receiver {
+		Subscriber_t subscriber;
+		std::vector<const void *> received;
+		SubscriberReply reply = SUBSCRIBER_ACK;
+		Receiver() {
+			Subscriber_Init(&subscriber, [](const PublishContent_t *publish, void *arg) {
+				Receiver *self = (Receiver *)arg;
+				self->received.push_back(PublishPayload_Data(publish->payload));
+				return self->reply;
+			}, this);
+		}
+	};
+};
+
+TEST_F(PublishPayloadTest, AllocateAndRelease) {
+	PublishPayload_t *payload = Allocate("payload");
+	ASSERT_NE(nullptr, payload);
+	EXPECT_EQ(8, PublishPayload_Size(payload));
+	EXPECT_STREQ("payload", (const char *)PublishPayload_Data(payload));
+	EXPECT_EQ(1, PublishPayloadPool_InUse(&pool));
+	PublishPayload_Release(payload);
+	EXPECT_EQ(0, PublishPayloadPool_InUse(&pool));
+}
+
+TEST_F(PublishPayloadTest, ReturnsToPoolOnLastRelease) {
+	PublishPayload_t *payload = PublishPayloadPool_Allocate(&pool, 100);
+	EXPECT_EQ(payload, PublishPayload_Retain(payload));
+	PublishPayload_Release(payload);
+	EXPECT_EQ(1, PublishPayloadPool_InUse(&pool));
+	PublishPayload_Release(payload);
+	EXPECT_EQ(0, PublishPayloadPool_InUse(&pool));
+	// 同じサイズクラスなら再利用される
+	PublishPayload_t *reused = PublishPayloadPool_Allocate(&pool, 128);
+	EXPECT_EQ(payload, reused);
+	EXPECT_EQ(128, PublishPayload_Size(reused));
+	PublishPayload_Release(reused);
+}
+
+TEST_F(PublishPayloadTest, LargePayload) {
+	PublishPayload_t *payload = PublishPayloadPool_Allocate(&pool, 1024 * 1024);
+	ASSERT_NE(nullptr, payload);
+	std::memset(PublishPayload_Data(payload), 0xA5, 1024 * 1024);
+	EXPECT_EQ(1024 * 1024, PublishPayload_Size(payload));
+	PublishPayload_Release(payload);
+}
+
+TEST_F(PublishPayloadTest, FanOutWithoutCopy) {
+	Receiver receiver1, receiver2;
+	Publisher_Subscribe(&publisher, &receiver1.subscriber, ATTR);
+	Publisher_Subscribe(&publisher, &receiver2.subscriber, ATTR);
+	PublishPayload_t *payload = Allocate("fan-out");
+	PublishContent_t content = { .message = 0, .attribute = ATTR, .payload = payload };
+	Publisher_Publish(&publisher, &content);
+	PublishPayload_Release(payload);
+	ASSERT_EQ(1, receiver1.received.size());
+	ASSERT_EQ(1, receiver2.received.size());
+	EXPECT_EQ(receiver1.received[0], receiver2.received[0]);
+	EXPECT_EQ(0, PublishPayloadPool_InUse(&pool));
+}
+
+TEST_F(PublishPayloadTest, HeldUntilLastAck) {
+	Receiver receiver1, receiver2;
+	receiver2.reply = SUBSCRIBER_NACK;
+	BrokerRetryPolicy_t policy = { .initialInterval = 60 * 1000, .maxInterval = 60 * 1000, .maxAttempts = 3 };
+	Publisher_SetRetryPolicy(&publisher, &policy);
+	Publisher_Subscribe(&publisher, &receiver1.subscriber, ATTR);
+	Publisher_Subscribe(&publisher, &receiver2.subscriber, ATTR);
+	PublishPayload_t *payload = Allocate("pending");
+	PublishContent_t content = { .message = 0, .attribute = ATTR, .payload = payload };
+	Publisher_Publish(&publisher, &content);
+	PublishPayload_Release(payload);
+	EXPECT_EQ(1, PublishPayloadPool_InUse(&pool));	// NACKしたサブスクライバーの分が残っている
+}
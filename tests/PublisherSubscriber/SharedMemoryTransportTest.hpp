@@ -0,0 +1,199 @@
+#pragma once
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+#include "PublisherSubscriber/SharedMemoryTransport.h"
+#include "PublisherSubscriber/Publisher.h"
+
+class SharedMemoryTransportTest : public::testing::Test {
+protected:
+	static constexpr PublishMessageAttribute ATTR = 1;
+	static constexpr size_t capacity = 8;
+	static constexpr size_t maxPayloadSize = 64;
+
+	std::string name = "/CUtilsTest_" + std::to_string(getpid());
+	SharedMemoryTransport_t creator;
+	SharedMemoryTransport_t opener;
+	PublishPayloadPool_t pool;
+	virtual void SetUp() {
+		ASSERT_EQ(0, SharedMemoryTransport_Create(&creator, name.c_str(), capacity, maxPayloadSize, 4));
+		ASSERT_EQ(0, SharedMemoryTransport_Open(&opener, name.c_str()));
+		PublishPayloadPool_Init(&pool);
+	}
+	virtual void TearDown() {
+		SharedMemoryTransport_Close(&opener);
+		SharedMemoryTransport_Close(&creator);
+		PublishPayloadPool_Destroy(&pool);
+	}
+
+	int Publish(PublishMessage message, const char *text = nullptr) {
+		PublishContent_t content = { .message = message, .attribute = ATTR, .payload = nullptr };
+		if (text) {
+			content.payload = PublishPayloadPool_Allocate(&pool, std::strlen(text) + 1);
+			std::memcpy(PublishPayload_Data(content.payload), text, std::strlen(text) + 1);
+		}
+		int ret = SharedMemoryTransport_Publish(&creator, &content);
+		PublishPayload_Release(content.payload);
+		return ret;
+	}
+};
+
+TEST_F(SharedMemoryTransportTest, PublishAndReceive) {
+	SubscriptionAccountId id = SharedMemoryTransport_Subscribe(&opener);
+	ASSERT_NE(-1, id);
+	ASSERT_EQ(0, Publish(1, "hello"));
+	PublishContent_t content;
+	char buffer[maxPayloadSize];
+	ASSERT_EQ(6, SharedMemoryTransport_Receive(&opener, id, &content, buffer, sizeof(buffer), 0));
+	EXPECT_EQ(1, content.message);
+	EXPECT_EQ(ATTR, content.attribute);
+	EXPECT_STREQ("hello", buffer);
+	EXPECT_EQ(-EAGAIN, SharedMemoryTransport_Receive(&opener, id, &content, buffer, sizeof(buffer), 0));
+}
+
+TEST_F(SharedMemoryTransportTest, OpenWhileCreating) {
+	// 大きさを決めた後、初期化し終えるまでは作成中として開き直してもらう
+	std::string creating = name + "_creating";
+	int fd = shm_open(creating.c_str(), O_CREAT | O_RDWR, 0600);
+	ASSERT_LE(0, fd);
+	ASSERT_EQ(0, ftruncate(fd, 1 << 20));
+	SharedMemoryTransport_t transport;
+	EXPECT_EQ(-EAGAIN, SharedMemoryTransport_Open(&transport, creating.c_str()));
+
+	uint32_t garbage = 0x12345678;
+	ASSERT_EQ((ssize_t)sizeof(garbage), pwrite(fd, &garbage, sizeof(garbage), 0));
+	EXPECT_EQ(-EPROTO, SharedMemoryTransport_Open(&transport, creating.c_str()));
+	close(fd);
+	shm_unlink(creating.c_str());
+}
+
+TEST_F(SharedMemoryTransportTest, EverySubscriberReceives) {
+	SubscriptionAccountId id1 = SharedMemoryTransport_Subscribe(&opener);
+	SubscriptionAccountId id2 = SharedMemoryTransport_Subscribe(&creator);
+	ASSERT_NE(id1, id2);
+	ASSERT_EQ(0, Publish(1));
+	ASSERT_EQ(0, Publish(2));
+	PublishContent_t content;
+	for (SubscriptionAccountId id : { id1, id2 }) {
+		ASSERT_EQ(0, SharedMemoryTransport_Receive(&opener, id, &content, nullptr, 0, 0));
+		EXPECT_EQ(1, content.message);
+		ASSERT_EQ(0, SharedMemoryTransport_Receive(&opener, id, &content, nullptr, 0, 0));
+		EXPECT_EQ(2, content.message);
+	}
+}
+
+TEST_F(SharedMemoryTransportTest, SlowestSubscriberLimitsPublish) {
+	SubscriptionAccountId id = SharedMemoryTransport_Subscribe(&opener);
+	for (size_t i = 0; i < capacity; i++) {
+		ASSERT_EQ(0, Publish(i));
+	}
+	EXPECT_EQ(-EAGAIN, Publish(capacity));
+	PublishContent_t content;
+	ASSERT_EQ(0, SharedMemoryTransport_Receive(&opener, id, &content, nullptr, 0, 0));
+	EXPECT_EQ(0, Publish(capacity));
+	SharedMemoryTransport_Unsubscribe(&opener, id);
+	EXPECT_EQ(0, Publish(capacity + 1));
+}
+
+TEST_F(SharedMemoryTransportTest, PublisherReportsTransportFailure) {
+	Publisher_t publisher;
+	Publisher_Init(&publisher, 4);
+	Publisher_AttachTransport(&publisher, &creator);
+	SubscriptionAccountId id = SharedMemoryTransport_Subscribe(&opener);
+	PublishContent_t content = { .message = 1, .attribute = ATTR, .payload = nullptr };
+	for (size_t i = 0; i < capacity; i++) {
+		ASSERT_EQ(0, Publisher_Publish(&publisher, &content));
+	}
+	EXPECT_EQ(-EAGAIN, Publisher_Publish(&publisher, &content));
+	SharedMemoryTransport_Unsubscribe(&opener, id);
+	EXPECT_EQ(0, Publisher_Publish(&publisher, &content));
+	Publisher_Destroy(&publisher);
+}
+
+TEST_F(SharedMemoryTransportTest, PayloadTooLarge) {
+	std::string text(maxPayloadSize, 'x');
+	EXPECT_EQ(-EMSGSIZE, Publish(1, text.c_str()));
+	SubscriptionAccountId id = SharedMemoryTransport_Subscribe(&opener);
+	ASSERT_EQ(0, Publish(1, "hello"));
+	PublishContent_t content;
+	char small[2];
+	EXPECT_EQ(-EMSGSIZE, SharedMemoryTransport_Receive(&opener, id, &content, small, sizeof(small), 0));
+	char buffer[maxPayloadSize];
+	EXPECT_EQ(6, SharedMemoryTransport_Receive(&opener, id, &content, buffer, sizeof(buffer), 0));
+}
+
+TEST_F(SharedMemoryTransportTest, WaitForPublish) {
+	SubscriptionAccountId id = SharedMemoryTransport_Subscribe(&opener);
+	std::thread publisher([this] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		Publish(7);
+	});
+	PublishContent_t content;
+	EXPECT_EQ(0, SharedMemoryTransport_Receive(&opener, id, &content, nullptr, 0, 1000));
+	EXPECT_EQ(7, content.message);
+	publisher.join();
+	EXPECT_EQ(-EAGAIN, SharedMemoryTransport_Receive(&opener, id, &content, nullptr, 0, 10));
+}
+
+TEST_F(SharedMemoryTransportTest, AcrossProcesses) {
+	SubscriptionAccountId id = SharedMemoryTransport_Subscribe(&opener);
+	constexpr int numMessages = 100;
+	pid_t child = fork();
+	ASSERT_NE(-1, child);
+	if (child == 0) {
+		SharedMemoryTransport_t transport;
+		if (SharedMemoryTransport_Open(&transport, name.c_str()) != 0) {
+			_exit(1);
+		}
+		for (int i = 0; i < numMessages; i++) {
+			PublishContent_t content = { .message = (PublishMessage)i, .attribute = ATTR, .payload = nullptr };
+			while (SharedMemoryTransport_Publish(&transport, &content) == -EAGAIN) {
+				usleep(100);
+			}
+		}
+		SharedMemoryTransport_Close(&transport);
+		_exit(0);
+	}
+	for (int i = 0; i < numMessages; i++) {
+		PublishContent_t content;
+		ASSERT_EQ(0, SharedMemoryTransport_Receive(&opener, id, &content, nullptr, 0, 1000));
+		EXPECT_EQ(i, content.message);
+	}
+	int status;
+	waitpid(child, &status, 0);
+	EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+TEST_F(SharedMemoryTransportTest, DispatchToBroker) {
+	Publisher_t local;
+	Publisher_Init(&local, 4);
+	std::string received;
+	Subscriber_t subscriber;
+	Subscriber_Init(&subscriber, [](const PublishContent_t *publish, void *arg) {
+		*(std::string *)arg = (const char *)PublishPayload_Data(publish->payload);
+		return SUBSCRIBER_ACK;
+	}, &received);
+	Publisher_Subscribe(&local, &subscriber, ATTR);
+
+	Publisher_t remote;
+	Publisher_Init(&remote, 4);
+	Publisher_AttachTransport(&remote, &creator);
+	SubscriptionAccountId id = SharedMemoryTransport_Subscribe(&opener);
+	PublishContent_t content = { .message = 1, .attribute = ATTR, .payload = PublishPayloadPool_Allocate(&pool, 6) };
+	std::memcpy(PublishPayload_Data(content.payload), "hello", 6);
+	Publisher_Publish(&remote, &content);
+	PublishPayload_Release(content.payload);
+
+	ASSERT_EQ(0, SharedMemoryTransport_Dispatch(&opener, id, &local.broker, &pool, 0));
+	EXPECT_EQ("hello", received);
+	EXPECT_EQ(0, PublishPayloadPool_InUse(&pool));
+	Publisher_Destroy(&remote);
+	Publisher_Destroy(&local);
+}
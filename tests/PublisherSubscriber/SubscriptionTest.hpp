@@ -126,7 +126,46 @@ TEST_F(SubscriptionTest, count) {
 	EXPECT_EQ(2, Count());
 }
 
+TEST_F(SubscriptionTest, ReuseCancelledAccount) {
+	Subscriber_t user1, user2, user3, user4, user5;
+	Contract(&user1, attr1);
+	SubscriptionAccountId user2Id = Contract(&user2, attr1);
+	Contract(&user3, attr1);
+	Contract(&user4, attr1);
+	Cancellation(user2Id);
+	EXPECT_EQ(3, Count());
+	EXPECT_EQ(user2Id, Contract(&user5, attr2));
+	EXPECT_EQ(4, Count());
+}
 
+TEST_F(SubscriptionTest, NextMatch) {
+	Subscriber_t user1, user2, user3;
+	SubscriptionAccountId user1Id = Contract(&user1, attr1);
+	Contract(&user2, attr2);
+	SubscriptionAccountId user3Id = Contract(&user3, attr1);
+	SubscriptionAccountId cursor = 0;
+	SubscriptionAccount_t *account = Subscription_NextMatch(&subscription, attr1, &cursor);
+	ASSERT_NE(nullptr, account);
+	EXPECT_EQ(user1Id, account->id);
+	account = Subscription_NextMatch(&subscription, attr1, &cursor);
+	ASSERT_NE(nullptr, account);
+	EXPECT_EQ(user3Id, account->id);
+	EXPECT_EQ(nullptr, Subscription_NextMatch(&subscription, attr1, &cursor));
+}
 
-
+TEST(SubscriptionGrowTest, BeyondInitialCapacity) {
+	constexpr size_t numAccounts = 1000;
+	Subscription_t subscription;
+	Subscription_Init(&subscription, numAccounts);
+	Subscriber_t user = {};
+	for (size_t i = 0; i < numAccounts; i++) {
+		ASSERT_EQ((SubscriptionAccountId)i, Subscription_Contract(&subscription, &user, (PublishMessageAttribute)(i % 2)));
+	}
+	EXPECT_EQ(-1, Subscription_Contract(&subscription, &user, 0));
+	EXPECT_EQ(numAccounts, Subscription_Count(&subscription));
+	SubscriptionAccount_t *account = Subscription_GetAccount(&subscription, numAccounts - 1);
+	ASSERT_NE(nullptr, account);
+	EXPECT_EQ(1, account->interestedPublish);
+	Subscription_Destroy(&subscription);
+}
 
@@ -1,4 +1,5 @@
 #include "SubscriptionTest.hpp"
 #include "MessageStorageTest.hpp"
 #include "PubSubTest.hpp"
-
+#include "PublishPayloadTest.hpp"
+#include "SharedMemoryTransportTest.hpp"
@@ -99,3 +99,17 @@ TEST_F(ThreadPoolTest, HeavyProcessing) {
 }
 
 
+
+TEST_F(ThreadPoolTest, IsWorker) {
+	ThreadPoolTask_t task;
+	static bool isWorker = false;
+	task.function = [](void *arg) {
+		isWorker = ThreadPool_IsWorker((ThreadPool_t *)arg);
+		};
+	task.arg = &pool;
+	EXPECT_FALSE(ThreadPool_IsWorker(&pool));
+	Push(&task);
+	Destroy(true);
+
+	EXPECT_EQ(true, isWorker);
+}